@@ -60,200 +60,366 @@
  */
 
 #include "sid.h"
+#include "c64.h"
 
 #include <stdint.h>
 #include <string.h>
 #include <stdlib.h>
 
 #include "mos6510.h"
+#include "c64_scan.h"
+#include "c64_jit.h"
+#include "c64_aot.h"
 
 static struct mos6510 cpu;
 
 static uint8_t bval;
 static uint16_t wval;
 
+/*
+ * N, Z, C and V are not kept in cpu.p, most results are overwritten before
+ * anything looks at them. Instead the last result is kept and the flags are
+ * only worked out when a branch, PHP or a snapshot needs them. flag_nz holds
+ * the result that set N and Z, the shift instructions store it unmasked so Z
+ * is only set when bit 8 is clear too, like setflags() used to do.
+ */
+static uint16_t flag_nz;
+static uint8_t flag_n;    /* N is bit 7 */
+static uint8_t flag_c;    /* 0 or 1 */
+static uint8_t flag_v;    /* 0 or 1 */
+
+#define SET_NZ(val) (flag_nz = flag_n = (val))
+
 static uint8_t memory[65536];
 
+static uint32_t instructions;
+static uint32_t cycles;
+
+/* One bit per 256 byte page written by the CPU since the last clear */
+static uint32_t dirty_pages[8];
+
+/*
+ * Calls to core_entry run on the predecoded core while the scan allows it.
+ * Loading memory in bulk makes the scan stale, it is redone on the next call
+ * to core_entry.
+ */
+static enum c64_core core;
+static uint16_t core_entry;
+static bool core_stale;
+static struct c64_scan scan;
+
+/*
+ * Routines translated ahead of time, see c64_aot.h. The one for core_entry
+ * is looked up with the scan, others on every call.
+ */
+static const struct c64_aot_routine* aot_routines;
+static uint8_t aot_n_routines;
+static const struct c64_aot_routine* aot_play;
+static const struct c64_aot_routine* aot_running;
+static bool aot_left;
+
+#ifdef C64_JIT
+static bool jit;
+#endif
+
+static void invalidate_scan(void)
+{
+  if (core_entry) {
+    core = C64_CORE_GENERIC;
+    core_stale = true;
+  }
+}
+
+/* Memory changed in bulk, addr to addr + size */
+static void invalidate_code(uint16_t addr, uint32_t size)
+{
+  invalidate_scan();
+
+#ifdef C64_JIT
+  if (jit) {
+    c64_jit_invalidate(addr, size);
+  }
+#else
+  (void)addr;
+  (void)size;
+#endif
+}
+
 uint8_t c64_getmem(uint16_t addr)
 {
     return memory[addr];
 }
 
+/*
+ * A background context runs on the generic core with ACCESS_SPARSE, its
+ * accesses go through the page map of the context instead of memory. The
+ * flag is a constant in every caller, so the live machine does not pay for
+ * the check.
+ */
+#define ACCESS_SPARSE 0x40
+
+static struct c64_context* ctx;
+
+static uint8_t sparse_read(uint16_t addr)
+{
+  uint8_t slot = ctx->page_slot[addr >> 8];
+
+  if ((addr & 0xfc00) == 0xd400 || slot == C64_CONTEXT_NO_PAGE)
+    return 0;
+
+  return ctx->pages[slot][addr & 0xff];
+}
+
+static void sparse_write(uint16_t addr, uint8_t val)
+{
+  uint8_t page = addr >> 8;
+
+  if ((addr & 0xfc00) == 0xd400) {
+    ctx->regs[addr & 0x1f] = val;
+
+    if (ctx->log) {
+      if (ctx->n_log < ctx->log_max) {
+        ctx->log[ctx->n_log].reg = addr & 0x1f;
+        ctx->log[ctx->n_log].val = val;
+        ctx->n_log++;
+      } else {
+        ctx->log_lost++;
+      }
+    }
+    return;
+  }
+
+  if (ctx->page_slot[page] == C64_CONTEXT_NO_PAGE) {
+    if (ctx->n_pages == ctx->max_pages) {
+      ctx->full = true;
+      return;
+    }
+
+    memset(ctx->pages[ctx->n_pages], 0, 256);
+    ctx->page_slot[page] = ctx->n_pages++;
+  }
+
+  ctx->pages[ctx->page_slot[page]][addr & 0xff] = val;
+  ctx->dirty[page >> 5] |= 1U << (page & 31);
+}
+
+static inline uint8_t read_byte(uint16_t addr, uint8_t access)
+{
+  if (access & ACCESS_SPARSE)
+    return sparse_read(addr);
+
+  return memory[addr];
+}
+
+/* Data reads through modes that can reach the I/O area */
+static inline uint8_t getmem_io(uint16_t addr)
+{
+  if ((addr & 0xfc00) == 0xd400) {
+    return sid_peek(addr & 0x1f);
+  }
+
+  return memory[addr];
+}
+
+static inline void mark_dirty(uint16_t addr)
+{
+  dirty_pages[addr >> 13] |= 1U << ((addr >> 8) & 31);
+}
+
 void c64_setmem(uint16_t addr, uint8_t value)
 {
   if ((addr & 0xfc00) == 0xd400) {
     sid_poke(addr & 0x1f, value);
   } else {
     memory[addr] = value;
+    mark_dirty(addr);
+
+#ifdef C64_JIT
+    if (jit) {
+      c64_jit_write(addr);
+    }
+#endif
   }
 }
 
-static uint8_t getaddr(uint8_t mode)
+bool c64_page_dirty(uint8_t page)
+{
+  return (dirty_pages[page >> 5] >> (page & 31)) & 1;
+}
+
+void c64_get_dirty(uint32_t dirty[8])
+{
+  memcpy(dirty, dirty_pages, sizeof(dirty_pages));
+}
+
+void c64_set_dirty(const uint32_t dirty[8])
+{
+  memcpy(dirty_pages, dirty, sizeof(dirty_pages));
+}
+
+/*
+ * Effective address of the operand for the generic core, the operand bytes
+ * are read from memory and pc is moved past them. Branches, jumps and calls
+ * get their target.
+ */
+static inline uint16_t fetch_ea(uint8_t mode, uint8_t access)
 {
   uint16_t ad,ad2;
 
   switch(mode) {
-    case MOS6510_MODE_IMP:
-        return 0;
-
     case MOS6510_MODE_IMM:
-        return c64_getmem(cpu.pc++);
+        return cpu.pc++;
 
     case MOS6510_MODE_ABS:
-        ad = c64_getmem(cpu.pc++);
-        ad |= 256 * c64_getmem(cpu.pc++);
-        return c64_getmem(ad);
+        ad = read_byte(cpu.pc++, access);
+        ad |= 256 * read_byte(cpu.pc++, access);
+        return ad;
 
     case MOS6510_MODE_ABSX:
-        ad = c64_getmem(cpu.pc++);
-        ad |= 256*c64_getmem(cpu.pc++);
+        ad = read_byte(cpu.pc++, access);
+        ad |= 256 * read_byte(cpu.pc++, access);
         ad2 = ad + cpu.x;
-        return c64_getmem(ad2);
+        return ad2;
 
     case MOS6510_MODE_ABSY:
-        ad = c64_getmem(cpu.pc++);
-        ad |= 256 * c64_getmem(cpu.pc++);
+        ad = read_byte(cpu.pc++, access);
+        ad |= 256 * read_byte(cpu.pc++, access);
         ad2 = ad + cpu.y;
-        return c64_getmem(ad2);
+        return ad2;
 
     case MOS6510_MODE_ZP:
-        ad = c64_getmem(cpu.pc++);
-        return c64_getmem(ad);
+        return read_byte(cpu.pc++, access);
 
     case MOS6510_MODE_ZPX:
-        ad = c64_getmem(cpu.pc++);
+        ad = read_byte(cpu.pc++, access);
         ad += cpu.x;
-        return c64_getmem(ad & 0xff);
+        return ad & 0xff;
 
     case MOS6510_MODE_ZPY:
-        ad = c64_getmem(cpu.pc++);
+        ad = read_byte(cpu.pc++, access);
         ad += cpu.y;
-        return c64_getmem(ad & 0xff);
+        return ad & 0xff;
 
     case MOS6510_MODE_INDX:
-        ad = c64_getmem(cpu.pc++);
+        ad = read_byte(cpu.pc++, access);
         ad += cpu.x;
-        ad2 = c64_getmem(ad&0xff);
+        ad2 = read_byte(ad & 0xff, access);
         ad++;
-        ad2 |= c64_getmem(ad & 0xff) << 8;
-        return c64_getmem(ad2);
+        ad2 |= read_byte(ad & 0xff, access) << 8;
+        return ad2;
 
     case MOS6510_MODE_INDY:
-        ad = c64_getmem(cpu.pc++);
-        ad2 = c64_getmem(ad);
-        ad2 |= c64_getmem((ad+1) & 0xff) << 8;
-        ad = ad2 + cpu.y;
-        return c64_getmem(ad);
-
-    case MOS6510_MODE_ACC:
-        return cpu.a;
+        ad = read_byte(cpu.pc++, access);
+        ad2 = read_byte(ad, access);
+        ad2 |= read_byte((ad + 1) & 0xff, access) << 8;
+        return ad2 + cpu.y;
+
+    case MOS6510_MODE_REL:
+        ad = (int8_t)read_byte(cpu.pc++, access);
+        return cpu.pc + ad;
+
+    case MOS6510_MODE_IND:
+        ad = read_byte(cpu.pc++, access);
+        ad |= 256 * read_byte(cpu.pc++, access);
+        ad2 = read_byte(ad, access);
+        ad2 |= 256 * read_byte(ad + 1, access);
+        return ad2;
   }
 
   return 0;
 }
 
-static void setaddr(uint8_t mode, uint8_t val)
+/* Same for the predecoded core, arg is the operand decoded by the scan */
+static inline uint16_t resolve_ea(uint8_t mode, uint16_t arg)
 {
   uint16_t ad,ad2;
 
-  switch(mode)
-  {
-    case MOS6510_MODE_ABS:
-      ad = c64_getmem(cpu.pc - 2);
-      ad |= 256 * c64_getmem(cpu.pc - 1);
-      c64_setmem(ad, val);
-      return;
-
+  switch(mode) {
     case MOS6510_MODE_ABSX:
-      ad = c64_getmem(cpu.pc-2);
-      ad |= 256 * c64_getmem(cpu.pc - 1);
-      ad2 = ad + cpu.x;
-      c64_setmem(ad2, val);
-      return;
+        return arg + cpu.x;
 
-    case MOS6510_MODE_ZP:
-      ad = c64_getmem(cpu.pc - 1);
-      c64_setmem(ad, val);
-      return;
+    case MOS6510_MODE_ABSY:
+        return arg + cpu.y;
 
     case MOS6510_MODE_ZPX:
-      ad = c64_getmem(cpu.pc - 1);
-      ad += cpu.x;
-      c64_setmem(ad & 0xff, val);
-      return;
+        return (arg + cpu.x) & 0xff;
 
-    case MOS6510_MODE_ACC:
-      cpu.a = val;
-      return;
+    case MOS6510_MODE_ZPY:
+        return (arg + cpu.y) & 0xff;
+
+    case MOS6510_MODE_INDX:
+        ad = arg + cpu.x;
+        ad2 = memory[ad & 0xff];
+        ad2 |= memory[(ad + 1) & 0xff] << 8;
+        return ad2;
 
+    case MOS6510_MODE_INDY:
+        ad2 = memory[arg];
+        ad2 |= memory[(arg + 1) & 0xff] << 8;
+        return ad2 + cpu.y;
+
+    case MOS6510_MODE_IND:
+        ad2 = memory[arg];
+        ad2 |= memory[(uint16_t)(arg + 1)] << 8;
+        return ad2;
   }
+
+  return arg;
 }
 
+/*
+ * Operand reads and writes. access holds the C64_SCAN_RAM or C64_SCAN_IO
+ * flag when the scan proved where the operand is, ACCESS_GUARD for the
+ * predecoded core when it did not. Zero page and immediate operands never
+ * reach the I/O area, checking them costs less than telling them apart.
+ */
+#define ACCESS_GUARD 0x80
 
-static void putaddr(uint8_t mode, uint8_t val)
+static inline uint8_t load(uint8_t mode, uint16_t ea, uint8_t access)
 {
-  uint16_t ad,ad2;
+  if (access & C64_SCAN_RAM)
+    return memory[ea];
 
-  switch(mode)
-  {
-    case MOS6510_MODE_ABS:
-      ad = c64_getmem(cpu.pc++);
-      ad |= c64_getmem(cpu.pc++) << 8;
-      c64_setmem(ad, val);
-      return;
+  if (access & C64_SCAN_IO)
+    return sid_peek(ea & 0x1f);
 
-    case MOS6510_MODE_ABSX:
-      ad = c64_getmem(cpu.pc++);
-      ad |= c64_getmem(cpu.pc++) << 8;
-      ad2 = ad+cpu.x;
-      c64_setmem(ad2, val);
-      return;
-
-    case MOS6510_MODE_ABSY:
-      ad = c64_getmem(cpu.pc++);
-      ad |= c64_getmem(cpu.pc++) << 8;
-      ad2 = ad + cpu.y;
-      c64_setmem(ad2, val);
-      return;
+  if (mode == MOS6510_MODE_ACC)
+    return cpu.a;
 
-    case MOS6510_MODE_ZP:
-      ad = c64_getmem(cpu.pc++);
-      c64_setmem(ad, val);
-      return;
+  if (access & ACCESS_SPARSE)
+    return sparse_read(ea);
 
-    case MOS6510_MODE_ZPX:
-      ad = c64_getmem(cpu.pc++);
-      ad += cpu.x;
-      c64_setmem(ad & 0xff, val);
-      return;
-
-    case MOS6510_MODE_ZPY:
-      ad = c64_getmem(cpu.pc++);
-      ad += cpu.y;
-      c64_setmem(ad & 0xff, val);
-      return;
+  return getmem_io(ea);
+}
 
-    case MOS6510_MODE_INDX:
-      ad = c64_getmem(cpu.pc++);
-      ad += cpu.x;
-      ad2 = c64_getmem(ad & 0xff);
-      ad++;
-      ad2 |= c64_getmem(ad & 0xff) << 8;
-      c64_setmem(ad2, val);
-      return;
+/* A store the scan could not place, stop predecoding when it hits code */
+static void store_guarded(uint16_t addr, uint8_t val)
+{
+  uint16_t offset = addr - scan.base;
 
-    case MOS6510_MODE_INDY:
-      ad = c64_getmem(cpu.pc++);
-      ad2 = c64_getmem(ad);
-      ad2 |= c64_getmem((ad + 1) & 0xff) << 8;
-      ad = ad2 + cpu.y;
-      c64_setmem(ad, val);
-      return;
+  c64_setmem(addr, val);
 
-    case MOS6510_MODE_ACC:
-      cpu.a = val;
-      return;
+  if (offset < scan.span &&
+      (C64_SCAN_FLAGS(scan.entry[offset]) & (C64_SCAN_START | C64_SCAN_CODE))) {
+    core = C64_CORE_GENERIC;
+  }
+}
 
+static inline void store(uint8_t mode, uint16_t ea, uint8_t val, uint8_t access)
+{
+  if (access & C64_SCAN_RAM) {
+    memory[ea] = val;
+    mark_dirty(ea);
+  } else if (access & C64_SCAN_IO) {
+    sid_poke(ea & 0x1f, val);
+  } else if (mode == MOS6510_MODE_ACC) {
+    cpu.a = val;
+  } else if (access & ACCESS_SPARSE) {
+    sparse_write(ea, val);
+  } else if (access & ACCESS_GUARD) {
+    store_guarded(ea, val);
+  } else {
+    c64_setmem(ea, val);
   }
 }
 
@@ -266,35 +432,47 @@ static void setflags(uint8_t flag, int cond)
   }
 }
 
-static void push(uint8_t val)
+static uint8_t get_p(void)
+{
+  uint8_t p = cpu.p & ~(MOS6510_FLAG_N | MOS6510_FLAG_V | MOS6510_FLAG_Z | MOS6510_FLAG_C);
+
+  p |= flag_n & MOS6510_FLAG_N;
+  p |= flag_v ? MOS6510_FLAG_V : 0;
+  p |= flag_nz ? 0 : MOS6510_FLAG_Z;
+  p |= flag_c;
+
+  return p;
+}
+
+static void set_p(uint8_t p)
 {
-  c64_setmem(0x100 + cpu.s, val);
+  cpu.p = p;
+  flag_n = p;
+  flag_nz = !(p & MOS6510_FLAG_Z);
+  flag_c = p & MOS6510_FLAG_C;
+  flag_v = !!(p & MOS6510_FLAG_V);
+}
+
+static inline void push(uint8_t val, uint8_t access)
+{
+  if (access & ACCESS_SPARSE) {
+    sparse_write(0x100 + cpu.s, val);
+  } else {
+    c64_setmem(0x100 + cpu.s, val);
+  }
 
   if (cpu.s) {
     cpu.s--;
   }
 }
 
-static uint8_t pop(void)
+static inline uint8_t pop(uint8_t access)
 {
   if (cpu.s < 0xff) {
     cpu.s++;
   }
 
-  return c64_getmem(0x100 + cpu.s);
-}
-
-static void branch(uint8_t flag)
-{
-    int8_t dist;
-
-    dist = (int8_t)getaddr(MOS6510_MODE_IMM);
-
-    wval = cpu.pc + dist;
-
-    if (flag) {
-      cpu.pc = wval;
-    }
+  return read_byte(0x100 + cpu.s, access);
 }
 
 void c64_cpu_reset(void)
@@ -302,7 +480,7 @@ void c64_cpu_reset(void)
   cpu.a = 0x00;
   cpu.x = 0x00;
   cpu.y = 0x00;
-  cpu.p = 0x00;
+  set_p(0x00);
   cpu.s = 0xff;
   cpu.pc = 0xfffc;
 }
@@ -312,83 +490,96 @@ void c64_cpu_reset_to(uint16_t new_pc, uint8_t new_a)
   cpu.a = new_a;
   cpu.x = 0x00;
   cpu.y = 0x00;
-  cpu.p = 0x00;
+  set_p(0x00);
   cpu.s = 0xff;
   cpu.pc = new_pc;
 }
 
-static void c64_cpu_step(void)
+/* A taken branch costs one cycle more */
+static inline void taken_branch(uint16_t ea)
 {
-  int c;
+  cpu.pc = ea;
+  cycles++;
+}
 
-  uint8_t opc = c64_getmem(cpu.pc++);
-  uint8_t cmd = mos6510_opcode_table[opc].type;
-  uint8_t addr = mos6510_opcode_table[opc].mode;
+/*
+ * Runs one instruction with its operand already resolved, shared by both
+ * cores. Inlined into each so the access checks fold away where possible.
+ */
+static inline __attribute__((always_inline))
+void execute(uint8_t cmd, uint8_t mode, uint16_t ea, uint8_t access)
+{
+  int c;
 
   switch (cmd)
   {
     case MOS6510_TYPE_ADC:
-        wval = (uint16_t)cpu.a + getaddr(addr) + ((cpu.p & MOS6510_FLAG_C) ? 1 : 0);
-        setflags(MOS6510_FLAG_C, wval & 0x100);
+        wval = (uint16_t)cpu.a + load(mode, ea, access) + flag_c;
+        flag_c = wval >> 8;
         cpu.a = (uint8_t)wval;
-        setflags(MOS6510_FLAG_Z, !cpu.a);
-        setflags(MOS6510_FLAG_N, cpu.a & 0x80);
-        setflags(MOS6510_FLAG_V, (!!(cpu.p & MOS6510_FLAG_C)) ^ (!!(cpu.p & MOS6510_FLAG_N)));
+        SET_NZ(cpu.a);
+        flag_v = flag_c ^ (cpu.a >> 7);
         break;
 
     case MOS6510_TYPE_AND:
-        bval = getaddr(addr);
+        bval = load(mode, ea, access);
         cpu.a &= bval;
-        setflags(MOS6510_FLAG_Z, !cpu.a);
-        setflags(MOS6510_FLAG_N, cpu.a & 0x80);
+        SET_NZ(cpu.a);
         break;
 
     case MOS6510_TYPE_ASL:
-        wval = getaddr(addr);
+        wval = load(mode, ea, access);
         wval <<= 1;
-        setaddr(addr,(uint8_t)wval);
-        setflags(MOS6510_FLAG_Z, !wval);
-        setflags(MOS6510_FLAG_N, wval & 0x80);
-        setflags(MOS6510_FLAG_C, wval & 0x100);
+        store(mode, ea, (uint8_t)wval, access);
+        SET_NZ(wval);
+        flag_c = wval >> 8;
         break;
 
     case MOS6510_TYPE_BCC:
-        branch(!(cpu.p & MOS6510_FLAG_C));
+        if (!flag_c)
+          taken_branch(ea);
         break;
 
     case MOS6510_TYPE_BCS:
-        branch(cpu.p & MOS6510_FLAG_C);
+        if (flag_c)
+          taken_branch(ea);
         break;
 
     case MOS6510_TYPE_BNE:
-        branch(!(cpu.p & MOS6510_FLAG_Z));
+        if (flag_nz != 0)
+          taken_branch(ea);
         break;
 
     case MOS6510_TYPE_BEQ:
-        branch(cpu.p & MOS6510_FLAG_Z);
+        if (flag_nz == 0)
+          taken_branch(ea);
         break;
 
     case MOS6510_TYPE_BPL:
-        branch(!(cpu.p & MOS6510_FLAG_N));
+        if (!(flag_n & 0x80))
+          taken_branch(ea);
         break;
 
     case MOS6510_TYPE_BMI:
-        branch(cpu.p & MOS6510_FLAG_N);
+        if (flag_n & 0x80)
+          taken_branch(ea);
         break;
 
     case MOS6510_TYPE_BVC:
-        branch(!(cpu.p & MOS6510_FLAG_V));
+        if (!flag_v)
+          taken_branch(ea);
         break;
 
     case MOS6510_TYPE_BVS:
-        branch(cpu.p & MOS6510_FLAG_V);
+        if (flag_v)
+          taken_branch(ea);
         break;
 
     case MOS6510_TYPE_BIT:
-        bval = getaddr(addr);
-        setflags(MOS6510_FLAG_Z, !(cpu.a & bval));
-        setflags(MOS6510_FLAG_N, bval & 0x80);
-        setflags(MOS6510_FLAG_V, bval & 0x40);
+        bval = load(mode, ea, access);
+        flag_nz = cpu.a & bval;
+        flag_n = bval;
+        flag_v = (bval >> 6) & 1;
         break;
 
     case MOS6510_TYPE_BRK:
@@ -396,7 +587,7 @@ static void c64_cpu_step(void)
         break;
 
     case MOS6510_TYPE_CLC:
-        setflags(MOS6510_FLAG_C, 0);
+        flag_c = 0;
         break;
 
     case MOS6510_TYPE_CLD:
@@ -408,198 +599,165 @@ static void c64_cpu_step(void)
         break;
 
     case MOS6510_TYPE_CLV:
-        setflags(MOS6510_FLAG_V, 0);
+        flag_v = 0;
         break;
 
     case MOS6510_TYPE_CMP:
-        bval = getaddr(addr);
+        bval = load(mode, ea, access);
         wval = (uint16_t)cpu.a - bval;
-        setflags(MOS6510_FLAG_Z, !wval);
-        setflags(MOS6510_FLAG_N, wval & 0x80);
-        setflags(MOS6510_FLAG_C, cpu.a >= bval);
+        SET_NZ(wval);
+        flag_c = cpu.a >= bval;
         break;
 
     case MOS6510_TYPE_CPX:
-        bval = getaddr(addr);
+        bval = load(mode, ea, access);
         wval = (uint16_t)cpu.x-bval;
-        setflags(MOS6510_FLAG_Z, !wval);
-        setflags(MOS6510_FLAG_N, wval & 0x80);
-        setflags(MOS6510_FLAG_C, cpu.x >= bval);
+        SET_NZ(wval);
+        flag_c = cpu.x >= bval;
         break;
 
     case MOS6510_TYPE_CPY:
-        bval = getaddr(addr);
+        bval = load(mode, ea, access);
         wval = (uint16_t)cpu.y - bval;
-        setflags(MOS6510_FLAG_Z, !wval);
-        setflags(MOS6510_FLAG_N, wval & 0x80);
-        setflags(MOS6510_FLAG_C, cpu.y >= bval);
+        SET_NZ(wval);
+        flag_c = cpu.y >= bval;
         break;
 
     case MOS6510_TYPE_DEC:
-        bval = getaddr(addr);
+        bval = load(mode, ea, access);
         bval--;
-        setaddr(addr, bval);
-        setflags(MOS6510_FLAG_Z, !bval);
-        setflags(MOS6510_FLAG_N, bval & 0x80);
+        store(mode, ea, bval, access);
+        SET_NZ(bval);
         break;
 
     case MOS6510_TYPE_DEX:
         cpu.x--;
-        setflags(MOS6510_FLAG_Z, !cpu.x);
-        setflags(MOS6510_FLAG_N, cpu.x & 0x80);
+        SET_NZ(cpu.x);
         break;
 
     case MOS6510_TYPE_DEY:
         cpu.y--;
-        setflags(MOS6510_FLAG_Z, !cpu.y);
-        setflags(MOS6510_FLAG_N, cpu.y & 0x80);
+        SET_NZ(cpu.y);
         break;
 
     case MOS6510_TYPE_EOR:
-        bval = getaddr(addr);
+        bval = load(mode, ea, access);
         cpu.a ^= bval;
-        setflags(MOS6510_FLAG_Z, !cpu.a);
-        setflags(MOS6510_FLAG_N, cpu.a & 0x80);
+        SET_NZ(cpu.a);
         break;
 
     case MOS6510_TYPE_INC:
-        bval = getaddr(addr);
+        bval = load(mode, ea, access);
         bval++;
-        setaddr(addr, bval);
-        setflags(MOS6510_FLAG_Z, !bval);
-        setflags(MOS6510_FLAG_N, bval & 0x80);
+        store(mode, ea, bval, access);
+        SET_NZ(bval);
         break;
 
     case MOS6510_TYPE_INX:
         cpu.x++;
-        setflags(MOS6510_FLAG_Z, !cpu.x);
-        setflags(MOS6510_FLAG_N, cpu.x & 0x80);
+        SET_NZ(cpu.x);
         break;
 
     case MOS6510_TYPE_INY:
         cpu.y++;
-        setflags(MOS6510_FLAG_Z, !cpu.y);
-        setflags(MOS6510_FLAG_N, cpu.y & 0x80);
+        SET_NZ(cpu.y);
         break;
 
     case MOS6510_TYPE_JMP:
-        wval = c64_getmem(cpu.pc++);
-        wval |= 256 * c64_getmem(cpu.pc++);
-        switch (addr)
-        {
-            case MOS6510_MODE_ABS:
-                cpu.pc = wval;
-                break;
-
-            case MOS6510_MODE_IND:
-                cpu.pc = c64_getmem(wval);
-                cpu.pc |= 256 * c64_getmem(wval + 1);
-                break;
-        }
+        cpu.pc = ea;
         break;
 
     case MOS6510_TYPE_JSR:
-        push((cpu.pc + 1) >> 8);
-        push((cpu.pc + 1));
-        wval = c64_getmem(cpu.pc++);
-        wval |= 256 * c64_getmem(cpu.pc++);
-        cpu.pc = wval;
+        push((cpu.pc - 1) >> 8, access);
+        push((cpu.pc - 1), access);
+        cpu.pc = ea;
         break;
 
     case MOS6510_TYPE_LDA:
-        cpu.a = getaddr(addr);
-        setflags(MOS6510_FLAG_Z, !cpu.a);
-        setflags(MOS6510_FLAG_N, cpu.a & 0x80);
+        cpu.a = load(mode, ea, access);
+        SET_NZ(cpu.a);
         break;
 
     case MOS6510_TYPE_LDX:
-        cpu.x = getaddr(addr);
-        setflags(MOS6510_FLAG_Z, !cpu.x);
-        setflags(MOS6510_FLAG_N, cpu.x & 0x80);
+        cpu.x = load(mode, ea, access);
+        SET_NZ(cpu.x);
         break;
 
     case MOS6510_TYPE_LDY:
-        cpu.y = getaddr(addr);
-        setflags(MOS6510_FLAG_Z, !cpu.y);
-        setflags(MOS6510_FLAG_N, cpu.y&0x80);
+        cpu.y = load(mode, ea, access);
+        SET_NZ(cpu.y);
         break;
 
     case MOS6510_TYPE_LSR:
-        bval = getaddr(addr);
+        bval = load(mode, ea, access);
         wval = (uint8_t)bval;
         wval >>= 1;
-        setaddr(addr, (uint8_t)wval);
-        setflags(MOS6510_FLAG_Z, !wval);
-        setflags(MOS6510_FLAG_N, wval & 0x80);
-        setflags(MOS6510_FLAG_C, bval & 1);
+        store(mode, ea, (uint8_t)wval, access);
+        SET_NZ(wval);
+        flag_c = bval & 1;
         break;
 
     case MOS6510_TYPE_NOP:
         break;
 
     case MOS6510_TYPE_ORA:
-        bval = getaddr(addr);
+        bval = load(mode, ea, access);
         cpu.a |= bval;
-        setflags(MOS6510_FLAG_Z, !cpu.a);
-        setflags(MOS6510_FLAG_N, cpu.a & 0x80);
+        SET_NZ(cpu.a);
         break;
 
     case MOS6510_TYPE_PHA:
-        push(cpu.a);
+        push(cpu.a, access);
         break;
     case MOS6510_TYPE_PHP:
-        push(cpu.p);
+        push(get_p(), access);
         break;
     case MOS6510_TYPE_PLA:
-        cpu.a=pop();
-        setflags(MOS6510_FLAG_Z,!cpu.a);
-        setflags(MOS6510_FLAG_N,cpu.a&0x80);
+        cpu.a=pop(access);
+        SET_NZ(cpu.a);
         break;
     case MOS6510_TYPE_PLP:
-        cpu.p=pop();
+        set_p(pop(access));
         break;
     case MOS6510_TYPE_ROL:
-        bval = getaddr(addr);
-        c = !!(cpu.p & MOS6510_FLAG_C);
-        setflags(MOS6510_FLAG_C, bval & 0x80);
+        bval = load(mode, ea, access);
+        c = flag_c;
+        flag_c = bval >> 7;
         bval <<= 1;
         bval |= c;
-        setaddr(addr, bval);
-        setflags(MOS6510_FLAG_N, bval & 0x80);
-        setflags(MOS6510_FLAG_Z,!bval);
+        store(mode, ea, bval, access);
+        SET_NZ(bval);
         break;
 
     case MOS6510_TYPE_ROR:
-        bval = getaddr(addr);
-        c = !!(cpu.p&MOS6510_FLAG_C);
-        setflags(MOS6510_FLAG_C, bval & 1);
+        bval = load(mode, ea, access);
+        c = flag_c;
+        flag_c = bval & 1;
         bval >>= 1;
         bval |= 128 * c;
-        setaddr(addr, bval);
-        setflags(MOS6510_FLAG_N, bval & 0x80);
-        setflags(MOS6510_FLAG_Z, !bval);
+        store(mode, ea, bval, access);
+        SET_NZ(bval);
         break;
 
     case MOS6510_TYPE_RTI:
         /* Treat RTI like RTS */
     case MOS6510_TYPE_RTS:
-        wval = pop();
-        wval |= pop() << 8;
+        wval = pop(access);
+        wval |= pop(access) << 8;
         cpu.pc = wval + 1;
         break;
 
     case MOS6510_TYPE_SBC:
-        bval = getaddr(addr) ^ 0xff;
-        wval=(uint16_t)cpu.a + bval + ((cpu.p & MOS6510_FLAG_C) ? 1 : 0);
-        setflags(MOS6510_FLAG_C, wval & 0x100);
+        bval = load(mode, ea, access) ^ 0xff;
+        wval=(uint16_t)cpu.a + bval + flag_c;
+        flag_c = wval >> 8;
         cpu.a = (uint8_t)wval;
-        setflags(MOS6510_FLAG_Z, !cpu.a);
-        setflags(MOS6510_FLAG_N, cpu.a > 127);
-        setflags(MOS6510_FLAG_V, (!!(cpu.p & MOS6510_FLAG_C)) ^ (!!(cpu.p & MOS6510_FLAG_N)));
+        SET_NZ(cpu.a);
+        flag_v = flag_c ^ (cpu.a >> 7);
         break;
 
     case MOS6510_TYPE_SEC:
-        setflags(MOS6510_FLAG_C, 1);
+        flag_c = 1;
         break;
 
     case MOS6510_TYPE_SED:
@@ -611,39 +769,35 @@ static void c64_cpu_step(void)
         break;
 
     case MOS6510_TYPE_STA:
-        putaddr(addr, cpu.a);
+        store(mode, ea, cpu.a, access);
         break;
 
     case MOS6510_TYPE_STX:
-        putaddr(addr, cpu.x);
+        store(mode, ea, cpu.x, access);
         break;
 
     case MOS6510_TYPE_STY:
-        putaddr(addr, cpu.y);
+        store(mode, ea, cpu.y, access);
         break;
 
     case MOS6510_TYPE_TAX:
         cpu.x = cpu.a;
-        setflags(MOS6510_FLAG_Z, !cpu.x);
-        setflags(MOS6510_FLAG_N, cpu.x & 0x80);
+        SET_NZ(cpu.x);
         break;
 
     case MOS6510_TYPE_TAY:
         cpu.y = cpu.a;
-        setflags(MOS6510_FLAG_Z, !cpu.y);
-        setflags(MOS6510_FLAG_N, cpu.y & 0x80);
+        SET_NZ(cpu.y);
         break;
 
     case MOS6510_TYPE_TSX:
         cpu.x = cpu.s;
-        setflags(MOS6510_FLAG_Z, !cpu.x);
-        setflags(MOS6510_FLAG_N, cpu.x & 0x80);
+        SET_NZ(cpu.x);
         break;
 
     case MOS6510_TYPE_TXA:
         cpu.a = cpu.x;
-        setflags(MOS6510_FLAG_Z, !cpu.a);
-        setflags(MOS6510_FLAG_N, cpu.a & 0x80);
+        SET_NZ(cpu.a);
         break;
 
     case MOS6510_TYPE_TXS:
@@ -652,45 +806,507 @@ static void c64_cpu_step(void)
 
     case MOS6510_TYPE_TYA:
         cpu.a = cpu.y;
-        setflags(MOS6510_FLAG_Z, !cpu.a);
-        setflags(MOS6510_FLAG_N, cpu.a & 0x80);
+        SET_NZ(cpu.a);
         break;
 
   }
 }
 
+static inline __attribute__((always_inline)) void step(uint8_t access)
+{
+  uint8_t opc = read_byte(cpu.pc++, access);
+  uint8_t cmd = mos6510_opcode_table[opc].type;
+  uint8_t addr = mos6510_opcode_table[opc].mode;
+  uint16_t ea = 0;
+
+  cycles += mos6510_cycle_table[opc];
+
+  /* The undocumented opcodes are skipped without their operands */
+  if (cmd < MOS6510_TYPE_XXX && cmd != MOS6510_TYPE_NOP) {
+    ea = fetch_ea(addr, access);
+  }
+
+  execute(cmd, addr, ea, access);
+}
+
+static void c64_cpu_step(void)
+{
+  step(0);
+}
+
+/* Falls back to the generic core at code the scan did not see */
+static void c64_cpu_step_predecoded(void)
+{
+  uint16_t offset = cpu.pc - scan.base;
+  uint32_t entry;
+  uint8_t flags;
+  uint8_t mode;
+  uint16_t ea;
+
+  if (offset >= scan.span ||
+      !((flags = C64_SCAN_FLAGS(entry = scan.entry[offset])) & C64_SCAN_START)) {
+    core = C64_CORE_GENERIC;
+    c64_cpu_step();
+    return;
+  }
+
+  if (flags & C64_SCAN_DIRECT) {
+    mode = MOS6510_MODE_IMP;
+    ea = C64_SCAN_ARG(entry);
+  } else {
+    mode = mos6510_opcode_table[memory[cpu.pc]].mode;
+    ea = resolve_ea(mode, C64_SCAN_ARG(entry));
+  }
+
+  cycles += mos6510_cycle_table[memory[cpu.pc]];
+  cpu.pc += flags & C64_SCAN_LEN;
+
+  execute(C64_SCAN_TYPE(entry), mode, ea,
+          (flags & (C64_SCAN_RAM | C64_SCAN_IO)) | ACCESS_GUARD);
+}
+
+/* Memory still holds the code the routine was made from */
+static bool aot_intact(const struct c64_aot_routine* r)
+{
+  for (uint16_t k = 0; k < r->n_ranges; k++) {
+    if (memcmp(&memory[r->ranges[k].addr], r->ranges[k].bytes, r->ranges[k].size) != 0)
+      return false;
+  }
+
+  return true;
+}
+
+static const struct c64_aot_routine* find_aot(uint16_t addr)
+{
+  for (uint8_t i = 0; i < aot_n_routines; i++) {
+    if (aot_routines[i].entry == addr && aot_intact(&aot_routines[i]))
+      return &aot_routines[i];
+  }
+
+  return NULL;
+}
+
+static bool run_aot(const struct c64_aot_routine* r)
+{
+  struct c64_aot_machine m = {
+    .memory = memory,
+    .dirty = dirty_pages,
+    .cycles = &cycles,
+    .instructions = &instructions,
+  };
+  bool intact;
+
+  cpu.p = get_p();
+  m.cpu = cpu;
+  aot_running = r;
+
+  intact = r->run(&m);
+
+  cpu = m.cpu;
+  set_p(cpu.p);
+
+  return intact;
+}
+
+bool c64_aot_write(uint16_t addr, uint8_t val)
+{
+  c64_setmem(addr, val);
+
+  for (uint16_t k = 0; k < aot_running->n_ranges; k++) {
+    if ((uint16_t)(addr - aot_running->ranges[k].addr) < aot_running->ranges[k].size)
+      return false;
+  }
+
+  return true;
+}
+
+static enum c64_core pick_core(void)
+{
+  enum c64_core picked = c64_scan_code(&scan, core_entry);
+
+  aot_play = find_aot(core_entry);
+
+  return aot_play ? C64_CORE_AOT : picked;
+}
+
 void c64_cpu_jsr(uint16_t new_pc, uint8_t new_a)
 {
   cpu.a = new_a;
   cpu.x = 0x00;
   cpu.y = 0x00;
-  cpu.p = 0x00;
+  set_p(0x00);
   cpu.s = 0xFF;
   cpu.pc = new_pc;
-  push(0);
-  push(0);
+  push(0, 0);
+  push(0, 0);
+
+  if (core_stale && new_pc == core_entry) {
+    core = pick_core();
+    core_stale = false;
+  }
+
+  /*
+   * Like the predecoded core a store into its code ends the translation. The
+   * interpreter does not look where it stores, after it took over the code
+   * is compared again.
+   */
+  if (core == C64_CORE_AOT && new_pc == core_entry && aot_left) {
+    aot_left = false;
+    if (!aot_intact(aot_play)) {
+      core = C64_CORE_GENERIC;
+    }
+  }
+
+  if (core == C64_CORE_AOT && new_pc == core_entry) {
+    if (!run_aot(aot_play)) {
+      core = C64_CORE_GENERIC;
+    }
+    aot_left = cpu.pc > 1;
+  } else if (aot_n_routines && new_pc != core_entry) {
+    const struct c64_aot_routine* r = find_aot(new_pc);
+
+    if (r) {
+      run_aot(r);
+    }
+  }
+
+  if (core == C64_CORE_PREDECODED && new_pc == core_entry) {
+    while (cpu.pc > 1 && core == C64_CORE_PREDECODED) {
+      c64_cpu_step_predecoded();
+      instructions++;
+    }
+  }
 
-  while (cpu.pc > 1)
+#ifdef C64_JIT
+  if (jit) {
+    while (cpu.pc > 1) {
+      cpu.p = get_p();
+      if (!c64_jit_run(&cpu)) {
+        set_p(cpu.p);
+        c64_cpu_step();
+        instructions++;
+      } else {
+        set_p(cpu.p);
+      }
+    }
+  }
+#endif
+
+  while (cpu.pc > 1) {
     c64_cpu_step();
+    instructions++;
+  }
+}
+
+#ifdef C64_JIT
+void c64_cpu_set_jit(bool on)
+{
+  jit = on;
+
+  /* Memory may have changed behind its back while it was off */
+  if (on) {
+    c64_jit_init(memory, dirty_pages, &cycles, &instructions);
+  }
+}
+#endif
+
+enum c64_core c64_cpu_optimize(uint16_t addr, struct c64_scan_info* info)
+{
+  core_entry = addr;
+  core_stale = false;
+  core = pick_core();
+
+  if (info) {
+    *info = scan.info;
+  }
+
+  return core;
+}
+
+void c64_set_aot(const struct c64_aot_routine* routines, uint8_t n)
+{
+  aot_routines = routines;
+  aot_n_routines = n;
+  invalidate_scan();
+}
+
+enum c64_core c64_cpu_get_core(void)
+{
+#ifdef C64_JIT
+  if (jit)
+    return C64_CORE_JIT;
+#endif
+
+  return core;
+}
+
+uint32_t c64_cpu_instructions(void)
+{
+  return instructions;
+}
+
+uint32_t c64_cpu_cycles(void)
+{
+  return cycles;
 }
 
 void c64_init()
 {
   memset(memory, 0, sizeof(memory));
+  memset(dirty_pages, 0, sizeof(dirty_pages));
+  instructions = 0;
+  cycles = 0;
+
+  core = C64_CORE_GENERIC;
+  core_entry = 0;
+  core_stale = false;
+
+#ifdef C64_JIT
+  if (jit) {
+    c64_jit_flush();
+  }
+#endif
 
   c64_cpu_reset();
 }
 
 void c64_memcpy(uint16_t dest, const uint8_t* src, uint32_t size)
 {
-  if (dest + size < 64*1024) {
+  if (dest + size <= 64*1024) {
     memcpy(&memory[dest], src, size);
+    invalidate_code(dest, size);
+  }
+}
+
+/*
+ * LZ4 block decoder writing straight into its destination. Matches copy from
+ * the bytes already written, so no buffer is needed. Overlapping matches are
+ * copied byte by byte, that is how LZ4 encodes runs.
+ */
+static bool lz4_decode(uint8_t* dest, uint32_t size, const uint8_t* src, size_t src_size)
+{
+  const uint8_t* end = src + src_size;
+  uint32_t out = 0;
+
+  while (src < end) {
+    uint8_t token = *src++;
+    uint32_t len = token >> 4;
+    uint16_t offset;
+    uint8_t b;
+
+    if (len == 15) {
+      do {
+        if (src == end)
+          return false;
+        b = *src++;
+        len += b;
+      } while (b == 255);
+    }
+
+    if (len > (uint32_t)(end - src) || len > size - out)
+      return false;
+
+    memcpy(&dest[out], src, len);
+    src += len;
+    out += len;
+
+    /* The last sequence has only literals */
+    if (src == end)
+      break;
+
+    if (end - src < 2)
+      return false;
+
+    offset = src[0] | (src[1] << 8);
+    src += 2;
+
+    if (offset == 0 || offset > out)
+      return false;
+
+    len = token & 15;
+    if (len == 15) {
+      do {
+        if (src == end)
+          return false;
+        b = *src++;
+        len += b;
+      } while (b == 255);
+    }
+    len += 4;
+
+    if (len > size - out)
+      return false;
+
+    while (len--) {
+      dest[out] = dest[out - offset];
+      out++;
+    }
+  }
+
+  return out == size;
+}
+
+bool c64_unpack_lz4(uint16_t dest, const uint8_t* src, size_t src_size, uint32_t size)
+{
+  if (dest + size > 64*1024)
+    return false;
+
+  invalidate_code(dest, size);
+
+  return lz4_decode(&memory[dest], size, src, src_size);
+}
+
+void c64_memread(uint8_t* dest, uint16_t src, uint32_t size)
+{
+  if (src + size <= 64*1024) {
+    memcpy(dest, &memory[src], size);
   }
 }
 
 void c64_memset(uint16_t dest, uint8_t val, uint32_t size)
 {
-  if (dest + size < 64*1024) {
+  if (dest + size <= 64*1024) {
     memset(&memory[dest], val, size);
+    invalidate_code(dest, size);
+  }
+}
+
+void c64_context_init(struct c64_context* c, uint8_t (*pool)[256], uint8_t max_pages)
+{
+  memset(c, 0, sizeof(*c));
+  memset(c->page_slot, C64_CONTEXT_NO_PAGE, sizeof(c->page_slot));
+
+  c->pages = pool;
+  c->max_pages = max_pages;
+}
+
+/* Fresh consecutive pages for dest to dest + size, so it can be filled linearly */
+static uint8_t* context_map(struct c64_context* c, uint16_t dest, uint32_t size)
+{
+  uint8_t first = dest >> 8;
+  uint32_t n = ((dest & 0xff) + size + 255) >> 8;
+  uint8_t* start;
+
+  if (dest + size > 64*1024 || c->n_pages + n > c->max_pages) {
+    c->full = true;
+    return NULL;
   }
+
+  for (uint32_t i = 0; i < n; i++) {
+    if (c->page_slot[first + i] != C64_CONTEXT_NO_PAGE)
+      return NULL;
+  }
+
+  for (uint32_t i = 0; i < n; i++) {
+    c->page_slot[first + i] = c->n_pages + i;
+    memset(c->pages[c->n_pages + i], 0, 256);
+  }
+
+  start = &c->pages[c->n_pages][dest & 0xff];
+  c->n_pages += n;
+
+  return start;
+}
+
+bool c64_context_memcpy(struct c64_context* c, uint16_t dest, const uint8_t* src, uint32_t size)
+{
+  uint8_t* out = context_map(c, dest, size);
+
+  if (!out)
+    return false;
+
+  memcpy(out, src, size);
+
+  return true;
+}
+
+bool c64_context_unpack_lz4(struct c64_context* c, uint16_t dest,
+                            const uint8_t* src, size_t src_size, uint32_t size)
+{
+  uint8_t* out = context_map(c, dest, size);
+
+  return out && lz4_decode(out, size, src, src_size);
+}
+
+void c64_context_call(struct c64_context* c, uint16_t addr, uint8_t a)
+{
+  memset(&c->cpu, 0, sizeof(c->cpu));
+  c->cpu.a = a;
+  c->cpu.s = 0xfd;
+  c->cpu.pc = addr;
+
+  /* The return address of 0 that ends the call, like c64_cpu_jsr() */
+  ctx = c;
+  sparse_write(0x1ff, 0);
+  sparse_write(0x1fe, 0);
+}
+
+enum c64_context_state c64_context_run(struct c64_context* c, uint32_t max_instructions)
+{
+  uint32_t live_cycles = cycles;
+
+  ctx = c;
+  cpu = c->cpu;
+  set_p(c->cpu.p);
+
+  while (cpu.pc > 1 && max_instructions-- && !c->full) {
+    step(ACCESS_SPARSE);
+    c->instructions++;
+  }
+
+  cpu.p = get_p();
+  c->cpu = cpu;
+
+  /* The digi and voice 3 timing of the live machine runs on its cycles */
+  c->cycles += cycles - live_cycles;
+  cycles = live_cycles;
+
+  if (c->full)
+    return C64_CONTEXT_FULL;
+
+  return cpu.pc > 1 ? C64_CONTEXT_RUNNING : C64_CONTEXT_DONE;
+}
+
+uint8_t c64_context_peek(const struct c64_context* c, uint16_t addr)
+{
+  uint8_t slot = c->page_slot[addr >> 8];
+
+  return slot == C64_CONTEXT_NO_PAGE ? 0 : c->pages[slot][addr & 0xff];
+}
+
+void c64_context_log(struct c64_context* c, struct c64_context_write* log, uint16_t max)
+{
+  c->log = log;
+  c->log_max = max;
+  c->n_log = 0;
+  c->log_lost = 0;
+}
+
+uint8_t (*c64_borrow_memory(void))[256]
+{
+  core = C64_CORE_GENERIC;
+  core_entry = 0;
+  core_stale = false;
+
+#ifdef C64_JIT
+  if (jit) {
+    c64_jit_flush();
+  }
+#endif
+
+  return (uint8_t (*)[256])memory;
+}
+
+void c64_context_commit(const struct c64_context* c)
+{
+  memset(memory, 0, sizeof(memory));
+
+  for (int page = 0; page < 256; page++) {
+    if (c->page_slot[page] != C64_CONTEXT_NO_PAGE) {
+      memcpy(&memory[page << 8], c->pages[c->page_slot[page]], 256);
+    }
+  }
+
+  memcpy(dirty_pages, c->dirty, sizeof(dirty_pages));
+  invalidate_code(0, sizeof(memory));
 }
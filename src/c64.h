@@ -7,15 +7,124 @@
 #ifndef C64_H
 #define C64_H
 
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "c64_scan.h"
+#include "mos6510.h"
+
 uint8_t c64_getmem(uint16_t addr);
 void c64_setmem(uint16_t addr, uint8_t value);
 void c64_cpu_jsr(uint16_t new_pc, uint8_t new_a);
 void c64_init(void);
 void c64_memcpy(uint16_t dest, const uint8_t* src, uint32_t size);
 void c64_memset(uint16_t dest, uint8_t val, uint32_t size);
+void c64_memread(uint8_t* dest, uint16_t src, uint32_t size);
+
+/* Decode an LZ4 block of exactly size bytes to dest, false if it is corrupt */
+bool c64_unpack_lz4(uint16_t dest, const uint8_t* src, size_t src_size, uint32_t size);
+
+/* Pages written by the CPU since c64_init(), used for snapshots */
+bool c64_page_dirty(uint8_t page);
+void c64_get_dirty(uint32_t dirty[8]);
+void c64_set_dirty(const uint32_t dirty[8]);
 
 void c64_cpu_reset(void);
 void c64_cpu_reset_to(uint16_t new_pc, uint8_t new_a);
 
+/*
+ * Scan the code reachable from addr, normally the play routine once init
+ * has run, and run later calls to addr on the predecoded core if the scan
+ * allows it. Returns the core picked, info may be NULL.
+ */
+enum c64_core c64_cpu_optimize(uint16_t addr, struct c64_scan_info* info);
+
+/* Drops back to generic when the predecoded core meets something unexpected */
+enum c64_core c64_cpu_get_core(void);
+
+/*
+ * Routines translated ahead of time, sid_aot_routines for the firmware or
+ * none. They take the place of the scan when they fit, see c64_aot.h.
+ */
+struct c64_aot_routine;
+void c64_set_aot(const struct c64_aot_routine* routines, uint8_t n);
+
+#ifdef C64_JIT
+/* Runs c64_cpu_jsr() on translated code, see c64_jit.h */
+void c64_cpu_set_jit(bool on);
+#endif
+
+/* Instructions executed since c64_init(), wraps around */
+uint32_t c64_cpu_instructions(void);
+
+/* Cycles executed since c64_init(), page crossings are not counted */
+uint32_t c64_cpu_cycles(void);
+
+/*
+ * A second machine for running a routine in the background, in slices, while
+ * the live machine keeps playing. Its memory is a pool of pages handed in by
+ * the caller: loaded and written pages get a slot, all others read as zero.
+ * SID writes only land in regs, and in the write log when one is set. SID
+ * reads return 0: the voice 3 model belongs to the live machine, so OSC3 and
+ * ENV3 are not modelled here. Committing replaces the live memory with it.
+ */
+#define C64_CONTEXT_NO_PAGE 0xff
+
+struct c64_context_write
+{
+    uint8_t reg;
+    uint8_t val;
+};
+
+struct c64_context
+{
+    struct mos6510 cpu;
+    uint8_t (*pages)[256];
+    uint8_t max_pages;
+    uint8_t n_pages;
+    bool full;              /* ran out of pages, the context is useless */
+    uint8_t page_slot[256];
+    uint32_t dirty[8];      /* pages written by the CPU */
+    uint8_t regs[32];
+    uint32_t instructions;
+    uint32_t cycles;        /* kept apart from the live machine's */
+    struct c64_context_write* log;
+    uint16_t log_max;
+    uint16_t n_log;
+    uint16_t log_lost;      /* writes that did not fit the log */
+};
+
+enum c64_context_state
+{
+    C64_CONTEXT_RUNNING,
+    C64_CONTEXT_DONE,
+    C64_CONTEXT_FULL,
+};
+
+void c64_context_init(struct c64_context* ctx, uint8_t (*pool)[256], uint8_t max_pages);
+bool c64_context_memcpy(struct c64_context* ctx, uint16_t dest, const uint8_t* src, uint32_t size);
+bool c64_context_unpack_lz4(struct c64_context* ctx, uint16_t dest,
+                            const uint8_t* src, size_t src_size, uint32_t size);
+
+/*
+ * Set up a call to addr and run it for at most max_instructions per slice.
+ * Running and committing overwrite the live CPU registers, so both only
+ * happen between play calls.
+ */
+void c64_context_call(struct c64_context* ctx, uint16_t addr, uint8_t a);
+enum c64_context_state c64_context_run(struct c64_context* ctx, uint32_t max_instructions);
+void c64_context_commit(const struct c64_context* ctx);
+uint8_t c64_context_peek(const struct c64_context* ctx, uint16_t addr);
+
+/* SID writes in the order the routine made them, restarts the log */
+void c64_context_log(struct c64_context* ctx, struct c64_context_write* log, uint16_t max);
+
+/*
+ * The live memory as 256 pages for context pools, while the live machine is
+ * not playing. c64_init() has to follow before it plays again.
+ */
+uint8_t (*c64_borrow_memory(void))[256];
+
 
 #endif /* C64_H */
@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef C64_AOT_H
+#define C64_AOT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "mos6510.h"
+
+/*
+ * Routines of a tune translated to C ahead of time by tools/sidaot.c, which
+ * writes them to src/sid_aot.c, so they are built into the firmware with
+ * the rest of src. A routine is made for the code as it is in memory after
+ * the tune was loaded (init) or initialised (play), and only runs where
+ * memory still holds those bytes, so any other tune is left alone.
+ *
+ * Translated code keeps the CPU in locals and only stores the cycle and
+ * instruction counters before it calls the SID and when it returns. It
+ * leaves to the interpreter, with the registers in cpu, when a return or an
+ * indirect jump goes to code it does not know. A store into its own code,
+ * through an address the tool could not place, leaves as well and tells the
+ * caller the routine is no longer valid. sidaot makes no routine for code
+ * that changes itself where it can see it.
+ */
+struct c64_aot_machine
+{
+    struct mos6510 cpu;         /* p is the whole status register */
+    uint8_t* memory;
+    uint32_t* dirty;
+    uint32_t* cycles;
+    uint32_t* instructions;
+};
+
+struct c64_aot_range
+{
+    uint16_t addr;
+    uint16_t size;
+    const uint8_t* bytes;
+};
+
+struct c64_aot_routine
+{
+    uint16_t entry;
+    uint16_t n_ranges;
+    const struct c64_aot_range* ranges;         /* the code it was made from */
+
+    /* Returns false when it wrote into its own code */
+    bool (*run)(struct c64_aot_machine* m);
+};
+
+/* Defined in src/sid_aot.c, none when the tool did not translate a tune */
+extern const struct c64_aot_routine* const sid_aot_routines;
+extern const uint8_t sid_aot_n_routines;
+
+/*
+ * A store through an address the tool could not place, like c64_setmem().
+ * Returns false when it went into the code of the running routine.
+ */
+bool c64_aot_write(uint16_t addr, uint8_t val);
+
+#endif /* C64_AOT_H */
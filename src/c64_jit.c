@@ -0,0 +1,1273 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * 6510 to x86-64 translator for the host tools, see c64_jit.h.
+ *
+ * Translated code keeps memory in rbx, the dirty page bits in rbp, A, X and
+ * Y zero extended in r12d, r13d and r14d and the rest of the CPU in the
+ * state r15 points at. The flags are kept like c64.c keeps them, as the
+ * last result for N and Z and one byte each for C and V, so the flag
+ * semantics of the interpreter carry over as they are. SET_NZ() there goes
+ * through the byte of N, so the result for Z is always a byte as well. rax, rcx, rdx, rsi,
+ * rdi and r8 are scratch, ecx holds the effective address of an operand.
+ *
+ * The cycle and instruction counters are added up per block and added on
+ * the way out. Around a call to the SID the part of the block run so far is
+ * added before and taken off again after, so the SID sees the same cycle
+ * count as on the interpreter.
+ */
+
+#ifdef C64_JIT
+
+#if !defined(__x86_64__)
+#error "the JIT only emits x86-64 code"
+#endif
+
+#include "c64_jit.h"
+#include "sid.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+/* Room a block may take at most, one instruction needs less than 300 bytes */
+#define BLOCK_CODE_MAX  (C64_JIT_BLOCK_INSNS * 320 + 256)
+
+struct state
+{
+  uint32_t a;
+  uint32_t x;
+  uint32_t y;
+  uint32_t pc;
+  uint32_t ea;
+  uint16_t nz;
+  uint8_t n;
+  uint8_t c;
+  uint8_t v;
+  uint8_t s;
+  uint8_t p;
+  uint8_t stop;
+  uint8_t code_map[65536];      /* 1 for every translated byte */
+};
+
+struct block
+{
+  uint16_t start;
+  uint16_t end;                 /* up to 0x10000 - start bytes, see translate() */
+  bool live;
+};
+
+struct page_list
+{
+  uint16_t* ids;
+  uint16_t n;
+  uint16_t max;
+};
+
+enum reg
+{
+  RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+  R8, R9, R10, R11, R12, R13, R14, R15,
+};
+
+#define REG_MEM   RBX
+#define REG_DIRTY RBP
+#define REG_A     R12
+#define REG_X     R13
+#define REG_Y     R14
+#define REG_ST    R15
+
+enum alu { ALU_ADD, ALU_OR, ALU_ADC, ALU_SBB, ALU_AND, ALU_SUB, ALU_XOR, ALU_CMP };
+enum shift { SHIFT_SHL = 4, SHIFT_SHR = 5 };
+enum cc { CC_B = 2, CC_AE = 3, CC_E = 4, CC_NE = 5, CC_S = 8, CC_NS = 9 };
+
+/* Operand of an instruction: a register or base + index * scale + disp */
+struct rm
+{
+  int8_t reg;
+  int8_t base;
+  int8_t index;
+  uint8_t scale;
+  int32_t disp;
+};
+
+#define R(r)            ((struct rm){ .reg = (r), .base = -1, .index = -1 })
+#define M(b, d)         ((struct rm){ .reg = -1, .base = (b), .index = -1, .disp = (d) })
+#define MX(b, i, s, d)  ((struct rm){ .reg = -1, .base = (b), .index = (i), .scale = (s), .disp = (d) })
+#define ST(field)       M(REG_ST, offsetof(struct state, field))
+
+#define OP_W    1               /* 64 bit operand */
+#define OP_16   2               /* 16 bit operand */
+
+static uint8_t* memory;
+static uint32_t* dirty_pages;
+static uint32_t* cycles;
+static uint32_t* instructions;
+
+static struct state st;
+static void* table[65536];      /* block starting at an address */
+static uint16_t code_count[65536];      /* blocks holding each byte */
+static uint8_t rewrites[65536]; /* stores into each translated byte */
+
+static struct block blocks[C64_JIT_MAX_BLOCKS];
+static uint32_t n_blocks;
+static struct page_list page_blocks[256];
+
+static uint8_t* code;
+static uint8_t* out;
+static uint8_t* code_start;     /* behind the entry and exit stubs */
+static void (*enter)(struct state* state, void* block);
+static uint8_t* exit_stub;
+
+static struct c64_jit_stats stats;
+
+static void code_written(uint32_t addr);
+static void jit_php(void);
+static void jit_plp(void);
+
+static void emit8(uint8_t b)
+{
+  *out++ = b;
+}
+
+static void emit32(uint32_t v)
+{
+  memcpy(out, &v, 4);
+  out += 4;
+}
+
+static void emit64(uint64_t v)
+{
+  memcpy(out, &v, 8);
+  out += 8;
+}
+
+/* One or two byte opcode, two byte ones start with 0x0f */
+static void op(int flags, uint16_t opcode, int reg, struct rm rm)
+{
+  uint8_t rex = 0x40;
+
+  if (flags & OP_W)
+    rex |= 0x08;
+  if (reg & 8)
+    rex |= 0x04;
+  if (rm.reg >= 0 && (rm.reg & 8))
+    rex |= 0x01;
+  if (rm.reg < 0 && (rm.base & 8))
+    rex |= 0x01;
+  if (rm.reg < 0 && rm.index >= 0 && (rm.index & 8))
+    rex |= 0x02;
+
+  if (flags & OP_16)
+    emit8(0x66);
+  if (rex != 0x40)
+    emit8(rex);
+  if (opcode > 0xff)
+    emit8(opcode >> 8);
+  emit8(opcode);
+
+  if (rm.reg >= 0) {
+    emit8(0xc0 | ((reg & 7) << 3) | (rm.reg & 7));
+    return;
+  }
+
+  /* Always mod 10 with a 32 bit displacement, rsp and r12 as base need a SIB */
+  if (rm.index >= 0) {
+    emit8(0x84 | ((reg & 7) << 3));
+    emit8((rm.scale << 6) | ((rm.index & 7) << 3) | (rm.base & 7));
+  } else if ((rm.base & 7) == RSP) {
+    emit8(0x84 | ((reg & 7) << 3));
+    emit8(0x24);
+  } else {
+    emit8(0x80 | ((reg & 7) << 3) | (rm.base & 7));
+  }
+  emit32(rm.disp);
+}
+
+/* 32 bit moves, byte stores only use al, cl, dl and r8b to r15b */
+static void mov_load(int r, struct rm rm)     { op(0, 0x8b, r, rm); }
+static void mov_store(struct rm rm, int r)    { op(0, 0x89, r, rm); }
+static void mov_store8(struct rm rm, int r)   { op(0, 0x88, r, rm); }
+static void mov_store16(struct rm rm, int r)  { op(OP_16, 0x89, r, rm); }
+static void movzx8(int r, struct rm rm)       { op(0, 0x0fb6, r, rm); }
+static void alu(enum alu a, struct rm rm, int r) { op(0, (a << 3) | 1, r, rm); }
+
+static void alu_imm(enum alu a, struct rm rm, int32_t imm)
+{
+  op(0, 0x81, a, rm);
+  emit32(imm);
+}
+
+static void alu_imm8(enum alu a, struct rm rm, uint8_t imm)
+{
+  op(0, 0x80, a, rm);
+  emit8(imm);
+}
+
+static void shift_imm(enum shift s, int r, uint8_t n)
+{
+  op(0, 0xc1, s, R(r));
+  emit8(n);
+}
+
+static void mov_imm(int r, uint32_t imm)
+{
+  if (r & 8)
+    emit8(0x41);
+  emit8(0xb8 + (r & 7));
+  emit32(imm);
+}
+
+static void mov_imm64(int r, uint64_t imm)
+{
+  emit8(0x48 | ((r >> 3) & 1));
+  emit8(0xb8 + (r & 7));
+  emit64(imm);
+}
+
+static void mov_store8_imm(struct rm rm, uint8_t imm)
+{
+  op(0, 0xc6, 0, rm);
+  emit8(imm);
+}
+
+static void mov_store32_imm(struct rm rm, uint32_t imm)
+{
+  op(0, 0xc7, 0, rm);
+  emit32(imm);
+}
+
+static void call(const void* fn)
+{
+  mov_imm64(RAX, (uintptr_t)fn);
+  op(0, 0xff, 2, R(RAX));
+}
+
+/* Forward jumps return the end of the jump, patch() points it at out */
+static uint8_t* jcc_fwd(enum cc cc)
+{
+  emit8(0x0f);
+  emit8(0x80 + cc);
+  emit32(0);
+  return out;
+}
+
+static uint8_t* jmp_fwd(void)
+{
+  emit8(0xe9);
+  emit32(0);
+  return out;
+}
+
+static void patch(uint8_t* end)
+{
+  int32_t rel = out - end;
+
+  memcpy(end - 4, &rel, 4);
+}
+
+static void jcc_to(enum cc cc, const uint8_t* target)
+{
+  emit8(0x0f);
+  emit8(0x80 + cc);
+  emit32(target - (out + 4));
+}
+
+/* Only touches rax */
+static void add_counters(int32_t cyc, int32_t insns)
+{
+  if (cyc) {
+    mov_imm64(RAX, (uintptr_t)cycles);
+    alu_imm(ALU_ADD, M(RAX, 0), cyc);
+  }
+  if (insns) {
+    mov_imm64(RAX, (uintptr_t)instructions);
+    alu_imm(ALU_ADD, M(RAX, 0), insns);
+  }
+}
+
+/* Goes on at the block for pc, or back to C when there is none yet */
+static void chain(void)
+{
+  op(OP_W, 0x85, RAX, R(RAX));
+  jcc_to(CC_E, exit_stub);
+  op(0, 0xff, 4, R(RAX));
+}
+
+static void exit_static(uint16_t pc, int32_t cyc, int32_t insns)
+{
+  mov_store32_imm(ST(pc), pc);
+  add_counters(cyc, insns);
+  mov_imm64(RAX, (uintptr_t)&table[pc]);
+  op(OP_W, 0x8b, RAX, M(RAX, 0));
+  chain();
+}
+
+/* pc in edx */
+static void exit_dynamic(int32_t cyc, int32_t insns)
+{
+  mov_store(ST(pc), RDX);
+  add_counters(cyc, insns);
+  mov_imm64(RAX, (uintptr_t)table);
+  op(OP_W, 0x8b, RAX, MX(RAX, RDX, 3, 0));
+  chain();
+}
+
+/*
+ * The translation of one instruction. pend_cycles and pend_insns are the
+ * counts of the block up to here, pend_cycles with this instruction and
+ * pend_insns without it, as c64.c has them while the instruction runs.
+ */
+struct insn
+{
+  uint8_t type;
+  uint8_t mode;
+  uint16_t pc;                  /* of the instruction */
+  uint16_t next;
+  uint16_t arg;                 /* operand, target for branches and jumps */
+  int32_t pend_cycles;
+  int32_t pend_insns;
+};
+
+enum ea_kind
+{
+  EA_CONST,                     /* address known at translation */
+  EA_DYNAMIC,                   /* address in ecx */
+  EA_ACC,
+  EA_IMM,
+};
+
+struct operand
+{
+  enum ea_kind kind;
+  uint16_t addr;
+  bool io;                      /* may reach the SID */
+};
+
+static bool is_io(uint16_t addr)
+{
+  return (addr & 0xfc00) == 0xd400;
+}
+
+/* Whether base plus 0 to 255 can be a SID register */
+static bool indexed_io(uint16_t base)
+{
+  for (uint32_t i = 0; i < 256; i++) {
+    if (is_io(base + i))
+      return true;
+  }
+
+  return false;
+}
+
+static struct operand emit_ea(const struct insn* in)
+{
+  struct operand o = { .kind = EA_DYNAMIC, .addr = in->arg };
+
+  switch (in->mode) {
+    case MOS6510_MODE_IMM:
+      o.kind = EA_IMM;
+      break;
+
+    case MOS6510_MODE_ACC:
+      o.kind = EA_ACC;
+      break;
+
+    case MOS6510_MODE_ZP:
+      o.kind = EA_CONST;
+      break;
+
+    case MOS6510_MODE_ABS:
+      o.kind = EA_CONST;
+      o.io = is_io(in->arg);
+      break;
+
+    case MOS6510_MODE_ZPX:
+    case MOS6510_MODE_ZPY:
+      mov_load(RCX, R(in->mode == MOS6510_MODE_ZPX ? REG_X : REG_Y));
+      alu_imm(ALU_ADD, R(RCX), in->arg);
+      alu_imm(ALU_AND, R(RCX), 0xff);
+      break;
+
+    case MOS6510_MODE_ABSX:
+    case MOS6510_MODE_ABSY:
+      mov_load(RCX, R(in->mode == MOS6510_MODE_ABSX ? REG_X : REG_Y));
+      alu_imm(ALU_ADD, R(RCX), in->arg);
+      alu_imm(ALU_AND, R(RCX), 0xffff);
+      o.io = indexed_io(in->arg);
+      break;
+
+    case MOS6510_MODE_INDX:
+      mov_load(RDX, R(REG_X));
+      alu_imm(ALU_ADD, R(RDX), in->arg);
+      alu_imm(ALU_AND, R(RDX), 0xff);
+      movzx8(RCX, MX(REG_MEM, RDX, 0, 0));
+      alu_imm(ALU_ADD, R(RDX), 1);
+      alu_imm(ALU_AND, R(RDX), 0xff);
+      movzx8(RDX, MX(REG_MEM, RDX, 0, 0));
+      shift_imm(SHIFT_SHL, RDX, 8);
+      alu(ALU_OR, R(RCX), RDX);
+      o.io = true;
+      break;
+
+    case MOS6510_MODE_INDY:
+      movzx8(RCX, M(REG_MEM, in->arg));
+      movzx8(RDX, M(REG_MEM, (in->arg + 1) & 0xff));
+      shift_imm(SHIFT_SHL, RDX, 8);
+      alu(ALU_OR, R(RCX), RDX);
+      alu(ALU_ADD, R(RCX), REG_Y);
+      alu_imm(ALU_AND, R(RCX), 0xffff);
+      o.io = true;
+      break;
+  }
+
+  return o;
+}
+
+/* sid_peek() of the register in edi, the value comes back in eax */
+static void emit_peek(const struct insn* in, bool keep_ea)
+{
+  if (keep_ea)
+    mov_store(ST(ea), RCX);
+  add_counters(in->pend_cycles, in->pend_insns);
+  alu_imm(ALU_AND, R(RDI), 0x1f);
+  call(sid_peek);
+  movzx8(RDX, R(RAX));
+  add_counters(-in->pend_cycles, -in->pend_insns);
+  mov_load(RAX, R(RDX));
+  if (keep_ea)
+    mov_load(RCX, ST(ea));
+}
+
+/* The operand into eax, ecx stays */
+static void emit_load(const struct insn* in, const struct operand* o)
+{
+  uint8_t* fast;
+  uint8_t* done;
+
+  switch (o->kind) {
+    case EA_IMM:
+      mov_imm(RAX, o->addr);
+      break;
+
+    case EA_ACC:
+      mov_load(RAX, R(REG_A));
+      break;
+
+    case EA_CONST:
+      if (o->io) {
+        mov_imm(RDI, o->addr);
+        emit_peek(in, false);
+      } else {
+        movzx8(RAX, M(REG_MEM, o->addr));
+      }
+      break;
+
+    case EA_DYNAMIC:
+      if (o->io) {
+        mov_load(RDX, R(RCX));
+        alu_imm(ALU_AND, R(RDX), 0xfc00);
+        alu_imm(ALU_CMP, R(RDX), 0xd400);
+        fast = jcc_fwd(CC_NE);
+        mov_load(RDI, R(RCX));
+        emit_peek(in, true);
+        done = jmp_fwd();
+        patch(fast);
+        movzx8(RAX, MX(REG_MEM, RCX, 0, 0));
+        patch(done);
+      } else {
+        movzx8(RAX, MX(REG_MEM, RCX, 0, 0));
+      }
+      break;
+  }
+}
+
+/*
+ * A store into translated code drops the blocks holding the byte. When that
+ * can be the running block it is left behind the instruction, which must
+ * have no effect after the store.
+ */
+static void emit_code_check(const struct insn* in, struct rm map, bool leave)
+{
+  uint8_t* skip;
+  uint8_t* cont;
+
+  alu_imm8(ALU_CMP, map, 0);
+  skip = jcc_fwd(CC_E);
+  call(code_written);
+
+  if (leave) {
+    alu_imm8(ALU_CMP, ST(stop), 0);
+    cont = jcc_fwd(CC_E);
+    mov_store8_imm(ST(stop), 0);
+    exit_static(in->next, in->pend_cycles, in->pend_insns + 1);
+    patch(cont);
+  }
+
+  patch(skip);
+}
+
+/* Stores al to the operand, everything else of the instruction is done */
+static void emit_store(const struct insn* in, const struct operand* o)
+{
+  uint8_t* fast;
+  uint8_t* done = NULL;
+
+  switch (o->kind) {
+    case EA_ACC:
+      movzx8(REG_A, R(RAX));
+      return;
+
+    case EA_IMM:
+      return;
+
+    case EA_CONST:
+      if (o->io) {
+        movzx8(RSI, R(RAX));
+        mov_imm(RDI, o->addr & 0x1f);
+        add_counters(in->pend_cycles, in->pend_insns);
+        call(sid_poke);
+        add_counters(-in->pend_cycles, -in->pend_insns);
+        return;
+      }
+
+      mov_store8(M(REG_MEM, o->addr), RAX);
+      alu_imm8(ALU_OR, M(REG_DIRTY, o->addr >> 11), 1 << ((o->addr >> 8) & 7));
+      mov_imm(RDI, o->addr);
+      emit_code_check(in, ST(code_map[o->addr]), true);
+      return;
+
+    case EA_DYNAMIC:
+      if (o->io) {
+        mov_load(RDX, R(RCX));
+        alu_imm(ALU_AND, R(RDX), 0xfc00);
+        alu_imm(ALU_CMP, R(RDX), 0xd400);
+        fast = jcc_fwd(CC_NE);
+        movzx8(RSI, R(RAX));
+        mov_load(RDI, R(RCX));
+        alu_imm(ALU_AND, R(RDI), 0x1f);
+        add_counters(in->pend_cycles, in->pend_insns);
+        call(sid_poke);
+        add_counters(-in->pend_cycles, -in->pend_insns);
+        done = jmp_fwd();
+        patch(fast);
+      }
+
+      mov_store8(MX(REG_MEM, RCX, 0, 0), RAX);
+      mov_load(RDX, R(RCX));
+      shift_imm(SHIFT_SHR, RDX, 8);
+      op(0, 0x0fab, RDX, M(REG_DIRTY, 0));       /* bts */
+      mov_load(RDI, R(RCX));
+      emit_code_check(in, MX(REG_ST, RCX, 0, offsetof(struct state, code_map)), true);
+
+      if (done)
+        patch(done);
+      return;
+  }
+}
+
+static void emit_set_nz(int r)
+{
+  mov_store16(ST(nz), r);
+  mov_store8(ST(n), r);
+}
+
+/* Like push() in c64.c, the stack page is always RAM */
+static void emit_push(const struct insn* in, int r, bool leave)
+{
+  uint8_t* skip;
+
+  movzx8(RCX, ST(s));
+  alu(ALU_OR, R(RCX), RCX);                     /* only for the flags */
+  skip = jcc_fwd(CC_E);
+  alu_imm8(ALU_SUB, ST(s), 1);
+  patch(skip);
+
+  mov_store8(MX(REG_MEM, RCX, 0, 0x100), r);
+  alu_imm8(ALU_OR, M(REG_DIRTY, 0), 2);
+  op(0, 0x8d, RDI, M(RCX, 0x100));             /* lea edi, [rcx + 0x100] */
+  emit_code_check(in, MX(REG_ST, RCX, 0, offsetof(struct state, code_map) + 0x100), leave);
+}
+
+/* Into eax */
+static void emit_pop(void)
+{
+  uint8_t* skip;
+
+  movzx8(RCX, ST(s));
+  alu_imm(ALU_CMP, R(RCX), 0xff);
+  skip = jcc_fwd(CC_E);
+  alu_imm(ALU_ADD, R(RCX), 1);
+  mov_store8(ST(s), RCX);
+  patch(skip);
+  movzx8(RAX, MX(REG_MEM, RCX, 0, 0x100));
+}
+
+static void emit_branch(const struct insn* in)
+{
+  struct rm flag;
+  enum cc taken;
+  uint8_t* skip;
+
+  switch (in->type) {
+    case MOS6510_TYPE_BCC: flag = ST(c); taken = CC_E; break;
+    case MOS6510_TYPE_BCS: flag = ST(c); taken = CC_NE; break;
+    case MOS6510_TYPE_BVC: flag = ST(v); taken = CC_E; break;
+    case MOS6510_TYPE_BVS: flag = ST(v); taken = CC_NE; break;
+    case MOS6510_TYPE_BPL: flag = ST(n); taken = CC_NS; break;
+    case MOS6510_TYPE_BMI: flag = ST(n); taken = CC_S; break;
+    case MOS6510_TYPE_BNE: flag = ST(nz); taken = CC_NE; break;
+    default:               flag = ST(nz); taken = CC_E; break;
+  }
+
+  if (in->type == MOS6510_TYPE_BNE || in->type == MOS6510_TYPE_BEQ) {
+    op(OP_16, 0x81, ALU_CMP, flag);
+    emit8(0);
+    emit8(0);
+  } else {
+    alu_imm8(ALU_CMP, flag, 0);
+  }
+
+  /* N is tested as a signed byte, cmp with 0 leaves the sign of the byte */
+  skip = jcc_fwd(taken ^ 1);
+  exit_static(in->arg, in->pend_cycles + 1, in->pend_insns + 1);
+  patch(skip);
+  exit_static(in->next, in->pend_cycles, in->pend_insns + 1);
+}
+
+/* Returns true when the instruction ended the block */
+static bool emit_insn(const struct insn* in)
+{
+  struct operand o = { .kind = EA_IMM, .addr = in->arg };
+  int r;
+
+  if (in->type < MOS6510_TYPE_XXX && in->type != MOS6510_TYPE_NOP &&
+      in->mode != MOS6510_MODE_IMP && in->mode != MOS6510_MODE_REL &&
+      in->type != MOS6510_TYPE_JSR && in->type != MOS6510_TYPE_JMP) {
+    o = emit_ea(in);
+  }
+
+  switch (in->type) {
+    case MOS6510_TYPE_ADC:
+    case MOS6510_TYPE_SBC:
+      emit_load(in, &o);
+      if (in->type == MOS6510_TYPE_SBC)
+        alu_imm(ALU_XOR, R(RAX), 0xff);
+      movzx8(RDX, ST(c));
+      alu(ALU_ADD, R(RAX), RDX);
+      alu(ALU_ADD, R(RAX), REG_A);
+      mov_load(RDX, R(RAX));
+      shift_imm(SHIFT_SHR, RDX, 8);
+      mov_store8(ST(c), RDX);
+      movzx8(REG_A, R(RAX));
+      emit_set_nz(REG_A);
+      mov_load(RAX, R(REG_A));
+      shift_imm(SHIFT_SHR, RAX, 7);
+      alu(ALU_XOR, R(RAX), RDX);
+      mov_store8(ST(v), RAX);
+      return false;
+
+    case MOS6510_TYPE_AND:
+    case MOS6510_TYPE_ORA:
+    case MOS6510_TYPE_EOR:
+      emit_load(in, &o);
+      alu(in->type == MOS6510_TYPE_AND ? ALU_AND :
+          in->type == MOS6510_TYPE_ORA ? ALU_OR : ALU_XOR, R(REG_A), RAX);
+      emit_set_nz(REG_A);
+      return false;
+
+    case MOS6510_TYPE_CMP:
+    case MOS6510_TYPE_CPX:
+    case MOS6510_TYPE_CPY:
+      r = in->type == MOS6510_TYPE_CMP ? REG_A : in->type == MOS6510_TYPE_CPX ? REG_X : REG_Y;
+      emit_load(in, &o);
+      mov_load(RDX, R(r));
+      alu(ALU_SUB, R(RDX), RAX);
+      movzx8(RDX, R(RDX));
+      emit_set_nz(RDX);
+      alu(ALU_CMP, R(r), RAX);
+      op(0, 0x0f90 + CC_AE, 0, R(RDX));         /* setae dl */
+      mov_store8(ST(c), RDX);
+      return false;
+
+    case MOS6510_TYPE_BIT:
+      emit_load(in, &o);
+      mov_load(RDX, R(REG_A));
+      alu(ALU_AND, R(RDX), RAX);
+      mov_store16(ST(nz), RDX);
+      mov_store8(ST(n), RAX);
+      shift_imm(SHIFT_SHR, RAX, 6);
+      alu_imm(ALU_AND, R(RAX), 1);
+      mov_store8(ST(v), RAX);
+      return false;
+
+    case MOS6510_TYPE_LDA:
+    case MOS6510_TYPE_LDX:
+    case MOS6510_TYPE_LDY:
+      r = in->type == MOS6510_TYPE_LDA ? REG_A : in->type == MOS6510_TYPE_LDX ? REG_X : REG_Y;
+      emit_load(in, &o);
+      mov_load(r, R(RAX));
+      emit_set_nz(r);
+      return false;
+
+    case MOS6510_TYPE_STA:
+    case MOS6510_TYPE_STX:
+    case MOS6510_TYPE_STY:
+      r = in->type == MOS6510_TYPE_STA ? REG_A : in->type == MOS6510_TYPE_STX ? REG_X : REG_Y;
+      mov_load(RAX, R(r));
+      emit_store(in, &o);
+      return false;
+
+    case MOS6510_TYPE_INC:
+    case MOS6510_TYPE_DEC:
+      emit_load(in, &o);
+      alu_imm(in->type == MOS6510_TYPE_INC ? ALU_ADD : ALU_SUB, R(RAX), 1);
+      movzx8(RAX, R(RAX));
+      emit_set_nz(RAX);
+      emit_store(in, &o);
+      return false;
+
+    case MOS6510_TYPE_ASL:
+      emit_load(in, &o);
+      shift_imm(SHIFT_SHL, RAX, 1);
+      mov_load(RDX, R(RAX));
+      shift_imm(SHIFT_SHR, RDX, 8);
+      mov_store8(ST(c), RDX);
+      movzx8(RAX, R(RAX));
+      emit_set_nz(RAX);
+      emit_store(in, &o);
+      return false;
+
+    case MOS6510_TYPE_LSR:
+      emit_load(in, &o);
+      mov_load(RDX, R(RAX));
+      alu_imm(ALU_AND, R(RDX), 1);
+      mov_store8(ST(c), RDX);
+      shift_imm(SHIFT_SHR, RAX, 1);
+      emit_set_nz(RAX);
+      emit_store(in, &o);
+      return false;
+
+    case MOS6510_TYPE_ROL:
+    case MOS6510_TYPE_ROR:
+      emit_load(in, &o);
+      movzx8(RDX, ST(c));
+      mov_load(R8, R(RAX));
+      if (in->type == MOS6510_TYPE_ROL) {
+        shift_imm(SHIFT_SHR, R8, 7);
+        shift_imm(SHIFT_SHL, RAX, 1);
+      } else {
+        alu_imm(ALU_AND, R(R8), 1);
+        shift_imm(SHIFT_SHR, RAX, 1);
+        shift_imm(SHIFT_SHL, RDX, 7);
+      }
+      mov_store8(ST(c), R8);
+      alu(ALU_OR, R(RAX), RDX);
+      movzx8(RAX, R(RAX));
+      emit_set_nz(RAX);
+      emit_store(in, &o);
+      return false;
+
+    case MOS6510_TYPE_INX:
+    case MOS6510_TYPE_DEX:
+    case MOS6510_TYPE_INY:
+    case MOS6510_TYPE_DEY:
+      r = (in->type == MOS6510_TYPE_INX || in->type == MOS6510_TYPE_DEX) ? REG_X : REG_Y;
+      alu_imm(in->type == MOS6510_TYPE_INX || in->type == MOS6510_TYPE_INY ? ALU_ADD : ALU_SUB,
+              R(r), 1);
+      alu_imm(ALU_AND, R(r), 0xff);
+      emit_set_nz(r);
+      return false;
+
+    case MOS6510_TYPE_TAX: mov_load(REG_X, R(REG_A)); emit_set_nz(REG_X); return false;
+    case MOS6510_TYPE_TAY: mov_load(REG_Y, R(REG_A)); emit_set_nz(REG_Y); return false;
+    case MOS6510_TYPE_TXA: mov_load(REG_A, R(REG_X)); emit_set_nz(REG_A); return false;
+    case MOS6510_TYPE_TYA: mov_load(REG_A, R(REG_Y)); emit_set_nz(REG_A); return false;
+    case MOS6510_TYPE_TSX: movzx8(REG_X, ST(s)); emit_set_nz(REG_X); return false;
+    case MOS6510_TYPE_TXS: mov_store8(ST(s), REG_X); return false;
+
+    case MOS6510_TYPE_CLC: mov_store8_imm(ST(c), 0); return false;
+    case MOS6510_TYPE_SEC: mov_store8_imm(ST(c), 1); return false;
+    case MOS6510_TYPE_CLV: mov_store8_imm(ST(v), 0); return false;
+    case MOS6510_TYPE_CLD: alu_imm8(ALU_AND, ST(p), ~MOS6510_FLAG_D); return false;
+    case MOS6510_TYPE_SED: alu_imm8(ALU_OR, ST(p), MOS6510_FLAG_D); return false;
+    case MOS6510_TYPE_CLI: alu_imm8(ALU_AND, ST(p), ~MOS6510_FLAG_I); return false;
+    case MOS6510_TYPE_SEI: alu_imm8(ALU_OR, ST(p), MOS6510_FLAG_I); return false;
+
+    case MOS6510_TYPE_PHA:
+      emit_push(in, REG_A, true);
+      return false;
+
+    case MOS6510_TYPE_PLA:
+      emit_pop();
+      mov_load(REG_A, R(RAX));
+      emit_set_nz(REG_A);
+      return false;
+
+    case MOS6510_TYPE_PHP:
+    case MOS6510_TYPE_PLP:
+      call(in->type == MOS6510_TYPE_PHP ? jit_php : jit_plp);
+      if (in->type == MOS6510_TYPE_PHP) {
+        uint8_t* cont;
+
+        alu_imm8(ALU_CMP, ST(stop), 0);
+        cont = jcc_fwd(CC_E);
+        mov_store8_imm(ST(stop), 0);
+        exit_static(in->next, in->pend_cycles, in->pend_insns + 1);
+        patch(cont);
+      }
+      return false;
+
+    case MOS6510_TYPE_JMP:
+      if (in->mode == MOS6510_MODE_IND) {
+        movzx8(RDX, M(REG_MEM, in->arg));
+        movzx8(RCX, M(REG_MEM, (uint16_t)(in->arg + 1)));
+        shift_imm(SHIFT_SHL, RCX, 8);
+        alu(ALU_OR, R(RDX), RCX);
+        exit_dynamic(in->pend_cycles, in->pend_insns + 1);
+      } else {
+        exit_static(in->arg, in->pend_cycles, in->pend_insns + 1);
+      }
+      return true;
+
+    case MOS6510_TYPE_JSR:
+      /* The block ends here anyway, a store into code needs no exit of its own */
+      mov_imm(RAX, (uint16_t)(in->next - 1) >> 8);
+      emit_push(in, RAX, false);
+      mov_imm(RAX, (uint8_t)(in->next - 1));
+      emit_push(in, RAX, false);
+      mov_store8_imm(ST(stop), 0);
+      exit_static(in->arg, in->pend_cycles, in->pend_insns + 1);
+      return true;
+
+    case MOS6510_TYPE_RTI:
+    case MOS6510_TYPE_RTS:
+      emit_pop();
+      mov_load(R8, R(RAX));
+      emit_pop();
+      shift_imm(SHIFT_SHL, RAX, 8);
+      alu(ALU_OR, R(RAX), R8);
+      alu_imm(ALU_ADD, R(RAX), 1);
+      alu_imm(ALU_AND, R(RAX), 0xffff);
+      mov_load(RDX, R(RAX));
+      exit_dynamic(in->pend_cycles, in->pend_insns + 1);
+      return true;
+
+    case MOS6510_TYPE_BRK:
+      exit_static(0, in->pend_cycles, in->pend_insns + 1);
+      return true;
+
+    case MOS6510_TYPE_BCC:
+    case MOS6510_TYPE_BCS:
+    case MOS6510_TYPE_BEQ:
+    case MOS6510_TYPE_BNE:
+    case MOS6510_TYPE_BMI:
+    case MOS6510_TYPE_BPL:
+    case MOS6510_TYPE_BVC:
+    case MOS6510_TYPE_BVS:
+      emit_branch(in);
+      return true;
+  }
+
+  /* NOP and the undocumented opcodes, which the interpreter skips too */
+  return false;
+}
+
+static uint8_t get_p(void)
+{
+  uint8_t p = st.p & ~(MOS6510_FLAG_N | MOS6510_FLAG_V | MOS6510_FLAG_Z | MOS6510_FLAG_C);
+
+  p |= st.n & MOS6510_FLAG_N;
+  p |= st.v ? MOS6510_FLAG_V : 0;
+  p |= st.nz ? 0 : MOS6510_FLAG_Z;
+  p |= st.c;
+
+  return p;
+}
+
+static void set_p(uint8_t p)
+{
+  st.p = p;
+  st.n = p;
+  st.nz = !(p & MOS6510_FLAG_Z);
+  st.c = p & MOS6510_FLAG_C;
+  st.v = !!(p & MOS6510_FLAG_V);
+}
+
+static void kill_block(uint32_t id)
+{
+  struct block* b = &blocks[id];
+
+  b->live = false;
+  table[b->start] = NULL;
+
+  for (uint32_t addr = b->start; addr < (uint32_t)b->start + b->end; addr++) {
+    if (--code_count[addr] == 0) {
+      st.code_map[addr] = 0;
+    }
+  }
+}
+
+/* Drops the blocks holding a byte of addr to addr + size */
+static uint32_t invalidate(uint32_t addr, uint32_t size)
+{
+  uint32_t end = addr + size;
+  uint32_t killed = 0;
+
+  for (uint32_t page = addr >> 8; page <= ((end - 1) >> 8) && page < 256; page++) {
+    struct page_list* l = &page_blocks[page];
+    uint16_t n = 0;
+
+    for (uint16_t i = 0; i < l->n; i++) {
+      struct block* b = &blocks[l->ids[i]];
+
+      if (b->live && b->start < end && (uint32_t)b->start + b->end > addr) {
+        kill_block(l->ids[i]);
+        killed++;
+      }
+      if (b->live) {
+        l->ids[n++] = l->ids[i];
+      }
+    }
+    l->n = n;
+  }
+
+  return killed;
+}
+
+/* A store of translated code into translated code */
+static void code_written(uint32_t addr)
+{
+  if (rewrites[addr] < C64_JIT_MAX_REWRITES) {
+    rewrites[addr]++;
+  }
+
+  stats.invalidated += invalidate(addr, 1);
+  st.stop = 1;
+}
+
+/* The stack page is always RAM */
+static void jit_php(void)
+{
+  uint16_t addr = 0x100 + st.s;
+
+  memory[addr] = get_p();
+  dirty_pages[0] |= 2;
+
+  if (st.s) {
+    st.s--;
+  }
+
+  if (st.code_map[addr]) {
+    code_written(addr);
+  }
+}
+
+static void jit_plp(void)
+{
+  if (st.s < 0xff) {
+    st.s++;
+  }
+
+  set_p(memory[0x100 + st.s]);
+}
+
+static bool add_to_page(uint8_t page, uint16_t id)
+{
+  struct page_list* l = &page_blocks[page];
+
+  if (l->n == l->max) {
+    uint16_t max = l->max ? l->max * 2 : 16;
+    uint16_t* ids = realloc(l->ids, max * sizeof(*ids));
+
+    if (!ids)
+      return false;
+
+    l->ids = ids;
+    l->max = max;
+  }
+
+  l->ids[l->n++] = id;
+
+  return true;
+}
+
+/*
+ * Whether the instruction can be translated: not in the I/O area, not
+ * wrapping around the end of memory and not rewritten too often.
+ */
+static bool translatable(uint16_t pc, uint8_t len)
+{
+  if ((uint32_t)pc + len > 0x10000)
+    return false;
+
+  for (uint8_t i = 0; i < len; i++) {
+    if (is_io(pc + i) || rewrites[pc + i] >= C64_JIT_MAX_REWRITES)
+      return false;
+  }
+
+  return true;
+}
+
+static uint8_t insn_length(uint8_t type, uint8_t mode)
+{
+  if (type >= MOS6510_TYPE_XXX || type == MOS6510_TYPE_NOP)
+    return 1;
+
+  switch (mode) {
+    case MOS6510_MODE_IMP:
+    case MOS6510_MODE_ACC:
+      return 1;
+
+    case MOS6510_MODE_ABS:
+    case MOS6510_MODE_ABSX:
+    case MOS6510_MODE_ABSY:
+    case MOS6510_MODE_IND:
+      return 3;
+  }
+
+  return 2;
+}
+
+static void flush(void)
+{
+  for (uint32_t i = 0; i < 256; i++) {
+    page_blocks[i].n = 0;
+  }
+
+  memset(table, 0, sizeof(table));
+  memset(code_count, 0, sizeof(code_count));
+  memset(st.code_map, 0, sizeof(st.code_map));
+  n_blocks = 0;
+  out = code_start;
+}
+
+/* Returns the translated block, NULL when the first instruction cannot be */
+static void* translate(uint16_t start)
+{
+  struct insn in = { .pc = start };
+  uint8_t* entry;
+  uint32_t n = 0;
+  uint32_t end;
+  bool done = false;
+
+  if (!translatable(start, insn_length(mos6510_opcode_table[memory[start]].type,
+                                       mos6510_opcode_table[memory[start]].mode)))
+    return NULL;
+
+  if (out + BLOCK_CODE_MAX > code + C64_JIT_CODE_SIZE || n_blocks == C64_JIT_MAX_BLOCKS) {
+    flush();
+    stats.flushes++;
+  }
+
+  entry = out;
+
+  while (!done) {
+    uint8_t opc = memory[in.pc];
+    uint8_t len;
+
+    in.type = mos6510_opcode_table[opc].type;
+    in.mode = mos6510_opcode_table[opc].mode;
+    len = insn_length(in.type, in.mode);
+
+    if (!translatable(in.pc, len)) {
+      exit_static(in.pc, in.pend_cycles, in.pend_insns);
+      break;
+    }
+
+    in.next = in.pc + len;
+    if (len == 2) {
+      in.arg = memory[(uint16_t)(in.pc + 1)];
+    } else if (len == 3) {
+      in.arg = memory[(uint16_t)(in.pc + 1)] | (memory[(uint16_t)(in.pc + 2)] << 8);
+    }
+    if (in.mode == MOS6510_MODE_REL) {
+      in.arg = in.next + (int8_t)in.arg;
+    } else if (in.mode == MOS6510_MODE_IMM) {
+      in.arg = memory[(uint16_t)(in.pc + 1)];
+    }
+
+    in.pend_cycles += mos6510_cycle_table[opc];
+    done = emit_insn(&in);
+
+    in.pend_insns++;
+    in.pc = in.next;
+    n++;
+
+    if (!done && (n == C64_JIT_BLOCK_INSNS || in.pc == 0)) {
+      exit_static(in.pc, in.pend_cycles, in.pend_insns);
+      done = true;
+    }
+  }
+
+  /* in.pc is 0 when the last instruction ends at the top of memory */
+  end = in.pc ? in.pc : 0x10000;
+
+  blocks[n_blocks].start = start;
+  blocks[n_blocks].end = end - start;
+  blocks[n_blocks].live = true;
+
+  for (uint32_t addr = start; addr < end; addr++) {
+    code_count[addr]++;
+    st.code_map[addr] = 1;
+  }
+
+  for (uint32_t page = start >> 8; page <= ((end - 1) >> 8); page++) {
+    if (!add_to_page(page, n_blocks)) {
+      /* Out of memory for the lists, start over without this block */
+      flush();
+      stats.flushes++;
+      return NULL;
+    }
+  }
+
+  n_blocks++;
+  table[start] = entry;
+
+  stats.blocks++;
+  stats.insns += n;
+
+  return entry;
+}
+
+/*
+ * enter(state, block) saves the registers the ABI wants kept, loads the
+ * machine and jumps to the block. Translated code comes back through the
+ * exit stub, which stores the machine again and returns from enter().
+ */
+static void emit_stubs(void)
+{
+  static const uint8_t save[] = {
+    0x53,                       /* push rbx */
+    0x55,                       /* push rbp */
+    0x41, 0x54,                 /* push r12 */
+    0x41, 0x55,                 /* push r13 */
+    0x41, 0x56,                 /* push r14 */
+    0x41, 0x57,                 /* push r15 */
+    0x48, 0x83, 0xec, 0x08,     /* sub rsp, 8 */
+  };
+  static const uint8_t restore[] = {
+    0x48, 0x83, 0xc4, 0x08,     /* add rsp, 8 */
+    0x41, 0x5f,                 /* pop r15 */
+    0x41, 0x5e,                 /* pop r14 */
+    0x41, 0x5d,                 /* pop r13 */
+    0x41, 0x5c,                 /* pop r12 */
+    0x5d,                       /* pop rbp */
+    0x5b,                       /* pop rbx */
+    0xc3,                       /* ret */
+  };
+
+  out = code;
+
+  enter = (void (*)(struct state*, void*))out;
+  memcpy(out, save, sizeof(save));
+  out += sizeof(save);
+  op(OP_W, 0x89, RDI, R(REG_ST));
+  mov_imm64(REG_MEM, (uintptr_t)memory);
+  mov_imm64(REG_DIRTY, (uintptr_t)dirty_pages);
+  mov_load(REG_A, ST(a));
+  mov_load(REG_X, ST(x));
+  mov_load(REG_Y, ST(y));
+  op(0, 0xff, 4, R(RSI));
+
+  exit_stub = out;
+  mov_store(ST(a), REG_A);
+  mov_store(ST(x), REG_X);
+  mov_store(ST(y), REG_Y);
+  memcpy(out, restore, sizeof(restore));
+  out += sizeof(restore);
+
+  code_start = out;
+}
+
+void c64_jit_init(uint8_t* mem, uint32_t* dirty, uint32_t* cyc, uint32_t* insns)
+{
+  memory = mem;
+  dirty_pages = dirty;
+  cycles = cyc;
+  instructions = insns;
+
+  if (!code) {
+    code = mmap(NULL, C64_JIT_CODE_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC,
+                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (code == MAP_FAILED) {
+      abort();
+    }
+  }
+
+  emit_stubs();
+  flush();
+  memset(rewrites, 0, sizeof(rewrites));
+  memset(&stats, 0, sizeof(stats));
+}
+
+bool c64_jit_run(struct mos6510* cpu)
+{
+  bool ran = false;
+  void* block;
+
+  st.a = cpu->a;
+  st.x = cpu->x;
+  st.y = cpu->y;
+  st.s = cpu->s;
+  st.pc = cpu->pc;
+  set_p(cpu->p);
+
+  while (st.pc > 1) {
+    block = table[st.pc];
+    if (!block) {
+      block = translate(st.pc);
+    }
+    if (!block)
+      break;
+
+    enter(&st, block);
+    ran = true;
+  }
+
+  if (!ran) {
+    stats.fallbacks++;
+  }
+
+  cpu->a = st.a;
+  cpu->x = st.x;
+  cpu->y = st.y;
+  cpu->s = st.s;
+  cpu->p = get_p();
+  cpu->pc = st.pc;
+
+  return ran;
+}
+
+void c64_jit_write(uint16_t addr)
+{
+  if (st.code_map[addr]) {
+    code_written(addr);
+    st.stop = 0;
+  }
+}
+
+void c64_jit_invalidate(uint16_t addr, uint32_t size)
+{
+  if (size) {
+    invalidate(addr, size);
+  }
+}
+
+void c64_jit_flush(void)
+{
+  flush();
+  memset(rewrites, 0, sizeof(rewrites));
+  stats.flushes++;
+}
+
+void c64_jit_get_stats(struct c64_jit_stats* s)
+{
+  *s = stats;
+  s->code_bytes = out - code;
+}
+
+#endif /* C64_JIT */
@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef C64_JIT_H
+#define C64_JIT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "mos6510.h"
+
+/*
+ * Translates the code of the live machine into x86-64 code, for the host
+ * tools only. It is built when C64_JIT is defined and src/c64_jit.c is
+ * linked in, the board never has it. c64_cpu_set_jit() turns it on.
+ *
+ * A block is the code from an entry up to the next branch, jump, call or
+ * return. Blocks jump to each other through a table with one entry per
+ * address, an address without a block goes back to C, which translates it.
+ * RAM accesses are inline, addresses that can be the SID call sid_peek() and
+ * sid_poke() with the cycle counter up to date. Stores check a map of the
+ * bytes that were translated, a store into one drops the blocks holding it
+ * and leaves the block it was made in.
+ *
+ * Instructions the interpreter runs instead: code in the I/O area or
+ * wrapping around the end of memory, and code that was changed more than
+ * once after it was translated. Undocumented opcodes are translated as the
+ * one byte no-ops the interpreter makes of them.
+ */
+#define C64_JIT_CODE_SIZE       (8 << 20)
+#define C64_JIT_MAX_BLOCKS      32768
+#define C64_JIT_BLOCK_INSNS     64
+
+/* Writes into translated code before an instruction is left to the interpreter */
+#define C64_JIT_MAX_REWRITES    2
+
+struct c64_jit_stats
+{
+    uint32_t blocks;            /* translated */
+    uint32_t insns;             /* translated */
+    uint32_t code_bytes;        /* in use */
+    uint32_t invalidated;       /* blocks dropped by stores into them */
+    uint32_t flushes;           /* times all blocks were dropped */
+    uint32_t fallbacks;         /* instructions left to the interpreter */
+};
+
+#ifdef C64_JIT
+
+void c64_jit_init(uint8_t* memory, uint32_t* dirty, uint32_t* cycles, uint32_t* instructions);
+
+/*
+ * Runs translated code from cpu->pc on until the call returns or an
+ * instruction has to run on the interpreter. p is the whole status
+ * register. Returns false when not a single instruction ran.
+ */
+bool c64_jit_run(struct mos6510* cpu);
+
+/* Memory changed outside translated code */
+void c64_jit_write(uint16_t addr);
+void c64_jit_invalidate(uint16_t addr, uint32_t size);
+void c64_jit_flush(void);
+
+void c64_jit_get_stats(struct c64_jit_stats* stats);
+
+#endif /* C64_JIT */
+
+#endif /* C64_JIT_H */
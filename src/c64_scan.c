@@ -0,0 +1,463 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Code scan for the predecoded core, see c64_scan.h.
+ *
+ * The scan runs on the image as it is after the init routine, so code that
+ * init patches is seen in its final form. Instruction lengths follow the
+ * interpreter, which does not consume operands of the undocumented NOPs.
+ * Anything the scan can not prove is either checked at run time or makes
+ * the tune stay on the generic core:
+ *
+ *  - a store to a fixed address inside scanned code is self modifying code
+ *  - undocumented opcodes are not handled by the predecoded core
+ *  - code in the stack page could be overwritten by any push
+ *  - indexed and indirect operands that may reach the SID or code are
+ *    checked on every access, a store that does hit code stops the
+ *    predecoded core
+ *  - JMP (ind) and RTS can reach code the scan did not see, the predecoded
+ *    core stops there too
+ */
+
+#include "c64_scan.h"
+#include "c64.h"
+#include "mos6510.h"
+
+#include <string.h>
+
+#define IO_FIRST  0xd400
+#define IO_LAST   0xd7ff
+
+static struct c64_scan* scan;
+static uint8_t slot_page[C64_SCAN_MAX_PAGES];
+
+static uint32_t* entry_at(uint16_t addr)
+{
+  uint8_t page = addr >> 8;
+  uint8_t slot = scan->page_slot[page];
+
+  if (slot == C64_SCAN_NO_PAGE) {
+    if (scan->n_pages == C64_SCAN_MAX_PAGES) {
+      scan->info.overflow = true;
+      return NULL;
+    }
+
+    slot = scan->n_pages++;
+    scan->page_slot[page] = slot;
+    slot_page[slot] = page;
+    memset(&scan->entry[slot * 256], 0, 256 * sizeof(scan->entry[0]));
+  }
+
+  return &scan->entry[slot * 256 + (addr & 0xff)];
+}
+
+static void set_flags(uint32_t* entry, uint8_t flags)
+{
+  *entry |= (uint32_t)flags << 24;
+}
+
+static bool is_code(uint16_t addr)
+{
+  uint8_t slot = scan->page_slot[addr >> 8];
+
+  if (slot == C64_SCAN_NO_PAGE)
+    return false;
+
+  return C64_SCAN_FLAGS(scan->entry[slot * 256 + (addr & 0xff)]) &
+         (C64_SCAN_START | C64_SCAN_CODE);
+}
+
+static bool range_has_code(uint16_t first, uint16_t last)
+{
+  for (uint32_t addr = first; addr <= last; addr++) {
+    if (is_code(addr))
+      return true;
+  }
+
+  return false;
+}
+
+static uint8_t insn_length(uint8_t type, uint8_t mode)
+{
+  if (type == MOS6510_TYPE_NOP || type >= MOS6510_TYPE_XXX)
+    return 1;
+
+  switch (mode) {
+    case MOS6510_MODE_IMM:
+    case MOS6510_MODE_ZP:
+    case MOS6510_MODE_ZPX:
+    case MOS6510_MODE_ZPY:
+    case MOS6510_MODE_INDX:
+    case MOS6510_MODE_INDY:
+    case MOS6510_MODE_REL:
+      return 2;
+
+    case MOS6510_MODE_ABS:
+    case MOS6510_MODE_ABSX:
+    case MOS6510_MODE_ABSY:
+    case MOS6510_MODE_IND:
+      return 3;
+  }
+
+  return 1;
+}
+
+static uint16_t decode_arg(uint16_t pc, uint8_t mode)
+{
+  uint16_t word = c64_getmem(pc + 1) | (c64_getmem(pc + 2) << 8);
+
+  switch (mode) {
+    case MOS6510_MODE_IMM:
+      return pc + 1;
+
+    case MOS6510_MODE_ZP:
+    case MOS6510_MODE_ZPX:
+    case MOS6510_MODE_ZPY:
+    case MOS6510_MODE_INDX:
+    case MOS6510_MODE_INDY:
+      return c64_getmem(pc + 1);
+
+    case MOS6510_MODE_REL:
+      return pc + 2 + (int8_t)c64_getmem(pc + 1);
+
+    case MOS6510_MODE_ABS:
+    case MOS6510_MODE_ABSX:
+    case MOS6510_MODE_ABSY:
+    case MOS6510_MODE_IND:
+      return word;
+  }
+
+  return 0;
+}
+
+/* Modes where the decoded operand is all the core needs */
+static bool is_direct(uint8_t mode)
+{
+  switch (mode) {
+    case MOS6510_MODE_IMP:
+    case MOS6510_MODE_IMM:
+    case MOS6510_MODE_ZP:
+    case MOS6510_MODE_ABS:
+    case MOS6510_MODE_REL:
+      return true;
+  }
+
+  return false;
+}
+
+static bool is_branch(uint8_t type)
+{
+  switch (type) {
+    case MOS6510_TYPE_BCC:
+    case MOS6510_TYPE_BCS:
+    case MOS6510_TYPE_BEQ:
+    case MOS6510_TYPE_BMI:
+    case MOS6510_TYPE_BNE:
+    case MOS6510_TYPE_BPL:
+    case MOS6510_TYPE_BVC:
+    case MOS6510_TYPE_BVS:
+      return true;
+  }
+
+  return false;
+}
+
+static bool is_store(uint8_t type, uint8_t mode)
+{
+  switch (type) {
+    case MOS6510_TYPE_STA:
+    case MOS6510_TYPE_STX:
+    case MOS6510_TYPE_STY:
+    case MOS6510_TYPE_INC:
+    case MOS6510_TYPE_DEC:
+    case MOS6510_TYPE_ASL:
+    case MOS6510_TYPE_LSR:
+    case MOS6510_TYPE_ROL:
+    case MOS6510_TYPE_ROR:
+      return mode != MOS6510_MODE_ACC;
+  }
+
+  return false;
+}
+
+static void walk(uint16_t entry)
+{
+  uint16_t pending[C64_SCAN_MAX_PENDING];
+  uint8_t n_pending = 0;
+
+  pending[n_pending++] = entry;
+
+  while (n_pending) {
+    uint16_t pc = pending[--n_pending];
+
+    for (;;) {
+      uint32_t* entry = entry_at(pc);
+      uint8_t opc, type, mode, len;
+      uint16_t arg, next;
+
+      if (!entry)
+        return;
+
+      if (C64_SCAN_FLAGS(*entry) & C64_SCAN_START)
+        break;
+
+      opc = c64_getmem(pc);
+      type = mos6510_opcode_table[opc].type;
+      mode = mos6510_opcode_table[opc].mode;
+
+      if (type >= MOS6510_TYPE_XXX) {
+        scan->info.illegal = true;
+        break;
+      }
+
+      len = insn_length(type, mode);
+      arg = decode_arg(pc, mode);
+      next = pc + len;
+
+      *entry |= ((uint32_t)type << 16) | arg;
+      set_flags(entry, C64_SCAN_START | len |
+                       (is_direct(mode) ? C64_SCAN_DIRECT : 0));
+      scan->info.insns++;
+
+      for (uint8_t i = 1; i < len; i++) {
+        uint32_t* op = entry_at(pc + i);
+
+        if (!op)
+          return;
+
+        set_flags(op, C64_SCAN_CODE);
+      }
+
+      if (is_branch(type)) {
+        if (n_pending == C64_SCAN_MAX_PENDING) {
+          scan->info.overflow = true;
+          return;
+        }
+        pending[n_pending++] = arg;
+        pc = next;
+        continue;
+      }
+
+      switch (type) {
+        case MOS6510_TYPE_JMP:
+          if (mode == MOS6510_MODE_IND) {
+            scan->info.indirect_jumps++;
+            pc = c64_getmem(arg) | (c64_getmem(arg + 1) << 8);
+            /* Unset vectors point nowhere useful, leave them to run time */
+            if (pc < 0x0200)
+              break;
+          } else {
+            pc = arg;
+          }
+          continue;
+
+        case MOS6510_TYPE_JSR:
+          if (n_pending == C64_SCAN_MAX_PENDING) {
+            scan->info.overflow = true;
+            return;
+          }
+          pending[n_pending++] = next;
+          pc = arg;
+          continue;
+
+        case MOS6510_TYPE_RTS:
+        case MOS6510_TYPE_RTI:
+        case MOS6510_TYPE_BRK:
+          break;
+
+        default:
+          pc = next;
+          continue;
+      }
+
+      break;
+    }
+  }
+}
+
+static void swap_slots(uint8_t a, uint8_t b)
+{
+  uint8_t page_a = slot_page[a];
+  uint8_t page_b = slot_page[b];
+
+  for (int i = 0; i < 256; i++) {
+    uint32_t tmp = scan->entry[a * 256 + i];
+
+    scan->entry[a * 256 + i] = scan->entry[b * 256 + i];
+    scan->entry[b * 256 + i] = tmp;
+  }
+
+  scan->page_slot[page_a] = b;
+  scan->page_slot[page_b] = a;
+  slot_page[a] = page_b;
+  slot_page[b] = page_a;
+}
+
+/*
+ * Put the slots in page order, with empty slots for pages without code in
+ * between, so entry[] can be indexed by address.
+ */
+static void arrange(void)
+{
+  int first = 0xff;
+  int last = 0;
+
+  if (!scan->n_pages)
+    return;
+
+  for (int page = 0; page < 256; page++) {
+    if (scan->page_slot[page] != C64_SCAN_NO_PAGE) {
+      if (page < first) {
+        first = page;
+      }
+      last = page;
+    }
+  }
+
+  scan->info.span = last - first + 1;
+
+  if (last - first >= C64_SCAN_MAX_PAGES) {
+    scan->info.overflow = true;
+    return;
+  }
+
+  /* Empty pages in the window get the unused slots */
+  for (int page = first; page <= last; page++) {
+    if (scan->page_slot[page] == C64_SCAN_NO_PAGE) {
+      entry_at(page << 8);
+    }
+  }
+
+  for (uint8_t slot = 0; slot <= last - first; slot++) {
+    uint8_t from = scan->page_slot[first + slot];
+
+    if (from != slot) {
+      swap_slots(from, slot);
+    }
+  }
+
+  scan->base = first << 8;
+  scan->span = (last - first + 1) * 256;
+}
+
+/* Classify the memory operand of every instruction found by walk() */
+static void classify(void)
+{
+  for (uint8_t slot = 0; slot < scan->n_pages; slot++) {
+    for (int lo = 0; lo < 256; lo++) {
+      uint32_t* entry = &scan->entry[slot * 256 + lo];
+      uint16_t pc = (slot_page[slot] << 8) | lo;
+      uint16_t arg = C64_SCAN_ARG(*entry);
+      uint8_t type, mode;
+      uint32_t first, last;
+
+      if (!(C64_SCAN_FLAGS(*entry) & C64_SCAN_START))
+        continue;
+
+      type = mos6510_opcode_table[c64_getmem(pc)].type;
+      mode = mos6510_opcode_table[c64_getmem(pc)].mode;
+
+      if (type == MOS6510_TYPE_NOP || type == MOS6510_TYPE_JMP ||
+          type == MOS6510_TYPE_JSR)
+        continue;
+
+      switch (mode) {
+        case MOS6510_MODE_IMM:
+        case MOS6510_MODE_ZP:
+        case MOS6510_MODE_ABS:
+          first = last = arg;
+          break;
+
+        case MOS6510_MODE_ZPX:
+        case MOS6510_MODE_ZPY:
+          first = 0x00;
+          last = 0xff;
+          break;
+
+        case MOS6510_MODE_ABSX:
+        case MOS6510_MODE_ABSY:
+          first = arg;
+          last = first + 0xff;
+          break;
+
+        case MOS6510_MODE_INDX:
+        case MOS6510_MODE_INDY:
+          scan->info.guarded_ops++;
+          continue;
+
+        default:
+          continue;
+      }
+
+      /* Indexing past the end of memory wraps, leave that to run time */
+      if (last > 0xffff || (first <= IO_LAST && last >= IO_FIRST)) {
+        if (mode == MOS6510_MODE_ABS) {
+          set_flags(entry, C64_SCAN_IO);
+          scan->info.io_ops++;
+        } else {
+          scan->info.guarded_ops++;
+        }
+        continue;
+      }
+
+      if (is_store(type, mode) && range_has_code(first, last)) {
+        if (first == last) {
+          scan->info.smc = true;
+        }
+        scan->info.guarded_ops++;
+        continue;
+      }
+
+      set_flags(entry, C64_SCAN_RAM);
+      scan->info.ram_ops++;
+    }
+  }
+}
+
+enum c64_core c64_scan_code(struct c64_scan* s, uint16_t entry)
+{
+  scan = s;
+
+  memset(scan->page_slot, C64_SCAN_NO_PAGE, sizeof(scan->page_slot));
+  memset(&scan->info, 0, sizeof(scan->info));
+  scan->n_pages = 0;
+  scan->base = 0;
+  scan->span = 0;
+
+  walk(entry);
+
+  scan->info.pages = scan->n_pages;
+
+  if (!scan->info.overflow) {
+    arrange();
+    classify();
+  }
+
+  scan->info.stack_code = scan->page_slot[0x01] != C64_SCAN_NO_PAGE;
+
+  if (scan->info.illegal || scan->info.smc || scan->info.stack_code ||
+      scan->info.overflow) {
+    scan->span = 0;
+    return C64_CORE_GENERIC;
+  }
+
+  return C64_CORE_PREDECODED;
+}
+
+const char* c64_core_name(enum c64_core core)
+{
+  switch (core) {
+    case C64_CORE_GENERIC:
+      return "generic";
+    case C64_CORE_PREDECODED:
+      return "predecoded";
+    case C64_CORE_AOT:
+      return "aot";
+    case C64_CORE_JIT:
+      return "jit";
+  }
+
+  return "unknown";
+}
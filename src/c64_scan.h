@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef C64_SCAN_H
+#define C64_SCAN_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Load time analysis of the code reachable from an entry point. The scan
+ * follows branches, jumps and subroutine calls through the loaded image and
+ * records, for every page holding code, which bytes are instructions along
+ * with their decoded type and operand. Every operand address is classified
+ * so a core running from the scan can skip the checks it makes unnecessary.
+ */
+
+/*
+ * Pages of code that can be predecoded, 1 KB of RAM each. The pages have to
+ * be consecutive so the core finds an instruction with a single compare.
+ */
+#define C64_SCAN_MAX_PAGES      12
+#define C64_SCAN_NO_PAGE        0xff
+
+/* Branch targets waiting to be followed */
+#define C64_SCAN_MAX_PENDING    64
+
+/*
+ * Every byte of a code page has a 32 bit entry. The low half is the operand
+ * with the instruction bytes already decoded: the address for immediate,
+ * zero page and absolute modes, the base address for indexed and indirect
+ * modes, the target for branches, jumps and calls. Above it are the
+ * instruction type and these flags.
+ */
+#define C64_SCAN_LEN            0x03  /* length of the instruction */
+#define C64_SCAN_START          0x04  /* first byte of an instruction */
+#define C64_SCAN_CODE           0x08  /* operand byte */
+#define C64_SCAN_RAM            0x10  /* operand can only be plain RAM */
+#define C64_SCAN_IO             0x20  /* operand is always a SID register */
+#define C64_SCAN_DIRECT         0x40  /* operand is the effective address */
+
+#define C64_SCAN_ARG(entry)     ((uint16_t)(entry))
+#define C64_SCAN_TYPE(entry)    ((uint8_t)((entry) >> 16))
+#define C64_SCAN_FLAGS(entry)   ((uint8_t)((entry) >> 24))
+
+enum c64_core
+{
+    C64_CORE_GENERIC,
+    C64_CORE_PREDECODED,
+    C64_CORE_AOT,             /* translated by tools/sidaot.c, see c64_aot.h */
+    C64_CORE_JIT,             /* host tools built with C64_JIT, see c64_jit.h */
+};
+
+struct c64_scan_info
+{
+    uint16_t insns;           /* instructions found */
+    uint8_t  pages;           /* pages holding code */
+    uint8_t  span;            /* pages from the first to the last of them */
+    uint16_t ram_ops;         /* memory operands proven to be plain RAM */
+    uint16_t io_ops;          /* memory operands proven to be the SID */
+    uint16_t guarded_ops;     /* memory operands checked at run time */
+    uint16_t indirect_jumps;  /* JMP (ind), followed through the current vector */
+    bool     smc;             /* code stores to a fixed address inside code */
+    bool     illegal;         /* reaches an undocumented or jamming opcode */
+    bool     stack_code;      /* code in the stack page */
+    bool     overflow;        /* code spread too wide or too many branches */
+};
+
+struct c64_scan
+{
+    uint8_t  page_slot[256];
+    uint32_t entry[C64_SCAN_MAX_PAGES * 256];
+    uint8_t  n_pages;
+    uint16_t base;            /* address of entry[0] */
+    uint16_t span;            /* bytes covered by entry[] */
+    struct c64_scan_info info;
+};
+
+enum c64_core c64_scan_code(struct c64_scan* scan, uint16_t entry);
+
+const char* c64_core_name(enum c64_core core);
+
+#endif /* C64_SCAN_H */
@@ -11,16 +11,538 @@
 #include <drivers/spi.h>
 #include <soc.h>
 #include <stdint.h>
+#include <stddef.h>
+#include <string.h>
 
 #include "c64.h"
+#include "c64_aot.h"
 #include "sid_spi.h"
 #include "sid.h"
+#include "sid_proto.h"
 #include "sid_file.h"
+#include "sid_seek.h"
+#include "sid_digi.h"
+#include "sid_playlist.h"
+#include "sid_stream.h"
+#include "sid_uart.h"
+#include "sid_upload.h"
+#include "sid_shell.h"
+#include "sid_power.h"
+#include "sid_clock.h"
+#include "sid_multi.h"
+#include "sid_live.h"
+
+#ifdef SID_BENCH
+#include "sid_bench.h"
+#endif
 
 volatile int n_refresh_cia;
 
 K_TIMER_DEFINE(sid_timer, NULL, NULL);
 
+enum source
+{
+  SOURCE_PLAYLIST,
+  SOURCE_STREAM,        /* pre-rendered, no emulation */
+  SOURCE_UPLOAD,        /* sent over the UART or run on after a stream, only in C64 memory */
+  SOURCE_LIVE,          /* frames from the host, emulated there */
+};
+
+static enum source source;
+static struct sid_info upload_info;
+static uint8_t uart_buf[SID_UPLOAD_MAX_DATA + 5];
+
+/* Tune in flash and song of every playlist entry */
+static uint8_t playlist_tunes[SID_PLAYLIST_MAX_TUNES];
+static uint8_t playlist_songs[SID_PLAYLIST_MAX_TUNES];
+
+/* What plays again when a live stream ends */
+static uint8_t live_return_tune;
+static uint8_t live_return_song;
+
+/* Published to the shell after every frame */
+static struct sid_shell_status player = { .speed = 100 };
+
+/* The frame of the tune's clock, and the timer period after the speed */
+static uint32_t frame_us;
+static uint32_t period_us;
+static uint32_t last_start;
+
+/* Frame timing on the digi timer, tick_us is when the next frame is due */
+static uint32_t frame_start_us;
+static uint32_t tick_us;
+static bool tick_valid;
+static uint32_t stats_start;
+static struct sid_proto_stats link_base;
+static uint8_t paused_regs[SID_NUM_REGS];
+
+static void set_speed(uint16_t speed)
+{
+  period_us = frame_us * 100 / speed;
+  k_timer_start(&sid_timer, K_USEC(period_us), K_USEC(period_us));
+
+  player.speed = speed;
+  last_start = 0;
+  tick_valid = false;
+  sid_power_set_period(period_us);
+}
+
+/* An NTSC tune gets NTSC frames, its writes are converted to the PAL chip */
+static void set_clock(uint8_t clock)
+{
+  sid_set_clock(clock);
+  player.clock = clock;
+  frame_us = sid_clock_frame_us(clock);
+  set_speed(player.speed);
+}
+
+/*
+ * The chosen tune first, then the other tunes in flash at their start song,
+ * each for the default length. Streams have no play routine and stay out.
+ */
+static void fill_playlist(uint8_t tune, uint8_t song)
+{
+  uint8_t n = 0;
+
+  sid_playlist_init();
+
+  for (uint8_t i = 0; i < sid_num_files && n < SID_PLAYLIST_MAX_TUNES; i++) {
+    uint8_t index = (tune + i) % sid_num_files;
+    const struct sid_file_entry* f = &sid_files[index];
+    struct sid_info info;
+
+    if (!i) {
+      info.start_song = song;
+    } else if (!sid_parse_header(f->data, f->size, &info)) {
+      continue;
+    }
+
+    if (sid_playlist_add(f->data, f->size, info.start_song, SID_PLAYLIST_DEFAULT_FRAMES)) {
+      playlist_tunes[n] = index;
+      playlist_songs[n] = info.start_song;
+      n++;
+    }
+  }
+}
+
+static void start_tune(uint8_t tune, uint8_t song)
+{
+  const struct sid_file_entry* f = &sid_files[tune];
+
+  /* A live stream that is still sending is dropped up to its next start */
+  sid_live_reset();
+  sid_digi_reset();
+  player.tune = tune;
+  player.song = song;
+  player.subsongs = 0;
+  player.paused = false;
+
+  if (sid_stream_init(f->data, f->size)) {
+    source = SOURCE_STREAM;
+    player.seekable = sid_stream_seekable();
+    set_clock(sid_stream_clock());
+    printk("playing a %u frame stream\n", sid_stream_length());
+  } else {
+    source = SOURCE_PLAYLIST;
+    fill_playlist(tune, song);
+    if (!sid_playlist_start()) {
+      printk("tune %u does not load\n", tune + 1);
+    }
+    player.subsongs = sid_playlist_info()->subsongs;
+    player.seekable = true;
+    set_clock(sid_playlist_info()->clock);
+
+    printk("play routine runs on the %s core, %s clock\n",
+           c64_core_name(c64_cpu_get_core()), sid_clock_name(player.clock));
+  }
+  sid_flush();
+}
+
+static void play_frame(void)
+{
+  sid_digi_frame();
+
+  switch (source) {
+    case SOURCE_STREAM:
+      if (sid_stream_frame()) {
+        player.position = sid_stream_position();
+      } else if (sid_stream_restore(sid_stream_position(), &upload_info)) {
+        /* A keyframed stream that has ended is emulated on from its tune */
+        c64_cpu_optimize(upload_info.play_addr, NULL);
+        source = SOURCE_UPLOAD;
+        player.seekable = false;
+        c64_cpu_jsr(upload_info.play_addr, 0);
+        player.position++;
+      }
+      sid_flush();
+      break;
+
+    case SOURCE_PLAYLIST:
+      sid_playlist_play();
+      if (sid_playlist_info()->clock != player.clock) {
+        set_clock(sid_playlist_info()->clock);
+      }
+      player.tune = playlist_tunes[sid_playlist_current()];
+      player.song = playlist_songs[sid_playlist_current()];
+      player.subsongs = sid_playlist_info()->subsongs;
+      sid_flush();
+      sid_seek_frame();
+      sid_playlist_idle();
+      player.position = sid_seek_position();
+      break;
+
+    case SOURCE_UPLOAD:
+      c64_cpu_jsr(upload_info.play_addr, 0);
+      sid_flush();
+      player.position++;
+      break;
+
+    case SOURCE_LIVE:
+      sid_live_frame();
+      if (sid_live_get_state() == SID_LIVE_IDLE) {
+        printk("live stream ended\n");
+        start_tune(live_return_tune, live_return_song);
+        break;
+      }
+      if (sid_live_clock() != player.clock) {
+        set_clock(sid_live_clock());
+      }
+      sid_flush();
+      player.position = sid_live_position();
+      break;
+  }
+}
+
+/* The host took over, the SID starts from silence like for an upload */
+static void start_live(void)
+{
+  if (player.tune != SID_SHELL_UPLOAD && player.tune != SID_SHELL_LIVE) {
+    live_return_tune = player.tune;
+    live_return_song = player.song;
+  }
+
+  sid_digi_reset();
+  sid_load_regs((const uint8_t[SID_NUM_REGS]){ 0 });
+  sid_flush();
+
+  source = SOURCE_LIVE;
+  player.tune = SID_SHELL_LIVE;
+  player.song = 0;
+  player.subsongs = 0;
+  player.paused = false;
+  player.seekable = false;
+  player.position = 0;
+  player.speed = 100;
+  set_clock(sid_live_clock());
+
+  printk("live stream from the host, %s clock\n", sid_clock_name(player.clock));
+}
+
+/* Everything that is waiting, a live stream does not wait for answers */
+static void receive_live(const uint8_t* buf, size_t n)
+{
+  do {
+    sid_live_feed(buf, n);
+  } while ((n = sid_uart_read(uart_buf, sizeof(uart_buf), 0)) != 0);
+}
+
+/*
+ * Receives an upload until it is complete, then runs init and the first play
+ * call at once instead of waiting for the next frame. The image is not kept
+ * anywhere else, so an uploaded tune can not seek or be part of the playlist.
+ */
+static void upload(uint32_t start)
+{
+  uint32_t ready;
+  size_t n;
+
+  sid_digi_reset();
+  sid_load_regs((const uint8_t[SID_NUM_REGS]){ 0 });
+  sid_flush();
+
+  while (sid_upload_get_state() == SID_UPLOAD_RECEIVING) {
+    n = sid_uart_read(uart_buf, sizeof(uart_buf), SID_UPLOAD_TIMEOUT_MS);
+    if (!n) {
+      sid_upload_reset();
+    }
+    sid_upload_feed(uart_buf, n);
+  }
+
+  ready = k_cycle_get_32();
+  sid_upload_get_stats(&player.upload);
+  player.upload_ok = sid_upload_get_state() == SID_UPLOAD_READY;
+  player.upload_ms = k_cyc_to_ms_floor32(ready - start);
+  player.first_note_ms = 0;
+  player.uart_overruns = sid_uart_get_overruns();
+
+  if (!player.upload_ok) {
+    printk("upload failed\n");
+    start_tune(player.tune < sid_num_files ? player.tune : 0, player.song);
+    return;
+  }
+
+  sid_upload_reset();
+
+  upload_info = *sid_upload_info();
+  c64_cpu_jsr(upload_info.init_addr, upload_info.start_song);
+  if (upload_info.play_addr == 0) {
+    upload_info.play_addr = (c64_getmem(0x0315) << 8) | c64_getmem(0x0314);
+  }
+  c64_cpu_optimize(upload_info.play_addr, NULL);
+
+  source = SOURCE_UPLOAD;
+  player.tune = SID_SHELL_UPLOAD;
+  player.song = upload_info.start_song;
+  player.subsongs = upload_info.subsongs;
+  player.paused = false;
+  player.seekable = false;
+  player.position = 0;
+  set_clock(upload_info.clock);
+  play_frame();
+  player.first_note_ms = k_cyc_to_ms_floor32(k_cycle_get_32() - start);
+}
+
+/* Back to a single tune, the bridges are silent and the live memory is lost */
+static void stop_multi(void)
+{
+  if (!sid_multi_players())
+    return;
+
+  sid_multi_stop();
+  sid_set_regs((const uint8_t[SID_NUM_REGS]){ 0 });
+  memset(&player.multi, 0, sizeof(player.multi));
+}
+
+/* A tune per bridge, tunes holds their numbers 8 bits each */
+static void start_multi(uint8_t players, uint32_t tunes)
+{
+  stop_multi();
+  sid_multi_init();
+
+  for (uint8_t i = 0; i < players; i++) {
+    const struct sid_file_entry* f = &sid_files[(tunes >> (i * 8)) & 0xff];
+    struct sid_info info;
+
+    if (sid_parse_header(f->data, f->size, &info)) {
+      sid_multi_add(f->data, f->size, info.start_song);
+      player.multi_tunes[i] = (tunes >> (i * 8)) & 0xff;
+    }
+  }
+
+  k_timer_stop(&sid_timer);
+  sid_digi_reset();
+  player.paused = false;
+  player.seekable = false;
+
+  printk("%u of %u players started\n", sid_multi_start(), sid_multi_players());
+}
+
+/* Silences the SID by its volume, resuming restores the registers */
+static void set_paused(bool paused)
+{
+  uint8_t regs[SID_NUM_REGS];
+
+  if (paused == player.paused)
+    return;
+
+  if (paused) {
+    sid_get_regs(paused_regs);
+    memcpy(regs, paused_regs, sizeof(regs));
+    regs[0x18] &= 0xf0;
+    sid_load_regs(regs);
+  } else {
+    sid_load_regs(paused_regs);
+  }
+  sid_flush();
+
+  player.paused = paused;
+}
+
+static void reset_stats(void)
+{
+  memset(&player.elapsed_ms, 0,
+         sizeof(player) - offsetof(struct sid_shell_status, elapsed_ms));
+  sid_proto_get_stats(&link_base);
+  stats_start = k_uptime_get_32();
+  last_start = 0;
+  sid_power_reset_stats();
+  sid_digi_reset_stats();
+}
+
+/* Requests from the shell, taken between two frames */
+static void handle_requests(void)
+{
+  struct sid_shell_request req;
+
+  while (sid_shell_get_request(&req)) {
+    switch (req.cmd) {
+      case SID_SHELL_LOAD:
+        stop_multi();
+        start_tune(req.arg, req.arg2);
+        break;
+
+      case SID_SHELL_PAUSE:
+      case SID_SHELL_RESUME:
+        if (!sid_multi_players()) {
+          set_paused(req.cmd == SID_SHELL_PAUSE);
+        }
+        break;
+
+      case SID_SHELL_SEEK:
+        if (sid_multi_players()) {
+          break;
+        } else if (source == SOURCE_PLAYLIST) {
+          sid_seek_to(req.arg);
+          player.position = sid_seek_position();
+        } else if (source == SOURCE_STREAM && sid_stream_seek(req.arg)) {
+          player.position = sid_stream_position();
+        }
+        break;
+
+      case SID_SHELL_SPEED:
+        if (!sid_multi_players()) {
+          set_speed(req.arg);
+        }
+        break;
+
+      case SID_SHELL_RESET_STATS:
+        reset_stats();
+        sid_multi_reset_stats();
+        sid_live_reset_stats();
+        break;
+
+      case SID_SHELL_POWER:
+        player.power_saving = req.arg;
+        break;
+
+      case SID_SHELL_AOT:
+        player.aot = req.arg;
+        c64_set_aot(player.aot ? sid_aot_routines : NULL, player.aot ? sid_aot_n_routines : 0);
+        break;
+
+      case SID_SHELL_MULTI:
+        if (req.arg) {
+          start_multi(req.arg, req.arg2);
+        } else if (sid_multi_players()) {
+          stop_multi();
+          start_tune(player.tune < sid_num_files ? player.tune : 0, player.song);
+        }
+        break;
+    }
+
+    player.commands++;
+  }
+}
+
+/* Until the shell ends it, every player keeps its own time */
+static void play_multi(void)
+{
+  while (sid_multi_players()) {
+    sid_multi_poll();
+    handle_requests();
+
+    player.elapsed_ms = k_uptime_get_32() - stats_start;
+    sid_multi_get_stats(&player.multi);
+    sid_shell_publish(&player);
+  }
+}
+
+/*
+ * Waits for the next frame in the state sid_power_choose() picks and returns
+ * the timer periods that passed, like k_timer_status_sync(). Deep sleep needs
+ * a known frame time and no digi writes, their timer interrupt would wait for
+ * the flash.
+ */
+static uint32_t wait_frame(void)
+{
+  enum sid_power_state state = SID_POWER_SLEEP;
+  uint32_t now = sid_digi_timer_now();
+  uint32_t wait_start = now;
+  int32_t left = (int32_t)(tick_us - now);
+  uint32_t expired;
+  uint32_t expected;
+  uint32_t latency = 0;
+
+  if (player.power_saving) {
+    state = sid_power_choose(now - frame_start_us, tick_valid && left > 0 ? left : 0,
+                             tick_valid && sid_digi_regs() == 0);
+  }
+
+  if (state == SID_POWER_DEEP) {
+    uint32_t wake = tick_us - sid_power_reserve();
+
+    sid_power_deep_enter();
+    k_sleep(K_USEC(wake - now));
+    sid_power_deep_exit();
+
+    sid_power_woke(MAX((int32_t)(sid_digi_timer_now() - wake), 0));
+  }
+
+  if (state == SID_POWER_POLL) {
+    while ((expired = k_timer_status_get(&sid_timer)) == 0) {
+    }
+  } else {
+    expired = k_timer_status_sync(&sid_timer);
+  }
+
+  now = sid_digi_timer_now();
+  expected = tick_us + period_us * (expired - 1);
+
+  /* The first frame, and one after a speed change, sets the time base */
+  if (!tick_valid || (int32_t)(now - expected) >= (int32_t)period_us) {
+    expected = now;
+    tick_valid = true;
+  }
+  latency = MAX((int32_t)(now - expected), 0);
+  tick_us = expected + period_us;
+  frame_start_us = now;
+
+  if (player.power_saving) {
+    sid_power_started(state, now - wait_start, latency);
+  }
+
+  return expired;
+}
+
+/* Frame start timing, expired is the number of timer periods since the last */
+static void count_start(uint32_t start, uint32_t expired)
+{
+  uint32_t overruns = expired > 1 ? expired - 1 : 0;
+  uint32_t jitter = 0;
+
+  if (last_start) {
+    uint32_t us = k_cyc_to_us_floor32(start - last_start);
+
+    jitter = us > period_us ? us - period_us : period_us - us;
+  }
+  last_start = start;
+
+  player.overruns += overruns;
+  player.jitter_max_us = MAX(player.jitter_max_us, jitter);
+
+  if (sid_shell_busy()) {
+    player.busy_frames++;
+    player.busy_overruns += overruns;
+    player.busy_jitter_max_us = MAX(player.busy_jitter_max_us, jitter);
+  }
+}
+
+static void count_play(uint32_t start, uint32_t start_cycles)
+{
+  uint32_t us = k_cyc_to_us_floor32(k_cycle_get_32() - start);
+  struct sid_proto_stats link;
+
+  sid_proto_get_stats(&link);
+
+  player.frames++;
+  player.play_sum_us += us;
+  player.play_sum_cycles += c64_cpu_cycles() - start_cycles;
+  player.core = c64_cpu_get_core();
+  player.play_max_us = MAX(player.play_max_us, us);
+  player.writes = link.writes - link_base.writes;
+  player.spi_bytes = link.bytes - link_base.bytes;
+}
+
 void main(void)
 {
   uint8_t status;
@@ -30,26 +552,80 @@ void main(void)
     goto error_out;
   }
 
+  sid_digi_timer_init();
+  sid_uart_init();
+
+  sid_proto_init(SID_PROTO_DEFAULT_MODE, SID_PROTO_DEFAULT_BURST);
+
+  if (SID_PROTO_DEFAULT_TRAIN) {
+    sid_proto_train();
+  }
+  sid_proto_set_verify(SID_PROTO_DEFAULT_VERIFY);
+
   for (uint8_t addr = 0; addr < 0x19; addr++) {
     sid_poke( addr, 0);
   }
+  sid_flush();
+
+  sid_set_chunk_store(sid_chunks, sid_chunks_size);
+
+#ifdef SID_BENCH
+  sid_bench_run();
+#endif
+
+  c64_set_aot(sid_aot_routines, sid_aot_n_routines);
+  player.aot = true;
+  start_tune(0, 0);
+  reset_stats();
 
-  c64_init();
+  player.power_saving = SID_POWER_DEFAULT_ENABLE;
+  sid_power_init(period_us);
 
-  struct sid_info info;
-  sid_load_from_memory(sid_file, sid_file_size, &info);
+  k_timer_start(&sid_timer, K_USEC(period_us), K_USEC(period_us));
+  frame_start_us = sid_digi_timer_now();
 
-  sid_poke(24, 15);
-  c64_cpu_jsr(info.init_addr, 0);
+  for (uint32_t frame = 1; ; frame++) {
+    uint32_t expired = wait_frame();
+    uint32_t start = k_cycle_get_32();
+    uint32_t start_cycles = c64_cpu_cycles();
+    size_t n;
 
-  k_timer_start(&sid_timer, K_MSEC(20), K_MSEC(20));
+    count_start(start, expired);
 
-  while (1) {
-    k_timer_status_sync(&sid_timer);
+    if (!player.paused) {
+      play_frame();
+      count_play(start, start_cycles);
+    }
 
-    c64_cpu_jsr(info.play_addr, 0);
+    /*
+     * An upload begins between two frames and takes over C64 memory, a live
+     * stream takes over the SID
+     */
+    n = sid_uart_read(uart_buf, sizeof(uart_buf), 0);
+    if (n && source == SOURCE_LIVE) {
+      receive_live(uart_buf, n);
+    } else if (n) {
+      uint32_t upload_start = k_cycle_get_32();
+
+      if (sid_live_feed(uart_buf, n) != SID_LIVE_IDLE) {
+        start_live();
+        receive_live(uart_buf, 0);
+      } else if (sid_upload_feed(uart_buf, n) != SID_UPLOAD_IDLE) {
+        upload(upload_start);
+      }
+    }
+
+    handle_requests();
 
     n_refresh_cia = (int)(20000 * (c64_getmem(0xdc04) | (c64_getmem(0xdc05) << 8)) / 0x4c00);
+
+    player.elapsed_ms = k_uptime_get_32() - stats_start;
+    sid_power_get_stats(&player.power);
+    sid_live_get_stats(&player.live);
+    sid_digi_get_stats(&player.digi);
+    sid_shell_publish(&player);
+
+    play_multi();
   }
 
 error_out:
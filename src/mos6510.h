@@ -124,5 +124,6 @@ struct mos6510_opcode {
 };
 
 extern const struct mos6510_opcode mos6510_opcode_table[256];
+extern const uint8_t mos6510_cycle_table[256];
 
 #endif /* MOS6510_H */
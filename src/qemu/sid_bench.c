@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Plays the tunes in flash like sid_render_frame() does on the host, but at
+ * their frame rate, so the digi sender gets the time between the calls it
+ * gets on the board. Prints one line per tune and core:
+ *
+ *   bench <tune> aot on|off <core>: <mean>/<max> insns per call,
+ *         <6510 insns>, <insns per 6510 insn>, <SID writes>,
+ *         <SPI bytes> <hash> (<title>)
+ *
+ * Instructions are means over the frames. The SPI hash comes from the
+ * recording layer, the two runs of a tune without digis write the same.
+ */
+
+#include "sid_bench.h"
+#include "sid_spi_record.h"
+
+#include <string.h>
+#include <zephyr.h>
+#include <sys/printk.h>
+
+#include "c64.h"
+#include "c64_aot.h"
+#include "sid.h"
+#include "sid_clock.h"
+#include "sid_digi.h"
+#include "sid_file.h"
+#include "sid_proto.h"
+
+#ifndef CONFIG_QEMU_ICOUNT
+#error "The benchmark counts instructions with QEMU icount, set CONFIG_QEMU_ICOUNT"
+#endif
+
+struct bench_result
+{
+    uint64_t insns;             /* Cortex-M3, in play calls */
+    uint32_t max_insns;
+    uint64_t c64_insns;
+    enum c64_core core;         /* after the last frame */
+    uint32_t writes;            /* SID registers */
+    struct sid_spi_record spi;
+};
+
+static uint32_t cycles_to_insns(uint32_t cycles)
+{
+  uint64_t ns = (uint64_t)cycles * 1000000000U / sys_clock_hw_cycles_per_sec();
+
+  return (uint32_t)(ns >> CONFIG_QEMU_ICOUNT_SHIFT);
+}
+
+static bool bench_tune(const struct sid_file_entry* f, bool aot,
+                       struct sid_info* info, struct bench_result* r)
+{
+  struct sid_proto_stats link;
+  uint32_t base_writes;
+  uint32_t frame_us;
+
+  if (!sid_parse_header(f->data, f->size, info))
+    return false;
+
+  c64_set_aot(aot ? sid_aot_routines : NULL, aot ? sid_aot_n_routines : 0);
+  sid_digi_reset();
+  c64_init();
+
+  if (!sid_load_payload(f->data, f->size))
+    return false;
+
+  sid_set_clock(info->clock);
+  frame_us = sid_clock_frame_us(info->clock);
+  c64_cpu_jsr(info->init_addr, 0);
+
+  if (info->play_addr == 0) {
+    info->play_addr = (c64_getmem(0x0315) << 8) | c64_getmem(0x0314);
+  }
+
+  c64_cpu_optimize(info->play_addr, NULL);
+  sid_flush();
+
+  memset(r, 0, sizeof(*r));
+  sid_proto_get_stats(&link);
+  base_writes = link.writes;
+  sid_spi_record_reset();
+
+  for (uint32_t frame = 0; frame < SID_BENCH_FRAMES; frame++) {
+    uint32_t frame_start = sid_digi_timer_now();
+    uint32_t start_insns = c64_cpu_instructions();
+    uint32_t start;
+    uint32_t insns;
+    int32_t left_us;
+
+    sid_digi_frame();
+
+    k_sched_lock();
+    start = k_cycle_get_32();
+    c64_cpu_jsr(info->play_addr, 0);
+    insns = cycles_to_insns(k_cycle_get_32() - start);
+    k_sched_unlock();
+
+    sid_flush();
+
+    r->insns += insns;
+    r->max_insns = MAX(r->max_insns, insns);
+    r->c64_insns += c64_cpu_instructions() - start_insns;
+
+    left_us = (int32_t)(frame_us - (sid_digi_timer_now() - frame_start));
+    if (left_us > 0) {
+      k_usleep(left_us);
+    }
+  }
+
+  /* The last digi writes are due one delay after the frame */
+  k_usleep(SID_DIGI_DELAY_US);
+  sid_digi_reset();
+
+  r->core = c64_cpu_get_core();
+  sid_proto_get_stats(&link);
+  r->writes = link.writes - base_writes;
+  sid_spi_record_get(&r->spi);
+
+  return true;
+}
+
+void sid_bench_run(void)
+{
+  printk("bench: %u frames per tune, %u ns per instruction\n",
+         SID_BENCH_FRAMES, 1U << CONFIG_QEMU_ICOUNT_SHIFT);
+
+  for (uint8_t tune = 0; tune < sid_num_files; tune++) {
+    for (int aot = 1; aot >= 0; aot--) {
+      struct sid_info info;
+      struct bench_result r;
+      uint32_t per_insn;
+
+      if (!bench_tune(&sid_files[tune], aot, &info, &r)) {
+        printk("bench %u: not a SID file, skipped\n", tune + 1);
+        break;
+      }
+
+      /* In tenths */
+      per_insn = r.c64_insns ? (uint32_t)(r.insns * 10 / r.c64_insns) : 0;
+
+      printk("bench %u aot %s %s: %u/%u insns per call, %u 6510 insns, %u.%u per 6510 insn,"
+             " %u writes, spi %u bytes %08x (%s)\n",
+             tune + 1, aot ? "on" : "off", c64_core_name(r.core),
+             (uint32_t)(r.insns / SID_BENCH_FRAMES), r.max_insns,
+             (uint32_t)(r.c64_insns / SID_BENCH_FRAMES), per_insn / 10, per_insn % 10,
+             r.writes, r.spi.bytes, r.spi.hash, info.title);
+    }
+  }
+
+  c64_set_aot(NULL, 0);
+  sid_digi_reset();
+}
@@ -0,0 +1,28 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef SID_BENCH_H
+#define SID_BENCH_H
+
+#include <stdint.h>
+
+/*
+ * Benchmark for the QEMU build, main runs it once before the player starts.
+ * Every tune in flash plays SID_BENCH_FRAMES frames on the routines
+ * translated ahead of time and again without them, and the instructions
+ * the emulated Cortex-M3 ran per play call are printed. Streams have no
+ * play routine and are left out.
+ *
+ * QEMU has no cycle counter of its own, under icount every instruction
+ * advances the virtual clock by 2^CONFIG_QEMU_ICOUNT_SHIFT ns, so the
+ * SysTick cycles of a call convert back to instructions. Interrupts stay
+ * on and are counted with the call, the scheduler is locked.
+ */
+#define SID_BENCH_FRAMES    1500
+
+void sid_bench_run(void);
+
+#endif /* SID_BENCH_H */
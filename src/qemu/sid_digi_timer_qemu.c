@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Digi timer hooks for QEMU, which has no TIM2. Microseconds come from the
+ * kernel cycle counter, extended to 64 bits so the conversion does not
+ * jump when it wraps. A wait sleeps to SPIN_US before the deadline and
+ * spins for the rest, like on the board. With icount the virtual clock
+ * follows the instructions run, so the timing is as repeatable as the
+ * code.
+ */
+
+#include "sid_digi.h"
+
+#include <zephyr.h>
+
+#define SPIN_US         20
+
+#define STACK_SIZE      1024
+#define PRIORITY        K_PRIO_COOP(2)
+
+K_SEM_DEFINE(digi_queued, 0, 1);
+K_MUTEX_DEFINE(digi_mutex);
+
+K_THREAD_STACK_DEFINE(digi_stack, STACK_SIZE);
+static struct k_thread digi_thread;
+
+static uint32_t last_cycles;
+static uint64_t high_cycles;
+
+/* Until the oldest write comes within a frame, or forever when there is none */
+static k_timeout_t idle_timeout(void)
+{
+  uint32_t due;
+  int32_t us;
+
+  if (!sid_digi_next_due(&due))
+    return K_FOREVER;
+
+  us = (int32_t)(due - SID_DIGI_FRAME_US - sid_digi_timer_now());
+
+  return us > 0 ? K_USEC(us) : K_NO_WAIT;
+}
+
+static void digi_send_loop(void* p1, void* p2, void* p3)
+{
+  while (1) {
+    if (!sid_digi_send(sid_digi_timer_now() + SID_DIGI_FRAME_US)) {
+      k_sem_take(&digi_queued, idle_timeout());
+    }
+  }
+}
+
+int sid_digi_timer_init(void)
+{
+  last_cycles = k_cycle_get_32();
+
+  k_thread_create(&digi_thread, digi_stack, K_THREAD_STACK_SIZEOF(digi_stack),
+                  digi_send_loop, NULL, NULL, NULL, PRIORITY, 0, K_NO_WAIT);
+
+  return 0;
+}
+
+/* The sender calls it every IDLE_MS, far more often than the counter wraps */
+uint32_t sid_digi_timer_now(void)
+{
+  unsigned int key = irq_lock();
+  uint32_t cycles = k_cycle_get_32();
+  uint32_t us;
+
+  if (cycles < last_cycles) {
+    high_cycles += 1ULL << 32;
+  }
+  last_cycles = cycles;
+  us = (uint32_t)k_cyc_to_us_floor64(high_cycles | cycles);
+
+  irq_unlock(key);
+
+  return us;
+}
+
+void sid_digi_timer_wait(uint32_t until)
+{
+  int32_t sleep_us = (int32_t)(until - SPIN_US - sid_digi_timer_now());
+
+  if (sleep_us > 0) {
+    k_usleep(sleep_us);
+  }
+
+  while ((int32_t)(until - sid_digi_timer_now()) > 0) {
+  }
+}
+
+void sid_digi_timer_wake(void)
+{
+  k_sem_give(&digi_queued);
+}
+
+void sid_digi_lock(void)
+{
+  k_mutex_lock(&digi_mutex, K_FOREVER);
+}
+
+void sid_digi_unlock(void)
+{
+  k_mutex_unlock(&digi_mutex);
+}
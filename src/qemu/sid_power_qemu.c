@@ -0,0 +1,18 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Deep sleep hooks for QEMU, where there is no flash to power down. The
+ * idle states are counted like on the board, a deep sleep is a plain one.
+ */
+
+#include "sid_power.h"
+
+void sid_power_deep_enter(void)
+{
+}
+
+void sid_power_deep_exit(void)
+{
+}
@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * SPI layer for QEMU, which has no bridge to talk to. It records what the
+ * protocol sends instead of clocking it out and offers the default clock
+ * only, so link training has nothing to choose from.
+ */
+
+#include "sid_spi.h"
+#include "sid_spi_record.h"
+
+#include <string.h>
+
+#define FNV_BASIS       2166136261U
+#define FNV_PRIME       16777619U
+
+static uint32_t frequency = SID_SPI_DEFAULT_FREQUENCY;
+static uint8_t selected;
+
+static struct sid_spi_record record = { .hash = FNV_BASIS };
+
+static void add(const uint8_t* tx, size_t len)
+{
+  record.transfers++;
+  record.bytes += len;
+
+  record.hash = (record.hash ^ selected) * FNV_PRIME;
+  while (len--) {
+    record.hash = (record.hash ^ *tx++) * FNV_PRIME;
+  }
+}
+
+void sid_spi_transfer( uint8_t cmd_addr, uint8_t wr_data,
+                       uint8_t* status, uint8_t* rd_data)
+{
+  add((const uint8_t[]){ cmd_addr, wr_data }, 2);
+
+  *status = 0;
+  *rd_data = 0;
+}
+
+void sid_spi_transceive(const uint8_t* tx, uint8_t* rx, size_t len)
+{
+  add(tx, len);
+
+  if (rx) {
+    memset(rx, 0, len);
+  }
+}
+
+int sid_spi_get_rates(uint32_t* rates, int max)
+{
+  if (max < 1)
+    return 0;
+
+  rates[0] = SID_SPI_DEFAULT_FREQUENCY;
+
+  return 1;
+}
+
+void sid_spi_set_frequency(uint32_t hz)
+{
+  frequency = hz;
+}
+
+uint32_t sid_spi_get_frequency(void)
+{
+  return frequency;
+}
+
+void sid_spi_select(uint8_t bridge)
+{
+  if (bridge < SID_SPI_MAX_BRIDGES) {
+    selected = bridge;
+  }
+}
+
+int sid_spi_init(void)
+{
+  sid_spi_select(0);
+
+  return 0;
+}
+
+void sid_spi_record_get(struct sid_spi_record* out)
+{
+  *out = record;
+}
+
+void sid_spi_record_reset(void)
+{
+  memset(&record, 0, sizeof(record));
+  record.hash = FNV_BASIS;
+}
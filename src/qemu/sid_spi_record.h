@@ -0,0 +1,27 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef SID_SPI_RECORD_H
+#define SID_SPI_RECORD_H
+
+#include <stdint.h>
+
+/*
+ * The SPI layer under QEMU. There is no bridge, every transfer is counted
+ * and hashed and reads back zeros, a status byte with an empty FIFO. The
+ * hash tells two runs apart that should have written the same.
+ */
+struct sid_spi_record
+{
+    uint32_t transfers;         /* chip select assertions */
+    uint32_t bytes;
+    uint32_t hash;              /* FNV-1a of the bytes sent, with the bridge */
+};
+
+void sid_spi_record_get(struct sid_spi_record* record);
+void sid_spi_record_reset(void);
+
+#endif /* SID_SPI_RECORD_H */
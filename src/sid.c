@@ -6,30 +6,478 @@
 
 #include "sid.h"
 #include "c64.h"
-#include "sid_spi.h"
+#include "sid_proto.h"
+#include "sid_digi.h"
+#include "sid_voice3.h"
+#include "sid_clock.h"
 
 #include <string.h>
 #include <stdlib.h>
 #include <stdint.h>
 
+/* Bytes a frame with its own chip select costs in blocking mode */
+#define SID_FRAME_OVERHEAD  2
+
+static uint8_t sid_regs[SID_NUM_REGS];
+static bool sid_muted;
+
+/* What the chip got, differs from sid_regs while the clock is converted */
+static uint8_t chip_regs[SID_NUM_REGS];
+
+/* Last value written, what the chip returns for its write only registers */
+static uint8_t bus_value;
+
+/*
+ * Registers written since the last flush. A batch holds at most one value
+ * per register, a second write to the same register sends the batch first
+ * so the chip still sees both values. The order the tune wrote them in is
+ * kept for single writes, a gate bit set before or after the envelope
+ * registers changes how the envelope starts.
+ */
+static uint32_t batch_mask;
+static uint8_t batch_order[SID_NUM_REGS];
+static uint8_t batch_len;
+
+static struct sid_stats stats;
+
+static const uint8_t* chunk_store;
+static size_t chunk_store_size;
+
+/* Pick the cheapest mix of single writes and bursts for the batch */
+static void batch_encode(uint32_t mask, const uint8_t* regs)
+{
+  uint8_t overhead = 0;
+  uint16_t cost[SID_NUM_REGS + 1];
+  uint8_t start[SID_NUM_REGS + 1];
+  uint8_t seg_start[SID_NUM_REGS];
+  uint8_t seg_end[SID_NUM_REGS];
+  uint8_t n_segs = 0;
+  uint8_t count = 0;
+  uint16_t masked_cost;
+  uint32_t digi = sid_digi_regs() & ~mask;
+
+  if (sid_proto_get_mode() == SID_PROTO_MODE_BLOCKING) {
+    overhead = SID_FRAME_OVERHEAD;
+  }
+
+  for (uint32_t m = mask; m; m &= m - 1) {
+    count++;
+  }
+
+  cost[0] = 0;
+  for (int i = 1; i <= SID_NUM_REGS; i++) {
+    cost[i] = 0xffff;
+  }
+
+  for (int i = 0; i < SID_NUM_REGS; i++) {
+    if (!(mask & (1U << i))) {
+      if (cost[i] < cost[i + 1]) {
+        cost[i + 1] = cost[i];
+        start[i + 1] = i;
+      }
+      continue;
+    }
+
+    if (cost[i] + 2 + overhead < cost[i + 1]) {
+      cost[i + 1] = cost[i] + 2 + overhead;
+      start[i + 1] = i;
+    }
+
+    /*
+     * Clean registers inside a burst are rewritten with their old value, digi
+     * registers may already hold a value that is not due yet.
+     */
+    for (int j = i + 1; j < SID_NUM_REGS && j - i < SID_PROTO_MAX_BURST; j++) {
+      uint16_t c = cost[i] + 2 + (j - i + 1) + overhead;
+
+      if (digi & (1U << j))
+        break;
+
+      if ((mask & (1U << j)) && c < cost[j + 1]) {
+        cost[j + 1] = c;
+        start[j + 1] = i;
+      }
+    }
+  }
+
+  masked_cost = 5 + count + overhead;
+  if (count > SID_PROTO_MAX_BURST) {
+    masked_cost += 5 + overhead;
+  }
+
+  if (masked_cost < cost[SID_NUM_REGS]) {
+    while (mask) {
+      uint32_t chunk = 0;
+
+      for (uint8_t n = 0; mask && n < SID_PROTO_MAX_BURST; n++) {
+        chunk |= mask & -mask;
+        mask &= mask - 1;
+      }
+
+      sid_proto_write_masked(chunk, regs);
+    }
+    return;
+  }
+
+  for (int end = SID_NUM_REGS; end > 0; end = start[end]) {
+    if (mask & (1U << start[end])) {
+      seg_start[n_segs] = start[end];
+      seg_end[n_segs] = end;
+      n_segs++;
+    }
+  }
+
+  while (n_segs--) {
+    uint8_t reg = seg_start[n_segs];
+    uint8_t len = seg_end[n_segs] - reg;
+
+    if (len == 1) {
+      sid_proto_write(reg, regs[reg]);
+    } else {
+      sid_proto_write_burst(reg, len, &regs[reg]);
+    }
+  }
+}
+
+void sid_write_regs(uint32_t mask, const uint8_t* regs, const uint8_t* order, uint8_t n)
+{
+  if (sid_proto_has_burst()) {
+    batch_encode(mask, regs);
+    return;
+  }
+
+  for (uint8_t i = 0; i < n; i++) {
+    if (mask & (1U << order[i])) {
+      sid_proto_write(order[i], regs[order[i]]);
+      mask &= ~(1U << order[i]);
+    }
+  }
+
+  for (uint8_t reg = 0; mask; reg++, mask >>= 1) {
+    if (mask & 1) {
+      sid_proto_write(reg, regs[reg]);
+    }
+  }
+}
+
+static void batch_send(void)
+{
+  uint32_t mask = batch_mask;
+  const uint8_t* regs = sid_regs;
+  uint8_t n = batch_len;
+
+  batch_len = 0;
+
+  if (!mask)
+    return;
+
+  batch_mask = 0;
+
+  if (sid_clock_converts()) {
+    mask = sid_clock_convert(sid_regs, chip_regs, mask);
+    regs = chip_regs;
+  }
+
+  sid_write_regs(mask, regs, batch_order, n);
+}
 
 void sid_poke(uint16_t reg, uint8_t val)
 {
-  uint8_t status;
-  uint8_t rd_data;
+  bus_value = val;
+  sid_voice3_write(reg, val);
+
+  if (reg >= SID_NUM_REGS) {
+    if (!sid_muted) {
+      sid_digi_lock();
+      sid_proto_write(reg, val);
+      sid_digi_unlock();
+    }
+    return;
+  }
+
+  if (!sid_muted && sid_digi_capture(reg, val)) {
+    sid_regs[reg] = val;
+    batch_mask &= ~(1U << reg);
+    stats.pokes++;
+    return;
+  }
+
+  if (!sid_muted && (batch_mask & (1U << reg))) {
+    sid_digi_lock();
+    batch_send();
+    sid_digi_unlock();
+  }
 
-  sid_spi_transfer(0x80 | reg, val, &status, &rd_data);
+  sid_regs[reg] = val;
+
+  if (sid_muted)
+    return;
+
+  batch_mask |= 1U << reg;
+  if (batch_len < SID_NUM_REGS) {
+    batch_order[batch_len++] = reg;
+  }
+  stats.pokes++;
 }
 
-bool sid_load_from_memory(const uint8_t* data, size_t size, struct sid_info *info)
+/* Reads are answered here, a round trip to the bridge would stall the tune */
+uint8_t sid_peek(uint16_t reg)
 {
-  if (!data || !size || !info)
+  switch (reg) {
+    case 0x19:
+    case 0x1a:
+      return 0xff;      /* POTX and POTY without paddles */
+    case 0x1b:
+      return sid_voice3_osc();
+    case 0x1c:
+      return sid_voice3_env();
+    default:
+      return bus_value;
+  }
+}
+
+void sid_flush(void)
+{
+  sid_digi_lock();
+
+  batch_send();
+  sid_proto_flush();
+
+  /*
+   * A failed check means any of the writes may be lost, resend them all.
+   * The digi registers are left to their own channel.
+   */
+  if (sid_proto_get_verify() && !sid_proto_check()) {
+    batch_mask = ((1U << SID_NUM_REGS) - 1) & ~sid_digi_regs();
+    batch_send();
+    sid_proto_flush();
+  }
+
+  sid_digi_unlock();
+
+  sid_digi_end_frame();
+  sid_voice3_end_frame();
+
+  stats.frames++;
+}
+
+void sid_set_clock(uint8_t clock)
+{
+  sid_clock_set(clock);
+  sid_digi_set_clock(sid_clock_hz(sid_clock_get()));
+  sid_voice3_set_frame(sid_clock_frame_cycles(sid_clock_get()));
+
+  /* The clock registers go out again, converted or as written */
+  memcpy(chip_regs, sid_regs, SID_NUM_REGS);
+  batch_mask |= SID_CLOCK_REGS;
+}
+
+void sid_get_stats(struct sid_stats* s)
+{
+  *s = stats;
+}
+
+void sid_reset_stats(void)
+{
+  memset(&stats, 0, sizeof(stats));
+}
+
+void sid_mute(bool mute)
+{
+  sid_muted = mute;
+
+  /* Queued digi writes belong to the frames being skipped */
+  if (mute) {
+    sid_digi_reset();
+  }
+}
+
+void sid_flush_regs(void)
+{
+  batch_mask = (1U << SID_NUM_REGS) - 1;
+
+  sid_digi_lock();
+  batch_send();
+  sid_proto_flush();
+  sid_digi_unlock();
+}
+
+void sid_get_regs(uint8_t regs[SID_NUM_REGS])
+{
+  memcpy(regs, sid_regs, SID_NUM_REGS);
+}
+
+void sid_set_regs(const uint8_t regs[SID_NUM_REGS])
+{
+  memcpy(sid_regs, regs, SID_NUM_REGS);
+}
+
+void sid_load_regs(const uint8_t regs[SID_NUM_REGS])
+{
+  for (uint8_t reg = 0; reg < SID_NUM_REGS; reg++) {
+    if (sid_regs[reg] != regs[reg]) {
+      sid_regs[reg] = regs[reg];
+      batch_mask |= 1U << reg;
+    }
+  }
+}
+
+bool sid_is_packed(const uint8_t* data, size_t size)
+{
+  return data && size >= 4 && data[1] == 'S' && data[2] == 'I' && data[3] == 'Z';
+}
+
+bool sid_is_chunked(const uint8_t* data, size_t size)
+{
+  return data && size >= 4 && data[1] == 'S' && data[2] == 'I' && data[3] == 'C';
+}
+
+void sid_set_chunk_store(const uint8_t* store, size_t size)
+{
+  chunk_store = store;
+  chunk_store_size = size;
+}
+
+static uint32_t get_le32(const uint8_t* p)
+{
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/* Copies the chunks of the list in src to memory or to ctx when it is not NULL */
+static bool load_chunks(struct c64_context* ctx, uint16_t load_addr, const uint8_t* src,
+                        size_t src_size, uint16_t size)
+{
+  uint16_t n_chunks;
+  uint16_t n;
+  uint32_t addr = load_addr;
+
+  if (!chunk_store || chunk_store_size < 6 || memcmp(chunk_store, "SIDC", 4) != 0 ||
+      src_size < 2)
+    return false;
+
+  n_chunks = chunk_store[4] | (chunk_store[5] << 8);
+  n = src[0] | (src[1] << 8);
+
+  if (src_size < 2 + n * 2u || chunk_store_size < 6 + (n_chunks + 1) * 4u ||
+      load_addr + (uint32_t)size > 0x10000)
+    return false;
+
+  for (uint16_t i = 0; i < n; i++) {
+    uint16_t id = src[2 + i * 2] | (src[3 + i * 2] << 8);
+    uint32_t start;
+    uint32_t end;
+    uint32_t len;
+
+    if (id >= n_chunks)
+      return false;
+
+    start = get_le32(&chunk_store[6 + id * 4]);
+    end = get_le32(&chunk_store[10 + id * 4]);
+    len = end - start;
+
+    if (end > chunk_store_size || start > end || addr + len > load_addr + (uint32_t)size)
+      return false;
+
+    if (ctx) {
+      if (!c64_context_memcpy(ctx, addr, &chunk_store[start], len))
+        return false;
+    } else {
+      c64_memcpy(addr, &chunk_store[start], len);
+    }
+    addr += len;
+  }
+
+  return addr == load_addr + (uint32_t)size;
+}
+
+/* Where the payload goes and where it is, size is 0 for a raw payload */
+static bool payload_find(const uint8_t* data, size_t size, uint16_t* load_addr,
+                         const uint8_t** src, size_t* src_size, uint16_t* unpacked_size)
+{
+  if (!data || size < 0x7c)
+    return false;
+
+  unsigned char data_file_offset = data[7];
+
+  if (size < data_file_offset + 2u)
+    return false;
+
+  *load_addr = data[data_file_offset];
+  *load_addr|= data[data_file_offset + 1] << 8;
+  *unpacked_size = 0;
+
+  if (sid_is_packed(data, size) || sid_is_chunked(data, size)) {
+    if (size < data_file_offset + 4u)
+      return false;
+
+    *unpacked_size = data[data_file_offset + 2];
+    *unpacked_size|= data[data_file_offset + 3] << 8;
+
+    *src = &data[data_file_offset+4];
+    *src_size = size-(data_file_offset+4);
+  } else {
+    *src = &data[data_file_offset+2];
+    *src_size = size-(data_file_offset+2);
+  }
+
+  return true;
+}
+
+bool sid_load_payload(const uint8_t* data, size_t size)
+{
+  uint16_t load_addr;
+  const uint8_t* src;
+  size_t src_size;
+  uint16_t unpacked_size;
+
+  if (!payload_find(data, size, &load_addr, &src, &src_size, &unpacked_size))
+    return false;
+
+  c64_memset(0, 0, 64 * 1024);
+
+  if (sid_is_packed(data, size))
+    return c64_unpack_lz4(load_addr, src, src_size, unpacked_size);
+
+  if (sid_is_chunked(data, size))
+    return load_chunks(NULL, load_addr, src, src_size, unpacked_size);
+
+  c64_memcpy(load_addr, src, src_size);
+
+  return true;
+}
+
+bool sid_load_context(struct c64_context* ctx, const uint8_t* data, size_t size)
+{
+  uint16_t load_addr;
+  const uint8_t* src;
+  size_t src_size;
+  uint16_t unpacked_size;
+
+  if (!payload_find(data, size, &load_addr, &src, &src_size, &unpacked_size))
+    return false;
+
+  if (sid_is_packed(data, size))
+    return c64_context_unpack_lz4(ctx, load_addr, src, src_size, unpacked_size);
+
+  if (sid_is_chunked(data, size))
+    return load_chunks(ctx, load_addr, src, src_size, unpacked_size);
+
+  return c64_context_memcpy(ctx, load_addr, src, src_size);
+}
+
+bool sid_parse_header(const uint8_t* data, size_t size, struct sid_info *info)
+{
+  if (!data || size < 0x7c || !info)
     return false;
 
   unsigned char data_file_offset;
 
   data_file_offset = data[7];
 
+  if (data[1] != 'S' || data[2] != 'I' || (data[0] != 'P' && data[0] != 'R') ||
+      size < data_file_offset + 2u)
+    return false;
+
   info->load_addr = data[8]<<8;
   info->load_addr|= data[9];
 
@@ -47,12 +495,27 @@ bool sid_load_from_memory(const uint8_t* data, size_t size, struct sid_info *inf
 
   info->speed = data[0x15];
 
-  c64_memset(0, 0, 64 * 1024);
-  c64_memcpy(info->load_addr, &data[data_file_offset+2], size-(data_file_offset+2));
+  /* Version 2 flags, a tune for both clocks plays as PAL */
+  info->clock = SID_CLOCK_PAL;
+  if (data[5] >= 2 && data_file_offset >= 0x7c && (data[0x77] & 0x0c) == 0x08) {
+    info->clock = SID_CLOCK_NTSC;
+  }
+
+  memcpy(info->title, &data[0x16], 32);
+  memcpy(info->author, &data[0x36], 32);
+  memcpy(info->released, &data[0x56], 32);
+  info->title[32] = info->author[32] = info->released[32] = '\0';
+
+  return true;
+}
 
-  strcpy(info->title, (const char*)&data[0x16]);
-  strcpy(info->author, (const char*)&data[0x36]);
-  strcpy(info->released, (const char*)&data[0x56]);
+bool sid_load_from_memory(const uint8_t* data, size_t size, struct sid_info *info)
+{
+  if (!data || !size || !info)
+    return false;
+
+  if (!sid_parse_header(data, size, info) || !sid_load_payload(data, size))
+    return false;
 
   if (info->play_addr == 0)
   {
@@ -11,7 +11,30 @@
 #include <stdbool.h>
 #include <stddef.h>
 
+#define SID_NUM_REGS 0x19
+
+struct sid_stats
+{
+    uint32_t frames;
+    uint32_t pokes;         /* register writes by the tune */
+};
+
 void sid_poke(uint16_t reg, uint8_t val);
+uint8_t sid_peek(uint16_t reg);
+
+/* Send the writes batched since the last call, once per frame */
+void sid_flush(void);
+void sid_get_stats(struct sid_stats* stats);
+
+/* The clock the tune was written for, see sid_clock.h */
+void sid_set_clock(uint8_t clock);
+void sid_reset_stats(void);
+
+/* While muted, writes only update the shadow register file */
+void sid_mute(bool mute);
+void sid_flush_regs(void);
+void sid_get_regs(uint8_t regs[SID_NUM_REGS]);
+void sid_set_regs(const uint8_t regs[SID_NUM_REGS]);
 
 struct sid_info
 {
@@ -21,11 +44,51 @@ struct sid_info
     uint8_t  subsongs;
     uint8_t  start_song;
     uint8_t  speed;
-    char     title[32];
-    char     author[32];
-    char     released[32];
+    uint8_t  clock;             /* enum sid_clock */
+    char     title[33];         /* 32 characters in the file, not always terminated */
+    char     author[33];
+    char     released[33];
 };
 
+/*
+ * Packed images, made by tools/sidpack.c, keep the header but have PSIZ or
+ * RSIZ as magic. Their payload is the load address, the unpacked size (both
+ * little endian) and an LZ4 block. Loading decodes it straight into memory.
+ */
+bool sid_is_packed(const uint8_t* data, size_t size);
+
+/*
+ * Chunked images, made by tools/sidchunk.c, have PSIC or RSIC as magic. Their
+ * payload is the load address, the size and the number of chunks (16 bit
+ * little endian) followed by the 16 bit chunk numbers. The chunks are cut
+ * where the content says so and kept once in a store all chunked images
+ * share, so the player code many tunes have in common is in flash once.
+ * Loading copies the chunks one after the other straight into memory.
+ *
+ * The store is SIDC, the number of chunks (16 bit) and a 32 bit offset from
+ * the start of the store for every chunk plus one for the end, then the
+ * chunks themselves.
+ */
+bool sid_is_chunked(const uint8_t* data, size_t size);
+void sid_set_chunk_store(const uint8_t* store, size_t size);
+
 bool sid_load_from_memory(const uint8_t* data, size_t size, struct sid_info* info);
+bool sid_load_payload(const uint8_t* data, size_t size);
+bool sid_parse_header(const uint8_t* data, size_t size, struct sid_info* info);
+
+/* Load the payload into a background context instead of the live memory */
+struct c64_context;
+bool sid_load_context(struct c64_context* ctx, const uint8_t* data, size_t size);
+
+/* Switch to regs in one go, only the registers that change are sent */
+void sid_load_regs(const uint8_t regs[SID_NUM_REGS]);
+
+/*
+ * Sends the registers in mask from regs the cheapest way the bridge allows,
+ * for machines that keep their own registers. Leaves the shadow registers
+ * and the batch alone. Without bursts the n registers in order go first in
+ * that order, the tune's own, the rest of mask follows in register order.
+ */
+void sid_write_regs(uint32_t mask, const uint8_t* regs, const uint8_t* order, uint8_t n);
 
 #endif /* SID_H */
@@ -0,0 +1,2391 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * The routines tools/sidaot.c translated, see c64_aot.h. The tool writes
+ * this file, run it again instead of editing it.
+ */
+
+#include "c64_aot.h"
+#include "sid.h"
+
+#include <stddef.h>
+
+/*
+ * The CPU is kept in locals, the counters are stored before the SID or the
+ * interpreter can look at them. The flags are kept the way the interpreter
+ * keeps them, nz holds the result that sets Z and n the one that sets N.
+ */
+#define SYNC()          (*m->cycles = cyc, *m->instructions = ins)
+#define NZ(val)         (nz = n = (uint8_t)(val))
+#define DIRTY(addr)     (m->dirty[(addr) >> 13] |= 1U << (((addr) >> 8) & 31))
+#define IO(addr)        (((addr) & 0xfc00) == 0xd400)
+#define READ(addr)      (IO(addr) ? (SYNC(), sid_peek((addr) & 0x1f)) : mem[addr])
+#define WRITE(addr, val) \
+  do { if (IO(addr)) { SYNC(); sid_poke((addr) & 0x1f, (val)); } \
+       else { mem[addr] = (val); DIRTY(addr); } } while (0)
+#define PUSH(val)       (mem[0x100 + s] = (val), DIRTY(0x100), s -= s != 0)
+#define POP()           (s += s < 0xff, mem[0x100 + s])
+#define GET_P()         ((p & ~(MOS6510_FLAG_N | MOS6510_FLAG_V | MOS6510_FLAG_Z | \
+                                MOS6510_FLAG_C)) | (n & MOS6510_FLAG_N) | \
+                         (v ? MOS6510_FLAG_V : 0) | (nz ? 0 : MOS6510_FLAG_Z) | c)
+#define SET_P(val)      (p = (val), n = p, nz = !(p & MOS6510_FLAG_Z), \
+                         c = p & MOS6510_FLAG_C, v = !!(p & MOS6510_FLAG_V))
+#define LEAVE(addr, intact) do { pc = (addr); ok = (intact); goto leave; } while (0)
+
+static const uint8_t init_0800_0_code[] = {
+  0xa9, 0x01, 0x85, 0x76, 0xa9, 0x00, 0x85, 0x6c, 0x60,
+};
+
+static const struct c64_aot_range init_0800_0_ranges[] = {
+  { 0x0800, 9, init_0800_0_code + 0 },
+};
+
+/* src/big_fun_tune_5.sid song 1, 5 instructions */
+static bool init_0800_0(struct c64_aot_machine* m)
+{
+  uint8_t* mem = m->memory;
+  uint32_t cyc = *m->cycles;
+  uint32_t ins = *m->instructions;
+  uint8_t a = m->cpu.a;
+  uint8_t x = m->cpu.x;
+  uint8_t y = m->cpu.y;
+  uint8_t s = m->cpu.s;
+  uint8_t p, n, nz, c, v;
+  uint8_t b;
+  uint16_t pc;
+  bool ok;
+
+  SET_P(m->cpu.p);
+  goto L0800;
+
+dispatch:
+  LEAVE(pc, true);
+
+L0800:
+  /* 0800 lda #$01 */
+  cyc += 2; a = 0x01; NZ(a); ins++;
+  /* 0802 sta $76 */
+  cyc += 3; mem[0x76] = a; DIRTY(0x0076); ins++;
+  /* 0804 lda #$00 */
+  cyc += 2; a = 0x00; NZ(a); ins++;
+  /* 0806 sta $6c */
+  cyc += 3; mem[0x6c] = a; DIRTY(0x006c); ins++;
+  /* 0808 rts */
+  cyc += 6; b = POP(); pc = b; b = POP(); pc = (pc | b << 8) + 1; ins++; goto dispatch;
+
+leave:
+  SYNC();
+  m->cpu.a = a;
+  m->cpu.x = x;
+  m->cpu.y = y;
+  m->cpu.s = s;
+  m->cpu.p = GET_P();
+  m->cpu.pc = pc;
+
+  return ok;
+}
+
+static const uint8_t play_0825_1_code[] = {
+  0xa4, 0x76, 0x30, 0x09, 0xf0, 0x03, 0x4c, 0x1c, 0x0b, 0x8c, 0x18, 0xd4,
+  0x60, 0xa2, 0x02, 0x20, 0x45, 0x08, 0xca, 0x10, 0xfa, 0x86, 0x77, 0xc6,
+  0x0e, 0x10, 0x04, 0xa5, 0x0f, 0x85, 0x0e, 0x60, 0xa5, 0x0e, 0xd0, 0x07,
+  0xd6, 0x0b, 0xd0, 0x03, 0x4c, 0x28, 0x0a, 0xb5, 0x13, 0xd0, 0x2f, 0x95,
+  0x6d, 0x95, 0x70, 0x95, 0x22, 0x95, 0x52, 0x95, 0x4f, 0x95, 0x61, 0x95,
+  0x64, 0x95, 0x67, 0xb4, 0x1c, 0xb9, 0x7b, 0x0c, 0x95, 0x3a, 0xb9, 0x7f,
+  0x0c, 0x29, 0x0f, 0x95, 0x73, 0xb9, 0x7d, 0x0c, 0x48, 0xb9, 0x7e, 0x0c,
+  0xbc, 0x1e, 0x0c, 0x99, 0x06, 0xd4, 0x68, 0x99, 0x05, 0xd4, 0xf6, 0x13,
+  0xb5, 0x43, 0x10, 0x24, 0xb4, 0x46, 0xb9, 0x3f, 0x0c, 0x85, 0xfe, 0xb9,
+  0x43, 0x0c, 0x85, 0xff, 0xb4, 0x3d, 0xb1, 0xfe, 0xc9, 0xff, 0xf0, 0x04,
+  0xf6, 0x3d, 0x95, 0x3a, 0xb4, 0x40, 0xb1, 0xfe, 0xc9, 0x80, 0xf0, 0x04,
+  0xf6, 0x40, 0x95, 0x22, 0xb5, 0x1f, 0x18, 0x75, 0x22, 0xa8, 0xb5, 0x43,
+  0x29, 0x08, 0xd0, 0x06, 0x98, 0x75, 0x25, 0x75, 0x52, 0xa8, 0x84, 0xff,
+  0xb9, 0x5e, 0x0b, 0x95, 0x58, 0xb9, 0xbe, 0x0b, 0x95, 0x5b, 0xb5, 0x13,
+  0xc9, 0x02, 0xd0, 0x0c, 0xb5, 0x43, 0x29, 0x40, 0xf0, 0x06, 0xa9, 0x81,
+  0x95, 0x3a, 0xd0, 0x0f, 0xc9, 0x03, 0xd0, 0x0b, 0xb5, 0x43, 0x30, 0x07,
+  0xb4, 0x1c, 0xb9, 0x7c, 0x0c, 0x95, 0x3a, 0xb5, 0x5e, 0x85, 0x78, 0xf0,
+  0x03, 0x20, 0x05, 0x0a, 0xb5, 0x4c, 0xf0, 0x03, 0x20, 0xd5, 0x09, 0xb4,
+  0x55, 0xf0, 0x09, 0x20, 0xbf, 0x09, 0xb5, 0x43, 0x29, 0x02, 0xd0, 0x1c,
+  0xb5, 0x43, 0x29, 0x01, 0xf0, 0x16, 0xa5, 0x78, 0xf0, 0x06, 0xb5, 0x43,
+  0x29, 0x04, 0xd0, 0x0c, 0xb5, 0x49, 0x29, 0x1c, 0x0a, 0xd5, 0x13, 0xb0,
+  0x03, 0x20, 0x47, 0x09, 0xbc, 0x1e, 0x0c, 0xb5, 0x70, 0x99, 0x02, 0xd4,
+  0xb5, 0x73, 0x99, 0x03, 0xd4, 0xb5, 0x58, 0x18, 0x75, 0x61, 0x99, 0x00,
+  0xd4, 0xb5, 0x5b, 0x75, 0x64, 0x99, 0x01, 0xd4, 0xb5, 0x3a, 0x99, 0x04,
+  0xd4, 0x60, 0xb5, 0x46, 0x29, 0x0f, 0x85, 0x78, 0x46, 0x78, 0xb4, 0x67,
+  0x10, 0x06, 0xd6, 0x6a, 0xd0, 0x0f, 0xf0, 0x08, 0xf6, 0x6a, 0xd5, 0x6a,
+  0xb0, 0x07, 0x95, 0x6a, 0x98, 0x49, 0xff, 0x95, 0x67, 0xa4, 0xff, 0xb9,
+  0x5f, 0x0b, 0x38, 0xf5, 0x58, 0x85, 0xfe, 0xb9, 0xbf, 0x0b, 0xf5, 0x5b,
+  0xb4, 0x46, 0x10, 0x02, 0x75, 0x13, 0x85, 0xff, 0xb5, 0x46, 0x29, 0x70,
+  0x4a, 0x4a, 0x4a, 0x4a, 0xa8, 0x46, 0xff, 0x66, 0xfe, 0x88, 0x10, 0xf9,
+  0xa5, 0x78, 0x38, 0xf5, 0x6a, 0x30, 0x14, 0xa8, 0x88, 0x30, 0x26, 0xb5,
+  0x58, 0x18, 0x65, 0xfe, 0x95, 0x58, 0xb5, 0x5b, 0x65, 0xff, 0x95, 0x5b,
+  0x4c, 0x95, 0x09, 0xb5, 0x6a, 0x38, 0xe5, 0x78, 0xa8, 0xb5, 0x58, 0x38,
+  0xe5, 0xfe, 0x95, 0x58, 0xb5, 0x5b, 0xe5, 0xff, 0x95, 0x5b, 0x88, 0xd0,
+  0xf0, 0x60, 0xd6, 0x4f, 0x10, 0x05, 0xb9, 0x33, 0x0c, 0x95, 0x4f, 0xb9,
+  0x20, 0x0c, 0x18, 0x75, 0x4f, 0xa8, 0xb9, 0x25, 0x0c, 0x95, 0x52, 0x60,
+  0xb5, 0x6d, 0xd0, 0x17, 0xb5, 0x70, 0x18, 0x75, 0x4c, 0xa8, 0xb5, 0x73,
+  0x69, 0x00, 0xc9, 0x10, 0xd0, 0x03, 0xf6, 0x6d, 0x60, 0x95, 0x73, 0x98,
+  0x95, 0x70, 0x60, 0xb5, 0x70, 0x38, 0xf5, 0x4c, 0xa8, 0xb5, 0x73, 0xe9,
+  0x00, 0x10, 0x03, 0xd6, 0x6d, 0x60, 0x95, 0x73, 0x98, 0x95, 0x70, 0x60,
+  0x29, 0x7f, 0x0a, 0xb4, 0x5e, 0x30, 0x0c, 0x18, 0x75, 0x61, 0x95, 0x61,
+  0xb5, 0x64, 0x69, 0x00, 0x95, 0x64, 0x60, 0x85, 0xfe, 0xb5, 0x61, 0x38,
+  0xe5, 0xfe, 0x95, 0x61, 0xb5, 0x64, 0xe9, 0x00, 0x95, 0x64, 0x60, 0xa5,
+  0x77, 0xf0, 0x20, 0xb4, 0x28, 0xb9, 0xe3, 0x0c, 0x85, 0xfe, 0xb9, 0xee,
+  0x0c, 0x85, 0xff, 0xb4, 0x2b, 0xb1, 0xfe, 0xc9, 0xff, 0xd0, 0x12, 0xb5,
+  0x37, 0xf0, 0x08, 0xd6, 0x37, 0xa9, 0x00, 0x95, 0x2b, 0xf0, 0xec, 0x20,
+  0xd9, 0x0a, 0x4c, 0x2c, 0x0a, 0xa9, 0x00, 0x85, 0x78, 0x95, 0x13, 0x95,
+  0x5e, 0xb1, 0xfe, 0x30, 0x08, 0x95, 0x1f, 0xc8, 0x98, 0x95, 0x2b, 0xd0,
+  0x2c, 0xc9, 0xc0, 0x90, 0x10, 0xc9, 0xe0, 0x90, 0x16, 0xc9, 0xf0, 0x90,
+  0x19, 0xc8, 0xb1, 0xfe, 0x95, 0x5e, 0xc8, 0xd0, 0xe0, 0x29, 0x3f, 0x18,
+  0x65, 0x78, 0x85, 0x78, 0xc8, 0xd0, 0xd6, 0x29, 0x1f, 0x95, 0x19, 0xc8,
+  0xd0, 0xcf, 0x29, 0x0f, 0x95, 0x55, 0xc8, 0xd0, 0xc8, 0xa5, 0x78, 0xf0,
+  0x02, 0x95, 0x10, 0xb5, 0x10, 0x95, 0x0b, 0xb5, 0x16, 0xd0, 0x02, 0xb5,
+  0x19, 0x0a, 0x0a, 0x0a, 0x95, 0x1c, 0xa8, 0xb9, 0x7f, 0x0c, 0x29, 0xf0,
+  0x95, 0x4c, 0xb9, 0x81, 0x0c, 0x95, 0x46, 0xb9, 0x82, 0x0c, 0x95, 0x49,
+  0xb9, 0x80, 0x0c, 0x95, 0x43, 0x30, 0x01, 0x60, 0xb4, 0x46, 0xb9, 0x3f,
+  0x0c, 0x85, 0xfe, 0xb9, 0x43, 0x0c, 0x85, 0xff, 0xa0, 0x00, 0xb1, 0xfe,
+  0x95, 0x3d, 0xc8, 0xb1, 0xfe, 0x95, 0x40, 0x60, 0xa9, 0x00, 0x95, 0x2b,
+  0x95, 0x55, 0x95, 0x16, 0xb4, 0x2e, 0xb5, 0x31, 0x85, 0xfe, 0xb5, 0x34,
+  0x85, 0xff, 0xb1, 0xfe, 0xc9, 0x40, 0x90, 0x24, 0xc9, 0xff, 0xf0, 0x1c,
+  0xc9, 0x80, 0x90, 0x0a, 0xc9, 0xc0, 0x90, 0x0d, 0xa0, 0x00, 0x84, 0x76,
+  0xf0, 0xe8, 0x29, 0x3f, 0x95, 0x37, 0xc8, 0xd0, 0xe1, 0x29, 0x3f, 0x95,
+  0x25, 0xc8, 0xd0, 0xda, 0xa0, 0x00, 0xf0, 0xd6, 0x95, 0x28, 0xc8, 0x98,
+  0x95, 0x2e, 0x60, 0xa9, 0x00, 0xa2, 0x17, 0x9d, 0x00, 0xd4, 0xca, 0x10,
+  0xfa, 0x86, 0x76, 0x85, 0x0e, 0x85, 0x77, 0xa9, 0x0f, 0x8d, 0x18, 0xd4,
+  0x88, 0xb9, 0x38, 0x0c, 0x85, 0x0f, 0x98, 0x0a, 0x85, 0xfe, 0x0a, 0x18,
+  0x65, 0xfe, 0xa8, 0xa2, 0x00, 0xb9, 0x39, 0x0c, 0x95, 0x31, 0xc8, 0xb9,
+  0x39, 0x0c, 0x95, 0x34, 0xa9, 0x01, 0x95, 0x0b, 0xa9, 0x00, 0x95, 0x2e,
+  0x95, 0x37, 0xc8, 0xe8, 0xe0, 0x03, 0xd0, 0xe5, 0x60,
+};
+
+static const struct c64_aot_range play_0825_1_ranges[] = {
+  { 0x0825, 825, play_0825_1_code + 0 },
+};
+
+/* src/big_fun_tune_5.sid song 1, 428 instructions */
+static bool play_0825_1(struct c64_aot_machine* m)
+{
+  uint8_t* mem = m->memory;
+  uint32_t cyc = *m->cycles;
+  uint32_t ins = *m->instructions;
+  uint8_t a = m->cpu.a;
+  uint8_t x = m->cpu.x;
+  uint8_t y = m->cpu.y;
+  uint8_t s = m->cpu.s;
+  uint8_t p, n, nz, c, v;
+  uint8_t b;
+  unsigned t;
+  uint16_t ea;
+  uint16_t pc;
+  bool ok;
+
+  SET_P(m->cpu.p);
+  goto L0825;
+
+dispatch:
+  switch (pc) {
+    case 0x0837: goto L0837;
+    case 0x08f5: goto L08f5;
+    case 0x08fc: goto L08fc;
+    case 0x0903: goto L0903;
+    case 0x0925: goto L0925;
+    case 0x0a4f: goto L0a4f;
+    default: LEAVE(pc, true);
+  }
+
+L0825:
+  /* 0825 ldy $76 */
+  cyc += 3; y = mem[0x76]; NZ(y); ins++;
+  /* 0827 bmi $0832 */
+  cyc += 2; ins++; if (n & 0x80) { cyc++; goto L0832; }
+  /* 0829 beq $082e */
+  cyc += 2; ins++; if (nz == 0) { cyc++; goto L082e; }
+  /* 082b jmp $0b1c */
+  cyc += 3; ins++; goto L0b1c;
+L082e:
+  /* 082e sty $d418 */
+  cyc += 4; SYNC(); sid_poke(0x18, y); ins++;
+  /* 0831 rts */
+  cyc += 6; b = POP(); pc = b; b = POP(); pc = (pc | b << 8) + 1; ins++; goto dispatch;
+L0832:
+  /* 0832 ldx #$02 */
+  cyc += 2; x = 0x02; NZ(x); ins++;
+L0834:
+  /* 0834 jsr $0845 */
+  cyc += 6; PUSH(0x08); PUSH(0x36); ins++; goto L0845;
+L0837:
+  /* 0837 dex a */
+  cyc += 2; x--; NZ(x); ins++;
+  /* 0838 bpl $0834 */
+  cyc += 2; ins++; if (!(n & 0x80)) { cyc++; goto L0834; }
+  /* 083a stx $77 */
+  cyc += 3; mem[0x77] = x; DIRTY(0x0077); ins++;
+  /* 083c dec $0e */
+  cyc += 5; b = mem[0x0e]; b--; mem[0x0e] = b; DIRTY(0x000e); NZ(b); ins++;
+  /* 083e bpl $0844 */
+  cyc += 2; ins++; if (!(n & 0x80)) { cyc++; goto L0844; }
+  /* 0840 lda $0f */
+  cyc += 3; a = mem[0x0f]; NZ(a); ins++;
+  /* 0842 sta $0e */
+  cyc += 3; mem[0x0e] = a; DIRTY(0x000e); ins++;
+L0844:
+  /* 0844 rts */
+  cyc += 6; b = POP(); pc = b; b = POP(); pc = (pc | b << 8) + 1; ins++; goto dispatch;
+L0845:
+  /* 0845 lda $0e */
+  cyc += 3; a = mem[0x0e]; NZ(a); ins++;
+  /* 0847 bne $0850 */
+  cyc += 2; ins++; if (nz != 0) { cyc++; goto L0850; }
+  /* 0849 dec $0b,x */
+  cyc += 6; ea = (uint8_t)(0x0b + x); b = mem[ea]; b--; mem[ea] = b; DIRTY(ea); NZ(b); ins++;
+  /* 084b bne $0850 */
+  cyc += 2; ins++; if (nz != 0) { cyc++; goto L0850; }
+  /* 084d jmp $0a28 */
+  cyc += 3; ins++; goto L0a28;
+L0850:
+  /* 0850 lda $13,x */
+  cyc += 4; ea = (uint8_t)(0x13 + x); a = mem[ea]; NZ(a); ins++;
+  /* 0852 bne $0883 */
+  cyc += 2; ins++; if (nz != 0) { cyc++; goto L0883; }
+  /* 0854 sta $6d,x */
+  cyc += 4; ea = (uint8_t)(0x6d + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 0856 sta $70,x */
+  cyc += 4; ea = (uint8_t)(0x70 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 0858 sta $22,x */
+  cyc += 4; ea = (uint8_t)(0x22 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 085a sta $52,x */
+  cyc += 4; ea = (uint8_t)(0x52 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 085c sta $4f,x */
+  cyc += 4; ea = (uint8_t)(0x4f + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 085e sta $61,x */
+  cyc += 4; ea = (uint8_t)(0x61 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 0860 sta $64,x */
+  cyc += 4; ea = (uint8_t)(0x64 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 0862 sta $67,x */
+  cyc += 4; ea = (uint8_t)(0x67 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 0864 ldy $1c,x */
+  cyc += 4; ea = (uint8_t)(0x1c + x); y = mem[ea]; NZ(y); ins++;
+  /* 0866 lda $0c7b,y */
+  cyc += 4; ea = (uint16_t)(0x0c7b + y); a = mem[ea]; NZ(a); ins++;
+  /* 0869 sta $3a,x */
+  cyc += 4; ea = (uint8_t)(0x3a + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 086b lda $0c7f,y */
+  cyc += 4; ea = (uint16_t)(0x0c7f + y); a = mem[ea]; NZ(a); ins++;
+  /* 086e and #$0f */
+  cyc += 2; a &= 0x0f; NZ(a); ins++;
+  /* 0870 sta $73,x */
+  cyc += 4; ea = (uint8_t)(0x73 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 0872 lda $0c7d,y */
+  cyc += 4; ea = (uint16_t)(0x0c7d + y); a = mem[ea]; NZ(a); ins++;
+  /* 0875 pha */
+  cyc += 3; PUSH(a); ins++;
+  /* 0876 lda $0c7e,y */
+  cyc += 4; ea = (uint16_t)(0x0c7e + y); a = mem[ea]; NZ(a); ins++;
+  /* 0879 ldy $0c1e,x */
+  cyc += 4; ea = (uint16_t)(0x0c1e + x); y = mem[ea]; NZ(y); ins++;
+  /* 087c sta $d406,y */
+  cyc += 5; ea = (uint16_t)(0xd406 + y); WRITE(ea, a); ins++;
+  /* 087f pla */
+  cyc += 4; a = POP(); NZ(a); ins++;
+  /* 0880 sta $d405,y */
+  cyc += 5; ea = (uint16_t)(0xd405 + y); WRITE(ea, a); ins++;
+L0883:
+  /* 0883 inc $13,x */
+  cyc += 6; ea = (uint8_t)(0x13 + x); b = mem[ea]; b++; mem[ea] = b; DIRTY(ea); NZ(b); ins++;
+  /* 0885 lda $43,x */
+  cyc += 4; ea = (uint8_t)(0x43 + x); a = mem[ea]; NZ(a); ins++;
+  /* 0887 bpl $08ad */
+  cyc += 2; ins++; if (!(n & 0x80)) { cyc++; goto L08ad; }
+  /* 0889 ldy $46,x */
+  cyc += 4; ea = (uint8_t)(0x46 + x); y = mem[ea]; NZ(y); ins++;
+  /* 088b lda $0c3f,y */
+  cyc += 4; ea = (uint16_t)(0x0c3f + y); a = mem[ea]; NZ(a); ins++;
+  /* 088e sta $fe */
+  cyc += 3; mem[0xfe] = a; DIRTY(0x00fe); ins++;
+  /* 0890 lda $0c43,y */
+  cyc += 4; ea = (uint16_t)(0x0c43 + y); a = mem[ea]; NZ(a); ins++;
+  /* 0893 sta $ff */
+  cyc += 3; mem[0xff] = a; DIRTY(0x00ff); ins++;
+  /* 0895 ldy $3d,x */
+  cyc += 4; ea = (uint8_t)(0x3d + x); y = mem[ea]; NZ(y); ins++;
+  /* 0897 lda ($fe),y */
+  cyc += 5; ea = (uint16_t)((mem[0xfe] | mem[0xff] << 8) + y); a = READ(ea); NZ(a); ins++;
+  /* 0899 cmp #$ff */
+  cyc += 2; b = 0xff; NZ(a - b); c = a >= b; ins++;
+  /* 089b beq $08a1 */
+  cyc += 2; ins++; if (nz == 0) { cyc++; goto L08a1; }
+  /* 089d inc $3d,x */
+  cyc += 6; ea = (uint8_t)(0x3d + x); b = mem[ea]; b++; mem[ea] = b; DIRTY(ea); NZ(b); ins++;
+  /* 089f sta $3a,x */
+  cyc += 4; ea = (uint8_t)(0x3a + x); mem[ea] = a; DIRTY(ea); ins++;
+L08a1:
+  /* 08a1 ldy $40,x */
+  cyc += 4; ea = (uint8_t)(0x40 + x); y = mem[ea]; NZ(y); ins++;
+  /* 08a3 lda ($fe),y */
+  cyc += 5; ea = (uint16_t)((mem[0xfe] | mem[0xff] << 8) + y); a = READ(ea); NZ(a); ins++;
+  /* 08a5 cmp #$80 */
+  cyc += 2; b = 0x80; NZ(a - b); c = a >= b; ins++;
+  /* 08a7 beq $08ad */
+  cyc += 2; ins++; if (nz == 0) { cyc++; goto L08ad; }
+  /* 08a9 inc $40,x */
+  cyc += 6; ea = (uint8_t)(0x40 + x); b = mem[ea]; b++; mem[ea] = b; DIRTY(ea); NZ(b); ins++;
+  /* 08ab sta $22,x */
+  cyc += 4; ea = (uint8_t)(0x22 + x); mem[ea] = a; DIRTY(ea); ins++;
+L08ad:
+  /* 08ad lda $1f,x */
+  cyc += 4; ea = (uint8_t)(0x1f + x); a = mem[ea]; NZ(a); ins++;
+  /* 08af clc */
+  cyc += 2; c = 0; ins++;
+  /* 08b0 adc $22,x */
+  cyc += 4; ea = (uint8_t)(0x22 + x); t = a + mem[ea] + c; c = t >> 8; a = t; NZ(a); v = c ^ (a >> 7); ins++;
+  /* 08b2 tay */
+  cyc += 2; y = a; NZ(y); ins++;
+  /* 08b3 lda $43,x */
+  cyc += 4; ea = (uint8_t)(0x43 + x); a = mem[ea]; NZ(a); ins++;
+  /* 08b5 and #$08 */
+  cyc += 2; a &= 0x08; NZ(a); ins++;
+  /* 08b7 bne $08bf */
+  cyc += 2; ins++; if (nz != 0) { cyc++; goto L08bf; }
+  /* 08b9 tya */
+  cyc += 2; a = y; NZ(a); ins++;
+  /* 08ba adc $25,x */
+  cyc += 4; ea = (uint8_t)(0x25 + x); t = a + mem[ea] + c; c = t >> 8; a = t; NZ(a); v = c ^ (a >> 7); ins++;
+  /* 08bc adc $52,x */
+  cyc += 4; ea = (uint8_t)(0x52 + x); t = a + mem[ea] + c; c = t >> 8; a = t; NZ(a); v = c ^ (a >> 7); ins++;
+  /* 08be tay */
+  cyc += 2; y = a; NZ(y); ins++;
+L08bf:
+  /* 08bf sty $ff */
+  cyc += 3; mem[0xff] = y; DIRTY(0x00ff); ins++;
+  /* 08c1 lda $0b5e,y */
+  cyc += 4; ea = (uint16_t)(0x0b5e + y); a = mem[ea]; NZ(a); ins++;
+  /* 08c4 sta $58,x */
+  cyc += 4; ea = (uint8_t)(0x58 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 08c6 lda $0bbe,y */
+  cyc += 4; ea = (uint16_t)(0x0bbe + y); a = mem[ea]; NZ(a); ins++;
+  /* 08c9 sta $5b,x */
+  cyc += 4; ea = (uint8_t)(0x5b + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 08cb lda $13,x */
+  cyc += 4; ea = (uint8_t)(0x13 + x); a = mem[ea]; NZ(a); ins++;
+  /* 08cd cmp #$02 */
+  cyc += 2; b = 0x02; NZ(a - b); c = a >= b; ins++;
+  /* 08cf bne $08dd */
+  cyc += 2; ins++; if (nz != 0) { cyc++; goto L08dd; }
+  /* 08d1 lda $43,x */
+  cyc += 4; ea = (uint8_t)(0x43 + x); a = mem[ea]; NZ(a); ins++;
+  /* 08d3 and #$40 */
+  cyc += 2; a &= 0x40; NZ(a); ins++;
+  /* 08d5 beq $08dd */
+  cyc += 2; ins++; if (nz == 0) { cyc++; goto L08dd; }
+  /* 08d7 lda #$81 */
+  cyc += 2; a = 0x81; NZ(a); ins++;
+  /* 08d9 sta $3a,x */
+  cyc += 4; ea = (uint8_t)(0x3a + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 08db bne $08ec */
+  cyc += 2; ins++; if (nz != 0) { cyc++; goto L08ec; }
+L08dd:
+  /* 08dd cmp #$03 */
+  cyc += 2; b = 0x03; NZ(a - b); c = a >= b; ins++;
+  /* 08df bne $08ec */
+  cyc += 2; ins++; if (nz != 0) { cyc++; goto L08ec; }
+  /* 08e1 lda $43,x */
+  cyc += 4; ea = (uint8_t)(0x43 + x); a = mem[ea]; NZ(a); ins++;
+  /* 08e3 bmi $08ec */
+  cyc += 2; ins++; if (n & 0x80) { cyc++; goto L08ec; }
+  /* 08e5 ldy $1c,x */
+  cyc += 4; ea = (uint8_t)(0x1c + x); y = mem[ea]; NZ(y); ins++;
+  /* 08e7 lda $0c7c,y */
+  cyc += 4; ea = (uint16_t)(0x0c7c + y); a = mem[ea]; NZ(a); ins++;
+  /* 08ea sta $3a,x */
+  cyc += 4; ea = (uint8_t)(0x3a + x); mem[ea] = a; DIRTY(ea); ins++;
+L08ec:
+  /* 08ec lda $5e,x */
+  cyc += 4; ea = (uint8_t)(0x5e + x); a = mem[ea]; NZ(a); ins++;
+  /* 08ee sta $78 */
+  cyc += 3; mem[0x78] = a; DIRTY(0x0078); ins++;
+  /* 08f0 beq $08f5 */
+  cyc += 2; ins++; if (nz == 0) { cyc++; goto L08f5; }
+  /* 08f2 jsr $0a05 */
+  cyc += 6; PUSH(0x08); PUSH(0xf4); ins++; goto L0a05;
+L08f5:
+  /* 08f5 lda $4c,x */
+  cyc += 4; ea = (uint8_t)(0x4c + x); a = mem[ea]; NZ(a); ins++;
+  /* 08f7 beq $08fc */
+  cyc += 2; ins++; if (nz == 0) { cyc++; goto L08fc; }
+  /* 08f9 jsr $09d5 */
+  cyc += 6; PUSH(0x08); PUSH(0xfb); ins++; goto L09d5;
+L08fc:
+  /* 08fc ldy $55,x */
+  cyc += 4; ea = (uint8_t)(0x55 + x); y = mem[ea]; NZ(y); ins++;
+  /* 08fe beq $0909 */
+  cyc += 2; ins++; if (nz == 0) { cyc++; goto L0909; }
+  /* 0900 jsr $09bf */
+  cyc += 6; PUSH(0x09); PUSH(0x02); ins++; goto L09bf;
+L0903:
+  /* 0903 lda $43,x */
+  cyc += 4; ea = (uint8_t)(0x43 + x); a = mem[ea]; NZ(a); ins++;
+  /* 0905 and #$02 */
+  cyc += 2; a &= 0x02; NZ(a); ins++;
+  /* 0907 bne $0925 */
+  cyc += 2; ins++; if (nz != 0) { cyc++; goto L0925; }
+L0909:
+  /* 0909 lda $43,x */
+  cyc += 4; ea = (uint8_t)(0x43 + x); a = mem[ea]; NZ(a); ins++;
+  /* 090b and #$01 */
+  cyc += 2; a &= 0x01; NZ(a); ins++;
+  /* 090d beq $0925 */
+  cyc += 2; ins++; if (nz == 0) { cyc++; goto L0925; }
+  /* 090f lda $78 */
+  cyc += 3; a = mem[0x78]; NZ(a); ins++;
+  /* 0911 beq $0919 */
+  cyc += 2; ins++; if (nz == 0) { cyc++; goto L0919; }
+  /* 0913 lda $43,x */
+  cyc += 4; ea = (uint8_t)(0x43 + x); a = mem[ea]; NZ(a); ins++;
+  /* 0915 and #$04 */
+  cyc += 2; a &= 0x04; NZ(a); ins++;
+  /* 0917 bne $0925 */
+  cyc += 2; ins++; if (nz != 0) { cyc++; goto L0925; }
+L0919:
+  /* 0919 lda $49,x */
+  cyc += 4; ea = (uint8_t)(0x49 + x); a = mem[ea]; NZ(a); ins++;
+  /* 091b and #$1c */
+  cyc += 2; a &= 0x1c; NZ(a); ins++;
+  /* 091d asl a */
+  cyc += 2; b = a; c = b >> 7; b <<= 1; a = b; NZ(b); ins++;
+  /* 091e cmp $13,x */
+  cyc += 4; ea = (uint8_t)(0x13 + x); b = mem[ea]; NZ(a - b); c = a >= b; ins++;
+  /* 0920 bcs $0925 */
+  cyc += 2; ins++; if (c) { cyc++; goto L0925; }
+  /* 0922 jsr $0947 */
+  cyc += 6; PUSH(0x09); PUSH(0x24); ins++; goto L0947;
+L0925:
+  /* 0925 ldy $0c1e,x */
+  cyc += 4; ea = (uint16_t)(0x0c1e + x); y = mem[ea]; NZ(y); ins++;
+  /* 0928 lda $70,x */
+  cyc += 4; ea = (uint8_t)(0x70 + x); a = mem[ea]; NZ(a); ins++;
+  /* 092a sta $d402,y */
+  cyc += 5; ea = (uint16_t)(0xd402 + y); WRITE(ea, a); ins++;
+  /* 092d lda $73,x */
+  cyc += 4; ea = (uint8_t)(0x73 + x); a = mem[ea]; NZ(a); ins++;
+  /* 092f sta $d403,y */
+  cyc += 5; ea = (uint16_t)(0xd403 + y); WRITE(ea, a); ins++;
+  /* 0932 lda $58,x */
+  cyc += 4; ea = (uint8_t)(0x58 + x); a = mem[ea]; NZ(a); ins++;
+  /* 0934 clc */
+  cyc += 2; c = 0; ins++;
+  /* 0935 adc $61,x */
+  cyc += 4; ea = (uint8_t)(0x61 + x); t = a + mem[ea] + c; c = t >> 8; a = t; NZ(a); v = c ^ (a >> 7); ins++;
+  /* 0937 sta $d400,y */
+  cyc += 5; ea = (uint16_t)(0xd400 + y); WRITE(ea, a); ins++;
+  /* 093a lda $5b,x */
+  cyc += 4; ea = (uint8_t)(0x5b + x); a = mem[ea]; NZ(a); ins++;
+  /* 093c adc $64,x */
+  cyc += 4; ea = (uint8_t)(0x64 + x); t = a + mem[ea] + c; c = t >> 8; a = t; NZ(a); v = c ^ (a >> 7); ins++;
+  /* 093e sta $d401,y */
+  cyc += 5; ea = (uint16_t)(0xd401 + y); WRITE(ea, a); ins++;
+  /* 0941 lda $3a,x */
+  cyc += 4; ea = (uint8_t)(0x3a + x); a = mem[ea]; NZ(a); ins++;
+  /* 0943 sta $d404,y */
+  cyc += 5; ea = (uint16_t)(0xd404 + y); WRITE(ea, a); ins++;
+  /* 0946 rts */
+  cyc += 6; b = POP(); pc = b; b = POP(); pc = (pc | b << 8) + 1; ins++; goto dispatch;
+L0947:
+  /* 0947 lda $46,x */
+  cyc += 4; ea = (uint8_t)(0x46 + x); a = mem[ea]; NZ(a); ins++;
+  /* 0949 and #$0f */
+  cyc += 2; a &= 0x0f; NZ(a); ins++;
+  /* 094b sta $78 */
+  cyc += 3; mem[0x78] = a; DIRTY(0x0078); ins++;
+  /* 094d lsr $78 */
+  cyc += 5; b = mem[0x78]; c = b & 1; b >>= 1; mem[0x78] = b; DIRTY(0x0078); NZ(b); ins++;
+  /* 094f ldy $67,x */
+  cyc += 4; ea = (uint8_t)(0x67 + x); y = mem[ea]; NZ(y); ins++;
+  /* 0951 bpl $0959 */
+  cyc += 2; ins++; if (!(n & 0x80)) { cyc++; goto L0959; }
+  /* 0953 dec $6a,x */
+  cyc += 6; ea = (uint8_t)(0x6a + x); b = mem[ea]; b--; mem[ea] = b; DIRTY(ea); NZ(b); ins++;
+  /* 0955 bne $0966 */
+  cyc += 2; ins++; if (nz != 0) { cyc++; goto L0966; }
+  /* 0957 beq $0961 */
+  cyc += 2; ins++; if (nz == 0) { cyc++; goto L0961; }
+L0959:
+  /* 0959 inc $6a,x */
+  cyc += 6; ea = (uint8_t)(0x6a + x); b = mem[ea]; b++; mem[ea] = b; DIRTY(ea); NZ(b); ins++;
+  /* 095b cmp $6a,x */
+  cyc += 4; ea = (uint8_t)(0x6a + x); b = mem[ea]; NZ(a - b); c = a >= b; ins++;
+  /* 095d bcs $0966 */
+  cyc += 2; ins++; if (c) { cyc++; goto L0966; }
+  /* 095f sta $6a,x */
+  cyc += 4; ea = (uint8_t)(0x6a + x); mem[ea] = a; DIRTY(ea); ins++;
+L0961:
+  /* 0961 tya */
+  cyc += 2; a = y; NZ(a); ins++;
+  /* 0962 eor #$ff */
+  cyc += 2; a ^= 0xff; NZ(a); ins++;
+  /* 0964 sta $67,x */
+  cyc += 4; ea = (uint8_t)(0x67 + x); mem[ea] = a; DIRTY(ea); ins++;
+L0966:
+  /* 0966 ldy $ff */
+  cyc += 3; y = mem[0xff]; NZ(y); ins++;
+  /* 0968 lda $0b5f,y */
+  cyc += 4; ea = (uint16_t)(0x0b5f + y); a = mem[ea]; NZ(a); ins++;
+  /* 096b sec */
+  cyc += 2; c = 1; ins++;
+  /* 096c sbc $58,x */
+  cyc += 4; ea = (uint8_t)(0x58 + x); t = a + (uint8_t)(mem[ea] ^ 0xff) + c; c = t >> 8; a = t; NZ(a); v = c ^ (a >> 7); ins++;
+  /* 096e sta $fe */
+  cyc += 3; mem[0xfe] = a; DIRTY(0x00fe); ins++;
+  /* 0970 lda $0bbf,y */
+  cyc += 4; ea = (uint16_t)(0x0bbf + y); a = mem[ea]; NZ(a); ins++;
+  /* 0973 sbc $5b,x */
+  cyc += 4; ea = (uint8_t)(0x5b + x); t = a + (uint8_t)(mem[ea] ^ 0xff) + c; c = t >> 8; a = t; NZ(a); v = c ^ (a >> 7); ins++;
+  /* 0975 ldy $46,x */
+  cyc += 4; ea = (uint8_t)(0x46 + x); y = mem[ea]; NZ(y); ins++;
+  /* 0977 bpl $097b */
+  cyc += 2; ins++; if (!(n & 0x80)) { cyc++; goto L097b; }
+  /* 0979 adc $13,x */
+  cyc += 4; ea = (uint8_t)(0x13 + x); t = a + mem[ea] + c; c = t >> 8; a = t; NZ(a); v = c ^ (a >> 7); ins++;
+L097b:
+  /* 097b sta $ff */
+  cyc += 3; mem[0xff] = a; DIRTY(0x00ff); ins++;
+  /* 097d lda $46,x */
+  cyc += 4; ea = (uint8_t)(0x46 + x); a = mem[ea]; NZ(a); ins++;
+  /* 097f and #$70 */
+  cyc += 2; a &= 0x70; NZ(a); ins++;
+  /* 0981 lsr a */
+  cyc += 2; b = a; c = b & 1; b >>= 1; a = b; NZ(b); ins++;
+  /* 0982 lsr a */
+  cyc += 2; b = a; c = b & 1; b >>= 1; a = b; NZ(b); ins++;
+  /* 0983 lsr a */
+  cyc += 2; b = a; c = b & 1; b >>= 1; a = b; NZ(b); ins++;
+  /* 0984 lsr a */
+  cyc += 2; b = a; c = b & 1; b >>= 1; a = b; NZ(b); ins++;
+  /* 0985 tay */
+  cyc += 2; y = a; NZ(y); ins++;
+L0986:
+  /* 0986 lsr $ff */
+  cyc += 5; b = mem[0xff]; c = b & 1; b >>= 1; mem[0xff] = b; DIRTY(0x00ff); NZ(b); ins++;
+  /* 0988 ror $fe */
+  cyc += 5; b = mem[0xfe]; t = c; c = b & 1; b = b >> 1 | t << 7; mem[0xfe] = b; DIRTY(0x00fe); NZ(b); ins++;
+  /* 098a dey */
+  cyc += 2; y--; NZ(y); ins++;
+  /* 098b bpl $0986 */
+  cyc += 2; ins++; if (!(n & 0x80)) { cyc++; goto L0986; }
+  /* 098d lda $78 */
+  cyc += 3; a = mem[0x78]; NZ(a); ins++;
+  /* 098f sec */
+  cyc += 2; c = 1; ins++;
+  /* 0990 sbc $6a,x */
+  cyc += 4; ea = (uint8_t)(0x6a + x); t = a + (uint8_t)(mem[ea] ^ 0xff) + c; c = t >> 8; a = t; NZ(a); v = c ^ (a >> 7); ins++;
+  /* 0992 bmi $09a8 */
+  cyc += 2; ins++; if (n & 0x80) { cyc++; goto L09a8; }
+  /* 0994 tay */
+  cyc += 2; y = a; NZ(y); ins++;
+L0995:
+  /* 0995 dey */
+  cyc += 2; y--; NZ(y); ins++;
+  /* 0996 bmi $09be */
+  cyc += 2; ins++; if (n & 0x80) { cyc++; goto L09be; }
+  /* 0998 lda $58,x */
+  cyc += 4; ea = (uint8_t)(0x58 + x); a = mem[ea]; NZ(a); ins++;
+  /* 099a clc */
+  cyc += 2; c = 0; ins++;
+  /* 099b adc $fe */
+  cyc += 3; t = a + mem[0xfe] + c; c = t >> 8; a = t; NZ(a); v = c ^ (a >> 7); ins++;
+  /* 099d sta $58,x */
+  cyc += 4; ea = (uint8_t)(0x58 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 099f lda $5b,x */
+  cyc += 4; ea = (uint8_t)(0x5b + x); a = mem[ea]; NZ(a); ins++;
+  /* 09a1 adc $ff */
+  cyc += 3; t = a + mem[0xff] + c; c = t >> 8; a = t; NZ(a); v = c ^ (a >> 7); ins++;
+  /* 09a3 sta $5b,x */
+  cyc += 4; ea = (uint8_t)(0x5b + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 09a5 jmp $0995 */
+  cyc += 3; ins++; goto L0995;
+L09a8:
+  /* 09a8 lda $6a,x */
+  cyc += 4; ea = (uint8_t)(0x6a + x); a = mem[ea]; NZ(a); ins++;
+  /* 09aa sec */
+  cyc += 2; c = 1; ins++;
+  /* 09ab sbc $78 */
+  cyc += 3; t = a + (uint8_t)(mem[0x78] ^ 0xff) + c; c = t >> 8; a = t; NZ(a); v = c ^ (a >> 7); ins++;
+  /* 09ad tay */
+  cyc += 2; y = a; NZ(y); ins++;
+L09ae:
+  /* 09ae lda $58,x */
+  cyc += 4; ea = (uint8_t)(0x58 + x); a = mem[ea]; NZ(a); ins++;
+  /* 09b0 sec */
+  cyc += 2; c = 1; ins++;
+  /* 09b1 sbc $fe */
+  cyc += 3; t = a + (uint8_t)(mem[0xfe] ^ 0xff) + c; c = t >> 8; a = t; NZ(a); v = c ^ (a >> 7); ins++;
+  /* 09b3 sta $58,x */
+  cyc += 4; ea = (uint8_t)(0x58 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 09b5 lda $5b,x */
+  cyc += 4; ea = (uint8_t)(0x5b + x); a = mem[ea]; NZ(a); ins++;
+  /* 09b7 sbc $ff */
+  cyc += 3; t = a + (uint8_t)(mem[0xff] ^ 0xff) + c; c = t >> 8; a = t; NZ(a); v = c ^ (a >> 7); ins++;
+  /* 09b9 sta $5b,x */
+  cyc += 4; ea = (uint8_t)(0x5b + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 09bb dey */
+  cyc += 2; y--; NZ(y); ins++;
+  /* 09bc bne $09ae */
+  cyc += 2; ins++; if (nz != 0) { cyc++; goto L09ae; }
+L09be:
+  /* 09be rts */
+  cyc += 6; b = POP(); pc = b; b = POP(); pc = (pc | b << 8) + 1; ins++; goto dispatch;
+L09bf:
+  /* 09bf dec $4f,x */
+  cyc += 6; ea = (uint8_t)(0x4f + x); b = mem[ea]; b--; mem[ea] = b; DIRTY(ea); NZ(b); ins++;
+  /* 09c1 bpl $09c8 */
+  cyc += 2; ins++; if (!(n & 0x80)) { cyc++; goto L09c8; }
+  /* 09c3 lda $0c33,y */
+  cyc += 4; ea = (uint16_t)(0x0c33 + y); a = mem[ea]; NZ(a); ins++;
+  /* 09c6 sta $4f,x */
+  cyc += 4; ea = (uint8_t)(0x4f + x); mem[ea] = a; DIRTY(ea); ins++;
+L09c8:
+  /* 09c8 lda $0c20,y */
+  cyc += 4; ea = (uint16_t)(0x0c20 + y); a = mem[ea]; NZ(a); ins++;
+  /* 09cb clc */
+  cyc += 2; c = 0; ins++;
+  /* 09cc adc $4f,x */
+  cyc += 4; ea = (uint8_t)(0x4f + x); t = a + mem[ea] + c; c = t >> 8; a = t; NZ(a); v = c ^ (a >> 7); ins++;
+  /* 09ce tay */
+  cyc += 2; y = a; NZ(y); ins++;
+  /* 09cf lda $0c25,y */
+  cyc += 4; ea = (uint16_t)(0x0c25 + y); a = mem[ea]; NZ(a); ins++;
+  /* 09d2 sta $52,x */
+  cyc += 4; ea = (uint8_t)(0x52 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 09d4 rts */
+  cyc += 6; b = POP(); pc = b; b = POP(); pc = (pc | b << 8) + 1; ins++; goto dispatch;
+L09d5:
+  /* 09d5 lda $6d,x */
+  cyc += 4; ea = (uint8_t)(0x6d + x); a = mem[ea]; NZ(a); ins++;
+  /* 09d7 bne $09f0 */
+  cyc += 2; ins++; if (nz != 0) { cyc++; goto L09f0; }
+  /* 09d9 lda $70,x */
+  cyc += 4; ea = (uint8_t)(0x70 + x); a = mem[ea]; NZ(a); ins++;
+  /* 09db clc */
+  cyc += 2; c = 0; ins++;
+  /* 09dc adc $4c,x */
+  cyc += 4; ea = (uint8_t)(0x4c + x); t = a + mem[ea] + c; c = t >> 8; a = t; NZ(a); v = c ^ (a >> 7); ins++;
+  /* 09de tay */
+  cyc += 2; y = a; NZ(y); ins++;
+  /* 09df lda $73,x */
+  cyc += 4; ea = (uint8_t)(0x73 + x); a = mem[ea]; NZ(a); ins++;
+  /* 09e1 adc #$00 */
+  cyc += 2; t = a + 0x00 + c; c = t >> 8; a = t; NZ(a); v = c ^ (a >> 7); ins++;
+  /* 09e3 cmp #$10 */
+  cyc += 2; b = 0x10; NZ(a - b); c = a >= b; ins++;
+  /* 09e5 bne $09ea */
+  cyc += 2; ins++; if (nz != 0) { cyc++; goto L09ea; }
+  /* 09e7 inc $6d,x */
+  cyc += 6; ea = (uint8_t)(0x6d + x); b = mem[ea]; b++; mem[ea] = b; DIRTY(ea); NZ(b); ins++;
+  /* 09e9 rts */
+  cyc += 6; b = POP(); pc = b; b = POP(); pc = (pc | b << 8) + 1; ins++; goto dispatch;
+L09ea:
+  /* 09ea sta $73,x */
+  cyc += 4; ea = (uint8_t)(0x73 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 09ec tya */
+  cyc += 2; a = y; NZ(a); ins++;
+  /* 09ed sta $70,x */
+  cyc += 4; ea = (uint8_t)(0x70 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 09ef rts */
+  cyc += 6; b = POP(); pc = b; b = POP(); pc = (pc | b << 8) + 1; ins++; goto dispatch;
+L09f0:
+  /* 09f0 lda $70,x */
+  cyc += 4; ea = (uint8_t)(0x70 + x); a = mem[ea]; NZ(a); ins++;
+  /* 09f2 sec */
+  cyc += 2; c = 1; ins++;
+  /* 09f3 sbc $4c,x */
+  cyc += 4; ea = (uint8_t)(0x4c + x); t = a + (uint8_t)(mem[ea] ^ 0xff) + c; c = t >> 8; a = t; NZ(a); v = c ^ (a >> 7); ins++;
+  /* 09f5 tay */
+  cyc += 2; y = a; NZ(y); ins++;
+  /* 09f6 lda $73,x */
+  cyc += 4; ea = (uint8_t)(0x73 + x); a = mem[ea]; NZ(a); ins++;
+  /* 09f8 sbc #$00 */
+  cyc += 2; t = a + (uint8_t)(0x00 ^ 0xff) + c; c = t >> 8; a = t; NZ(a); v = c ^ (a >> 7); ins++;
+  /* 09fa bpl $09ff */
+  cyc += 2; ins++; if (!(n & 0x80)) { cyc++; goto L09ff; }
+  /* 09fc dec $6d,x */
+  cyc += 6; ea = (uint8_t)(0x6d + x); b = mem[ea]; b--; mem[ea] = b; DIRTY(ea); NZ(b); ins++;
+  /* 09fe rts */
+  cyc += 6; b = POP(); pc = b; b = POP(); pc = (pc | b << 8) + 1; ins++; goto dispatch;
+L09ff:
+  /* 09ff sta $73,x */
+  cyc += 4; ea = (uint8_t)(0x73 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 0a01 tya */
+  cyc += 2; a = y; NZ(a); ins++;
+  /* 0a02 sta $70,x */
+  cyc += 4; ea = (uint8_t)(0x70 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 0a04 rts */
+  cyc += 6; b = POP(); pc = b; b = POP(); pc = (pc | b << 8) + 1; ins++; goto dispatch;
+L0a05:
+  /* 0a05 and #$7f */
+  cyc += 2; a &= 0x7f; NZ(a); ins++;
+  /* 0a07 asl a */
+  cyc += 2; b = a; c = b >> 7; b <<= 1; a = b; NZ(b); ins++;
+  /* 0a08 ldy $5e,x */
+  cyc += 4; ea = (uint8_t)(0x5e + x); y = mem[ea]; NZ(y); ins++;
+  /* 0a0a bmi $0a18 */
+  cyc += 2; ins++; if (n & 0x80) { cyc++; goto L0a18; }
+  /* 0a0c clc */
+  cyc += 2; c = 0; ins++;
+  /* 0a0d adc $61,x */
+  cyc += 4; ea = (uint8_t)(0x61 + x); t = a + mem[ea] + c; c = t >> 8; a = t; NZ(a); v = c ^ (a >> 7); ins++;
+  /* 0a0f sta $61,x */
+  cyc += 4; ea = (uint8_t)(0x61 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 0a11 lda $64,x */
+  cyc += 4; ea = (uint8_t)(0x64 + x); a = mem[ea]; NZ(a); ins++;
+  /* 0a13 adc #$00 */
+  cyc += 2; t = a + 0x00 + c; c = t >> 8; a = t; NZ(a); v = c ^ (a >> 7); ins++;
+  /* 0a15 sta $64,x */
+  cyc += 4; ea = (uint8_t)(0x64 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 0a17 rts */
+  cyc += 6; b = POP(); pc = b; b = POP(); pc = (pc | b << 8) + 1; ins++; goto dispatch;
+L0a18:
+  /* 0a18 sta $fe */
+  cyc += 3; mem[0xfe] = a; DIRTY(0x00fe); ins++;
+  /* 0a1a lda $61,x */
+  cyc += 4; ea = (uint8_t)(0x61 + x); a = mem[ea]; NZ(a); ins++;
+  /* 0a1c sec */
+  cyc += 2; c = 1; ins++;
+  /* 0a1d sbc $fe */
+  cyc += 3; t = a + (uint8_t)(mem[0xfe] ^ 0xff) + c; c = t >> 8; a = t; NZ(a); v = c ^ (a >> 7); ins++;
+  /* 0a1f sta $61,x */
+  cyc += 4; ea = (uint8_t)(0x61 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 0a21 lda $64,x */
+  cyc += 4; ea = (uint8_t)(0x64 + x); a = mem[ea]; NZ(a); ins++;
+  /* 0a23 sbc #$00 */
+  cyc += 2; t = a + (uint8_t)(0x00 ^ 0xff) + c; c = t >> 8; a = t; NZ(a); v = c ^ (a >> 7); ins++;
+  /* 0a25 sta $64,x */
+  cyc += 4; ea = (uint8_t)(0x64 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 0a27 rts */
+  cyc += 6; b = POP(); pc = b; b = POP(); pc = (pc | b << 8) + 1; ins++; goto dispatch;
+L0a28:
+  /* 0a28 lda $77 */
+  cyc += 3; a = mem[0x77]; NZ(a); ins++;
+  /* 0a2a beq $0a4c */
+  cyc += 2; ins++; if (nz == 0) { cyc++; goto L0a4c; }
+L0a2c:
+  /* 0a2c ldy $28,x */
+  cyc += 4; ea = (uint8_t)(0x28 + x); y = mem[ea]; NZ(y); ins++;
+  /* 0a2e lda $0ce3,y */
+  cyc += 4; ea = (uint16_t)(0x0ce3 + y); a = mem[ea]; NZ(a); ins++;
+  /* 0a31 sta $fe */
+  cyc += 3; mem[0xfe] = a; DIRTY(0x00fe); ins++;
+  /* 0a33 lda $0cee,y */
+  cyc += 4; ea = (uint16_t)(0x0cee + y); a = mem[ea]; NZ(a); ins++;
+  /* 0a36 sta $ff */
+  cyc += 3; mem[0xff] = a; DIRTY(0x00ff); ins++;
+L0a38:
+  /* 0a38 ldy $2b,x */
+  cyc += 4; ea = (uint8_t)(0x2b + x); y = mem[ea]; NZ(y); ins++;
+  /* 0a3a lda ($fe),y */
+  cyc += 5; ea = (uint16_t)((mem[0xfe] | mem[0xff] << 8) + y); a = READ(ea); NZ(a); ins++;
+  /* 0a3c cmp #$ff */
+  cyc += 2; b = 0xff; NZ(a - b); c = a >= b; ins++;
+  /* 0a3e bne $0a52 */
+  cyc += 2; ins++; if (nz != 0) { cyc++; goto L0a52; }
+  /* 0a40 lda $37,x */
+  cyc += 4; ea = (uint8_t)(0x37 + x); a = mem[ea]; NZ(a); ins++;
+  /* 0a42 beq $0a4c */
+  cyc += 2; ins++; if (nz == 0) { cyc++; goto L0a4c; }
+  /* 0a44 dec $37,x */
+  cyc += 6; ea = (uint8_t)(0x37 + x); b = mem[ea]; b--; mem[ea] = b; DIRTY(ea); NZ(b); ins++;
+  /* 0a46 lda #$00 */
+  cyc += 2; a = 0x00; NZ(a); ins++;
+  /* 0a48 sta $2b,x */
+  cyc += 4; ea = (uint8_t)(0x2b + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 0a4a beq $0a38 */
+  cyc += 2; ins++; if (nz == 0) { cyc++; goto L0a38; }
+L0a4c:
+  /* 0a4c jsr $0ad9 */
+  cyc += 6; PUSH(0x0a); PUSH(0x4e); ins++; goto L0ad9;
+L0a4f:
+  /* 0a4f jmp $0a2c */
+  cyc += 3; ins++; goto L0a2c;
+L0a52:
+  /* 0a52 lda #$00 */
+  cyc += 2; a = 0x00; NZ(a); ins++;
+  /* 0a54 sta $78 */
+  cyc += 3; mem[0x78] = a; DIRTY(0x0078); ins++;
+  /* 0a56 sta $13,x */
+  cyc += 4; ea = (uint8_t)(0x13 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 0a58 sta $5e,x */
+  cyc += 4; ea = (uint8_t)(0x5e + x); mem[ea] = a; DIRTY(ea); ins++;
+L0a5a:
+  /* 0a5a lda ($fe),y */
+  cyc += 5; ea = (uint16_t)((mem[0xfe] | mem[0xff] << 8) + y); a = READ(ea); NZ(a); ins++;
+  /* 0a5c bmi $0a66 */
+  cyc += 2; ins++; if (n & 0x80) { cyc++; goto L0a66; }
+  /* 0a5e sta $1f,x */
+  cyc += 4; ea = (uint8_t)(0x1f + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 0a60 iny */
+  cyc += 2; y++; NZ(y); ins++;
+  /* 0a61 tya */
+  cyc += 2; a = y; NZ(a); ins++;
+  /* 0a62 sta $2b,x */
+  cyc += 4; ea = (uint8_t)(0x2b + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 0a64 bne $0a92 */
+  cyc += 2; ins++; if (nz != 0) { cyc++; goto L0a92; }
+L0a66:
+  /* 0a66 cmp #$c0 */
+  cyc += 2; b = 0xc0; NZ(a - b); c = a >= b; ins++;
+  /* 0a68 bcc $0a7a */
+  cyc += 2; ins++; if (!c) { cyc++; goto L0a7a; }
+  /* 0a6a cmp #$e0 */
+  cyc += 2; b = 0xe0; NZ(a - b); c = a >= b; ins++;
+  /* 0a6c bcc $0a84 */
+  cyc += 2; ins++; if (!c) { cyc++; goto L0a84; }
+  /* 0a6e cmp #$f0 */
+  cyc += 2; b = 0xf0; NZ(a - b); c = a >= b; ins++;
+  /* 0a70 bcc $0a8b */
+  cyc += 2; ins++; if (!c) { cyc++; goto L0a8b; }
+  /* 0a72 iny */
+  cyc += 2; y++; NZ(y); ins++;
+  /* 0a73 lda ($fe),y */
+  cyc += 5; ea = (uint16_t)((mem[0xfe] | mem[0xff] << 8) + y); a = READ(ea); NZ(a); ins++;
+  /* 0a75 sta $5e,x */
+  cyc += 4; ea = (uint8_t)(0x5e + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 0a77 iny */
+  cyc += 2; y++; NZ(y); ins++;
+  /* 0a78 bne $0a5a */
+  cyc += 2; ins++; if (nz != 0) { cyc++; goto L0a5a; }
+L0a7a:
+  /* 0a7a and #$3f */
+  cyc += 2; a &= 0x3f; NZ(a); ins++;
+  /* 0a7c clc */
+  cyc += 2; c = 0; ins++;
+  /* 0a7d adc $78 */
+  cyc += 3; t = a + mem[0x78] + c; c = t >> 8; a = t; NZ(a); v = c ^ (a >> 7); ins++;
+  /* 0a7f sta $78 */
+  cyc += 3; mem[0x78] = a; DIRTY(0x0078); ins++;
+  /* 0a81 iny */
+  cyc += 2; y++; NZ(y); ins++;
+  /* 0a82 bne $0a5a */
+  cyc += 2; ins++; if (nz != 0) { cyc++; goto L0a5a; }
+L0a84:
+  /* 0a84 and #$1f */
+  cyc += 2; a &= 0x1f; NZ(a); ins++;
+  /* 0a86 sta $19,x */
+  cyc += 4; ea = (uint8_t)(0x19 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 0a88 iny */
+  cyc += 2; y++; NZ(y); ins++;
+  /* 0a89 bne $0a5a */
+  cyc += 2; ins++; if (nz != 0) { cyc++; goto L0a5a; }
+L0a8b:
+  /* 0a8b and #$0f */
+  cyc += 2; a &= 0x0f; NZ(a); ins++;
+  /* 0a8d sta $55,x */
+  cyc += 4; ea = (uint8_t)(0x55 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 0a8f iny */
+  cyc += 2; y++; NZ(y); ins++;
+  /* 0a90 bne $0a5a */
+  cyc += 2; ins++; if (nz != 0) { cyc++; goto L0a5a; }
+L0a92:
+  /* 0a92 lda $78 */
+  cyc += 3; a = mem[0x78]; NZ(a); ins++;
+  /* 0a94 beq $0a98 */
+  cyc += 2; ins++; if (nz == 0) { cyc++; goto L0a98; }
+  /* 0a96 sta $10,x */
+  cyc += 4; ea = (uint8_t)(0x10 + x); mem[ea] = a; DIRTY(ea); ins++;
+L0a98:
+  /* 0a98 lda $10,x */
+  cyc += 4; ea = (uint8_t)(0x10 + x); a = mem[ea]; NZ(a); ins++;
+  /* 0a9a sta $0b,x */
+  cyc += 4; ea = (uint8_t)(0x0b + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 0a9c lda $16,x */
+  cyc += 4; ea = (uint8_t)(0x16 + x); a = mem[ea]; NZ(a); ins++;
+  /* 0a9e bne $0aa2 */
+  cyc += 2; ins++; if (nz != 0) { cyc++; goto L0aa2; }
+  /* 0aa0 lda $19,x */
+  cyc += 4; ea = (uint8_t)(0x19 + x); a = mem[ea]; NZ(a); ins++;
+L0aa2:
+  /* 0aa2 asl a */
+  cyc += 2; b = a; c = b >> 7; b <<= 1; a = b; NZ(b); ins++;
+  /* 0aa3 asl a */
+  cyc += 2; b = a; c = b >> 7; b <<= 1; a = b; NZ(b); ins++;
+  /* 0aa4 asl a */
+  cyc += 2; b = a; c = b >> 7; b <<= 1; a = b; NZ(b); ins++;
+  /* 0aa5 sta $1c,x */
+  cyc += 4; ea = (uint8_t)(0x1c + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 0aa7 tay */
+  cyc += 2; y = a; NZ(y); ins++;
+  /* 0aa8 lda $0c7f,y */
+  cyc += 4; ea = (uint16_t)(0x0c7f + y); a = mem[ea]; NZ(a); ins++;
+  /* 0aab and #$f0 */
+  cyc += 2; a &= 0xf0; NZ(a); ins++;
+  /* 0aad sta $4c,x */
+  cyc += 4; ea = (uint8_t)(0x4c + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 0aaf lda $0c81,y */
+  cyc += 4; ea = (uint16_t)(0x0c81 + y); a = mem[ea]; NZ(a); ins++;
+  /* 0ab2 sta $46,x */
+  cyc += 4; ea = (uint8_t)(0x46 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 0ab4 lda $0c82,y */
+  cyc += 4; ea = (uint16_t)(0x0c82 + y); a = mem[ea]; NZ(a); ins++;
+  /* 0ab7 sta $49,x */
+  cyc += 4; ea = (uint8_t)(0x49 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 0ab9 lda $0c80,y */
+  cyc += 4; ea = (uint16_t)(0x0c80 + y); a = mem[ea]; NZ(a); ins++;
+  /* 0abc sta $43,x */
+  cyc += 4; ea = (uint8_t)(0x43 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 0abe bmi $0ac1 */
+  cyc += 2; ins++; if (n & 0x80) { cyc++; goto L0ac1; }
+  /* 0ac0 rts */
+  cyc += 6; b = POP(); pc = b; b = POP(); pc = (pc | b << 8) + 1; ins++; goto dispatch;
+L0ac1:
+  /* 0ac1 ldy $46,x */
+  cyc += 4; ea = (uint8_t)(0x46 + x); y = mem[ea]; NZ(y); ins++;
+  /* 0ac3 lda $0c3f,y */
+  cyc += 4; ea = (uint16_t)(0x0c3f + y); a = mem[ea]; NZ(a); ins++;
+  /* 0ac6 sta $fe */
+  cyc += 3; mem[0xfe] = a; DIRTY(0x00fe); ins++;
+  /* 0ac8 lda $0c43,y */
+  cyc += 4; ea = (uint16_t)(0x0c43 + y); a = mem[ea]; NZ(a); ins++;
+  /* 0acb sta $ff */
+  cyc += 3; mem[0xff] = a; DIRTY(0x00ff); ins++;
+  /* 0acd ldy #$00 */
+  cyc += 2; y = 0x00; NZ(y); ins++;
+  /* 0acf lda ($fe),y */
+  cyc += 5; ea = (uint16_t)((mem[0xfe] | mem[0xff] << 8) + y); a = READ(ea); NZ(a); ins++;
+  /* 0ad1 sta $3d,x */
+  cyc += 4; ea = (uint8_t)(0x3d + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 0ad3 iny */
+  cyc += 2; y++; NZ(y); ins++;
+  /* 0ad4 lda ($fe),y */
+  cyc += 5; ea = (uint16_t)((mem[0xfe] | mem[0xff] << 8) + y); a = READ(ea); NZ(a); ins++;
+  /* 0ad6 sta $40,x */
+  cyc += 4; ea = (uint8_t)(0x40 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 0ad8 rts */
+  cyc += 6; b = POP(); pc = b; b = POP(); pc = (pc | b << 8) + 1; ins++; goto dispatch;
+L0ad9:
+  /* 0ad9 lda #$00 */
+  cyc += 2; a = 0x00; NZ(a); ins++;
+  /* 0adb sta $2b,x */
+  cyc += 4; ea = (uint8_t)(0x2b + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 0add sta $55,x */
+  cyc += 4; ea = (uint8_t)(0x55 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 0adf sta $16,x */
+  cyc += 4; ea = (uint8_t)(0x16 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 0ae1 ldy $2e,x */
+  cyc += 4; ea = (uint8_t)(0x2e + x); y = mem[ea]; NZ(y); ins++;
+  /* 0ae3 lda $31,x */
+  cyc += 4; ea = (uint8_t)(0x31 + x); a = mem[ea]; NZ(a); ins++;
+  /* 0ae5 sta $fe */
+  cyc += 3; mem[0xfe] = a; DIRTY(0x00fe); ins++;
+  /* 0ae7 lda $34,x */
+  cyc += 4; ea = (uint8_t)(0x34 + x); a = mem[ea]; NZ(a); ins++;
+  /* 0ae9 sta $ff */
+  cyc += 3; mem[0xff] = a; DIRTY(0x00ff); ins++;
+L0aeb:
+  /* 0aeb lda ($fe),y */
+  cyc += 5; ea = (uint16_t)((mem[0xfe] | mem[0xff] << 8) + y); a = READ(ea); NZ(a); ins++;
+  /* 0aed cmp #$40 */
+  cyc += 2; b = 0x40; NZ(a - b); c = a >= b; ins++;
+  /* 0aef bcc $0b15 */
+  cyc += 2; ins++; if (!c) { cyc++; goto L0b15; }
+  /* 0af1 cmp #$ff */
+  cyc += 2; b = 0xff; NZ(a - b); c = a >= b; ins++;
+  /* 0af3 beq $0b11 */
+  cyc += 2; ins++; if (nz == 0) { cyc++; goto L0b11; }
+  /* 0af5 cmp #$80 */
+  cyc += 2; b = 0x80; NZ(a - b); c = a >= b; ins++;
+  /* 0af7 bcc $0b03 */
+  cyc += 2; ins++; if (!c) { cyc++; goto L0b03; }
+  /* 0af9 cmp #$c0 */
+  cyc += 2; b = 0xc0; NZ(a - b); c = a >= b; ins++;
+  /* 0afb bcc $0b0a */
+  cyc += 2; ins++; if (!c) { cyc++; goto L0b0a; }
+  /* 0afd ldy #$00 */
+  cyc += 2; y = 0x00; NZ(y); ins++;
+  /* 0aff sty $76 */
+  cyc += 3; mem[0x76] = y; DIRTY(0x0076); ins++;
+  /* 0b01 beq $0aeb */
+  cyc += 2; ins++; if (nz == 0) { cyc++; goto L0aeb; }
+L0b03:
+  /* 0b03 and #$3f */
+  cyc += 2; a &= 0x3f; NZ(a); ins++;
+  /* 0b05 sta $37,x */
+  cyc += 4; ea = (uint8_t)(0x37 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 0b07 iny */
+  cyc += 2; y++; NZ(y); ins++;
+  /* 0b08 bne $0aeb */
+  cyc += 2; ins++; if (nz != 0) { cyc++; goto L0aeb; }
+L0b0a:
+  /* 0b0a and #$3f */
+  cyc += 2; a &= 0x3f; NZ(a); ins++;
+  /* 0b0c sta $25,x */
+  cyc += 4; ea = (uint8_t)(0x25 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 0b0e iny */
+  cyc += 2; y++; NZ(y); ins++;
+  /* 0b0f bne $0aeb */
+  cyc += 2; ins++; if (nz != 0) { cyc++; goto L0aeb; }
+L0b11:
+  /* 0b11 ldy #$00 */
+  cyc += 2; y = 0x00; NZ(y); ins++;
+  /* 0b13 beq $0aeb */
+  cyc += 2; ins++; if (nz == 0) { cyc++; goto L0aeb; }
+L0b15:
+  /* 0b15 sta $28,x */
+  cyc += 4; ea = (uint8_t)(0x28 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 0b17 iny */
+  cyc += 2; y++; NZ(y); ins++;
+  /* 0b18 tya */
+  cyc += 2; a = y; NZ(a); ins++;
+  /* 0b19 sta $2e,x */
+  cyc += 4; ea = (uint8_t)(0x2e + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 0b1b rts */
+  cyc += 6; b = POP(); pc = b; b = POP(); pc = (pc | b << 8) + 1; ins++; goto dispatch;
+L0b1c:
+  /* 0b1c lda #$00 */
+  cyc += 2; a = 0x00; NZ(a); ins++;
+  /* 0b1e ldx #$17 */
+  cyc += 2; x = 0x17; NZ(x); ins++;
+L0b20:
+  /* 0b20 sta $d400,x */
+  cyc += 5; ea = (uint16_t)(0xd400 + x); WRITE(ea, a); ins++;
+  /* 0b23 dex a */
+  cyc += 2; x--; NZ(x); ins++;
+  /* 0b24 bpl $0b20 */
+  cyc += 2; ins++; if (!(n & 0x80)) { cyc++; goto L0b20; }
+  /* 0b26 stx $76 */
+  cyc += 3; mem[0x76] = x; DIRTY(0x0076); ins++;
+  /* 0b28 sta $0e */
+  cyc += 3; mem[0x0e] = a; DIRTY(0x000e); ins++;
+  /* 0b2a sta $77 */
+  cyc += 3; mem[0x77] = a; DIRTY(0x0077); ins++;
+  /* 0b2c lda #$0f */
+  cyc += 2; a = 0x0f; NZ(a); ins++;
+  /* 0b2e sta $d418 */
+  cyc += 4; SYNC(); sid_poke(0x18, a); ins++;
+  /* 0b31 dey */
+  cyc += 2; y--; NZ(y); ins++;
+  /* 0b32 lda $0c38,y */
+  cyc += 4; ea = (uint16_t)(0x0c38 + y); a = mem[ea]; NZ(a); ins++;
+  /* 0b35 sta $0f */
+  cyc += 3; mem[0x0f] = a; DIRTY(0x000f); ins++;
+  /* 0b37 tya */
+  cyc += 2; a = y; NZ(a); ins++;
+  /* 0b38 asl a */
+  cyc += 2; b = a; c = b >> 7; b <<= 1; a = b; NZ(b); ins++;
+  /* 0b39 sta $fe */
+  cyc += 3; mem[0xfe] = a; DIRTY(0x00fe); ins++;
+  /* 0b3b asl a */
+  cyc += 2; b = a; c = b >> 7; b <<= 1; a = b; NZ(b); ins++;
+  /* 0b3c clc */
+  cyc += 2; c = 0; ins++;
+  /* 0b3d adc $fe */
+  cyc += 3; t = a + mem[0xfe] + c; c = t >> 8; a = t; NZ(a); v = c ^ (a >> 7); ins++;
+  /* 0b3f tay */
+  cyc += 2; y = a; NZ(y); ins++;
+  /* 0b40 ldx #$00 */
+  cyc += 2; x = 0x00; NZ(x); ins++;
+L0b42:
+  /* 0b42 lda $0c39,y */
+  cyc += 4; ea = (uint16_t)(0x0c39 + y); a = mem[ea]; NZ(a); ins++;
+  /* 0b45 sta $31,x */
+  cyc += 4; ea = (uint8_t)(0x31 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 0b47 iny */
+  cyc += 2; y++; NZ(y); ins++;
+  /* 0b48 lda $0c39,y */
+  cyc += 4; ea = (uint16_t)(0x0c39 + y); a = mem[ea]; NZ(a); ins++;
+  /* 0b4b sta $34,x */
+  cyc += 4; ea = (uint8_t)(0x34 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 0b4d lda #$01 */
+  cyc += 2; a = 0x01; NZ(a); ins++;
+  /* 0b4f sta $0b,x */
+  cyc += 4; ea = (uint8_t)(0x0b + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 0b51 lda #$00 */
+  cyc += 2; a = 0x00; NZ(a); ins++;
+  /* 0b53 sta $2e,x */
+  cyc += 4; ea = (uint8_t)(0x2e + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 0b55 sta $37,x */
+  cyc += 4; ea = (uint8_t)(0x37 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 0b57 iny */
+  cyc += 2; y++; NZ(y); ins++;
+  /* 0b58 inx */
+  cyc += 2; x++; NZ(x); ins++;
+  /* 0b59 cpx #$03 */
+  cyc += 2; b = 0x03; NZ(x - b); c = x >= b; ins++;
+  /* 0b5b bne $0b42 */
+  cyc += 2; ins++; if (nz != 0) { cyc++; goto L0b42; }
+  /* 0b5d rts */
+  cyc += 6; b = POP(); pc = b; b = POP(); pc = (pc | b << 8) + 1; ins++; goto dispatch;
+
+leave:
+  SYNC();
+  m->cpu.a = a;
+  m->cpu.x = x;
+  m->cpu.y = y;
+  m->cpu.s = s;
+  m->cpu.p = GET_P();
+  m->cpu.pc = pc;
+
+  return ok;
+}
+
+static const uint8_t init_0c00_2_code[] = {
+  0x4c, 0x07, 0x0c, 0x0a, 0x0a, 0x0a, 0xa8, 0xa2, 0x84, 0xa9, 0x00, 0xca,
+  0x9d, 0x56, 0x12, 0xd0, 0xfa, 0xa9, 0x00, 0x8d, 0xd8, 0x12, 0x8d, 0xd5,
+  0x12, 0x8d, 0x92, 0x0c, 0x8d, 0x06, 0x0c, 0xa9, 0x01, 0x8d, 0x53, 0x12,
+  0x8d, 0xd9, 0x12, 0xa9, 0x0f, 0x8d, 0x93, 0x0c, 0x8d, 0xd4, 0x12, 0xb9,
+  0xb2, 0x13, 0x8d, 0x54, 0x12, 0x8d, 0x55, 0x12, 0xc9, 0x02, 0x10, 0x07,
+  0xa8, 0xb9, 0xf7, 0x15, 0x8d, 0x55, 0x12, 0xa2, 0x00, 0x20, 0x53, 0x0c,
+  0xa2, 0x07, 0x20, 0x53, 0x0c, 0xa2, 0x0e, 0xb9, 0xac, 0x13, 0x9d, 0xda,
+  0x12, 0x9d, 0xdc, 0x12, 0xb9, 0xad, 0x13, 0x9d, 0xdb, 0x12, 0x9d, 0xdd,
+  0x12, 0xc8, 0xc8, 0xa9, 0x01, 0x9d, 0x5a, 0x12, 0x9d, 0xaa, 0x12, 0x9d,
+  0xac, 0x12, 0x9d, 0x86, 0x12, 0xa9, 0x00, 0x9d, 0x98, 0x12, 0x60,
+};
+
+static const struct c64_aot_range init_0c00_2_ranges[] = {
+  { 0x0c00, 3, init_0c00_2_code + 0 },
+  { 0x0c07, 116, init_0c00_2_code + 3 },
+};
+
+/* src/cantina_band.sid song 1, 50 instructions */
+static bool init_0c00_2(struct c64_aot_machine* m)
+{
+  uint8_t* mem = m->memory;
+  uint32_t cyc = *m->cycles;
+  uint32_t ins = *m->instructions;
+  uint8_t a = m->cpu.a;
+  uint8_t x = m->cpu.x;
+  uint8_t y = m->cpu.y;
+  uint8_t s = m->cpu.s;
+  uint8_t p, n, nz, c, v;
+  uint8_t b;
+  uint16_t ea;
+  uint16_t pc;
+  bool ok;
+
+  SET_P(m->cpu.p);
+  goto L0c00;
+
+dispatch:
+  switch (pc) {
+    case 0x0c4c: goto L0c4c;
+    case 0x0c51: goto L0c51;
+    default: LEAVE(pc, true);
+  }
+
+L0c00:
+  /* 0c00 jmp $0c07 */
+  cyc += 3; ins++; goto L0c07;
+L0c07:
+  /* 0c07 asl a */
+  cyc += 2; b = a; c = b >> 7; b <<= 1; a = b; NZ(b); ins++;
+  /* 0c08 asl a */
+  cyc += 2; b = a; c = b >> 7; b <<= 1; a = b; NZ(b); ins++;
+  /* 0c09 asl a */
+  cyc += 2; b = a; c = b >> 7; b <<= 1; a = b; NZ(b); ins++;
+  /* 0c0a tay */
+  cyc += 2; y = a; NZ(y); ins++;
+  /* 0c0b ldx #$84 */
+  cyc += 2; x = 0x84; NZ(x); ins++;
+  /* 0c0d lda #$00 */
+  cyc += 2; a = 0x00; NZ(a); ins++;
+L0c0f:
+  /* 0c0f dex a */
+  cyc += 2; x--; NZ(x); ins++;
+  /* 0c10 sta $1256,x */
+  cyc += 5; ea = (uint16_t)(0x1256 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 0c13 bne $0c0f */
+  cyc += 2; ins++; if (nz != 0) { cyc++; goto L0c0f; }
+  /* 0c15 lda #$00 */
+  cyc += 2; a = 0x00; NZ(a); ins++;
+  /* 0c17 sta $12d8 */
+  cyc += 4; mem[0x12d8] = a; DIRTY(0x12d8); ins++;
+  /* 0c1a sta $12d5 */
+  cyc += 4; mem[0x12d5] = a; DIRTY(0x12d5); ins++;
+  /* 0c1d sta $0c92 */
+  cyc += 4; mem[0x0c92] = a; DIRTY(0x0c92); ins++;
+  /* 0c20 sta $0c06 */
+  cyc += 4; mem[0x0c06] = a; DIRTY(0x0c06); ins++;
+  /* 0c23 lda #$01 */
+  cyc += 2; a = 0x01; NZ(a); ins++;
+  /* 0c25 sta $1253 */
+  cyc += 4; mem[0x1253] = a; DIRTY(0x1253); ins++;
+  /* 0c28 sta $12d9 */
+  cyc += 4; mem[0x12d9] = a; DIRTY(0x12d9); ins++;
+  /* 0c2b lda #$0f */
+  cyc += 2; a = 0x0f; NZ(a); ins++;
+  /* 0c2d sta $0c93 */
+  cyc += 4; mem[0x0c93] = a; DIRTY(0x0c93); ins++;
+  /* 0c30 sta $12d4 */
+  cyc += 4; mem[0x12d4] = a; DIRTY(0x12d4); ins++;
+  /* 0c33 lda $13b2,y */
+  cyc += 4; ea = (uint16_t)(0x13b2 + y); a = mem[ea]; NZ(a); ins++;
+  /* 0c36 sta $1254 */
+  cyc += 4; mem[0x1254] = a; DIRTY(0x1254); ins++;
+  /* 0c39 sta $1255 */
+  cyc += 4; mem[0x1255] = a; DIRTY(0x1255); ins++;
+  /* 0c3c cmp #$02 */
+  cyc += 2; b = 0x02; NZ(a - b); c = a >= b; ins++;
+  /* 0c3e bpl $0c47 */
+  cyc += 2; ins++; if (!(n & 0x80)) { cyc++; goto L0c47; }
+  /* 0c40 tay */
+  cyc += 2; y = a; NZ(y); ins++;
+  /* 0c41 lda $15f7,y */
+  cyc += 4; ea = (uint16_t)(0x15f7 + y); a = mem[ea]; NZ(a); ins++;
+  /* 0c44 sta $1255 */
+  cyc += 4; mem[0x1255] = a; DIRTY(0x1255); ins++;
+L0c47:
+  /* 0c47 ldx #$00 */
+  cyc += 2; x = 0x00; NZ(x); ins++;
+  /* 0c49 jsr $0c53 */
+  cyc += 6; PUSH(0x0c); PUSH(0x4b); ins++; goto L0c53;
+L0c4c:
+  /* 0c4c ldx #$07 */
+  cyc += 2; x = 0x07; NZ(x); ins++;
+  /* 0c4e jsr $0c53 */
+  cyc += 6; PUSH(0x0c); PUSH(0x50); ins++; goto L0c53;
+L0c51:
+  /* 0c51 ldx #$0e */
+  cyc += 2; x = 0x0e; NZ(x); ins++;
+L0c53:
+  /* 0c53 lda $13ac,y */
+  cyc += 4; ea = (uint16_t)(0x13ac + y); a = mem[ea]; NZ(a); ins++;
+  /* 0c56 sta $12da,x */
+  cyc += 5; ea = (uint16_t)(0x12da + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 0c59 sta $12dc,x */
+  cyc += 5; ea = (uint16_t)(0x12dc + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 0c5c lda $13ad,y */
+  cyc += 4; ea = (uint16_t)(0x13ad + y); a = mem[ea]; NZ(a); ins++;
+  /* 0c5f sta $12db,x */
+  cyc += 5; ea = (uint16_t)(0x12db + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 0c62 sta $12dd,x */
+  cyc += 5; ea = (uint16_t)(0x12dd + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 0c65 iny */
+  cyc += 2; y++; NZ(y); ins++;
+  /* 0c66 iny */
+  cyc += 2; y++; NZ(y); ins++;
+  /* 0c67 lda #$01 */
+  cyc += 2; a = 0x01; NZ(a); ins++;
+  /* 0c69 sta $125a,x */
+  cyc += 5; ea = (uint16_t)(0x125a + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 0c6c sta $12aa,x */
+  cyc += 5; ea = (uint16_t)(0x12aa + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 0c6f sta $12ac,x */
+  cyc += 5; ea = (uint16_t)(0x12ac + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 0c72 sta $1286,x */
+  cyc += 5; ea = (uint16_t)(0x1286 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 0c75 lda #$00 */
+  cyc += 2; a = 0x00; NZ(a); ins++;
+  /* 0c77 sta $1298,x */
+  cyc += 5; ea = (uint16_t)(0x1298 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 0c7a rts */
+  cyc += 6; b = POP(); pc = b; b = POP(); pc = (pc | b << 8) + 1; ins++; goto dispatch;
+
+leave:
+  SYNC();
+  m->cpu.a = a;
+  m->cpu.x = x;
+  m->cpu.y = y;
+  m->cpu.s = s;
+  m->cpu.p = GET_P();
+  m->cpu.pc = pc;
+
+  return ok;
+}
+
+static const uint8_t init_19ae_4_code[] = {
+  0x69, 0x01, 0x85, 0x76, 0x60,
+};
+
+static const struct c64_aot_range init_19ae_4_ranges[] = {
+  { 0x19ae, 5, init_19ae_4_code + 0 },
+};
+
+/* src/nexion.sid song 1, 3 instructions */
+static bool init_19ae_4(struct c64_aot_machine* m)
+{
+  uint8_t* mem = m->memory;
+  uint32_t cyc = *m->cycles;
+  uint32_t ins = *m->instructions;
+  uint8_t a = m->cpu.a;
+  uint8_t x = m->cpu.x;
+  uint8_t y = m->cpu.y;
+  uint8_t s = m->cpu.s;
+  uint8_t p, n, nz, c, v;
+  uint8_t b;
+  unsigned t;
+  uint16_t pc;
+  bool ok;
+
+  SET_P(m->cpu.p);
+  goto L19ae;
+
+dispatch:
+  LEAVE(pc, true);
+
+L19ae:
+  /* 19ae adc #$01 */
+  cyc += 2; t = a + 0x01 + c; c = t >> 8; a = t; NZ(a); v = c ^ (a >> 7); ins++;
+  /* 19b0 sta $76 */
+  cyc += 3; mem[0x76] = a; DIRTY(0x0076); ins++;
+  /* 19b2 rts */
+  cyc += 6; b = POP(); pc = b; b = POP(); pc = (pc | b << 8) + 1; ins++; goto dispatch;
+
+leave:
+  SYNC();
+  m->cpu.a = a;
+  m->cpu.x = x;
+  m->cpu.y = y;
+  m->cpu.s = s;
+  m->cpu.p = GET_P();
+  m->cpu.pc = pc;
+
+  return ok;
+}
+
+static const uint8_t play_1000_5_code[] = {
+  0xa4, 0x76, 0x30, 0x09, 0xf0, 0x03, 0x4c, 0xf9, 0x12, 0x8c, 0x18, 0xd4,
+  0x60, 0xa2, 0x02, 0x20, 0x20, 0x10, 0xca, 0x10, 0xfa, 0x86, 0x77, 0xc6,
+  0x0e, 0x10, 0x04, 0xa5, 0x0f, 0x85, 0x0e, 0x60, 0xa5, 0x0e, 0xd0, 0x07,
+  0xd6, 0x0b, 0xd0, 0x03, 0x4c, 0x03, 0x12, 0xb5, 0x13, 0xd0, 0x2f, 0x95,
+  0x6d, 0x95, 0x70, 0x95, 0x22, 0x95, 0x52, 0x95, 0x4f, 0x95, 0x61, 0x95,
+  0x64, 0x95, 0x67, 0xb4, 0x1c, 0xb9, 0x66, 0x14, 0x95, 0x3a, 0xb9, 0x6a,
+  0x14, 0x29, 0x0f, 0x95, 0x73, 0xb9, 0x68, 0x14, 0x48, 0xb9, 0x69, 0x14,
+  0xbc, 0xfb, 0x13, 0x99, 0x06, 0xd4, 0x68, 0x99, 0x05, 0xd4, 0xf6, 0x13,
+  0xb5, 0x43, 0x10, 0x24, 0xb4, 0x46, 0xb9, 0x2a, 0x14, 0x85, 0xfe, 0xb9,
+  0x2e, 0x14, 0x85, 0xff, 0xb4, 0x3d, 0xb1, 0xfe, 0xc9, 0xff, 0xf0, 0x04,
+  0xf6, 0x3d, 0x95, 0x3a, 0xb4, 0x40, 0xb1, 0xfe, 0xc9, 0x80, 0xf0, 0x04,
+  0xf6, 0x40, 0x95, 0x22, 0xb5, 0x1f, 0x18, 0x75, 0x22, 0xa8, 0xb5, 0x43,
+  0x29, 0x08, 0xd0, 0x06, 0x98, 0x75, 0x25, 0x75, 0x52, 0xa8, 0x84, 0xff,
+  0xb9, 0x3b, 0x13, 0x95, 0x58, 0xb9, 0x9b, 0x13, 0x95, 0x5b, 0xb5, 0x13,
+  0xc9, 0x02, 0xd0, 0x0c, 0xb5, 0x43, 0x29, 0x40, 0xf0, 0x06, 0xa9, 0x81,
+  0x95, 0x3a, 0xd0, 0x0f, 0xc9, 0x03, 0xd0, 0x0b, 0xb5, 0x43, 0x30, 0x07,
+  0xb4, 0x1c, 0xb9, 0x67, 0x14, 0x95, 0x3a, 0xb5, 0x5e, 0x85, 0x78, 0xf0,
+  0x03, 0x20, 0xe0, 0x11, 0xb5, 0x4c, 0xf0, 0x03, 0x20, 0xb0, 0x11, 0xb4,
+  0x55, 0xf0, 0x09, 0x20, 0x9a, 0x11, 0xb5, 0x43, 0x29, 0x02, 0xd0, 0x1c,
+  0xb5, 0x43, 0x29, 0x01, 0xf0, 0x16, 0xa5, 0x78, 0xf0, 0x06, 0xb5, 0x43,
+  0x29, 0x04, 0xd0, 0x0c, 0xb5, 0x49, 0x29, 0x1c, 0x0a, 0xd5, 0x13, 0xb0,
+  0x03, 0x20, 0x22, 0x11, 0xbc, 0xfb, 0x13, 0xb5, 0x70, 0x99, 0x02, 0xd4,
+  0xb5, 0x73, 0x99, 0x03, 0xd4, 0xb5, 0x58, 0x18, 0x75, 0x61, 0x99, 0x00,
+  0xd4, 0xb5, 0x5b, 0x75, 0x64, 0x99, 0x01, 0xd4, 0xb5, 0x3a, 0x99, 0x04,
+  0xd4, 0x60, 0xb5, 0x46, 0x29, 0x0f, 0x85, 0x78, 0x46, 0x78, 0xb4, 0x67,
+  0x10, 0x06, 0xd6, 0x6a, 0xd0, 0x0f, 0xf0, 0x08, 0xf6, 0x6a, 0xd5, 0x6a,
+  0xb0, 0x07, 0x95, 0x6a, 0x98, 0x49, 0xff, 0x95, 0x67, 0xa4, 0xff, 0xb9,
+  0x3c, 0x13, 0x38, 0xf5, 0x58, 0x85, 0xfe, 0xb9, 0x9c, 0x13, 0xf5, 0x5b,
+  0xb4, 0x46, 0x10, 0x02, 0x75, 0x13, 0x85, 0xff, 0xb5, 0x46, 0x29, 0x70,
+  0x4a, 0x4a, 0x4a, 0x4a, 0xa8, 0x46, 0xff, 0x66, 0xfe, 0x88, 0x10, 0xf9,
+  0xa5, 0x78, 0x38, 0xf5, 0x6a, 0x30, 0x14, 0xa8, 0x88, 0x30, 0x26, 0xb5,
+  0x58, 0x18, 0x65, 0xfe, 0x95, 0x58, 0xb5, 0x5b, 0x65, 0xff, 0x95, 0x5b,
+  0x4c, 0x70, 0x11, 0xb5, 0x6a, 0x38, 0xe5, 0x78, 0xa8, 0xb5, 0x58, 0x38,
+  0xe5, 0xfe, 0x95, 0x58, 0xb5, 0x5b, 0xe5, 0xff, 0x95, 0x5b, 0x88, 0xd0,
+  0xf0, 0x60, 0xd6, 0x4f, 0x10, 0x05, 0xb9, 0x10, 0x14, 0x95, 0x4f, 0xb9,
+  0xfd, 0x13, 0x18, 0x75, 0x4f, 0xa8, 0xb9, 0x02, 0x14, 0x95, 0x52, 0x60,
+  0xb5, 0x6d, 0xd0, 0x17, 0xb5, 0x70, 0x18, 0x75, 0x4c, 0xa8, 0xb5, 0x73,
+  0x69, 0x00, 0xc9, 0x10, 0xd0, 0x03, 0xf6, 0x6d, 0x60, 0x95, 0x73, 0x98,
+  0x95, 0x70, 0x60, 0xb5, 0x70, 0x38, 0xf5, 0x4c, 0xa8, 0xb5, 0x73, 0xe9,
+  0x00, 0x10, 0x03, 0xd6, 0x6d, 0x60, 0x95, 0x73, 0x98, 0x95, 0x70, 0x60,
+  0x29, 0x7f, 0x0a, 0xb4, 0x5e, 0x30, 0x0c, 0x18, 0x75, 0x61, 0x95, 0x61,
+  0xb5, 0x64, 0x69, 0x00, 0x95, 0x64, 0x60, 0x85, 0xfe, 0xb5, 0x61, 0x38,
+  0xe5, 0xfe, 0x95, 0x61, 0xb5, 0x64, 0xe9, 0x00, 0x95, 0x64, 0x60, 0xa5,
+  0x77, 0xf0, 0x24, 0xb4, 0x28, 0xb9, 0xe6, 0x14, 0x85, 0xfe, 0xb9, 0x00,
+  0x15, 0x85, 0xff, 0xb4, 0x2b, 0xb1, 0xfe, 0xc9, 0xff, 0xd0, 0x16, 0xa9,
+  0x00, 0x95, 0x55, 0xb5, 0x37, 0xf0, 0x08, 0xd6, 0x37, 0xa9, 0x00, 0x95,
+  0x2b, 0xf0, 0xe8, 0x20, 0xb8, 0x12, 0x4c, 0x07, 0x12, 0xa9, 0x00, 0x85,
+  0x78, 0x95, 0x13, 0x95, 0x5e, 0xb1, 0xfe, 0x30, 0x08, 0x95, 0x1f, 0xc8,
+  0x98, 0x95, 0x2b, 0xd0, 0x2c, 0xc9, 0xc0, 0x90, 0x10, 0xc9, 0xe0, 0x90,
+  0x16, 0xc9, 0xf0, 0x90, 0x19, 0xc8, 0xb1, 0xfe, 0x95, 0x5e, 0xc8, 0xd0,
+  0xe0, 0x29, 0x3f, 0x18, 0x65, 0x78, 0x85, 0x78, 0xc8, 0xd0, 0xd6, 0x29,
+  0x1f, 0x95, 0x19, 0xc8, 0xd0, 0xcf, 0x29, 0x0f, 0x95, 0x55, 0xc8, 0xd0,
+  0xc8, 0xa5, 0x78, 0xf0, 0x02, 0x95, 0x10, 0xb5, 0x10, 0x95, 0x0b, 0xb5,
+  0x16, 0xd0, 0x02, 0xb5, 0x19, 0x0a, 0x0a, 0x0a, 0x95, 0x1c, 0xa8, 0xb9,
+  0x6a, 0x14, 0x29, 0xf0, 0x95, 0x4c, 0xb9, 0x6c, 0x14, 0x95, 0x46, 0xb9,
+  0x6d, 0x14, 0x95, 0x49, 0xb9, 0x6b, 0x14, 0x95, 0x43, 0x30, 0x01, 0x60,
+  0xb4, 0x46, 0xb9, 0x2a, 0x14, 0x85, 0xfe, 0xb9, 0x2e, 0x14, 0x85, 0xff,
+  0xa0, 0x00, 0xb1, 0xfe, 0x95, 0x3d, 0xc8, 0xb1, 0xfe, 0x95, 0x40, 0x60,
+  0xa9, 0x00, 0x95, 0x2b, 0x95, 0x16, 0xb4, 0x2e, 0xb5, 0x31, 0x85, 0xfe,
+  0xb5, 0x34, 0x85, 0xff, 0xb1, 0xfe, 0xc9, 0x40, 0x90, 0x24, 0xc9, 0xff,
+  0xf0, 0x1c, 0xc9, 0x80, 0x90, 0x0a, 0xc9, 0xc0, 0x90, 0x0d, 0xa0, 0x00,
+  0x84, 0x76, 0xf0, 0xe8, 0x29, 0x3f, 0x95, 0x37, 0xc8, 0xd0, 0xe1, 0x29,
+  0x3f, 0x95, 0x25, 0xc8, 0xd0, 0xda, 0xa0, 0x00, 0xf0, 0xd6, 0x95, 0x28,
+  0xc8, 0x98, 0x95, 0x2e, 0x60, 0xa9, 0x00, 0xa2, 0x17, 0x9d, 0x00, 0xd4,
+  0xca, 0x10, 0xfa, 0x86, 0x76, 0x85, 0x0e, 0x85, 0x77, 0xa9, 0x0f, 0x8d,
+  0x18, 0xd4, 0x88, 0xb9, 0x15, 0x14, 0x85, 0x0f, 0x98, 0x0a, 0x85, 0xfe,
+  0x0a, 0x18, 0x65, 0xfe, 0xa8, 0xa2, 0x00, 0xb9, 0x18, 0x14, 0x95, 0x31,
+  0xc8, 0xb9, 0x18, 0x14, 0x95, 0x34, 0xa9, 0x01, 0x95, 0x0b, 0xa9, 0x00,
+  0x95, 0x2e, 0x95, 0x37, 0xc8, 0xe8, 0xe0, 0x03, 0xd0, 0xe5, 0x60,
+};
+
+static const struct c64_aot_range play_1000_5_ranges[] = {
+  { 0x1000, 827, play_1000_5_code + 0 },
+};
+
+/* src/nexion.sid song 1, 429 instructions */
+static bool play_1000_5(struct c64_aot_machine* m)
+{
+  uint8_t* mem = m->memory;
+  uint32_t cyc = *m->cycles;
+  uint32_t ins = *m->instructions;
+  uint8_t a = m->cpu.a;
+  uint8_t x = m->cpu.x;
+  uint8_t y = m->cpu.y;
+  uint8_t s = m->cpu.s;
+  uint8_t p, n, nz, c, v;
+  uint8_t b;
+  unsigned t;
+  uint16_t ea;
+  uint16_t pc;
+  bool ok;
+
+  SET_P(m->cpu.p);
+  goto L1000;
+
+dispatch:
+  switch (pc) {
+    case 0x1012: goto L1012;
+    case 0x10d0: goto L10d0;
+    case 0x10d7: goto L10d7;
+    case 0x10de: goto L10de;
+    case 0x1100: goto L1100;
+    case 0x122e: goto L122e;
+    default: LEAVE(pc, true);
+  }
+
+L1000:
+  /* 1000 ldy $76 */
+  cyc += 3; y = mem[0x76]; NZ(y); ins++;
+  /* 1002 bmi $100d */
+  cyc += 2; ins++; if (n & 0x80) { cyc++; goto L100d; }
+  /* 1004 beq $1009 */
+  cyc += 2; ins++; if (nz == 0) { cyc++; goto L1009; }
+  /* 1006 jmp $12f9 */
+  cyc += 3; ins++; goto L12f9;
+L1009:
+  /* 1009 sty $d418 */
+  cyc += 4; SYNC(); sid_poke(0x18, y); ins++;
+  /* 100c rts */
+  cyc += 6; b = POP(); pc = b; b = POP(); pc = (pc | b << 8) + 1; ins++; goto dispatch;
+L100d:
+  /* 100d ldx #$02 */
+  cyc += 2; x = 0x02; NZ(x); ins++;
+L100f:
+  /* 100f jsr $1020 */
+  cyc += 6; PUSH(0x10); PUSH(0x11); ins++; goto L1020;
+L1012:
+  /* 1012 dex a */
+  cyc += 2; x--; NZ(x); ins++;
+  /* 1013 bpl $100f */
+  cyc += 2; ins++; if (!(n & 0x80)) { cyc++; goto L100f; }
+  /* 1015 stx $77 */
+  cyc += 3; mem[0x77] = x; DIRTY(0x0077); ins++;
+  /* 1017 dec $0e */
+  cyc += 5; b = mem[0x0e]; b--; mem[0x0e] = b; DIRTY(0x000e); NZ(b); ins++;
+  /* 1019 bpl $101f */
+  cyc += 2; ins++; if (!(n & 0x80)) { cyc++; goto L101f; }
+  /* 101b lda $0f */
+  cyc += 3; a = mem[0x0f]; NZ(a); ins++;
+  /* 101d sta $0e */
+  cyc += 3; mem[0x0e] = a; DIRTY(0x000e); ins++;
+L101f:
+  /* 101f rts */
+  cyc += 6; b = POP(); pc = b; b = POP(); pc = (pc | b << 8) + 1; ins++; goto dispatch;
+L1020:
+  /* 1020 lda $0e */
+  cyc += 3; a = mem[0x0e]; NZ(a); ins++;
+  /* 1022 bne $102b */
+  cyc += 2; ins++; if (nz != 0) { cyc++; goto L102b; }
+  /* 1024 dec $0b,x */
+  cyc += 6; ea = (uint8_t)(0x0b + x); b = mem[ea]; b--; mem[ea] = b; DIRTY(ea); NZ(b); ins++;
+  /* 1026 bne $102b */
+  cyc += 2; ins++; if (nz != 0) { cyc++; goto L102b; }
+  /* 1028 jmp $1203 */
+  cyc += 3; ins++; goto L1203;
+L102b:
+  /* 102b lda $13,x */
+  cyc += 4; ea = (uint8_t)(0x13 + x); a = mem[ea]; NZ(a); ins++;
+  /* 102d bne $105e */
+  cyc += 2; ins++; if (nz != 0) { cyc++; goto L105e; }
+  /* 102f sta $6d,x */
+  cyc += 4; ea = (uint8_t)(0x6d + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 1031 sta $70,x */
+  cyc += 4; ea = (uint8_t)(0x70 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 1033 sta $22,x */
+  cyc += 4; ea = (uint8_t)(0x22 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 1035 sta $52,x */
+  cyc += 4; ea = (uint8_t)(0x52 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 1037 sta $4f,x */
+  cyc += 4; ea = (uint8_t)(0x4f + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 1039 sta $61,x */
+  cyc += 4; ea = (uint8_t)(0x61 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 103b sta $64,x */
+  cyc += 4; ea = (uint8_t)(0x64 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 103d sta $67,x */
+  cyc += 4; ea = (uint8_t)(0x67 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 103f ldy $1c,x */
+  cyc += 4; ea = (uint8_t)(0x1c + x); y = mem[ea]; NZ(y); ins++;
+  /* 1041 lda $1466,y */
+  cyc += 4; ea = (uint16_t)(0x1466 + y); a = mem[ea]; NZ(a); ins++;
+  /* 1044 sta $3a,x */
+  cyc += 4; ea = (uint8_t)(0x3a + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 1046 lda $146a,y */
+  cyc += 4; ea = (uint16_t)(0x146a + y); a = mem[ea]; NZ(a); ins++;
+  /* 1049 and #$0f */
+  cyc += 2; a &= 0x0f; NZ(a); ins++;
+  /* 104b sta $73,x */
+  cyc += 4; ea = (uint8_t)(0x73 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 104d lda $1468,y */
+  cyc += 4; ea = (uint16_t)(0x1468 + y); a = mem[ea]; NZ(a); ins++;
+  /* 1050 pha */
+  cyc += 3; PUSH(a); ins++;
+  /* 1051 lda $1469,y */
+  cyc += 4; ea = (uint16_t)(0x1469 + y); a = mem[ea]; NZ(a); ins++;
+  /* 1054 ldy $13fb,x */
+  cyc += 4; ea = (uint16_t)(0x13fb + x); y = mem[ea]; NZ(y); ins++;
+  /* 1057 sta $d406,y */
+  cyc += 5; ea = (uint16_t)(0xd406 + y); WRITE(ea, a); ins++;
+  /* 105a pla */
+  cyc += 4; a = POP(); NZ(a); ins++;
+  /* 105b sta $d405,y */
+  cyc += 5; ea = (uint16_t)(0xd405 + y); WRITE(ea, a); ins++;
+L105e:
+  /* 105e inc $13,x */
+  cyc += 6; ea = (uint8_t)(0x13 + x); b = mem[ea]; b++; mem[ea] = b; DIRTY(ea); NZ(b); ins++;
+  /* 1060 lda $43,x */
+  cyc += 4; ea = (uint8_t)(0x43 + x); a = mem[ea]; NZ(a); ins++;
+  /* 1062 bpl $1088 */
+  cyc += 2; ins++; if (!(n & 0x80)) { cyc++; goto L1088; }
+  /* 1064 ldy $46,x */
+  cyc += 4; ea = (uint8_t)(0x46 + x); y = mem[ea]; NZ(y); ins++;
+  /* 1066 lda $142a,y */
+  cyc += 4; ea = (uint16_t)(0x142a + y); a = mem[ea]; NZ(a); ins++;
+  /* 1069 sta $fe */
+  cyc += 3; mem[0xfe] = a; DIRTY(0x00fe); ins++;
+  /* 106b lda $142e,y */
+  cyc += 4; ea = (uint16_t)(0x142e + y); a = mem[ea]; NZ(a); ins++;
+  /* 106e sta $ff */
+  cyc += 3; mem[0xff] = a; DIRTY(0x00ff); ins++;
+  /* 1070 ldy $3d,x */
+  cyc += 4; ea = (uint8_t)(0x3d + x); y = mem[ea]; NZ(y); ins++;
+  /* 1072 lda ($fe),y */
+  cyc += 5; ea = (uint16_t)((mem[0xfe] | mem[0xff] << 8) + y); a = READ(ea); NZ(a); ins++;
+  /* 1074 cmp #$ff */
+  cyc += 2; b = 0xff; NZ(a - b); c = a >= b; ins++;
+  /* 1076 beq $107c */
+  cyc += 2; ins++; if (nz == 0) { cyc++; goto L107c; }
+  /* 1078 inc $3d,x */
+  cyc += 6; ea = (uint8_t)(0x3d + x); b = mem[ea]; b++; mem[ea] = b; DIRTY(ea); NZ(b); ins++;
+  /* 107a sta $3a,x */
+  cyc += 4; ea = (uint8_t)(0x3a + x); mem[ea] = a; DIRTY(ea); ins++;
+L107c:
+  /* 107c ldy $40,x */
+  cyc += 4; ea = (uint8_t)(0x40 + x); y = mem[ea]; NZ(y); ins++;
+  /* 107e lda ($fe),y */
+  cyc += 5; ea = (uint16_t)((mem[0xfe] | mem[0xff] << 8) + y); a = READ(ea); NZ(a); ins++;
+  /* 1080 cmp #$80 */
+  cyc += 2; b = 0x80; NZ(a - b); c = a >= b; ins++;
+  /* 1082 beq $1088 */
+  cyc += 2; ins++; if (nz == 0) { cyc++; goto L1088; }
+  /* 1084 inc $40,x */
+  cyc += 6; ea = (uint8_t)(0x40 + x); b = mem[ea]; b++; mem[ea] = b; DIRTY(ea); NZ(b); ins++;
+  /* 1086 sta $22,x */
+  cyc += 4; ea = (uint8_t)(0x22 + x); mem[ea] = a; DIRTY(ea); ins++;
+L1088:
+  /* 1088 lda $1f,x */
+  cyc += 4; ea = (uint8_t)(0x1f + x); a = mem[ea]; NZ(a); ins++;
+  /* 108a clc */
+  cyc += 2; c = 0; ins++;
+  /* 108b adc $22,x */
+  cyc += 4; ea = (uint8_t)(0x22 + x); t = a + mem[ea] + c; c = t >> 8; a = t; NZ(a); v = c ^ (a >> 7); ins++;
+  /* 108d tay */
+  cyc += 2; y = a; NZ(y); ins++;
+  /* 108e lda $43,x */
+  cyc += 4; ea = (uint8_t)(0x43 + x); a = mem[ea]; NZ(a); ins++;
+  /* 1090 and #$08 */
+  cyc += 2; a &= 0x08; NZ(a); ins++;
+  /* 1092 bne $109a */
+  cyc += 2; ins++; if (nz != 0) { cyc++; goto L109a; }
+  /* 1094 tya */
+  cyc += 2; a = y; NZ(a); ins++;
+  /* 1095 adc $25,x */
+  cyc += 4; ea = (uint8_t)(0x25 + x); t = a + mem[ea] + c; c = t >> 8; a = t; NZ(a); v = c ^ (a >> 7); ins++;
+  /* 1097 adc $52,x */
+  cyc += 4; ea = (uint8_t)(0x52 + x); t = a + mem[ea] + c; c = t >> 8; a = t; NZ(a); v = c ^ (a >> 7); ins++;
+  /* 1099 tay */
+  cyc += 2; y = a; NZ(y); ins++;
+L109a:
+  /* 109a sty $ff */
+  cyc += 3; mem[0xff] = y; DIRTY(0x00ff); ins++;
+  /* 109c lda $133b,y */
+  cyc += 4; ea = (uint16_t)(0x133b + y); a = mem[ea]; NZ(a); ins++;
+  /* 109f sta $58,x */
+  cyc += 4; ea = (uint8_t)(0x58 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 10a1 lda $139b,y */
+  cyc += 4; ea = (uint16_t)(0x139b + y); a = mem[ea]; NZ(a); ins++;
+  /* 10a4 sta $5b,x */
+  cyc += 4; ea = (uint8_t)(0x5b + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 10a6 lda $13,x */
+  cyc += 4; ea = (uint8_t)(0x13 + x); a = mem[ea]; NZ(a); ins++;
+  /* 10a8 cmp #$02 */
+  cyc += 2; b = 0x02; NZ(a - b); c = a >= b; ins++;
+  /* 10aa bne $10b8 */
+  cyc += 2; ins++; if (nz != 0) { cyc++; goto L10b8; }
+  /* 10ac lda $43,x */
+  cyc += 4; ea = (uint8_t)(0x43 + x); a = mem[ea]; NZ(a); ins++;
+  /* 10ae and #$40 */
+  cyc += 2; a &= 0x40; NZ(a); ins++;
+  /* 10b0 beq $10b8 */
+  cyc += 2; ins++; if (nz == 0) { cyc++; goto L10b8; }
+  /* 10b2 lda #$81 */
+  cyc += 2; a = 0x81; NZ(a); ins++;
+  /* 10b4 sta $3a,x */
+  cyc += 4; ea = (uint8_t)(0x3a + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 10b6 bne $10c7 */
+  cyc += 2; ins++; if (nz != 0) { cyc++; goto L10c7; }
+L10b8:
+  /* 10b8 cmp #$03 */
+  cyc += 2; b = 0x03; NZ(a - b); c = a >= b; ins++;
+  /* 10ba bne $10c7 */
+  cyc += 2; ins++; if (nz != 0) { cyc++; goto L10c7; }
+  /* 10bc lda $43,x */
+  cyc += 4; ea = (uint8_t)(0x43 + x); a = mem[ea]; NZ(a); ins++;
+  /* 10be bmi $10c7 */
+  cyc += 2; ins++; if (n & 0x80) { cyc++; goto L10c7; }
+  /* 10c0 ldy $1c,x */
+  cyc += 4; ea = (uint8_t)(0x1c + x); y = mem[ea]; NZ(y); ins++;
+  /* 10c2 lda $1467,y */
+  cyc += 4; ea = (uint16_t)(0x1467 + y); a = mem[ea]; NZ(a); ins++;
+  /* 10c5 sta $3a,x */
+  cyc += 4; ea = (uint8_t)(0x3a + x); mem[ea] = a; DIRTY(ea); ins++;
+L10c7:
+  /* 10c7 lda $5e,x */
+  cyc += 4; ea = (uint8_t)(0x5e + x); a = mem[ea]; NZ(a); ins++;
+  /* 10c9 sta $78 */
+  cyc += 3; mem[0x78] = a; DIRTY(0x0078); ins++;
+  /* 10cb beq $10d0 */
+  cyc += 2; ins++; if (nz == 0) { cyc++; goto L10d0; }
+  /* 10cd jsr $11e0 */
+  cyc += 6; PUSH(0x10); PUSH(0xcf); ins++; goto L11e0;
+L10d0:
+  /* 10d0 lda $4c,x */
+  cyc += 4; ea = (uint8_t)(0x4c + x); a = mem[ea]; NZ(a); ins++;
+  /* 10d2 beq $10d7 */
+  cyc += 2; ins++; if (nz == 0) { cyc++; goto L10d7; }
+  /* 10d4 jsr $11b0 */
+  cyc += 6; PUSH(0x10); PUSH(0xd6); ins++; goto L11b0;
+L10d7:
+  /* 10d7 ldy $55,x */
+  cyc += 4; ea = (uint8_t)(0x55 + x); y = mem[ea]; NZ(y); ins++;
+  /* 10d9 beq $10e4 */
+  cyc += 2; ins++; if (nz == 0) { cyc++; goto L10e4; }
+  /* 10db jsr $119a */
+  cyc += 6; PUSH(0x10); PUSH(0xdd); ins++; goto L119a;
+L10de:
+  /* 10de lda $43,x */
+  cyc += 4; ea = (uint8_t)(0x43 + x); a = mem[ea]; NZ(a); ins++;
+  /* 10e0 and #$02 */
+  cyc += 2; a &= 0x02; NZ(a); ins++;
+  /* 10e2 bne $1100 */
+  cyc += 2; ins++; if (nz != 0) { cyc++; goto L1100; }
+L10e4:
+  /* 10e4 lda $43,x */
+  cyc += 4; ea = (uint8_t)(0x43 + x); a = mem[ea]; NZ(a); ins++;
+  /* 10e6 and #$01 */
+  cyc += 2; a &= 0x01; NZ(a); ins++;
+  /* 10e8 beq $1100 */
+  cyc += 2; ins++; if (nz == 0) { cyc++; goto L1100; }
+  /* 10ea lda $78 */
+  cyc += 3; a = mem[0x78]; NZ(a); ins++;
+  /* 10ec beq $10f4 */
+  cyc += 2; ins++; if (nz == 0) { cyc++; goto L10f4; }
+  /* 10ee lda $43,x */
+  cyc += 4; ea = (uint8_t)(0x43 + x); a = mem[ea]; NZ(a); ins++;
+  /* 10f0 and #$04 */
+  cyc += 2; a &= 0x04; NZ(a); ins++;
+  /* 10f2 bne $1100 */
+  cyc += 2; ins++; if (nz != 0) { cyc++; goto L1100; }
+L10f4:
+  /* 10f4 lda $49,x */
+  cyc += 4; ea = (uint8_t)(0x49 + x); a = mem[ea]; NZ(a); ins++;
+  /* 10f6 and #$1c */
+  cyc += 2; a &= 0x1c; NZ(a); ins++;
+  /* 10f8 asl a */
+  cyc += 2; b = a; c = b >> 7; b <<= 1; a = b; NZ(b); ins++;
+  /* 10f9 cmp $13,x */
+  cyc += 4; ea = (uint8_t)(0x13 + x); b = mem[ea]; NZ(a - b); c = a >= b; ins++;
+  /* 10fb bcs $1100 */
+  cyc += 2; ins++; if (c) { cyc++; goto L1100; }
+  /* 10fd jsr $1122 */
+  cyc += 6; PUSH(0x10); PUSH(0xff); ins++; goto L1122;
+L1100:
+  /* 1100 ldy $13fb,x */
+  cyc += 4; ea = (uint16_t)(0x13fb + x); y = mem[ea]; NZ(y); ins++;
+  /* 1103 lda $70,x */
+  cyc += 4; ea = (uint8_t)(0x70 + x); a = mem[ea]; NZ(a); ins++;
+  /* 1105 sta $d402,y */
+  cyc += 5; ea = (uint16_t)(0xd402 + y); WRITE(ea, a); ins++;
+  /* 1108 lda $73,x */
+  cyc += 4; ea = (uint8_t)(0x73 + x); a = mem[ea]; NZ(a); ins++;
+  /* 110a sta $d403,y */
+  cyc += 5; ea = (uint16_t)(0xd403 + y); WRITE(ea, a); ins++;
+  /* 110d lda $58,x */
+  cyc += 4; ea = (uint8_t)(0x58 + x); a = mem[ea]; NZ(a); ins++;
+  /* 110f clc */
+  cyc += 2; c = 0; ins++;
+  /* 1110 adc $61,x */
+  cyc += 4; ea = (uint8_t)(0x61 + x); t = a + mem[ea] + c; c = t >> 8; a = t; NZ(a); v = c ^ (a >> 7); ins++;
+  /* 1112 sta $d400,y */
+  cyc += 5; ea = (uint16_t)(0xd400 + y); WRITE(ea, a); ins++;
+  /* 1115 lda $5b,x */
+  cyc += 4; ea = (uint8_t)(0x5b + x); a = mem[ea]; NZ(a); ins++;
+  /* 1117 adc $64,x */
+  cyc += 4; ea = (uint8_t)(0x64 + x); t = a + mem[ea] + c; c = t >> 8; a = t; NZ(a); v = c ^ (a >> 7); ins++;
+  /* 1119 sta $d401,y */
+  cyc += 5; ea = (uint16_t)(0xd401 + y); WRITE(ea, a); ins++;
+  /* 111c lda $3a,x */
+  cyc += 4; ea = (uint8_t)(0x3a + x); a = mem[ea]; NZ(a); ins++;
+  /* 111e sta $d404,y */
+  cyc += 5; ea = (uint16_t)(0xd404 + y); WRITE(ea, a); ins++;
+  /* 1121 rts */
+  cyc += 6; b = POP(); pc = b; b = POP(); pc = (pc | b << 8) + 1; ins++; goto dispatch;
+L1122:
+  /* 1122 lda $46,x */
+  cyc += 4; ea = (uint8_t)(0x46 + x); a = mem[ea]; NZ(a); ins++;
+  /* 1124 and #$0f */
+  cyc += 2; a &= 0x0f; NZ(a); ins++;
+  /* 1126 sta $78 */
+  cyc += 3; mem[0x78] = a; DIRTY(0x0078); ins++;
+  /* 1128 lsr $78 */
+  cyc += 5; b = mem[0x78]; c = b & 1; b >>= 1; mem[0x78] = b; DIRTY(0x0078); NZ(b); ins++;
+  /* 112a ldy $67,x */
+  cyc += 4; ea = (uint8_t)(0x67 + x); y = mem[ea]; NZ(y); ins++;
+  /* 112c bpl $1134 */
+  cyc += 2; ins++; if (!(n & 0x80)) { cyc++; goto L1134; }
+  /* 112e dec $6a,x */
+  cyc += 6; ea = (uint8_t)(0x6a + x); b = mem[ea]; b--; mem[ea] = b; DIRTY(ea); NZ(b); ins++;
+  /* 1130 bne $1141 */
+  cyc += 2; ins++; if (nz != 0) { cyc++; goto L1141; }
+  /* 1132 beq $113c */
+  cyc += 2; ins++; if (nz == 0) { cyc++; goto L113c; }
+L1134:
+  /* 1134 inc $6a,x */
+  cyc += 6; ea = (uint8_t)(0x6a + x); b = mem[ea]; b++; mem[ea] = b; DIRTY(ea); NZ(b); ins++;
+  /* 1136 cmp $6a,x */
+  cyc += 4; ea = (uint8_t)(0x6a + x); b = mem[ea]; NZ(a - b); c = a >= b; ins++;
+  /* 1138 bcs $1141 */
+  cyc += 2; ins++; if (c) { cyc++; goto L1141; }
+  /* 113a sta $6a,x */
+  cyc += 4; ea = (uint8_t)(0x6a + x); mem[ea] = a; DIRTY(ea); ins++;
+L113c:
+  /* 113c tya */
+  cyc += 2; a = y; NZ(a); ins++;
+  /* 113d eor #$ff */
+  cyc += 2; a ^= 0xff; NZ(a); ins++;
+  /* 113f sta $67,x */
+  cyc += 4; ea = (uint8_t)(0x67 + x); mem[ea] = a; DIRTY(ea); ins++;
+L1141:
+  /* 1141 ldy $ff */
+  cyc += 3; y = mem[0xff]; NZ(y); ins++;
+  /* 1143 lda $133c,y */
+  cyc += 4; ea = (uint16_t)(0x133c + y); a = mem[ea]; NZ(a); ins++;
+  /* 1146 sec */
+  cyc += 2; c = 1; ins++;
+  /* 1147 sbc $58,x */
+  cyc += 4; ea = (uint8_t)(0x58 + x); t = a + (uint8_t)(mem[ea] ^ 0xff) + c; c = t >> 8; a = t; NZ(a); v = c ^ (a >> 7); ins++;
+  /* 1149 sta $fe */
+  cyc += 3; mem[0xfe] = a; DIRTY(0x00fe); ins++;
+  /* 114b lda $139c,y */
+  cyc += 4; ea = (uint16_t)(0x139c + y); a = mem[ea]; NZ(a); ins++;
+  /* 114e sbc $5b,x */
+  cyc += 4; ea = (uint8_t)(0x5b + x); t = a + (uint8_t)(mem[ea] ^ 0xff) + c; c = t >> 8; a = t; NZ(a); v = c ^ (a >> 7); ins++;
+  /* 1150 ldy $46,x */
+  cyc += 4; ea = (uint8_t)(0x46 + x); y = mem[ea]; NZ(y); ins++;
+  /* 1152 bpl $1156 */
+  cyc += 2; ins++; if (!(n & 0x80)) { cyc++; goto L1156; }
+  /* 1154 adc $13,x */
+  cyc += 4; ea = (uint8_t)(0x13 + x); t = a + mem[ea] + c; c = t >> 8; a = t; NZ(a); v = c ^ (a >> 7); ins++;
+L1156:
+  /* 1156 sta $ff */
+  cyc += 3; mem[0xff] = a; DIRTY(0x00ff); ins++;
+  /* 1158 lda $46,x */
+  cyc += 4; ea = (uint8_t)(0x46 + x); a = mem[ea]; NZ(a); ins++;
+  /* 115a and #$70 */
+  cyc += 2; a &= 0x70; NZ(a); ins++;
+  /* 115c lsr a */
+  cyc += 2; b = a; c = b & 1; b >>= 1; a = b; NZ(b); ins++;
+  /* 115d lsr a */
+  cyc += 2; b = a; c = b & 1; b >>= 1; a = b; NZ(b); ins++;
+  /* 115e lsr a */
+  cyc += 2; b = a; c = b & 1; b >>= 1; a = b; NZ(b); ins++;
+  /* 115f lsr a */
+  cyc += 2; b = a; c = b & 1; b >>= 1; a = b; NZ(b); ins++;
+  /* 1160 tay */
+  cyc += 2; y = a; NZ(y); ins++;
+L1161:
+  /* 1161 lsr $ff */
+  cyc += 5; b = mem[0xff]; c = b & 1; b >>= 1; mem[0xff] = b; DIRTY(0x00ff); NZ(b); ins++;
+  /* 1163 ror $fe */
+  cyc += 5; b = mem[0xfe]; t = c; c = b & 1; b = b >> 1 | t << 7; mem[0xfe] = b; DIRTY(0x00fe); NZ(b); ins++;
+  /* 1165 dey */
+  cyc += 2; y--; NZ(y); ins++;
+  /* 1166 bpl $1161 */
+  cyc += 2; ins++; if (!(n & 0x80)) { cyc++; goto L1161; }
+  /* 1168 lda $78 */
+  cyc += 3; a = mem[0x78]; NZ(a); ins++;
+  /* 116a sec */
+  cyc += 2; c = 1; ins++;
+  /* 116b sbc $6a,x */
+  cyc += 4; ea = (uint8_t)(0x6a + x); t = a + (uint8_t)(mem[ea] ^ 0xff) + c; c = t >> 8; a = t; NZ(a); v = c ^ (a >> 7); ins++;
+  /* 116d bmi $1183 */
+  cyc += 2; ins++; if (n & 0x80) { cyc++; goto L1183; }
+  /* 116f tay */
+  cyc += 2; y = a; NZ(y); ins++;
+L1170:
+  /* 1170 dey */
+  cyc += 2; y--; NZ(y); ins++;
+  /* 1171 bmi $1199 */
+  cyc += 2; ins++; if (n & 0x80) { cyc++; goto L1199; }
+  /* 1173 lda $58,x */
+  cyc += 4; ea = (uint8_t)(0x58 + x); a = mem[ea]; NZ(a); ins++;
+  /* 1175 clc */
+  cyc += 2; c = 0; ins++;
+  /* 1176 adc $fe */
+  cyc += 3; t = a + mem[0xfe] + c; c = t >> 8; a = t; NZ(a); v = c ^ (a >> 7); ins++;
+  /* 1178 sta $58,x */
+  cyc += 4; ea = (uint8_t)(0x58 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 117a lda $5b,x */
+  cyc += 4; ea = (uint8_t)(0x5b + x); a = mem[ea]; NZ(a); ins++;
+  /* 117c adc $ff */
+  cyc += 3; t = a + mem[0xff] + c; c = t >> 8; a = t; NZ(a); v = c ^ (a >> 7); ins++;
+  /* 117e sta $5b,x */
+  cyc += 4; ea = (uint8_t)(0x5b + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 1180 jmp $1170 */
+  cyc += 3; ins++; goto L1170;
+L1183:
+  /* 1183 lda $6a,x */
+  cyc += 4; ea = (uint8_t)(0x6a + x); a = mem[ea]; NZ(a); ins++;
+  /* 1185 sec */
+  cyc += 2; c = 1; ins++;
+  /* 1186 sbc $78 */
+  cyc += 3; t = a + (uint8_t)(mem[0x78] ^ 0xff) + c; c = t >> 8; a = t; NZ(a); v = c ^ (a >> 7); ins++;
+  /* 1188 tay */
+  cyc += 2; y = a; NZ(y); ins++;
+L1189:
+  /* 1189 lda $58,x */
+  cyc += 4; ea = (uint8_t)(0x58 + x); a = mem[ea]; NZ(a); ins++;
+  /* 118b sec */
+  cyc += 2; c = 1; ins++;
+  /* 118c sbc $fe */
+  cyc += 3; t = a + (uint8_t)(mem[0xfe] ^ 0xff) + c; c = t >> 8; a = t; NZ(a); v = c ^ (a >> 7); ins++;
+  /* 118e sta $58,x */
+  cyc += 4; ea = (uint8_t)(0x58 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 1190 lda $5b,x */
+  cyc += 4; ea = (uint8_t)(0x5b + x); a = mem[ea]; NZ(a); ins++;
+  /* 1192 sbc $ff */
+  cyc += 3; t = a + (uint8_t)(mem[0xff] ^ 0xff) + c; c = t >> 8; a = t; NZ(a); v = c ^ (a >> 7); ins++;
+  /* 1194 sta $5b,x */
+  cyc += 4; ea = (uint8_t)(0x5b + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 1196 dey */
+  cyc += 2; y--; NZ(y); ins++;
+  /* 1197 bne $1189 */
+  cyc += 2; ins++; if (nz != 0) { cyc++; goto L1189; }
+L1199:
+  /* 1199 rts */
+  cyc += 6; b = POP(); pc = b; b = POP(); pc = (pc | b << 8) + 1; ins++; goto dispatch;
+L119a:
+  /* 119a dec $4f,x */
+  cyc += 6; ea = (uint8_t)(0x4f + x); b = mem[ea]; b--; mem[ea] = b; DIRTY(ea); NZ(b); ins++;
+  /* 119c bpl $11a3 */
+  cyc += 2; ins++; if (!(n & 0x80)) { cyc++; goto L11a3; }
+  /* 119e lda $1410,y */
+  cyc += 4; ea = (uint16_t)(0x1410 + y); a = mem[ea]; NZ(a); ins++;
+  /* 11a1 sta $4f,x */
+  cyc += 4; ea = (uint8_t)(0x4f + x); mem[ea] = a; DIRTY(ea); ins++;
+L11a3:
+  /* 11a3 lda $13fd,y */
+  cyc += 4; ea = (uint16_t)(0x13fd + y); a = mem[ea]; NZ(a); ins++;
+  /* 11a6 clc */
+  cyc += 2; c = 0; ins++;
+  /* 11a7 adc $4f,x */
+  cyc += 4; ea = (uint8_t)(0x4f + x); t = a + mem[ea] + c; c = t >> 8; a = t; NZ(a); v = c ^ (a >> 7); ins++;
+  /* 11a9 tay */
+  cyc += 2; y = a; NZ(y); ins++;
+  /* 11aa lda $1402,y */
+  cyc += 4; ea = (uint16_t)(0x1402 + y); a = mem[ea]; NZ(a); ins++;
+  /* 11ad sta $52,x */
+  cyc += 4; ea = (uint8_t)(0x52 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 11af rts */
+  cyc += 6; b = POP(); pc = b; b = POP(); pc = (pc | b << 8) + 1; ins++; goto dispatch;
+L11b0:
+  /* 11b0 lda $6d,x */
+  cyc += 4; ea = (uint8_t)(0x6d + x); a = mem[ea]; NZ(a); ins++;
+  /* 11b2 bne $11cb */
+  cyc += 2; ins++; if (nz != 0) { cyc++; goto L11cb; }
+  /* 11b4 lda $70,x */
+  cyc += 4; ea = (uint8_t)(0x70 + x); a = mem[ea]; NZ(a); ins++;
+  /* 11b6 clc */
+  cyc += 2; c = 0; ins++;
+  /* 11b7 adc $4c,x */
+  cyc += 4; ea = (uint8_t)(0x4c + x); t = a + mem[ea] + c; c = t >> 8; a = t; NZ(a); v = c ^ (a >> 7); ins++;
+  /* 11b9 tay */
+  cyc += 2; y = a; NZ(y); ins++;
+  /* 11ba lda $73,x */
+  cyc += 4; ea = (uint8_t)(0x73 + x); a = mem[ea]; NZ(a); ins++;
+  /* 11bc adc #$00 */
+  cyc += 2; t = a + 0x00 + c; c = t >> 8; a = t; NZ(a); v = c ^ (a >> 7); ins++;
+  /* 11be cmp #$10 */
+  cyc += 2; b = 0x10; NZ(a - b); c = a >= b; ins++;
+  /* 11c0 bne $11c5 */
+  cyc += 2; ins++; if (nz != 0) { cyc++; goto L11c5; }
+  /* 11c2 inc $6d,x */
+  cyc += 6; ea = (uint8_t)(0x6d + x); b = mem[ea]; b++; mem[ea] = b; DIRTY(ea); NZ(b); ins++;
+  /* 11c4 rts */
+  cyc += 6; b = POP(); pc = b; b = POP(); pc = (pc | b << 8) + 1; ins++; goto dispatch;
+L11c5:
+  /* 11c5 sta $73,x */
+  cyc += 4; ea = (uint8_t)(0x73 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 11c7 tya */
+  cyc += 2; a = y; NZ(a); ins++;
+  /* 11c8 sta $70,x */
+  cyc += 4; ea = (uint8_t)(0x70 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 11ca rts */
+  cyc += 6; b = POP(); pc = b; b = POP(); pc = (pc | b << 8) + 1; ins++; goto dispatch;
+L11cb:
+  /* 11cb lda $70,x */
+  cyc += 4; ea = (uint8_t)(0x70 + x); a = mem[ea]; NZ(a); ins++;
+  /* 11cd sec */
+  cyc += 2; c = 1; ins++;
+  /* 11ce sbc $4c,x */
+  cyc += 4; ea = (uint8_t)(0x4c + x); t = a + (uint8_t)(mem[ea] ^ 0xff) + c; c = t >> 8; a = t; NZ(a); v = c ^ (a >> 7); ins++;
+  /* 11d0 tay */
+  cyc += 2; y = a; NZ(y); ins++;
+  /* 11d1 lda $73,x */
+  cyc += 4; ea = (uint8_t)(0x73 + x); a = mem[ea]; NZ(a); ins++;
+  /* 11d3 sbc #$00 */
+  cyc += 2; t = a + (uint8_t)(0x00 ^ 0xff) + c; c = t >> 8; a = t; NZ(a); v = c ^ (a >> 7); ins++;
+  /* 11d5 bpl $11da */
+  cyc += 2; ins++; if (!(n & 0x80)) { cyc++; goto L11da; }
+  /* 11d7 dec $6d,x */
+  cyc += 6; ea = (uint8_t)(0x6d + x); b = mem[ea]; b--; mem[ea] = b; DIRTY(ea); NZ(b); ins++;
+  /* 11d9 rts */
+  cyc += 6; b = POP(); pc = b; b = POP(); pc = (pc | b << 8) + 1; ins++; goto dispatch;
+L11da:
+  /* 11da sta $73,x */
+  cyc += 4; ea = (uint8_t)(0x73 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 11dc tya */
+  cyc += 2; a = y; NZ(a); ins++;
+  /* 11dd sta $70,x */
+  cyc += 4; ea = (uint8_t)(0x70 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 11df rts */
+  cyc += 6; b = POP(); pc = b; b = POP(); pc = (pc | b << 8) + 1; ins++; goto dispatch;
+L11e0:
+  /* 11e0 and #$7f */
+  cyc += 2; a &= 0x7f; NZ(a); ins++;
+  /* 11e2 asl a */
+  cyc += 2; b = a; c = b >> 7; b <<= 1; a = b; NZ(b); ins++;
+  /* 11e3 ldy $5e,x */
+  cyc += 4; ea = (uint8_t)(0x5e + x); y = mem[ea]; NZ(y); ins++;
+  /* 11e5 bmi $11f3 */
+  cyc += 2; ins++; if (n & 0x80) { cyc++; goto L11f3; }
+  /* 11e7 clc */
+  cyc += 2; c = 0; ins++;
+  /* 11e8 adc $61,x */
+  cyc += 4; ea = (uint8_t)(0x61 + x); t = a + mem[ea] + c; c = t >> 8; a = t; NZ(a); v = c ^ (a >> 7); ins++;
+  /* 11ea sta $61,x */
+  cyc += 4; ea = (uint8_t)(0x61 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 11ec lda $64,x */
+  cyc += 4; ea = (uint8_t)(0x64 + x); a = mem[ea]; NZ(a); ins++;
+  /* 11ee adc #$00 */
+  cyc += 2; t = a + 0x00 + c; c = t >> 8; a = t; NZ(a); v = c ^ (a >> 7); ins++;
+  /* 11f0 sta $64,x */
+  cyc += 4; ea = (uint8_t)(0x64 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 11f2 rts */
+  cyc += 6; b = POP(); pc = b; b = POP(); pc = (pc | b << 8) + 1; ins++; goto dispatch;
+L11f3:
+  /* 11f3 sta $fe */
+  cyc += 3; mem[0xfe] = a; DIRTY(0x00fe); ins++;
+  /* 11f5 lda $61,x */
+  cyc += 4; ea = (uint8_t)(0x61 + x); a = mem[ea]; NZ(a); ins++;
+  /* 11f7 sec */
+  cyc += 2; c = 1; ins++;
+  /* 11f8 sbc $fe */
+  cyc += 3; t = a + (uint8_t)(mem[0xfe] ^ 0xff) + c; c = t >> 8; a = t; NZ(a); v = c ^ (a >> 7); ins++;
+  /* 11fa sta $61,x */
+  cyc += 4; ea = (uint8_t)(0x61 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 11fc lda $64,x */
+  cyc += 4; ea = (uint8_t)(0x64 + x); a = mem[ea]; NZ(a); ins++;
+  /* 11fe sbc #$00 */
+  cyc += 2; t = a + (uint8_t)(0x00 ^ 0xff) + c; c = t >> 8; a = t; NZ(a); v = c ^ (a >> 7); ins++;
+  /* 1200 sta $64,x */
+  cyc += 4; ea = (uint8_t)(0x64 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 1202 rts */
+  cyc += 6; b = POP(); pc = b; b = POP(); pc = (pc | b << 8) + 1; ins++; goto dispatch;
+L1203:
+  /* 1203 lda $77 */
+  cyc += 3; a = mem[0x77]; NZ(a); ins++;
+  /* 1205 beq $122b */
+  cyc += 2; ins++; if (nz == 0) { cyc++; goto L122b; }
+L1207:
+  /* 1207 ldy $28,x */
+  cyc += 4; ea = (uint8_t)(0x28 + x); y = mem[ea]; NZ(y); ins++;
+  /* 1209 lda $14e6,y */
+  cyc += 4; ea = (uint16_t)(0x14e6 + y); a = mem[ea]; NZ(a); ins++;
+  /* 120c sta $fe */
+  cyc += 3; mem[0xfe] = a; DIRTY(0x00fe); ins++;
+  /* 120e lda $1500,y */
+  cyc += 4; ea = (uint16_t)(0x1500 + y); a = mem[ea]; NZ(a); ins++;
+  /* 1211 sta $ff */
+  cyc += 3; mem[0xff] = a; DIRTY(0x00ff); ins++;
+L1213:
+  /* 1213 ldy $2b,x */
+  cyc += 4; ea = (uint8_t)(0x2b + x); y = mem[ea]; NZ(y); ins++;
+  /* 1215 lda ($fe),y */
+  cyc += 5; ea = (uint16_t)((mem[0xfe] | mem[0xff] << 8) + y); a = READ(ea); NZ(a); ins++;
+  /* 1217 cmp #$ff */
+  cyc += 2; b = 0xff; NZ(a - b); c = a >= b; ins++;
+  /* 1219 bne $1231 */
+  cyc += 2; ins++; if (nz != 0) { cyc++; goto L1231; }
+  /* 121b lda #$00 */
+  cyc += 2; a = 0x00; NZ(a); ins++;
+  /* 121d sta $55,x */
+  cyc += 4; ea = (uint8_t)(0x55 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 121f lda $37,x */
+  cyc += 4; ea = (uint8_t)(0x37 + x); a = mem[ea]; NZ(a); ins++;
+  /* 1221 beq $122b */
+  cyc += 2; ins++; if (nz == 0) { cyc++; goto L122b; }
+  /* 1223 dec $37,x */
+  cyc += 6; ea = (uint8_t)(0x37 + x); b = mem[ea]; b--; mem[ea] = b; DIRTY(ea); NZ(b); ins++;
+  /* 1225 lda #$00 */
+  cyc += 2; a = 0x00; NZ(a); ins++;
+  /* 1227 sta $2b,x */
+  cyc += 4; ea = (uint8_t)(0x2b + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 1229 beq $1213 */
+  cyc += 2; ins++; if (nz == 0) { cyc++; goto L1213; }
+L122b:
+  /* 122b jsr $12b8 */
+  cyc += 6; PUSH(0x12); PUSH(0x2d); ins++; goto L12b8;
+L122e:
+  /* 122e jmp $1207 */
+  cyc += 3; ins++; goto L1207;
+L1231:
+  /* 1231 lda #$00 */
+  cyc += 2; a = 0x00; NZ(a); ins++;
+  /* 1233 sta $78 */
+  cyc += 3; mem[0x78] = a; DIRTY(0x0078); ins++;
+  /* 1235 sta $13,x */
+  cyc += 4; ea = (uint8_t)(0x13 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 1237 sta $5e,x */
+  cyc += 4; ea = (uint8_t)(0x5e + x); mem[ea] = a; DIRTY(ea); ins++;
+L1239:
+  /* 1239 lda ($fe),y */
+  cyc += 5; ea = (uint16_t)((mem[0xfe] | mem[0xff] << 8) + y); a = READ(ea); NZ(a); ins++;
+  /* 123b bmi $1245 */
+  cyc += 2; ins++; if (n & 0x80) { cyc++; goto L1245; }
+  /* 123d sta $1f,x */
+  cyc += 4; ea = (uint8_t)(0x1f + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 123f iny */
+  cyc += 2; y++; NZ(y); ins++;
+  /* 1240 tya */
+  cyc += 2; a = y; NZ(a); ins++;
+  /* 1241 sta $2b,x */
+  cyc += 4; ea = (uint8_t)(0x2b + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 1243 bne $1271 */
+  cyc += 2; ins++; if (nz != 0) { cyc++; goto L1271; }
+L1245:
+  /* 1245 cmp #$c0 */
+  cyc += 2; b = 0xc0; NZ(a - b); c = a >= b; ins++;
+  /* 1247 bcc $1259 */
+  cyc += 2; ins++; if (!c) { cyc++; goto L1259; }
+  /* 1249 cmp #$e0 */
+  cyc += 2; b = 0xe0; NZ(a - b); c = a >= b; ins++;
+  /* 124b bcc $1263 */
+  cyc += 2; ins++; if (!c) { cyc++; goto L1263; }
+  /* 124d cmp #$f0 */
+  cyc += 2; b = 0xf0; NZ(a - b); c = a >= b; ins++;
+  /* 124f bcc $126a */
+  cyc += 2; ins++; if (!c) { cyc++; goto L126a; }
+  /* 1251 iny */
+  cyc += 2; y++; NZ(y); ins++;
+  /* 1252 lda ($fe),y */
+  cyc += 5; ea = (uint16_t)((mem[0xfe] | mem[0xff] << 8) + y); a = READ(ea); NZ(a); ins++;
+  /* 1254 sta $5e,x */
+  cyc += 4; ea = (uint8_t)(0x5e + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 1256 iny */
+  cyc += 2; y++; NZ(y); ins++;
+  /* 1257 bne $1239 */
+  cyc += 2; ins++; if (nz != 0) { cyc++; goto L1239; }
+L1259:
+  /* 1259 and #$3f */
+  cyc += 2; a &= 0x3f; NZ(a); ins++;
+  /* 125b clc */
+  cyc += 2; c = 0; ins++;
+  /* 125c adc $78 */
+  cyc += 3; t = a + mem[0x78] + c; c = t >> 8; a = t; NZ(a); v = c ^ (a >> 7); ins++;
+  /* 125e sta $78 */
+  cyc += 3; mem[0x78] = a; DIRTY(0x0078); ins++;
+  /* 1260 iny */
+  cyc += 2; y++; NZ(y); ins++;
+  /* 1261 bne $1239 */
+  cyc += 2; ins++; if (nz != 0) { cyc++; goto L1239; }
+L1263:
+  /* 1263 and #$1f */
+  cyc += 2; a &= 0x1f; NZ(a); ins++;
+  /* 1265 sta $19,x */
+  cyc += 4; ea = (uint8_t)(0x19 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 1267 iny */
+  cyc += 2; y++; NZ(y); ins++;
+  /* 1268 bne $1239 */
+  cyc += 2; ins++; if (nz != 0) { cyc++; goto L1239; }
+L126a:
+  /* 126a and #$0f */
+  cyc += 2; a &= 0x0f; NZ(a); ins++;
+  /* 126c sta $55,x */
+  cyc += 4; ea = (uint8_t)(0x55 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 126e iny */
+  cyc += 2; y++; NZ(y); ins++;
+  /* 126f bne $1239 */
+  cyc += 2; ins++; if (nz != 0) { cyc++; goto L1239; }
+L1271:
+  /* 1271 lda $78 */
+  cyc += 3; a = mem[0x78]; NZ(a); ins++;
+  /* 1273 beq $1277 */
+  cyc += 2; ins++; if (nz == 0) { cyc++; goto L1277; }
+  /* 1275 sta $10,x */
+  cyc += 4; ea = (uint8_t)(0x10 + x); mem[ea] = a; DIRTY(ea); ins++;
+L1277:
+  /* 1277 lda $10,x */
+  cyc += 4; ea = (uint8_t)(0x10 + x); a = mem[ea]; NZ(a); ins++;
+  /* 1279 sta $0b,x */
+  cyc += 4; ea = (uint8_t)(0x0b + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 127b lda $16,x */
+  cyc += 4; ea = (uint8_t)(0x16 + x); a = mem[ea]; NZ(a); ins++;
+  /* 127d bne $1281 */
+  cyc += 2; ins++; if (nz != 0) { cyc++; goto L1281; }
+  /* 127f lda $19,x */
+  cyc += 4; ea = (uint8_t)(0x19 + x); a = mem[ea]; NZ(a); ins++;
+L1281:
+  /* 1281 asl a */
+  cyc += 2; b = a; c = b >> 7; b <<= 1; a = b; NZ(b); ins++;
+  /* 1282 asl a */
+  cyc += 2; b = a; c = b >> 7; b <<= 1; a = b; NZ(b); ins++;
+  /* 1283 asl a */
+  cyc += 2; b = a; c = b >> 7; b <<= 1; a = b; NZ(b); ins++;
+  /* 1284 sta $1c,x */
+  cyc += 4; ea = (uint8_t)(0x1c + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 1286 tay */
+  cyc += 2; y = a; NZ(y); ins++;
+  /* 1287 lda $146a,y */
+  cyc += 4; ea = (uint16_t)(0x146a + y); a = mem[ea]; NZ(a); ins++;
+  /* 128a and #$f0 */
+  cyc += 2; a &= 0xf0; NZ(a); ins++;
+  /* 128c sta $4c,x */
+  cyc += 4; ea = (uint8_t)(0x4c + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 128e lda $146c,y */
+  cyc += 4; ea = (uint16_t)(0x146c + y); a = mem[ea]; NZ(a); ins++;
+  /* 1291 sta $46,x */
+  cyc += 4; ea = (uint8_t)(0x46 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 1293 lda $146d,y */
+  cyc += 4; ea = (uint16_t)(0x146d + y); a = mem[ea]; NZ(a); ins++;
+  /* 1296 sta $49,x */
+  cyc += 4; ea = (uint8_t)(0x49 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 1298 lda $146b,y */
+  cyc += 4; ea = (uint16_t)(0x146b + y); a = mem[ea]; NZ(a); ins++;
+  /* 129b sta $43,x */
+  cyc += 4; ea = (uint8_t)(0x43 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 129d bmi $12a0 */
+  cyc += 2; ins++; if (n & 0x80) { cyc++; goto L12a0; }
+  /* 129f rts */
+  cyc += 6; b = POP(); pc = b; b = POP(); pc = (pc | b << 8) + 1; ins++; goto dispatch;
+L12a0:
+  /* 12a0 ldy $46,x */
+  cyc += 4; ea = (uint8_t)(0x46 + x); y = mem[ea]; NZ(y); ins++;
+  /* 12a2 lda $142a,y */
+  cyc += 4; ea = (uint16_t)(0x142a + y); a = mem[ea]; NZ(a); ins++;
+  /* 12a5 sta $fe */
+  cyc += 3; mem[0xfe] = a; DIRTY(0x00fe); ins++;
+  /* 12a7 lda $142e,y */
+  cyc += 4; ea = (uint16_t)(0x142e + y); a = mem[ea]; NZ(a); ins++;
+  /* 12aa sta $ff */
+  cyc += 3; mem[0xff] = a; DIRTY(0x00ff); ins++;
+  /* 12ac ldy #$00 */
+  cyc += 2; y = 0x00; NZ(y); ins++;
+  /* 12ae lda ($fe),y */
+  cyc += 5; ea = (uint16_t)((mem[0xfe] | mem[0xff] << 8) + y); a = READ(ea); NZ(a); ins++;
+  /* 12b0 sta $3d,x */
+  cyc += 4; ea = (uint8_t)(0x3d + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 12b2 iny */
+  cyc += 2; y++; NZ(y); ins++;
+  /* 12b3 lda ($fe),y */
+  cyc += 5; ea = (uint16_t)((mem[0xfe] | mem[0xff] << 8) + y); a = READ(ea); NZ(a); ins++;
+  /* 12b5 sta $40,x */
+  cyc += 4; ea = (uint8_t)(0x40 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 12b7 rts */
+  cyc += 6; b = POP(); pc = b; b = POP(); pc = (pc | b << 8) + 1; ins++; goto dispatch;
+L12b8:
+  /* 12b8 lda #$00 */
+  cyc += 2; a = 0x00; NZ(a); ins++;
+  /* 12ba sta $2b,x */
+  cyc += 4; ea = (uint8_t)(0x2b + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 12bc sta $16,x */
+  cyc += 4; ea = (uint8_t)(0x16 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 12be ldy $2e,x */
+  cyc += 4; ea = (uint8_t)(0x2e + x); y = mem[ea]; NZ(y); ins++;
+  /* 12c0 lda $31,x */
+  cyc += 4; ea = (uint8_t)(0x31 + x); a = mem[ea]; NZ(a); ins++;
+  /* 12c2 sta $fe */
+  cyc += 3; mem[0xfe] = a; DIRTY(0x00fe); ins++;
+  /* 12c4 lda $34,x */
+  cyc += 4; ea = (uint8_t)(0x34 + x); a = mem[ea]; NZ(a); ins++;
+  /* 12c6 sta $ff */
+  cyc += 3; mem[0xff] = a; DIRTY(0x00ff); ins++;
+L12c8:
+  /* 12c8 lda ($fe),y */
+  cyc += 5; ea = (uint16_t)((mem[0xfe] | mem[0xff] << 8) + y); a = READ(ea); NZ(a); ins++;
+  /* 12ca cmp #$40 */
+  cyc += 2; b = 0x40; NZ(a - b); c = a >= b; ins++;
+  /* 12cc bcc $12f2 */
+  cyc += 2; ins++; if (!c) { cyc++; goto L12f2; }
+  /* 12ce cmp #$ff */
+  cyc += 2; b = 0xff; NZ(a - b); c = a >= b; ins++;
+  /* 12d0 beq $12ee */
+  cyc += 2; ins++; if (nz == 0) { cyc++; goto L12ee; }
+  /* 12d2 cmp #$80 */
+  cyc += 2; b = 0x80; NZ(a - b); c = a >= b; ins++;
+  /* 12d4 bcc $12e0 */
+  cyc += 2; ins++; if (!c) { cyc++; goto L12e0; }
+  /* 12d6 cmp #$c0 */
+  cyc += 2; b = 0xc0; NZ(a - b); c = a >= b; ins++;
+  /* 12d8 bcc $12e7 */
+  cyc += 2; ins++; if (!c) { cyc++; goto L12e7; }
+  /* 12da ldy #$00 */
+  cyc += 2; y = 0x00; NZ(y); ins++;
+  /* 12dc sty $76 */
+  cyc += 3; mem[0x76] = y; DIRTY(0x0076); ins++;
+  /* 12de beq $12c8 */
+  cyc += 2; ins++; if (nz == 0) { cyc++; goto L12c8; }
+L12e0:
+  /* 12e0 and #$3f */
+  cyc += 2; a &= 0x3f; NZ(a); ins++;
+  /* 12e2 sta $37,x */
+  cyc += 4; ea = (uint8_t)(0x37 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 12e4 iny */
+  cyc += 2; y++; NZ(y); ins++;
+  /* 12e5 bne $12c8 */
+  cyc += 2; ins++; if (nz != 0) { cyc++; goto L12c8; }
+L12e7:
+  /* 12e7 and #$3f */
+  cyc += 2; a &= 0x3f; NZ(a); ins++;
+  /* 12e9 sta $25,x */
+  cyc += 4; ea = (uint8_t)(0x25 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 12eb iny */
+  cyc += 2; y++; NZ(y); ins++;
+  /* 12ec bne $12c8 */
+  cyc += 2; ins++; if (nz != 0) { cyc++; goto L12c8; }
+L12ee:
+  /* 12ee ldy #$00 */
+  cyc += 2; y = 0x00; NZ(y); ins++;
+  /* 12f0 beq $12c8 */
+  cyc += 2; ins++; if (nz == 0) { cyc++; goto L12c8; }
+L12f2:
+  /* 12f2 sta $28,x */
+  cyc += 4; ea = (uint8_t)(0x28 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 12f4 iny */
+  cyc += 2; y++; NZ(y); ins++;
+  /* 12f5 tya */
+  cyc += 2; a = y; NZ(a); ins++;
+  /* 12f6 sta $2e,x */
+  cyc += 4; ea = (uint8_t)(0x2e + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 12f8 rts */
+  cyc += 6; b = POP(); pc = b; b = POP(); pc = (pc | b << 8) + 1; ins++; goto dispatch;
+L12f9:
+  /* 12f9 lda #$00 */
+  cyc += 2; a = 0x00; NZ(a); ins++;
+  /* 12fb ldx #$17 */
+  cyc += 2; x = 0x17; NZ(x); ins++;
+L12fd:
+  /* 12fd sta $d400,x */
+  cyc += 5; ea = (uint16_t)(0xd400 + x); WRITE(ea, a); ins++;
+  /* 1300 dex a */
+  cyc += 2; x--; NZ(x); ins++;
+  /* 1301 bpl $12fd */
+  cyc += 2; ins++; if (!(n & 0x80)) { cyc++; goto L12fd; }
+  /* 1303 stx $76 */
+  cyc += 3; mem[0x76] = x; DIRTY(0x0076); ins++;
+  /* 1305 sta $0e */
+  cyc += 3; mem[0x0e] = a; DIRTY(0x000e); ins++;
+  /* 1307 sta $77 */
+  cyc += 3; mem[0x77] = a; DIRTY(0x0077); ins++;
+  /* 1309 lda #$0f */
+  cyc += 2; a = 0x0f; NZ(a); ins++;
+  /* 130b sta $d418 */
+  cyc += 4; SYNC(); sid_poke(0x18, a); ins++;
+  /* 130e dey */
+  cyc += 2; y--; NZ(y); ins++;
+  /* 130f lda $1415,y */
+  cyc += 4; ea = (uint16_t)(0x1415 + y); a = mem[ea]; NZ(a); ins++;
+  /* 1312 sta $0f */
+  cyc += 3; mem[0x0f] = a; DIRTY(0x000f); ins++;
+  /* 1314 tya */
+  cyc += 2; a = y; NZ(a); ins++;
+  /* 1315 asl a */
+  cyc += 2; b = a; c = b >> 7; b <<= 1; a = b; NZ(b); ins++;
+  /* 1316 sta $fe */
+  cyc += 3; mem[0xfe] = a; DIRTY(0x00fe); ins++;
+  /* 1318 asl a */
+  cyc += 2; b = a; c = b >> 7; b <<= 1; a = b; NZ(b); ins++;
+  /* 1319 clc */
+  cyc += 2; c = 0; ins++;
+  /* 131a adc $fe */
+  cyc += 3; t = a + mem[0xfe] + c; c = t >> 8; a = t; NZ(a); v = c ^ (a >> 7); ins++;
+  /* 131c tay */
+  cyc += 2; y = a; NZ(y); ins++;
+  /* 131d ldx #$00 */
+  cyc += 2; x = 0x00; NZ(x); ins++;
+L131f:
+  /* 131f lda $1418,y */
+  cyc += 4; ea = (uint16_t)(0x1418 + y); a = mem[ea]; NZ(a); ins++;
+  /* 1322 sta $31,x */
+  cyc += 4; ea = (uint8_t)(0x31 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 1324 iny */
+  cyc += 2; y++; NZ(y); ins++;
+  /* 1325 lda $1418,y */
+  cyc += 4; ea = (uint16_t)(0x1418 + y); a = mem[ea]; NZ(a); ins++;
+  /* 1328 sta $34,x */
+  cyc += 4; ea = (uint8_t)(0x34 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 132a lda #$01 */
+  cyc += 2; a = 0x01; NZ(a); ins++;
+  /* 132c sta $0b,x */
+  cyc += 4; ea = (uint8_t)(0x0b + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 132e lda #$00 */
+  cyc += 2; a = 0x00; NZ(a); ins++;
+  /* 1330 sta $2e,x */
+  cyc += 4; ea = (uint8_t)(0x2e + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 1332 sta $37,x */
+  cyc += 4; ea = (uint8_t)(0x37 + x); mem[ea] = a; DIRTY(ea); ins++;
+  /* 1334 iny */
+  cyc += 2; y++; NZ(y); ins++;
+  /* 1335 inx */
+  cyc += 2; x++; NZ(x); ins++;
+  /* 1336 cpx #$03 */
+  cyc += 2; b = 0x03; NZ(x - b); c = x >= b; ins++;
+  /* 1338 bne $131f */
+  cyc += 2; ins++; if (nz != 0) { cyc++; goto L131f; }
+  /* 133a rts */
+  cyc += 6; b = POP(); pc = b; b = POP(); pc = (pc | b << 8) + 1; ins++; goto dispatch;
+
+leave:
+  SYNC();
+  m->cpu.a = a;
+  m->cpu.x = x;
+  m->cpu.y = y;
+  m->cpu.s = s;
+  m->cpu.p = GET_P();
+  m->cpu.pc = pc;
+
+  return ok;
+}
+
+static const struct c64_aot_routine routines[] = {
+  { 0x0800, 1, init_0800_0_ranges, init_0800_0 },
+  { 0x0825, 1, play_0825_1_ranges, play_0825_1 },
+  { 0x0c00, 2, init_0c00_2_ranges, init_0c00_2 },
+  { 0x19ae, 1, init_19ae_4_ranges, init_19ae_4 },
+  { 0x1000, 1, play_1000_5_ranges, play_1000_5 },
+};
+
+const struct c64_aot_routine* const sid_aot_routines = routines;
+const uint8_t sid_aot_n_routines = 5;
@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Clock conversion, see sid_clock.h. A frequency F plays at F * clock / 2^24
+ * Hz, so the chip needs F * tune clock / chip clock for the same pitch.
+ */
+
+#include "sid_clock.h"
+
+struct clock_params
+{
+  uint32_t hz;
+  uint32_t frame_cycles;
+  const char* name;
+};
+
+static const struct clock_params params[SID_CLOCK_NUM] = {
+  [SID_CLOCK_PAL] = { SID_CLOCK_PAL_HZ, SID_CLOCK_PAL_FRAME_CYCLES, "PAL" },
+  [SID_CLOCK_NTSC] = { SID_CLOCK_NTSC_HZ, SID_CLOCK_NTSC_FRAME_CYCLES, "NTSC" },
+};
+
+static enum sid_clock tune_clock = SID_CLOCK_CHIP;
+
+/* Tune clock over chip clock, Q16 */
+static uint32_t ratio = 1U << 16;
+
+static uint32_t scale(uint32_t value, uint32_t max)
+{
+  value = ((uint64_t)value * ratio + 0x8000) >> 16;
+
+  return value > max ? max : value;
+}
+
+void sid_clock_set(enum sid_clock clock)
+{
+  if (clock >= SID_CLOCK_NUM) {
+    clock = SID_CLOCK_CHIP;
+  }
+
+  tune_clock = clock;
+  ratio = (uint32_t)((((uint64_t)params[clock].hz << 16) + params[SID_CLOCK_CHIP].hz / 2) /
+                     params[SID_CLOCK_CHIP].hz);
+}
+
+enum sid_clock sid_clock_get(void)
+{
+  return tune_clock;
+}
+
+bool sid_clock_converts(void)
+{
+  return tune_clock != SID_CLOCK_CHIP;
+}
+
+uint32_t sid_clock_convert(const uint8_t* in, uint8_t* out, uint32_t mask)
+{
+  uint32_t changed = 0;
+  uint32_t value;
+  uint8_t lo;
+  uint8_t hi;
+
+  for (uint8_t reg = 0x00; reg <= 0x0e; reg += 7) {
+    if (!(mask & (3U << reg)))
+      continue;
+
+    value = scale(in[reg] | (in[reg + 1] << 8), 0xffff);
+    lo = value;
+    hi = value >> 8;
+
+    changed |= (out[reg] != lo ? 1U << reg : 0) | (out[reg + 1] != hi ? 2U << reg : 0);
+    out[reg] = lo;
+    out[reg + 1] = hi;
+  }
+
+  for (uint32_t m = mask & ~SID_CLOCK_REGS, reg = 0; m; reg++, m >>= 1) {
+    if (m & 1) {
+      out[reg] = in[reg];
+    }
+  }
+
+  return mask | changed;
+}
+
+uint32_t sid_clock_hz(enum sid_clock clock)
+{
+  return params[clock].hz;
+}
+
+uint32_t sid_clock_frame_cycles(enum sid_clock clock)
+{
+  return params[clock].frame_cycles;
+}
+
+uint32_t sid_clock_frame_us(enum sid_clock clock)
+{
+  return (uint32_t)((uint64_t)params[clock].frame_cycles * 1000000 / params[clock].hz);
+}
+
+uint32_t sid_clock_frames_per_second(enum sid_clock clock)
+{
+  return (params[clock].hz + params[clock].frame_cycles / 2) / params[clock].frame_cycles;
+}
+
+const char* sid_clock_name(enum sid_clock clock)
+{
+  return clock < SID_CLOCK_NUM ? params[clock].name : "?";
+}
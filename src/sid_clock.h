@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef SID_CLOCK_H
+#define SID_CLOCK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * The SID on the bridge always runs at the PAL clock. An NTSC tune computes
+ * its frequencies for a 1.023 MHz clock and plays 60 frames a second, so the
+ * player runs its frames at the NTSC rate and the writes to the voice
+ * frequencies are scaled by the clock ratio on their way to the chip. The
+ * filter is analog, its cutoff does not depend on the clock and goes out as
+ * written. The shadow registers keep the values the tune wrote, the
+ * seek snapshots and sid_get_regs() stay in the tune's own clock.
+ *
+ * The ratio is a Q16 factor worked out once per tune. A flush converts only
+ * the register pairs it sends, a pair costs one multiply, and a PAL tune
+ * skips the conversion altogether.
+ */
+enum sid_clock
+{
+    SID_CLOCK_PAL,
+    SID_CLOCK_NTSC,
+    SID_CLOCK_NUM,
+};
+
+#define SID_CLOCK_PAL_HZ            985248
+#define SID_CLOCK_NTSC_HZ           1022727
+
+/* Cycles between two vertical blanks, 312 lines of 63 and 263 of 65 */
+#define SID_CLOCK_PAL_FRAME_CYCLES  19656
+#define SID_CLOCK_NTSC_FRAME_CYCLES 17095
+
+/* The clock of the SID on the bridge */
+#define SID_CLOCK_CHIP              SID_CLOCK_PAL
+
+/* Voice frequencies */
+#define SID_CLOCK_REGS              ((3U << 0x00) | (3U << 0x07) | (3U << 0x0e))
+
+void sid_clock_set(enum sid_clock clock);
+enum sid_clock sid_clock_get(void);
+
+/* True while the tune's clock is not the chip's */
+bool sid_clock_converts(void);
+
+/*
+ * Updates out from in for the registers in mask, scaling the clock
+ * registers. Returns mask plus the other halves of the converted pairs whose
+ * value in out changed.
+ */
+uint32_t sid_clock_convert(const uint8_t* in, uint8_t* out, uint32_t mask);
+
+uint32_t sid_clock_hz(enum sid_clock clock);
+uint32_t sid_clock_frame_cycles(enum sid_clock clock);
+uint32_t sid_clock_frame_us(enum sid_clock clock);
+
+/* Rounded, for times shown in seconds */
+uint32_t sid_clock_frames_per_second(enum sid_clock clock);
+
+const char* sid_clock_name(enum sid_clock clock);
+
+#endif /* SID_CLOCK_H */
@@ -0,0 +1,222 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Digi channel, see sid_digi.h.
+ *
+ * The emulator runs a whole play call at once, long before the writes would
+ * happen on a real C64. Every queued write gets the time it is due at: the
+ * start of its frame plus SID_DIGI_DELAY_US plus its cycle offset into the
+ * play call. The timer hooks do the waiting, on the board a compare
+ * interrupt wakes the sender thread just before the write is due.
+ *
+ * The queue has one producer, the player, and one consumer, the sender.
+ * The player only moves head and the sender only moves tail, except for a
+ * reset which drops the queue under the lock.
+ */
+
+#include "sid_digi.h"
+#include "sid_proto.h"
+#include "c64.h"
+
+#include <string.h>
+
+/* Microseconds per cycle as Q16 */
+#define US_PER_CYCLE_Q16(hz)  ((uint32_t)((1000000ULL << 16) / (hz)))
+
+#define QUEUE_MASK        (SID_DIGI_QUEUE - 1)
+
+struct digi_write
+{
+  uint32_t due;
+  uint8_t reg;
+  uint8_t val;
+};
+
+static struct digi_write queue[SID_DIGI_QUEUE];
+static uint16_t head;
+static uint16_t tail;
+
+static uint32_t active;
+static uint8_t count[32];
+static uint8_t quiet[32];
+
+static uint32_t base_cycle;
+static uint32_t base_us;
+static uint32_t us_per_cycle = US_PER_CYCLE_Q16(SID_DIGI_CLOCK_HZ);
+
+static struct sid_digi_stats stats;
+
+void sid_digi_reset(void)
+{
+  sid_digi_lock();
+  tail = head;
+  sid_digi_unlock();
+
+  active = 0;
+  memset(count, 0, sizeof(count));
+  memset(quiet, 0, sizeof(quiet));
+  base_cycle = c64_cpu_cycles();
+}
+
+void sid_digi_set_clock(uint32_t hz)
+{
+  us_per_cycle = US_PER_CYCLE_Q16(hz);
+}
+
+void sid_digi_frame(void)
+{
+  base_cycle = c64_cpu_cycles();
+  base_us = sid_digi_timer_now() + SID_DIGI_DELAY_US;
+}
+
+void sid_digi_end_frame(void)
+{
+  for (uint8_t reg = 0; reg < 32; reg++) {
+    if (!(active & (1U << reg)))
+      continue;
+
+    if (count[reg] >= SID_DIGI_MIN_WRITES) {
+      quiet[reg] = 0;
+    } else if (++quiet[reg] >= SID_DIGI_HOLD_FRAMES) {
+      active &= ~(1U << reg);
+    }
+  }
+
+  memset(count, 0, sizeof(count));
+  base_cycle = c64_cpu_cycles();
+}
+
+bool sid_digi_capture(uint8_t reg, uint8_t val)
+{
+  uint32_t bit = 1U << reg;
+  struct digi_write* w;
+  uint16_t queued;
+
+  if (!(SID_DIGI_REGS & bit))
+    return false;
+
+  if (count[reg] < 0xff) {
+    count[reg]++;
+  }
+
+  if (!(active & bit)) {
+    if (count[reg] < SID_DIGI_MIN_WRITES)
+      return false;
+
+    active |= bit;
+    quiet[reg] = 0;
+  }
+
+  stats.writes++;
+
+  queued = head - __atomic_load_n(&tail, __ATOMIC_ACQUIRE);
+  if (queued == SID_DIGI_QUEUE) {
+    stats.dropped++;
+    return true;
+  }
+
+  w = &queue[head & QUEUE_MASK];
+  w->due = base_us + (uint32_t)(((uint64_t)(c64_cpu_cycles() - base_cycle) *
+                                 us_per_cycle) >> 16);
+  w->reg = reg;
+  w->val = val;
+  __atomic_store_n(&head, head + 1, __ATOMIC_RELEASE);
+
+  if (!queued) {
+    sid_digi_timer_wake();
+  }
+
+  return true;
+}
+
+uint32_t sid_digi_regs(void)
+{
+  return active;
+}
+
+static void account(uint32_t late)
+{
+  uint8_t bucket = 0;
+
+  stats.sent++;
+  stats.sum_us += late;
+
+  if (late > stats.max_us) {
+    stats.max_us = late;
+  }
+
+  if (late > SID_DIGI_LATE_US) {
+    stats.late++;
+  }
+
+  while (late && bucket < SID_DIGI_HIST_BUCKETS - 1) {
+    late >>= 1;
+    bucket++;
+  }
+  stats.hist[bucket]++;
+}
+
+uint32_t sid_digi_send(uint32_t until)
+{
+  uint32_t sent = 0;
+
+  while (1) {
+    uint16_t t = tail;
+    struct digi_write w;
+    int32_t late;
+
+    if (t == __atomic_load_n(&head, __ATOMIC_ACQUIRE))
+      break;
+
+    w = queue[t & QUEUE_MASK];
+    if ((int32_t)(w.due - until) >= 0)
+      break;
+
+    sid_digi_timer_wait(w.due);
+    sid_digi_lock();
+
+    /* Dropped by a reset while waiting */
+    if (tail != t) {
+      sid_digi_unlock();
+      continue;
+    }
+
+    late = sid_digi_timer_now() - w.due;
+
+    sid_proto_write(w.reg, w.val);
+    sid_proto_flush();
+
+    __atomic_store_n(&tail, t + 1, __ATOMIC_RELEASE);
+    sid_digi_unlock();
+
+    account(late > 0 ? late : 0);
+    sent++;
+  }
+
+  return sent;
+}
+
+bool sid_digi_next_due(uint32_t* due)
+{
+  uint16_t t = tail;
+
+  if (t == __atomic_load_n(&head, __ATOMIC_ACQUIRE))
+    return false;
+
+  *due = queue[t & QUEUE_MASK].due;
+
+  return true;
+}
+
+void sid_digi_get_stats(struct sid_digi_stats* s)
+{
+  *s = stats;
+  s->regs = active;
+}
+
+void sid_digi_reset_stats(void)
+{
+  memset(&stats, 0, sizeof(stats));
+}
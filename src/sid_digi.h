@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef SID_DIGI_H
+#define SID_DIGI_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Sample playback writes the volume register, or a pulse width, thousands of
+ * times per second. Sending those with the frame batch would play a whole
+ * frame of samples at once. A register that gets SID_DIGI_MIN_WRITES writes
+ * in one frame moves to the digi channel instead: its writes are stamped with
+ * the emulated cycle they happened at and queued, sid_digi_send() plays them
+ * against a hardware timer SID_DIGI_DELAY_US after the start of their frame.
+ * On the board a thread above the player does the sending, so writes keep
+ * going out while the next play call runs.
+ */
+#define SID_DIGI_CLOCK_HZ       985248  /* PAL 6510 clock, until sid_digi_set_clock() */
+#define SID_DIGI_MIN_WRITES     4
+#define SID_DIGI_HOLD_FRAMES    50      /* quiet frames before a register goes back */
+
+/* Volume and the three pulse widths */
+#define SID_DIGI_REGS           ((1U << 0x18) | (3U << 0x02) | (3U << 0x09) | (3U << 0x10))
+
+/* Time the play routine gets before its first write is due */
+#define SID_DIGI_DELAY_US       2000
+
+#define SID_DIGI_QUEUE          512     /* power of two */
+#define SID_DIGI_LATE_US        8
+#define SID_DIGI_HIST_BUCKETS   8
+
+struct sid_digi_stats
+{
+    uint32_t regs;          /* registers on the digi channel */
+    uint32_t writes;        /* writes queued */
+    uint32_t sent;
+    uint32_t dropped;       /* queue full */
+    uint32_t late;          /* sent more than SID_DIGI_LATE_US after their time */
+    uint32_t max_us;        /* worst lateness */
+    uint32_t sum_us;
+    uint32_t hist[SID_DIGI_HIST_BUCKETS];   /* lateness 0, 1, 2-3, 4-7, ... us */
+};
+
+/*
+ * Microsecond timer, free running and wrapping at 32 bits. The lock keeps
+ * the sender and the player from using the bridge at the same time. Wake is
+ * called when a write goes into an empty queue, the sender sleeps until
+ * then instead of polling.
+ */
+int sid_digi_timer_init(void);
+uint32_t sid_digi_timer_now(void);
+void sid_digi_timer_wait(uint32_t until);
+void sid_digi_timer_wake(void);
+void sid_digi_lock(void);
+void sid_digi_unlock(void);
+
+void sid_digi_reset(void);
+
+/* The 6510 clock of the tune, the cycle stamps are in its time */
+void sid_digi_set_clock(uint32_t hz);
+
+/* Called at the start of every frame, before the play routine runs */
+void sid_digi_frame(void);
+void sid_digi_end_frame(void);
+
+/* Returns true when the write was queued and must not go in the batch */
+bool sid_digi_capture(uint8_t reg, uint8_t val);
+uint32_t sid_digi_regs(void);
+
+/* Sends the writes due before until, returns how many were sent */
+uint32_t sid_digi_send(uint32_t until);
+
+/* Time the oldest queued write is due, false when the queue is empty */
+bool sid_digi_next_due(uint32_t* due);
+
+void sid_digi_get_stats(struct sid_digi_stats* stats);
+void sid_digi_reset_stats(void);
+
+#endif /* SID_DIGI_H */
@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Digi timer hooks on TIM2, a 32 bit timer counting microseconds. A wait
+ * sleeps until the channel 1 compare interrupt fires SPIN_US before the
+ * deadline and spins on the counter for the rest, which keeps the wake up
+ * latency of the thread out of the write timing.
+ *
+ * The sender is a cooperative thread, it preempts the player as soon as a
+ * write is due and only waits for a bridge transfer that is in progress.
+ * With nothing queued it blocks until the player queues a write, so a tune
+ * without digis leaves the idle time between frames in one piece.
+ */
+
+#include "sid_digi.h"
+
+#include <zephyr.h>
+#include <soc.h>
+#include <stm32g4xx_ll_bus.h>
+#include <stm32g4xx_ll_rcc.h>
+#include <stm32g4xx_ll_tim.h>
+
+#define SPIN_US         20
+
+#define STACK_SIZE      1024
+#define PRIORITY        K_PRIO_COOP(2)
+
+K_SEM_DEFINE(digi_wake, 0, 1);
+K_SEM_DEFINE(digi_queued, 0, 1);
+K_MUTEX_DEFINE(digi_mutex);
+
+K_THREAD_STACK_DEFINE(digi_stack, STACK_SIZE);
+static struct k_thread digi_thread;
+
+static void digi_timer_isr(const void* arg)
+{
+  LL_TIM_ClearFlag_CC1(TIM2);
+  LL_TIM_DisableIT_CC1(TIM2);
+
+  k_sem_give(&digi_wake);
+}
+
+/* Until the oldest write comes within a frame, or forever when there is none */
+static k_timeout_t idle_timeout(void)
+{
+  uint32_t due;
+  int32_t us;
+
+  if (!sid_digi_next_due(&due))
+    return K_FOREVER;
+
+  us = (int32_t)(due - SID_DIGI_FRAME_US - sid_digi_timer_now());
+
+  return us > 0 ? K_USEC(us) : K_NO_WAIT;
+}
+
+static void digi_send_loop(void* p1, void* p2, void* p3)
+{
+  while (1) {
+    if (!sid_digi_send(sid_digi_timer_now() + SID_DIGI_FRAME_US)) {
+      k_sem_take(&digi_queued, idle_timeout());
+    }
+  }
+}
+
+int sid_digi_timer_init(void)
+{
+  LL_RCC_ClocksTypeDef clocks;
+  uint32_t hz;
+
+  /* Timers run at twice PCLK1 when APB1 is divided */
+  LL_RCC_GetSystemClocksFreq(&clocks);
+  hz = clocks.PCLK1_Frequency;
+  if (LL_RCC_GetAPB1Prescaler() != LL_RCC_APB1_DIV_1) {
+    hz *= 2;
+  }
+
+  LL_APB1_GRP1_EnableClock(LL_APB1_GRP1_PERIPH_TIM2);
+
+  LL_TIM_SetPrescaler(TIM2, hz / 1000000 - 1);
+  LL_TIM_SetAutoReload(TIM2, 0xffffffff);
+  LL_TIM_GenerateEvent_UPDATE(TIM2);
+  LL_TIM_ClearFlag_UPDATE(TIM2);
+  LL_TIM_EnableCounter(TIM2);
+
+  IRQ_CONNECT(TIM2_IRQn, 0, digi_timer_isr, NULL, 0);
+  irq_enable(TIM2_IRQn);
+
+  k_thread_create(&digi_thread, digi_stack, K_THREAD_STACK_SIZEOF(digi_stack),
+                  digi_send_loop, NULL, NULL, NULL, PRIORITY, 0, K_NO_WAIT);
+
+  return 0;
+}
+
+uint32_t sid_digi_timer_now(void)
+{
+  return LL_TIM_GetCounter(TIM2);
+}
+
+void sid_digi_timer_wait(uint32_t until)
+{
+  uint32_t wake = until - SPIN_US;
+
+  if ((int32_t)(wake - sid_digi_timer_now()) > 0) {
+    k_sem_reset(&digi_wake);
+
+    LL_TIM_OC_SetCompareCH1(TIM2, wake);
+    LL_TIM_ClearFlag_CC1(TIM2);
+    LL_TIM_EnableIT_CC1(TIM2);
+
+    /* A compare that passed before the interrupt was enabled never fires */
+    if ((int32_t)(wake - sid_digi_timer_now()) > 0) {
+      k_sem_take(&digi_wake, K_FOREVER);
+    }
+
+    LL_TIM_DisableIT_CC1(TIM2);
+  }
+
+  while ((int32_t)(until - sid_digi_timer_now()) > 0) {
+  }
+}
+
+void sid_digi_timer_wake(void)
+{
+  k_sem_give(&digi_queued);
+}
+
+void sid_digi_lock(void)
+{
+  k_mutex_lock(&digi_mutex, K_FOREVER);
+}
+
+void sid_digi_unlock(void)
+{
+  k_mutex_unlock(&digi_mutex);
+}
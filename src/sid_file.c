@@ -6,9 +6,34 @@
 
 #include "sid_file.h"
 
+#include <stddef.h>
+
 const uint8_t sid_file_data[] = {
-#include "big_fun_tune_5.hex"
+#include "big_fun_tune_5_packed.hex"
+};
+
+static const uint8_t cantina_band[] = {
+#include "cantina_band.hex"
+};
+
+static const uint8_t nexion[] = {
+#include "nexion.hex"
 };
 
 const uint8_t* sid_file = sid_file_data;
-const uint16_t sid_file_size = sizeof(sid_file_data);
+const uint32_t sid_file_size = sizeof(sid_file_data);
+
+const struct sid_file_entry sid_files[] = {
+  { sid_file_data, sizeof(sid_file_data) },
+  { cantina_band, sizeof(cantina_band) },
+  { nexion, sizeof(nexion) },
+};
+
+const uint8_t sid_num_files = sizeof(sid_files) / sizeof(sid_files[0]);
+
+/*
+ * Tunes written by tools/sidchunk.c share one store, include its
+ * sid_chunks.hex here when the list has any.
+ */
+const uint8_t* const sid_chunks = NULL;
+const uint32_t sid_chunks_size = 0;
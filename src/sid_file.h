@@ -10,6 +10,20 @@
 #include <stdint.h>
 
 extern const uint8_t* sid_file;
-extern const uint16_t sid_file_size;
+extern const uint32_t sid_file_size;
+
+/* Every tune in flash, the first one is sid_file */
+struct sid_file_entry
+{
+    const uint8_t* data;
+    uint32_t size;
+};
+
+extern const struct sid_file_entry sid_files[];
+extern const uint8_t sid_num_files;
+
+/* The store of the chunked tunes, NULL when there are none */
+extern const uint8_t* const sid_chunks;
+extern const uint32_t sid_chunks_size;
 
 #endif /* SID_FILE_H */
@@ -0,0 +1,290 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Jitter buffered register frames from the host, see sid_live.h.
+ *
+ * Frame n waits in slot n % SID_LIVE_FRAMES, so a frame is found without a
+ * search and frames may come out of order. Frames are taken in the player
+ * thread between two ticks, the same thread that plays them.
+ */
+
+#include "sid_live.h"
+#include "sid.h"
+#include "sid_clock.h"
+
+#include <string.h>
+
+struct slot
+{
+  uint32_t frame;
+  bool used;
+  uint8_t n_writes;
+  uint8_t writes[SID_LIVE_MAX_WRITES][2];
+};
+
+static enum sid_live_state state;
+
+static struct sid_packet_rx rx = { .sync = SID_LIVE_SYNC };
+
+static uint8_t next_seq;
+static uint8_t report_seq;
+
+static struct slot slots[SID_LIVE_FRAMES];
+static uint32_t next;
+static bool have_next;          /* false until the first frame played */
+static bool stopping;
+static uint8_t clock;
+static uint32_t ticks;
+static uint32_t quiet_ticks;
+
+static struct sid_live_stats stats;
+
+static uint32_t get_le32(const uint8_t* p)
+{
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void put_le32(uint8_t* p, uint32_t val)
+{
+  for (int i = 0; i < 4; i++) {
+    p[i] = val >> (i * 8);
+  }
+}
+
+void sid_live_reset(void)
+{
+  state = SID_LIVE_IDLE;
+  sid_packet_rx_init(&rx, SID_LIVE_SYNC);
+}
+
+static bool start(void)
+{
+  if (rx.len != 2 || rx.data[0] >= SID_CLOCK_NUM || rx.data[1] >= SID_LIVE_FRAMES)
+    return false;
+
+  memset(slots, 0, sizeof(slots));
+  memset(&stats, 0, sizeof(stats));
+
+  clock = rx.data[0];
+  stats.target = rx.data[1] ? rx.data[1] : SID_LIVE_DEFAULT_TARGET;
+  stats.fill_min = 0xff;
+
+  have_next = false;
+  stopping = false;
+  ticks = 0;
+  state = SID_LIVE_BUFFERING;
+
+  return true;
+}
+
+static void poke_writes(const uint8_t (*writes)[2], uint8_t n)
+{
+  for (uint8_t i = 0; i < n; i++) {
+    sid_poke(writes[i][0], writes[i][1]);
+  }
+}
+
+static bool frame(void)
+{
+  uint32_t number = get_le32(rx.data);
+  uint8_t n = (rx.len - 4) / 2;
+  struct slot* s;
+
+  if (state == SID_LIVE_IDLE || rx.len < 4 || (rx.len & 1) || n > SID_LIVE_MAX_WRITES)
+    return false;
+
+  stats.frames++;
+
+  if (have_next && (int32_t)(number - next) < 0) {
+    poke_writes((const uint8_t (*)[2])&rx.data[4], n);
+    stats.late++;
+    return true;
+  }
+
+  s = &slots[number % SID_LIVE_FRAMES];
+
+  if ((have_next && number - next >= SID_LIVE_FRAMES) || (s->used && s->frame != number)) {
+    stats.overflows++;
+    return true;
+  }
+
+  /* A frame sent again is taken once */
+  if (s->used)
+    return true;
+
+  s->frame = number;
+  s->used = true;
+  s->n_writes = n;
+  memcpy(s->writes, &rx.data[4], n * 2);
+
+  stats.fill++;
+  if (stats.fill > stats.fill_max) {
+    stats.fill_max = stats.fill;
+  }
+
+  return true;
+}
+
+static void packet(void)
+{
+  bool ok;
+
+  if (rx.type == SID_LIVE_START) {
+    ok = start();
+  } else {
+    if (state != SID_LIVE_IDLE && rx.seq != next_seq) {
+      stats.lost += (uint8_t)(rx.seq - next_seq);
+    }
+
+    if (rx.type == SID_LIVE_FRAME) {
+      ok = frame();
+    } else if (rx.type == SID_LIVE_STOP) {
+      stopping = true;
+      ok = state != SID_LIVE_IDLE;
+    } else {
+      ok = false;
+    }
+  }
+
+  if (ok) {
+    next_seq = rx.seq + 1;
+    quiet_ticks = 0;
+  }
+}
+
+enum sid_live_state sid_live_feed(const uint8_t* data, size_t len)
+{
+  stats.bytes += len;
+
+  while (len--) {
+    switch (sid_packet_rx_byte(&rx, *data++)) {
+      case SID_PACKET_OK:
+        packet();
+        break;
+      case SID_PACKET_CRC_ERROR:
+        stats.crc_errors++;
+        break;
+      case SID_PACKET_NONE:
+        break;
+    }
+  }
+
+  return state;
+}
+
+enum sid_live_state sid_live_get_state(void)
+{
+  return state;
+}
+
+uint8_t sid_live_clock(void)
+{
+  return clock;
+}
+
+/* Playback goes on from the oldest frame, frames before it never came */
+static void start_playing(void)
+{
+  bool found = false;
+
+  for (uint8_t i = 0; i < SID_LIVE_FRAMES; i++) {
+    if (slots[i].used && (!found || (int32_t)(slots[i].frame - next) < 0)) {
+      next = slots[i].frame;
+      found = true;
+    }
+  }
+
+  have_next = true;
+  state = SID_LIVE_PLAYING;
+}
+
+static void report(void)
+{
+  uint8_t data[SID_LIVE_REPORT_SIZE];
+  uint8_t buf[SID_LIVE_REPORT_SIZE + SID_PACKET_OVERHEAD];
+
+  put_le32(&data[0], ticks);
+  put_le32(&data[4], next);
+  put_le32(&data[8], stats.late);
+  put_le32(&data[12], stats.underruns);
+  put_le32(&data[16], stats.lost + stats.crc_errors);
+  data[20] = stats.fill;
+
+  sid_live_send(buf, sid_packet_build(buf, SID_LIVE_SYNC, SID_LIVE_REPORT, report_seq++,
+                                      data, sizeof(data)));
+}
+
+bool sid_live_frame(void)
+{
+  struct slot* s;
+  bool played = false;
+
+  if (state == SID_LIVE_IDLE)
+    return false;
+
+  ticks++;
+  if (++quiet_ticks > SID_LIVE_TIMEOUT_TICKS || (stopping && !stats.fill)) {
+    state = SID_LIVE_IDLE;
+    return false;
+  }
+
+  if (state == SID_LIVE_BUFFERING &&
+      (stats.fill >= stats.target || (stopping && stats.fill))) {
+    start_playing();
+  }
+
+  if (state == SID_LIVE_PLAYING) {
+    s = &slots[next % SID_LIVE_FRAMES];
+
+    if (s->used && s->frame == next) {
+      poke_writes((const uint8_t (*)[2])s->writes, s->n_writes);
+      s->used = false;
+      stats.fill--;
+      stats.played++;
+      played = true;
+    } else {
+      stats.underruns++;
+    }
+    next++;
+
+    if (stats.fill < stats.fill_min) {
+      stats.fill_min = stats.fill;
+    }
+
+    if (!stats.fill && stopping) {
+      state = SID_LIVE_IDLE;
+    } else if (!stats.fill && !played) {
+      stats.rebuffers++;
+      state = SID_LIVE_BUFFERING;
+    }
+  }
+
+  if (ticks % SID_LIVE_REPORT_TICKS == 0) {
+    report();
+  }
+
+  return played;
+}
+
+uint32_t sid_live_position(void)
+{
+  return next;
+}
+
+void sid_live_get_stats(struct sid_live_stats* s)
+{
+  *s = stats;
+}
+
+void sid_live_reset_stats(void)
+{
+  uint8_t fill = stats.fill;
+  uint8_t target = stats.target;
+
+  memset(&stats, 0, sizeof(stats));
+  stats.fill = fill;
+  stats.target = target;
+  stats.fill_min = 0xff;
+}
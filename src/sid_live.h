@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef SID_LIVE_H
+#define SID_LIVE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "sid_packet.h"
+
+/*
+ * Register frames from a host that runs the emulation itself, for tunes too
+ * heavy for the board. The device only keeps the time: frames wait in a
+ * jitter buffer and one goes to the SID per frame tick. Packets are framed
+ * by sid_packet.h like the ones of sid_upload.h, with their own sync byte
+ * and no answers:
+ *
+ *   SID_LIVE_SYNC, type, sequence, length, length bytes, CRC-8
+ *
+ *   start:  clock (enum sid_clock), buffer target in frames
+ *   frame:  frame number (32 bit little endian), then register and value
+ *           pairs in the order the tune wrote them
+ *   stop:   no data, the frames in the buffer still play
+ *
+ * The frame number is the time stamp, frame n plays n ticks after frame 0.
+ * Playback starts once the target number of frames is buffered. A frame
+ * that comes after its tick is late, its writes go out with the next tick
+ * so no register is left behind. A tick without its frame is an underrun,
+ * when the buffer has run empty playback waits for the target fill again.
+ * Damaged packets are dropped, the host sends all registers every
+ * SID_LIVE_REFRESH_FRAMES so a lost frame does not linger.
+ *
+ * Every SID_LIVE_REPORT_TICKS ticks the device reports back, in the same
+ * framing with type SID_LIVE_REPORT:
+ *
+ *   ticks, next frame, late, underruns, lost (32 bit little endian), fill
+ *
+ * The host paces its frames by the tick rate the reports show, which takes
+ * out the drift between the two clocks, and steers towards the target fill.
+ */
+#define SID_LIVE_SYNC           0x5a
+#define SID_LIVE_START          'S'
+#define SID_LIVE_FRAME          'F'
+#define SID_LIVE_STOP           'E'
+#define SID_LIVE_REPORT         'R'
+
+#define SID_LIVE_MAX_DATA       SID_PACKET_MAX_DATA
+#define SID_LIVE_REPORT_SIZE    21
+
+/* Frames the buffer holds, a power of two, and writes per frame */
+#define SID_LIVE_FRAMES         32
+#define SID_LIVE_MAX_WRITES     56
+
+#define SID_LIVE_DEFAULT_TARGET 8       /* 160 ms of PAL frames */
+#define SID_LIVE_REFRESH_FRAMES 50
+#define SID_LIVE_REPORT_TICKS   10
+
+/* Ticks without any packet before the stream counts as gone */
+#define SID_LIVE_TIMEOUT_TICKS  100
+
+enum sid_live_state
+{
+    SID_LIVE_IDLE,
+    SID_LIVE_BUFFERING,         /* waiting for the target fill */
+    SID_LIVE_PLAYING,
+};
+
+struct sid_live_stats
+{
+    uint32_t bytes;             /* received */
+    uint32_t frames;            /* received */
+    uint32_t played;
+    uint32_t late;              /* frames that came after their tick */
+    uint32_t underruns;         /* ticks without their frame */
+    uint32_t rebuffers;         /* the buffer ran empty */
+    uint32_t overflows;         /* frames too far ahead, dropped */
+    uint32_t crc_errors;
+    uint32_t lost;              /* packets missing from the sequence */
+    uint8_t  fill;
+    uint8_t  fill_min;          /* while playing */
+    uint8_t  fill_max;
+    uint8_t  target;
+};
+
+void sid_live_reset(void);
+
+/* Takes received bytes, a start packet begins a stream */
+enum sid_live_state sid_live_feed(const uint8_t* data, size_t len);
+enum sid_live_state sid_live_get_state(void);
+
+/* Clock of the host's tune, enum sid_clock */
+uint8_t sid_live_clock(void);
+
+/* Called every frame tick, pokes the frame that is due, sid_flush() follows */
+bool sid_live_frame(void);
+
+/* Number of the next frame to play */
+uint32_t sid_live_position(void);
+
+void sid_live_get_stats(struct sid_live_stats* stats);
+void sid_live_reset_stats(void);
+
+/* Sends a report to the host, provided by the transport */
+void sid_live_send(const uint8_t* data, size_t len);
+
+#endif /* SID_LIVE_H */
@@ -0,0 +1,413 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Players on several bridges, see sid_multi.h.
+ *
+ * Every player has at most one frame computed ahead. A poll first sends the
+ * computed frames whose tick has come, then picks the player without a
+ * computed frame whose tick is the earliest. Time runs on the digi timer,
+ * ticks are compared as signed differences so the counter may wrap.
+ *
+ * The writes of a frame are replayed on the player's own registers in their
+ * order. Like sid_flush() a batch holds one value per register, a second
+ * write to a register sends the batch so far first.
+ */
+
+#include "sid_multi.h"
+#include "sid_proto.h"
+#include "sid_digi.h"
+#include "sid_clock.h"
+#include "c64.h"
+
+#include <string.h>
+
+#define NO_PLAYER       -1
+
+struct player
+{
+  const uint8_t* data;
+  size_t size;
+  uint8_t song;
+  struct sid_info info;
+  struct c64_context ctx;
+  struct c64_context_write log[SID_MULTI_MAX_WRITES];
+  uint8_t regs[SID_NUM_REGS];   /* as the tune wrote them */
+  uint8_t chip[SID_NUM_REGS];   /* as the bridge got them, after the clock */
+  uint32_t due;                 /* tick of the next frame */
+  uint32_t expect_us;           /* what the next play call is expected to take */
+  bool ready;                   /* the frame for due is computed */
+};
+
+static struct player players[SID_MULTI_MAX_PLAYERS];
+static uint8_t n_players;
+
+static struct sid_multi_stats stats;
+static uint32_t last_now;
+static uint32_t window_start;
+static uint32_t window_busy;
+
+static const uint8_t silence[SID_NUM_REGS];
+
+/* Protocol settings of the single player, restored by sid_multi_stop() */
+static enum sid_proto_mode saved_mode;
+static bool saved_burst;
+static bool saved_verify;
+static bool proto_saved;
+
+static void add_busy(uint32_t us)
+{
+  stats.busy_us += us;
+  window_busy += us;
+}
+
+static void account(uint32_t now)
+{
+  uint32_t window = now - window_start;
+
+  stats.elapsed_us += now - last_now;
+  last_now = now;
+
+  if (window >= SID_MULTI_LOAD_WINDOW_US) {
+    uint32_t load = (uint32_t)((uint64_t)window_busy * 1000 / window);
+
+    if (load > stats.load_max) {
+      stats.load_max = load;
+    }
+    window_start = now;
+    window_busy = 0;
+  }
+}
+
+/* The clock is set per batch, the live machine does not play meanwhile */
+static void send_regs(struct player* p, uint32_t mask, const uint8_t* order, uint8_t n)
+{
+  const uint8_t* regs = p->regs;
+
+  if (!mask)
+    return;
+
+  sid_clock_set(p->info.clock);
+  if (sid_clock_converts()) {
+    mask = sid_clock_convert(p->regs, p->chip, mask);
+    regs = p->chip;
+  }
+
+  sid_write_regs(mask, regs, order, n);
+}
+
+static void load_regs(uint8_t index, const uint8_t regs[SID_NUM_REGS])
+{
+  struct player* p = &players[index];
+
+  memcpy(p->regs, regs, SID_NUM_REGS);
+  memcpy(p->chip, regs, SID_NUM_REGS);
+
+  sid_spi_select(index);
+  send_regs(p, (1U << SID_NUM_REGS) - 1, NULL, 0);
+  sid_proto_flush();
+}
+
+static void stop_player(uint8_t index)
+{
+  stats.player[index].running = false;
+  load_regs(index, silence);
+}
+
+static bool init_player(struct player* p, uint8_t (*pool)[256], uint8_t pages)
+{
+  c64_context_init(&p->ctx, pool, pages);
+
+  if (!sid_parse_header(p->data, p->size, &p->info) ||
+      !sid_load_context(&p->ctx, p->data, p->size))
+    return false;
+
+  c64_context_call(&p->ctx, p->info.init_addr, p->song);
+  if (c64_context_run(&p->ctx, SID_MULTI_MAX_INIT) != C64_CONTEXT_DONE)
+    return false;
+
+  if (p->info.play_addr == 0) {
+    p->info.play_addr = (c64_context_peek(&p->ctx, 0x0315) << 8) |
+                        c64_context_peek(&p->ctx, 0x0314);
+  }
+
+  return p->info.play_addr != 0;
+}
+
+/* Among the running players with or without a computed frame */
+static int8_t earliest(bool ready, uint32_t now)
+{
+  int8_t best = NO_PLAYER;
+
+  for (uint8_t i = 0; i < n_players; i++) {
+    if (!stats.player[i].running || players[i].ready != ready)
+      continue;
+
+    if (best == NO_PLAYER ||
+        (int32_t)(players[i].due - now) < (int32_t)(players[best].due - now)) {
+      best = i;
+    }
+  }
+
+  return best;
+}
+
+static void play(uint8_t index)
+{
+  struct player* p = &players[index];
+  struct sid_multi_player_stats* s = &stats.player[index];
+  uint32_t start = sid_digi_timer_now();
+  uint32_t instructions = p->ctx.instructions;
+  enum c64_context_state state;
+  uint32_t end;
+  uint32_t us;
+
+  c64_context_log(&p->ctx, p->log, SID_MULTI_MAX_WRITES);
+  c64_context_call(&p->ctx, p->info.play_addr, 0);
+  state = c64_context_run(&p->ctx, SID_MULTI_MAX_PLAY);
+  s->instructions += p->ctx.instructions - instructions;
+
+  end = sid_digi_timer_now();
+  us = end - start;
+  add_busy(us);
+
+  if (state != C64_CONTEXT_DONE) {
+    stop_player(index);
+    return;
+  }
+
+  s->writes += p->ctx.n_log;
+  s->lost_writes += p->ctx.log_lost;
+  s->play_sum_us += us;
+  if (us > s->play_max_us) {
+    s->play_max_us = us;
+  }
+  s->pages = p->ctx.n_pages;
+
+  /* Follows a slower call at once, forgets it over a few frames */
+  p->expect_us = us > p->expect_us ? us : p->expect_us - (p->expect_us - us) / 8;
+
+  if ((int32_t)(end - p->due) > 0) {
+    s->misses++;
+  }
+
+  p->ready = true;
+}
+
+static void send(uint8_t index, uint32_t now)
+{
+  struct player* p = &players[index];
+  struct sid_multi_player_stats* s = &stats.player[index];
+  uint32_t late = now - p->due;
+  uint32_t mask = 0;
+  uint8_t order[SID_NUM_REGS];
+  uint8_t n = 0;
+
+  sid_spi_select(index);
+
+  for (uint16_t i = 0; i < p->ctx.n_log; i++) {
+    uint8_t reg = p->log[i].reg;
+
+    /* The registers above are read only */
+    if (reg >= SID_NUM_REGS)
+      continue;
+
+    if (mask & (1U << reg)) {
+      send_regs(p, mask, order, n);
+      mask = 0;
+      n = 0;
+    }
+
+    p->regs[reg] = p->log[i].val;
+    mask |= 1U << reg;
+    order[n++] = reg;
+  }
+
+  send_regs(p, mask, order, n);
+  sid_proto_flush();
+
+  if (late > s->late_max_us) {
+    s->late_max_us = late;
+  }
+  s->frames++;
+  p->ready = false;
+
+  /* A player a whole frame behind skips to the next tick to come */
+  p->due += s->period_us;
+  if ((int32_t)(now - p->due) >= 0) {
+    uint32_t skipped = (now - p->due) / s->period_us + 1;
+
+    s->overruns += skipped;
+    p->due += skipped * s->period_us;
+  }
+
+  add_busy(sid_digi_timer_now() - now);
+}
+
+void sid_multi_init(void)
+{
+  n_players = 0;
+  memset(&stats, 0, sizeof(stats));
+}
+
+bool sid_multi_add(const uint8_t* data, size_t size, uint8_t song)
+{
+  if (n_players == SID_MULTI_MAX_PLAYERS || !data || size < 0x7c)
+    return false;
+
+  players[n_players].data = data;
+  players[n_players].size = size;
+  players[n_players].song = song;
+  n_players++;
+
+  return true;
+}
+
+uint8_t sid_multi_start(void)
+{
+  uint8_t (*pool)[256] = c64_borrow_memory();
+  uint32_t pages = n_players ? 256 / n_players : 0;
+  uint8_t running = 0;
+  uint32_t now;
+
+  if (!n_players)
+    return 0;
+
+  if (!proto_saved) {
+    saved_mode = sid_proto_get_mode();
+    saved_burst = sid_proto_has_burst();
+    saved_verify = sid_proto_get_verify();
+    proto_saved = true;
+  }
+  sid_proto_set_verify(false);
+  sid_proto_set_mode(SID_PROTO_MODE_BLOCKING, false);
+
+  sid_digi_reset();
+  memset(&stats, 0, sizeof(stats));
+  stats.players = n_players;
+
+  for (uint8_t i = 0; i < n_players; i++) {
+    struct player* p = &players[i];
+    struct sid_multi_player_stats* s = &stats.player[i];
+
+    p->ready = false;
+    p->expect_us = 0;
+
+    /* A context has at most 255 pages, its slots are 8 bit */
+    if (!init_player(p, pool + i * pages, pages > 255 ? 255 : pages)) {
+      stop_player(i);
+      continue;
+    }
+
+    /* The bridge goes to the registers init left in one batch */
+    s->running = true;
+    s->clock = p->info.clock;
+    s->pages = p->ctx.n_pages;
+    s->period_us = sid_clock_frame_us(p->info.clock);
+    load_regs(i, p->ctx.regs);
+    running++;
+  }
+
+  sid_spi_select(0);
+
+  /* The ticks are spread over a frame so the batches do not meet */
+  now = sid_digi_timer_now();
+  for (uint8_t i = 0; i < n_players; i++) {
+    players[i].due = now + stats.player[i].period_us * (i + n_players) / n_players;
+  }
+
+  last_now = now;
+  window_start = now;
+  window_busy = 0;
+
+  return running;
+}
+
+void sid_multi_poll(void)
+{
+  uint32_t now = sid_digi_timer_now();
+  int8_t next;
+  int8_t ready;
+
+  account(now);
+
+  while ((ready = earliest(true, now)) != NO_PLAYER &&
+         (int32_t)(now - players[ready].due) >= 0) {
+    send(ready, now);
+    now = sid_digi_timer_now();
+  }
+
+  next = earliest(false, now);
+
+  if (next == NO_PLAYER && ready == NO_PLAYER) {
+    sid_digi_timer_wait(now + sid_clock_frame_us(SID_CLOCK_CHIP));
+    return;
+  }
+
+  /*
+   * The play call goes first when its own tick is the earlier one, or when
+   * it is expected to be done before the tick of the frame that is ready.
+   */
+  if (next != NO_PLAYER &&
+      (ready == NO_PLAYER ||
+       (int32_t)(players[next].due - players[ready].due) <= 0 ||
+       (int32_t)(players[ready].due - now) > (int32_t)players[next].expect_us)) {
+    play(next);
+    return;
+  }
+
+  sid_digi_timer_wait(players[ready].due);
+}
+
+void sid_multi_stop(void)
+{
+  for (uint8_t i = 0; i < n_players; i++) {
+    stop_player(i);
+  }
+
+  sid_spi_select(0);
+  n_players = 0;
+  stats.players = 0;
+
+  /* Setting verify again also resynchronises the CRC with bridge 0 */
+  if (proto_saved) {
+    sid_proto_set_mode(saved_mode, saved_burst);
+    sid_proto_set_verify(saved_verify);
+    proto_saved = false;
+  }
+}
+
+uint8_t sid_multi_players(void)
+{
+  return n_players;
+}
+
+void sid_multi_get_stats(struct sid_multi_stats* s)
+{
+  *s = stats;
+}
+
+void sid_multi_reset_stats(void)
+{
+  stats.elapsed_us = 0;
+  stats.busy_us = 0;
+  stats.load_max = 0;
+
+  for (uint8_t i = 0; i < n_players; i++) {
+    struct sid_multi_player_stats* s = &stats.player[i];
+
+    s->frames = 0;
+    s->misses = 0;
+    s->overruns = 0;
+    s->late_max_us = 0;
+    s->play_max_us = 0;
+    s->play_sum_us = 0;
+    s->instructions = 0;
+    s->writes = 0;
+    s->lost_writes = 0;
+  }
+
+  window_start = sid_digi_timer_now();
+  window_busy = 0;
+}
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef SID_MULTI_H
+#define SID_MULTI_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "sid.h"
+#include "sid_spi.h"
+
+/*
+ * Several tunes at once, each on its own bridge. Every player is a
+ * background context with its own tune, CPU, frame time and chip select,
+ * the pages of all of them share the live memory, which is not playing
+ * meanwhile.
+ *
+ * A play call is computed up to one frame ahead of its tick and its SID
+ * writes are kept in order. At the tick they go out to the player's bridge
+ * in one batch, so the frame timing on every bridge does not depend on how
+ * long the play calls took. The play calls are scheduled earliest deadline
+ * first, the deadline being the tick of the frame, and run to completion.
+ * A play call is not started when it is expected to run past the tick of a
+ * frame that is ready to go out, that frame is sent first.
+ *
+ * A play call that had not finished by its tick is a deadline miss, a
+ * player that fell a whole frame behind skips ticks like the single player
+ * does. The load is the time spent playing and sending over the time that
+ * passed.
+ *
+ * Players run on the generic core. Reads of the SID return 0, so tunes that
+ * take random numbers or sync from voice 3 play differently than alone.
+ *
+ * The protocol layer keeps one set of FIFO credits and one frame CRC, which
+ * belong to a single bridge. While several players run the protocol is
+ * therefore switched to blocking mode without bursts and without frame
+ * checks, which need neither, and sid_multi_stop() restores what it was.
+ */
+#define SID_MULTI_MAX_PLAYERS       SID_SPI_MAX_BRIDGES
+
+/* SID writes of one play call, more are lost and counted */
+#define SID_MULTI_MAX_WRITES        128
+
+/* An init or play call running longer has hung, the player is stopped */
+#define SID_MULTI_MAX_INIT          2000000
+#define SID_MULTI_MAX_PLAY          200000
+
+/* Window of the peak load */
+#define SID_MULTI_LOAD_WINDOW_US    1000000
+
+struct sid_multi_player_stats
+{
+    bool     running;
+    uint8_t  clock;             /* enum sid_clock */
+    uint8_t  pages;             /* context pages in use */
+    uint32_t period_us;
+    uint32_t frames;
+    uint32_t misses;            /* play calls that finished after their tick */
+    uint32_t overruns;          /* ticks skipped after falling behind */
+    uint32_t late_max_us;       /* worst batch start after its tick */
+    uint32_t play_max_us;
+    uint64_t play_sum_us;
+    uint32_t instructions;      /* of all play calls */
+    uint32_t writes;            /* SID writes of all play calls */
+    uint32_t lost_writes;       /* beyond SID_MULTI_MAX_WRITES */
+};
+
+struct sid_multi_stats
+{
+    uint8_t  players;
+    uint64_t elapsed_us;
+    uint64_t busy_us;           /* playing and sending */
+    uint32_t load_max;          /* per mille, busiest window */
+    struct sid_multi_player_stats player[SID_MULTI_MAX_PLAYERS];
+};
+
+/* Players are numbered by their bridge */
+void sid_multi_init(void);
+bool sid_multi_add(const uint8_t* data, size_t size, uint8_t song);
+
+/* Runs the inits and silences the bridges, the first ticks follow */
+uint8_t sid_multi_start(void);
+
+/*
+ * Sends the frames that are due and runs the next play call, or waits for
+ * the next tick when every player is ahead. Call it in a loop.
+ */
+void sid_multi_poll(void);
+
+/* Silences the bridges and selects bridge 0, the live machine needs a c64_init() */
+void sid_multi_stop(void);
+
+uint8_t sid_multi_players(void);
+
+void sid_multi_get_stats(struct sid_multi_stats* stats);
+void sid_multi_reset_stats(void);
+
+#endif /* SID_MULTI_H */
@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Packet framing and CRC-8, see sid_packet.h.
+ */
+
+#include "sid_packet.h"
+
+#include <string.h>
+
+enum rx_state
+{
+  RX_SYNC,
+  RX_TYPE,
+  RX_SEQ,
+  RX_LEN,
+  RX_DATA,
+  RX_CRC,
+};
+
+uint8_t sid_crc8(uint8_t crc, const uint8_t* data, size_t len)
+{
+  while (len--) {
+    crc ^= *data++;
+
+    for (uint8_t bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+    }
+  }
+
+  return crc;
+}
+
+void sid_packet_rx_init(struct sid_packet_rx* rx, uint8_t sync)
+{
+  rx->sync = sync;
+  rx->state = RX_SYNC;
+}
+
+enum sid_packet_result sid_packet_rx_byte(struct sid_packet_rx* rx, uint8_t byte)
+{
+  switch (rx->state) {
+    case RX_SYNC:
+      if (byte == rx->sync) {
+        rx->crc = 0;
+        rx->state = RX_TYPE;
+      }
+      return SID_PACKET_NONE;
+
+    case RX_TYPE:
+      rx->type = byte;
+      rx->state = RX_SEQ;
+      break;
+
+    case RX_SEQ:
+      rx->seq = byte;
+      rx->state = RX_LEN;
+      break;
+
+    case RX_LEN:
+      rx->len = byte;
+      rx->pos = 0;
+      rx->state = byte ? RX_DATA : RX_CRC;
+      break;
+
+    case RX_DATA:
+      rx->data[rx->pos++] = byte;
+      if (rx->pos == rx->len) {
+        rx->state = RX_CRC;
+      }
+      break;
+
+    case RX_CRC:
+      rx->state = RX_SYNC;
+      return byte == rx->crc ? SID_PACKET_OK : SID_PACKET_CRC_ERROR;
+  }
+
+  rx->crc = sid_crc8(rx->crc, &byte, 1);
+
+  return SID_PACKET_NONE;
+}
+
+size_t sid_packet_build(uint8_t* buf, uint8_t sync, uint8_t type, uint8_t seq,
+                        const uint8_t* data, uint8_t len)
+{
+  buf[0] = sync;
+  buf[1] = type;
+  buf[2] = seq;
+  buf[3] = len;
+  memcpy(&buf[4], data, len);
+  buf[4 + len] = sid_crc8(0, &buf[1], len + 3);
+
+  return len + SID_PACKET_OVERHEAD;
+}
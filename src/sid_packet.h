@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef SID_PACKET_H
+#define SID_PACKET_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Packets of the serial links, sid_upload and sid_live, each with its own
+ * sync byte:
+ *
+ *   sync, type, sequence, length, length bytes, CRC-8
+ *
+ * The CRC-8 (poly 0x07) is over type up to the last data byte. The SPI
+ * frames of sid_proto are checked with the same CRC-8.
+ */
+#define SID_PACKET_MAX_DATA     255
+#define SID_PACKET_OVERHEAD     5
+
+enum sid_packet_result
+{
+    SID_PACKET_NONE,            /* more bytes needed */
+    SID_PACKET_OK,              /* type, seq, len and data hold a packet */
+    SID_PACKET_CRC_ERROR,
+};
+
+struct sid_packet_rx
+{
+    uint8_t sync;
+    uint8_t state;
+    uint8_t crc;
+    uint8_t pos;
+    uint8_t type;
+    uint8_t seq;
+    uint8_t len;
+    uint8_t data[SID_PACKET_MAX_DATA];
+};
+
+uint8_t sid_crc8(uint8_t crc, const uint8_t* data, size_t len);
+
+/* Waits for the sync byte of the next packet */
+void sid_packet_rx_init(struct sid_packet_rx* rx, uint8_t sync);
+enum sid_packet_result sid_packet_rx_byte(struct sid_packet_rx* rx, uint8_t byte);
+
+/* Writes a packet of len + SID_PACKET_OVERHEAD bytes to buf, returns its size */
+size_t sid_packet_build(uint8_t* buf, uint8_t sync, uint8_t type, uint8_t seq,
+                        const uint8_t* data, uint8_t len);
+
+#endif /* SID_PACKET_H */
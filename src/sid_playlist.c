@@ -0,0 +1,307 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Gapless playlist, see sid_playlist.h.
+ *
+ * There is no room for a second 64 KB machine. The next tune is loaded into
+ * a background context instead, which only holds the pages of its image and
+ * the pages its init writes. The init runs there a slice per frame while the
+ * current tune keeps playing. At the end of the current tune the context
+ * replaces the live memory between two play calls and the first play call
+ * of the new tune follows in the same frame. The SID goes from the old
+ * registers to the ones init left in a single flush, together with the
+ * writes of that first play call.
+ *
+ * When the preload fails, because the tune does not fit the pool or its
+ * init never returns, the tune is loaded the old way in the switch frame.
+ * Its init runs muted, so the register transition is still a single flush.
+ * A tune whose image does not load is skipped, when none loads the playlist
+ * stops with the SID silent.
+ */
+
+#include "sid_playlist.h"
+#include "sid_clock.h"
+#include "sid_digi.h"
+#include "c64.h"
+
+#include <string.h>
+
+struct tune
+{
+  const uint8_t* data;
+  size_t size;
+  uint8_t song;
+  uint32_t frames;
+};
+
+enum preload_state
+{
+  PRELOAD_IDLE,
+  PRELOAD_RUNNING,
+  PRELOAD_READY,
+  PRELOAD_FAILED,
+};
+
+static struct tune tunes[SID_PLAYLIST_MAX_TUNES];
+static uint8_t n_tunes;
+static uint8_t current;
+static bool playing;
+static struct sid_info info;
+
+static struct c64_context next;
+static struct sid_info next_info;
+static enum preload_state state;
+static uint32_t preload_frame;
+
+static uint8_t pool[SID_PLAYLIST_POOL_PAGES][256];
+
+static struct sid_playlist_stats stats;
+
+/* Length of the current tune in frames of its clock, 0 is forever */
+static uint32_t current_frames(void)
+{
+  uint32_t frames = tunes[current].frames;
+
+  /* A tune on its own has nothing to make room for */
+  if (n_tunes < 2)
+    return 0;
+
+  if (frames == SID_PLAYLIST_DEFAULT_FRAMES) {
+    frames = SID_PLAYLIST_DEFAULT_SECONDS * sid_clock_frames_per_second(sid_clock_get());
+  }
+
+  return frames;
+}
+
+static uint8_t next_index(void)
+{
+  return (current + 1) % n_tunes;
+}
+
+/* Registers every init starts from, a reset SID with the volume up */
+static const uint8_t start_regs[SID_NUM_REGS] = { [0x18] = SID_PLAYLIST_START_VOLUME };
+
+static void transition(const uint8_t regs[SID_NUM_REGS])
+{
+  uint8_t old[SID_NUM_REGS];
+
+  sid_get_regs(old);
+
+  stats.regs_changed = 0;
+  for (uint8_t reg = 0; reg < SID_NUM_REGS; reg++) {
+    if (old[reg] != regs[reg]) {
+      stats.regs_changed++;
+    }
+  }
+
+  sid_load_regs(regs);
+}
+
+static bool start_live(uint8_t index)
+{
+  const struct tune* t = &tunes[index];
+  uint8_t old[SID_NUM_REGS];
+  uint8_t regs[SID_NUM_REGS];
+
+  sid_get_regs(old);
+  sid_mute(true);
+  sid_set_regs(start_regs);
+
+  c64_init();
+  if (!sid_load_from_memory(t->data, t->size, &info)) {
+    sid_set_regs(old);
+    sid_mute(false);
+    return false;
+  }
+  c64_cpu_jsr(info.init_addr, t->song);
+
+  sid_get_regs(regs);
+  sid_set_regs(old);
+  sid_mute(false);
+  transition(regs);
+
+  current = index;
+  c64_cpu_optimize(info.play_addr, NULL);
+  sid_seek_init(t->data, t->size, &info, t->song);
+
+  return true;
+}
+
+/* Starts the first tune from index on that loads */
+static bool start_from(uint8_t index)
+{
+  for (uint8_t i = 0; i < n_tunes; i++) {
+    if (start_live((index + i) % n_tunes))
+      return true;
+  }
+
+  memset(&info, 0, sizeof(info));
+  transition((const uint8_t[SID_NUM_REGS]){ 0 });
+  playing = false;
+
+  return false;
+}
+
+static void preload_begin(void)
+{
+  const struct tune* t = &tunes[next_index()];
+
+  c64_context_init(&next, pool, SID_PLAYLIST_POOL_PAGES);
+  memcpy(next.regs, start_regs, SID_NUM_REGS);
+  preload_frame = sid_seek_position();
+
+  if (!sid_parse_header(t->data, t->size, &next_info) ||
+      !sid_load_context(&next, t->data, t->size)) {
+    state = PRELOAD_FAILED;
+    return;
+  }
+
+  c64_context_call(&next, next_info.init_addr, t->song);
+  state = PRELOAD_RUNNING;
+}
+
+static void preload_step(uint32_t budget)
+{
+  switch (c64_context_run(&next, budget)) {
+    case C64_CONTEXT_DONE:
+      if (next_info.play_addr == 0) {
+        next_info.play_addr = (c64_context_peek(&next, 0x0315) << 8) |
+                              c64_context_peek(&next, 0x0314);
+      }
+
+      stats.preload_frames = sid_seek_position() - preload_frame;
+      stats.init_instructions = next.instructions;
+      stats.pages = next.n_pages;
+      state = PRELOAD_READY;
+      break;
+
+    case C64_CONTEXT_FULL:
+      state = PRELOAD_FAILED;
+      break;
+
+    case C64_CONTEXT_RUNNING:
+      if (next.instructions >= SID_PLAYLIST_MAX_INIT) {
+        state = PRELOAD_FAILED;
+      }
+      break;
+  }
+}
+
+static void switch_tune(void)
+{
+  uint8_t index = next_index();
+
+  if (state == PRELOAD_IDLE) {
+    preload_begin();
+  }
+
+  if (state == PRELOAD_RUNNING) {
+    stats.late++;
+    preload_step(SID_PLAYLIST_MAX_INIT - next.instructions);
+  }
+
+  if (state == PRELOAD_READY) {
+    c64_context_commit(&next);
+    info = next_info;
+    current = index;
+
+    /* Digi writes still queued belong to the old tune */
+    sid_digi_reset();
+    transition(next.regs);
+
+    c64_cpu_optimize(info.play_addr, NULL);
+    sid_seek_init(tunes[index].data, tunes[index].size, &info,
+                  tunes[index].song);
+    stats.gapless++;
+  } else if (start_from(index)) {
+    stats.fallbacks++;
+  }
+
+  state = PRELOAD_IDLE;
+  stats.switches++;
+}
+
+void sid_playlist_init(void)
+{
+  n_tunes = 0;
+  current = 0;
+  playing = false;
+  state = PRELOAD_IDLE;
+  memset(&stats, 0, sizeof(stats));
+}
+
+bool sid_playlist_add(const uint8_t* data, size_t size, uint8_t song, uint32_t frames)
+{
+  if (n_tunes == SID_PLAYLIST_MAX_TUNES || !data || size < 0x7c)
+    return false;
+
+  tunes[n_tunes].data = data;
+  tunes[n_tunes].size = size;
+  tunes[n_tunes].song = song;
+  tunes[n_tunes].frames = frames;
+  n_tunes++;
+
+  return true;
+}
+
+bool sid_playlist_start(void)
+{
+  if (!n_tunes)
+    return false;
+
+  state = PRELOAD_IDLE;
+  playing = true;
+
+  return start_from(0);
+}
+
+const struct sid_info* sid_playlist_info(void)
+{
+  return &info;
+}
+
+uint8_t sid_playlist_current(void)
+{
+  return current;
+}
+
+void sid_playlist_play(void)
+{
+  uint32_t frames = current_frames();
+
+  if (!playing)
+    return;
+
+  if (frames && sid_seek_position() >= frames) {
+    switch_tune();
+  }
+
+  if (playing) {
+    c64_cpu_jsr(info.play_addr, 0);
+  }
+}
+
+void sid_playlist_idle(void)
+{
+  uint32_t frames = current_frames();
+
+  if (!playing || !frames)
+    return;
+
+  if (state == PRELOAD_IDLE &&
+      sid_seek_position() +
+      SID_PLAYLIST_PRELOAD_SECONDS * sid_clock_frames_per_second(sid_clock_get()) >= frames) {
+    preload_begin();
+  }
+
+  if (state == PRELOAD_RUNNING) {
+    preload_step(SID_PLAYLIST_SLICE);
+  }
+}
+
+void sid_playlist_get_stats(struct sid_playlist_stats* s)
+{
+  *s = stats;
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef SID_PLAYLIST_H
+#define SID_PLAYLIST_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "sid.h"
+#include "sid_seek.h"
+
+#define SID_PLAYLIST_MAX_TUNES      16
+
+/*
+ * $d418 before init runs. Tunes that never set the volume themselves rely on
+ * the player having turned it up.
+ */
+#define SID_PLAYLIST_START_VOLUME   0x0f
+
+/*
+ * Tunes without a known length play for this long, in frames of their own
+ * clock, 50 or 60 a second
+ */
+#define SID_PLAYLIST_DEFAULT_SECONDS    180
+#define SID_PLAYLIST_DEFAULT_FRAMES     UINT32_MAX
+
+/*
+ * The next tune is loaded and initialised during the last seconds of a tune,
+ * in a background context where OSC3 and ENV3 read 0. An init that seeds a
+ * random generator from voice 3 starts the same way every time.
+ */
+#define SID_PLAYLIST_PRELOAD_SECONDS    5
+
+/* Instructions of the next init run per frame, after the frame's own work */
+#define SID_PLAYLIST_SLICE          2000
+
+/* An init running longer than this never returns, like an RSID main loop */
+#define SID_PLAYLIST_MAX_INIT       2000000
+
+/* Pages for the image and the writes of the next init, 256 bytes each */
+#define SID_PLAYLIST_POOL_PAGES     32
+
+struct sid_playlist_stats
+{
+    uint32_t switches;
+    uint32_t gapless;           /* switched to a preloaded tune */
+    uint32_t fallbacks;         /* loaded in the switch frame, the preload failed */
+    uint32_t late;              /* the preload was finished in the switch frame */
+    uint32_t preload_frames;    /* frames the last preload took */
+    uint32_t init_instructions; /* instructions of the last init */
+    uint8_t  pages;             /* pool pages of the last preload */
+    uint8_t  regs_changed;      /* registers written by the last transition */
+};
+
+void sid_playlist_init(void);
+
+/*
+ * song counts from 0, frames of 0 plays the tune forever and
+ * SID_PLAYLIST_DEFAULT_FRAMES for SID_PLAYLIST_DEFAULT_SECONDS. A playlist
+ * of one tune plays it forever whatever its length.
+ */
+bool sid_playlist_add(const uint8_t* data, size_t size, uint8_t song, uint32_t frames);
+
+/* Loads and initialises the first tune */
+bool sid_playlist_start(void);
+const struct sid_info* sid_playlist_info(void);
+uint8_t sid_playlist_current(void);
+
+/*
+ * Called every frame instead of the play routine, followed by sid_flush().
+ * sid_playlist_idle() runs a slice of the preload once everything else in
+ * the frame is done.
+ */
+void sid_playlist_play(void);
+void sid_playlist_idle(void);
+
+void sid_playlist_get_stats(struct sid_playlist_stats* stats);
+
+#endif /* SID_PLAYLIST_H */
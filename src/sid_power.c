@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Sleep state choice between frames, see sid_power.h. Two histories are
+ * kept, the busy time of the last frames and the lateness of the last deep
+ * wake ups, both as rings whose maximum is taken when it is needed.
+ */
+
+#include "sid_power.h"
+
+#include <string.h>
+
+static uint32_t period;
+
+static uint32_t busy_history[SID_POWER_HISTORY];
+static uint32_t busy_pos;
+
+static uint32_t late_history[SID_POWER_HISTORY];
+static uint32_t late_pos;
+static bool late_seen;
+
+static struct sid_power_stats stats;
+
+static const char* const state_names[SID_POWER_NUM_STATES] = {
+  "poll", "sleep", "deep",
+};
+
+static uint32_t ring_max(const uint32_t* ring)
+{
+  uint32_t max = 0;
+
+  for (uint32_t i = 0; i < SID_POWER_HISTORY; i++) {
+    if (ring[i] > max) {
+      max = ring[i];
+    }
+  }
+
+  return max;
+}
+
+void sid_power_init(uint32_t period_us)
+{
+  period = period_us;
+
+  memset(busy_history, 0, sizeof(busy_history));
+  memset(late_history, 0, sizeof(late_history));
+  busy_pos = 0;
+  late_pos = 0;
+  late_seen = false;
+
+  sid_power_reset_stats();
+}
+
+void sid_power_set_period(uint32_t period_us)
+{
+  period = period_us;
+}
+
+uint32_t sid_power_reserve(void)
+{
+  if (!late_seen)
+    return SID_POWER_DEEP_RESERVE_US;
+
+  return ring_max(late_history) + SID_POWER_MARGIN_US;
+}
+
+enum sid_power_state sid_power_choose(uint32_t busy_us, uint32_t idle_us, bool deep)
+{
+  uint32_t reserve = sid_power_reserve();
+  uint32_t predicted;
+
+  busy_history[busy_pos++ % SID_POWER_HISTORY] = busy_us;
+  predicted = ring_max(busy_history);
+
+  stats.frames++;
+  stats.busy_us += busy_us;
+  if (busy_us > stats.busy_max_us) {
+    stats.busy_max_us = busy_us;
+  }
+  stats.predicted_us = predicted;
+  stats.reserve_us = reserve;
+
+  if (deep && idle_us >= reserve + SID_POWER_DEEP_MIN_US && predicted + reserve <= period)
+    return SID_POWER_DEEP;
+
+  if (idle_us >= SID_POWER_SLEEP_MIN_US)
+    return SID_POWER_SLEEP;
+
+  return SID_POWER_POLL;
+}
+
+void sid_power_woke(uint32_t late_us)
+{
+  late_history[late_pos++ % SID_POWER_HISTORY] = late_us;
+  late_seen = true;
+
+  if (late_us > stats.reserve_us) {
+    stats.late_wakes++;
+  }
+}
+
+void sid_power_started(enum sid_power_state state, uint32_t idle_us, uint32_t latency_us)
+{
+  stats.entries[state]++;
+  stats.idle_us[state] += idle_us;
+  stats.latency_sum_us[state] += latency_us;
+  if (latency_us > stats.latency_max_us[state]) {
+    stats.latency_max_us[state] = latency_us;
+  }
+}
+
+const char* sid_power_state_name(enum sid_power_state state)
+{
+  return state < SID_POWER_NUM_STATES ? state_names[state] : "?";
+}
+
+uint32_t sid_power_mean_ua(const struct sid_power_stats* s)
+{
+  static const uint32_t idle_ua[SID_POWER_NUM_STATES] = {
+    SID_POWER_RUN_UA, SID_POWER_SLEEP_UA, SID_POWER_DEEP_UA,
+  };
+  uint64_t total_us = s->busy_us;
+  uint64_t charge = s->busy_us * SID_POWER_RUN_UA;
+
+  for (int i = 0; i < SID_POWER_NUM_STATES; i++) {
+    total_us += s->idle_us[i];
+    charge += s->idle_us[i] * idle_ua[i];
+  }
+
+  return total_us ? charge / total_us : SID_POWER_RUN_UA;
+}
+
+void sid_power_get_stats(struct sid_power_stats* s)
+{
+  *s = stats;
+}
+
+void sid_power_reset_stats(void)
+{
+  memset(&stats, 0, sizeof(stats));
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef SID_POWER_H
+#define SID_POWER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Picks how the player waits for its next frame. Polling the timer starts
+ * the frame the soonest, sleeping stops the core until the timer interrupt,
+ * deep sleep also powers the flash down and has to wake up a reserve ahead
+ * of the frame, followed by a normal sleep up to the frame itself.
+ *
+ * The reserve is the latest deep wake up seen in the last frames plus a
+ * margin. Deep sleep is only taken when the idle time is worth it and the
+ * slowest frame of the history still fits its period after a wake up as
+ * late as the reserve, so a late wake up never makes a frame miss its
+ * deadline.
+ */
+#define SID_POWER_DEFAULT_ENABLE    true
+
+#define SID_POWER_HISTORY           64      /* frames, power of two */
+#define SID_POWER_SLEEP_MIN_US      20      /* shorter waits poll */
+#define SID_POWER_DEEP_MIN_US       1000    /* idle time left after the reserve */
+#define SID_POWER_DEEP_RESERVE_US   300     /* before a wake up was seen */
+#define SID_POWER_MARGIN_US         100     /* kernel tick rounding included */
+
+/* Supply current per state, rough G474 figures at 170 MHz, measure the board */
+#define SID_POWER_RUN_UA            26000
+#define SID_POWER_SLEEP_UA          9000
+#define SID_POWER_DEEP_UA           6500
+
+enum sid_power_state
+{
+    SID_POWER_POLL,
+    SID_POWER_SLEEP,
+    SID_POWER_DEEP,
+    SID_POWER_NUM_STATES,
+};
+
+struct sid_power_stats
+{
+    uint32_t frames;
+    uint64_t busy_us;
+    uint32_t busy_max_us;
+    uint32_t predicted_us;      /* slowest frame of the history */
+    uint32_t reserve_us;        /* current deep sleep reserve */
+    uint32_t late_wakes;        /* deep wake ups later than their reserve */
+    uint32_t entries[SID_POWER_NUM_STATES];
+    uint64_t idle_us[SID_POWER_NUM_STATES];
+    uint64_t latency_sum_us[SID_POWER_NUM_STATES];  /* frame start after its time */
+    uint32_t latency_max_us[SID_POWER_NUM_STATES];
+};
+
+void sid_power_init(uint32_t period_us);
+void sid_power_set_period(uint32_t period_us);
+
+/* After the work of a frame, deep is false while it would disturb a device */
+enum sid_power_state sid_power_choose(uint32_t busy_us, uint32_t idle_us, bool deep);
+uint32_t sid_power_reserve(void);
+
+/* How late the deep wake up came, and how late the frame started */
+void sid_power_woke(uint32_t late_us);
+void sid_power_started(enum sid_power_state state, uint32_t idle_us, uint32_t latency_us);
+
+const char* sid_power_state_name(enum sid_power_state state);
+
+/* Estimated mean supply current, SID_POWER_RUN_UA when the core never sleeps */
+uint32_t sid_power_mean_ua(const struct sid_power_stats* stats);
+
+void sid_power_get_stats(struct sid_power_stats* stats);
+void sid_power_reset_stats(void);
+
+/* Flash power down for deep sleep, provided by the board */
+void sid_power_deep_enter(void);
+void sid_power_deep_exit(void);
+
+#endif /* SID_POWER_H */
@@ -0,0 +1,26 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Deep sleep hooks for the G474. The Stop modes would save more, but they
+ * stop SysTick, TIM2 and the SPI and LPUART1 clocks, the kernel would lose
+ * time and an upload its bytes. Deep sleep is the sleep mode with the flash
+ * powered down instead, every clock keeps running and the wake up only
+ * waits for the flash.
+ */
+
+#include "sid_power.h"
+
+#include <soc.h>
+#include <stm32g4xx_ll_system.h>
+
+void sid_power_deep_enter(void)
+{
+  LL_FLASH_EnableSleepPowerDown();
+}
+
+void sid_power_deep_exit(void)
+{
+  LL_FLASH_DisableSleepPowerDown();
+}
@@ -0,0 +1,419 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Host side of the SPI to SID bridge protocol, see sid_proto.h.
+ *
+ * In pipelined mode the host keeps a credit count of free FIFO entries on
+ * the bridge. Credits are refreshed from the status byte of the last frame
+ * of every transfer, the FIFO only drains in between so this never
+ * overestimates the free space. Only when the credits run out the host
+ * polls with NOP frames until the bridge has room again. Bursts can fill
+ * the FIFO faster than it drains, so with bursts enabled blocking mode is
+ * flow controlled the same way. A bridge that reports a full FIFO for
+ * SID_PROTO_MAX_POLLS polls, or a floating MISO reading 0xff, is not
+ * waited for any longer: the host drops to blocking mode without bursts,
+ * which needs no credits.
+ *
+ * Link training steps the SPI clock up from the slowest rate, at every rate
+ * random and fixed patterns are echoed by the bridge and the CRC over all
+ * bytes is compared. The fastest passing rate minus a margin is kept. With
+ * verification enabled every frame ends with a CRC check, repeated failures
+ * lower the clock one step.
+ *
+ * The player never reads the SID over the link, OSC3 and ENV3 come from the
+ * voice 3 model in sid_voice3.c.
+ */
+
+#include "sid_proto.h"
+#include "sid_spi.h"
+#include "sid_packet.h"
+
+#include <string.h>
+
+static enum sid_proto_mode mode;
+static bool burst;
+
+static uint8_t tx_buf[SID_PROTO_MAX_BYTES];
+static uint8_t rx_buf[SID_PROTO_MAX_BYTES];
+static uint8_t tx_len;
+
+/* Start and number of SID writes of every frame in tx_buf */
+static uint8_t frame_start[SID_PROTO_MAX_FRAMES];
+static uint8_t frame_writes[SID_PROTO_MAX_FRAMES];
+static uint8_t n_frames;
+
+static uint8_t credits;
+
+/* CRC-8 of the bytes sent since the last crc frame */
+static uint8_t tx_crc;
+static bool crc_ok;
+static bool verify;
+static uint8_t error_run;
+
+static struct sid_proto_stats stats;
+
+static void transfer(void)
+{
+  uint8_t status = 0;
+  uint8_t level;
+
+  sid_spi_transceive(tx_buf, rx_buf, tx_len);
+
+  stats.transfers++;
+  stats.bytes += tx_len;
+
+  for (uint8_t i = 0; i < n_frames; i++) {
+    uint8_t cmd = tx_buf[frame_start[i]];
+    uint8_t end = (i + 1 < n_frames) ? frame_start[i + 1] : tx_len;
+
+    status = rx_buf[frame_start[i]];
+
+    if (cmd == SID_PROTO_CMD_CRC) {
+      crc_ok = rx_buf[frame_start[i] + 1] == tx_crc;
+      tx_crc = 0;
+    } else {
+      tx_crc = sid_crc8(tx_crc, &tx_buf[frame_start[i]], end - frame_start[i]);
+    }
+
+    if (status & SID_PROTO_STATUS_OVERFLOW) {
+      stats.overflows++;
+    }
+
+    level = status & SID_PROTO_STATUS_LEVEL;
+    if (level > SID_PROTO_FIFO_DEPTH) {
+      stats.level_errors++;
+    } else if (level > stats.max_level) {
+      stats.max_level = level;
+    }
+  }
+
+  /*
+   * status is the level before the last frame, which may have added more. A
+   * level the FIFO cannot hold is a damaged status byte, assume it is full.
+   */
+  level = status & SID_PROTO_STATUS_LEVEL;
+  credits = level < SID_PROTO_FIFO_DEPTH ? SID_PROTO_FIFO_DEPTH - level : 0;
+  if (credits >= frame_writes[n_frames - 1]) {
+    credits -= frame_writes[n_frames - 1];
+  } else {
+    credits = 0;
+  }
+
+  tx_len = 0;
+  n_frames = 0;
+}
+
+/* Make room for a frame of len bytes carrying the given number of writes */
+static uint8_t* frame_begin(uint8_t len, uint8_t writes)
+{
+  uint8_t* frame;
+  uint16_t polls = 0;
+
+  if (mode == SID_PROTO_MODE_PIPELINED || burst) {
+    if (n_frames == SID_PROTO_MAX_FRAMES || tx_len + len > SID_PROTO_MAX_BYTES ||
+        credits < writes) {
+      sid_proto_flush();
+    }
+
+    while (credits < writes) {
+      if (polls++ == SID_PROTO_MAX_POLLS) {
+        stats.timeouts++;
+        mode = SID_PROTO_MODE_BLOCKING;
+        burst = false;
+        credits = SID_PROTO_FIFO_DEPTH;
+        break;
+      }
+
+      tx_buf[0] = SID_PROTO_CMD_NOP;
+      tx_buf[1] = 0;
+      tx_len = 2;
+      frame_start[0] = 0;
+      frame_writes[0] = 0;
+      n_frames = 1;
+      transfer();
+      stats.stalls++;
+    }
+  }
+
+  frame = &tx_buf[tx_len];
+
+  frame_start[n_frames] = tx_len;
+  frame_writes[n_frames] = writes;
+  n_frames++;
+  tx_len += len;
+
+  credits = credits > writes ? credits - writes : 0;
+
+  return frame;
+}
+
+static void frame_end(void)
+{
+  if (mode == SID_PROTO_MODE_BLOCKING) {
+    sid_proto_flush();
+  }
+}
+
+void sid_proto_init(enum sid_proto_mode new_mode, bool new_burst)
+{
+  mode = new_mode;
+  burst = new_burst;
+  tx_len = 0;
+  n_frames = 0;
+  credits = SID_PROTO_FIFO_DEPTH;
+  tx_crc = 0;
+  verify = false;
+  error_run = 0;
+  memset(&stats, 0, sizeof(stats));
+  stats.rate = sid_spi_get_frequency();
+}
+
+void sid_proto_set_mode(enum sid_proto_mode new_mode, bool new_burst)
+{
+  sid_proto_flush();
+
+  mode = new_mode;
+  burst = new_burst;
+  credits = SID_PROTO_FIFO_DEPTH;
+}
+
+enum sid_proto_mode sid_proto_get_mode(void)
+{
+  return mode;
+}
+
+bool sid_proto_has_burst(void)
+{
+  return burst;
+}
+
+void sid_proto_write(uint8_t reg, uint8_t val)
+{
+  uint8_t* frame = frame_begin(2, 1);
+
+  frame[0] = SID_PROTO_CMD_WRITE | (reg & SID_PROTO_REG_MASK);
+  frame[1] = val;
+
+  stats.writes++;
+
+  frame_end();
+}
+
+void sid_proto_write_burst(uint8_t reg, uint8_t count, const uint8_t* vals)
+{
+  uint8_t* frame = frame_begin(2 + count, count);
+
+  frame[0] = SID_PROTO_CMD_BURST | (reg & SID_PROTO_REG_MASK);
+  frame[1] = count;
+  memcpy(&frame[2], vals, count);
+
+  stats.writes += count;
+  stats.bursts++;
+
+  frame_end();
+}
+
+void sid_proto_write_masked(uint32_t mask, const uint8_t* regs)
+{
+  uint8_t count = 0;
+  uint8_t* frame;
+
+  for (uint32_t m = mask; m; m &= m - 1) {
+    count++;
+  }
+
+  frame = frame_begin(5 + count, count);
+
+  frame[0] = SID_PROTO_CMD_MASKED;
+  frame[1] = mask;
+  frame[2] = mask >> 8;
+  frame[3] = mask >> 16;
+  frame[4] = mask >> 24;
+
+  frame += 5;
+  for (uint8_t reg = 0; mask; reg++, mask >>= 1) {
+    if (mask & 1) {
+      *frame++ = regs[reg];
+    }
+  }
+
+  stats.writes += count;
+  stats.bursts++;
+
+  frame_end();
+}
+
+void sid_proto_flush(void)
+{
+  if (n_frames) {
+    transfer();
+  }
+}
+
+static bool crc_frame(void)
+{
+  uint8_t* frame;
+
+  sid_proto_flush();
+
+  frame = frame_begin(2, 0);
+  frame[0] = SID_PROTO_CMD_CRC;
+  frame[1] = 0;
+  crc_ok = false;
+
+  sid_proto_flush();
+
+  return crc_ok;
+}
+
+static bool link_test(void)
+{
+  uint8_t pattern[24] = {
+    0x55, 0xaa, 0x00, 0xff, 0x0f, 0xf0, 0x33, 0xcc,
+    0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80,
+    0xfe, 0xfd, 0xfb, 0xf7, 0xef, 0xdf, 0xbf, 0x7f,
+  };
+  uint32_t seed = 0x1234567;
+
+  for (int round = 0; round < SID_PROTO_TRAIN_ROUNDS; round++) {
+    uint8_t* frame;
+
+    if (round) {
+      for (uint8_t i = 0; i < sizeof(pattern); i++) {
+        seed = seed * 1103515245 + 12345;
+        pattern[i] = seed >> 16;
+      }
+    }
+
+    sid_proto_flush();
+
+    frame = frame_begin(sizeof(pattern) + 3, 0);
+    frame[0] = SID_PROTO_CMD_ECHO;
+    frame[1] = sizeof(pattern);
+    memcpy(&frame[2], pattern, sizeof(pattern));
+    frame[2 + sizeof(pattern)] = 0;
+
+    sid_proto_flush();
+
+    if (memcmp(&rx_buf[3], pattern, sizeof(pattern)) || !crc_frame()) {
+      stats.echo_errors++;
+      return false;
+    }
+  }
+
+  return true;
+}
+
+uint32_t sid_proto_train(void)
+{
+  uint32_t rates[SID_PROTO_MAX_RATES];
+  uint32_t prev = sid_spi_get_frequency();
+  int n = sid_spi_get_rates(rates, SID_PROTO_MAX_RATES);
+  int best = -1;
+
+  if (n <= 0)
+    return 0;
+
+  /*
+   * The bridge keeps its CRC across a reset of the MCU, start both sides
+   * from zero at the slowest rate so the first round compares fresh bytes.
+   */
+  sid_spi_set_frequency(rates[n - 1]);
+  crc_frame();
+
+  /* Rates are listed fastest first, step up from the slowest one */
+  for (int i = n - 1; i >= 0; i--) {
+    sid_spi_set_frequency(rates[i]);
+
+    if (!link_test())
+      break;
+
+    best = i;
+  }
+
+  if (best < 0) {
+    sid_spi_set_frequency(prev);
+    stats.rate = prev;
+
+    /* The bridge still holds the CRC of the failed test */
+    crc_frame();
+    return 0;
+  }
+
+  if (best + SID_PROTO_TRAIN_MARGIN < n) {
+    best += SID_PROTO_TRAIN_MARGIN;
+  } else {
+    best = n - 1;
+  }
+
+  sid_spi_set_frequency(rates[best]);
+
+  /* Resynchronise the CRC after the failed rate */
+  crc_frame();
+
+  stats.rate = rates[best];
+
+  return stats.rate;
+}
+
+void sid_proto_set_verify(bool new_verify)
+{
+  verify = new_verify;
+  error_run = 0;
+
+  if (verify) {
+    crc_frame();
+  }
+}
+
+bool sid_proto_get_verify(void)
+{
+  return verify;
+}
+
+bool sid_proto_check(void)
+{
+  uint32_t rates[SID_PROTO_MAX_RATES];
+  int n;
+
+  stats.checks++;
+
+  if (crc_frame()) {
+    error_run = 0;
+    return true;
+  }
+
+  stats.crc_errors++;
+
+  if (++error_run < SID_PROTO_FALLBACK_ERRORS)
+    return false;
+
+  error_run = 0;
+
+  n = sid_spi_get_rates(rates, SID_PROTO_MAX_RATES);
+  for (int i = 0; i + 1 < n; i++) {
+    if (rates[i] <= sid_spi_get_frequency()) {
+      sid_spi_set_frequency(rates[i + 1]);
+      stats.rate = rates[i + 1];
+      stats.fallbacks++;
+      break;
+    }
+  }
+
+  crc_frame();
+
+  return false;
+}
+
+void sid_proto_get_stats(struct sid_proto_stats* s)
+{
+  *s = stats;
+}
+
+void sid_proto_reset_stats(void)
+{
+  memset(&stats, 0, sizeof(stats));
+  stats.rate = sid_spi_get_frequency();
+}
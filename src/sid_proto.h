@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef SID_PROTO_H
+#define SID_PROTO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Every frame on the bridge is two bytes, while the host shifts out the
+ * command and data the bridge shifts back a status byte and read data.
+ *
+ *   write:  SID_PROTO_CMD_WRITE | reg, value
+ *   read:   SID_PROTO_CMD_READ  | reg, don't care
+ *   nop:    SID_PROTO_CMD_NOP,         don't care
+ *
+ * Bridges with burst support also take frames that write several registers:
+ *
+ *   burst:  SID_PROTO_CMD_BURST | reg, count, count values for reg onwards
+ *   masked: SID_PROTO_CMD_MASKED, 32 bit register mask (LSB first),
+ *           one value for every set bit in register order
+ *
+ * The first byte returned with any frame is the status byte and the second
+ * the read data, the remaining bytes of a burst return the status again.
+ *
+ * Two link test frames return their own data instead of read data, they
+ * leave a pending read result for the next frame:
+ *
+ *   echo:   SID_PROTO_CMD_ECHO, count, count bytes, one pad byte
+ *           every byte is returned one byte later
+ *   crc:    SID_PROTO_CMD_CRC, don't care
+ *           returns the CRC-8 (poly 0x07) of all bytes received since the
+ *           previous crc frame, excluding crc frames
+ *
+ * In blocking mode every frame has its own chip select. In pipelined mode
+ * frames are streamed back to back within one chip select, the bridge
+ * queues writes in a FIFO towards the SID. The status byte returned with a
+ * frame holds the FIFO level before that frame, the read data returned with
+ * a frame is the result of the read in the frame before it.
+ */
+#define SID_PROTO_CMD_READ          0x00
+#define SID_PROTO_CMD_NOP           0x40
+#define SID_PROTO_CMD_ECHO          0x41
+#define SID_PROTO_CMD_CRC           0x42
+#define SID_PROTO_CMD_WRITE         0x80
+#define SID_PROTO_CMD_BURST         0xa0
+#define SID_PROTO_CMD_MASKED        0xc0
+#define SID_PROTO_REG_MASK          0x1f
+
+#define SID_PROTO_STATUS_LEVEL      0x1f
+#define SID_PROTO_STATUS_OVERFLOW   0x40
+#define SID_PROTO_STATUS_RD_VALID   0x80
+
+#define SID_PROTO_FIFO_DEPTH        16
+
+/* Frames collected before a pipelined transfer is started */
+#define SID_PROTO_MAX_FRAMES        32
+#define SID_PROTO_MAX_BYTES         64
+
+/* A burst must fit in the FIFO to be flow controlled */
+#define SID_PROTO_MAX_BURST         SID_PROTO_FIFO_DEPTH
+
+enum sid_proto_mode
+{
+    SID_PROTO_MODE_BLOCKING,
+    SID_PROTO_MODE_PIPELINED,
+};
+
+/* Link training, rates that pass get SID_PROTO_TRAIN_MARGIN steps slack */
+#define SID_PROTO_TRAIN_ROUNDS      16
+#define SID_PROTO_TRAIN_MARGIN      1
+#define SID_PROTO_MAX_RATES         8
+
+/*
+ * NOP polls for FIFO space before the bridge counts as not answering. A
+ * poll takes at least the chip select overhead, with the FIFO draining one
+ * write per microsecond a full FIFO empties within 16 of them.
+ */
+#define SID_PROTO_MAX_POLLS         256
+
+/* Failed frame checks in a row before the clock is lowered one step */
+#define SID_PROTO_FALLBACK_ERRORS   2
+
+/* Pipelined mode and bursts need a bridge that understands them */
+#define SID_PROTO_DEFAULT_MODE      SID_PROTO_MODE_BLOCKING
+#define SID_PROTO_DEFAULT_BURST     false
+#define SID_PROTO_DEFAULT_TRAIN     false
+#define SID_PROTO_DEFAULT_VERIFY    false
+
+struct sid_proto_stats
+{
+    uint32_t transfers;     /* chip select assertions */
+    uint32_t bytes;
+    uint32_t writes;        /* SID registers written */
+    uint32_t bursts;        /* burst and masked frames */
+    uint32_t stalls;        /* status polls while the FIFO was full */
+    uint32_t timeouts;      /* polls given up, back to blocking mode */
+    uint32_t overflows;     /* FIFO overflows reported by the bridge */
+    uint32_t level_errors;  /* status levels above the FIFO depth, link errors */
+    uint32_t checks;        /* frame CRC checks */
+    uint32_t crc_errors;
+    uint32_t echo_errors;   /* failed link training rounds */
+    uint32_t fallbacks;     /* clock steps down after CRC errors */
+    uint32_t rate;          /* negotiated SPI clock */
+    uint8_t  max_level;
+};
+
+void sid_proto_init(enum sid_proto_mode mode, bool burst);
+
+/* Switches modes without touching the stats, pending frames are sent first */
+void sid_proto_set_mode(enum sid_proto_mode mode, bool burst);
+enum sid_proto_mode sid_proto_get_mode(void);
+bool sid_proto_has_burst(void);
+
+void sid_proto_write(uint8_t reg, uint8_t val);
+void sid_proto_write_burst(uint8_t reg, uint8_t count, const uint8_t* vals);
+void sid_proto_write_masked(uint32_t mask, const uint8_t* regs);
+void sid_proto_flush(void);
+
+/* Returns the selected clock, 0 when no rate passed and nothing changed */
+uint32_t sid_proto_train(void);
+void sid_proto_set_verify(bool verify);
+bool sid_proto_get_verify(void);
+
+/* Compare the CRC of everything sent since the last check with the bridge */
+bool sid_proto_check(void);
+
+void sid_proto_get_stats(struct sid_proto_stats* stats);
+void sid_proto_reset_stats(void);
+
+#endif /* SID_PROTO_H */
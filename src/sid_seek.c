@@ -0,0 +1,274 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Fast seeking within a tune.
+ *
+ * Between two play calls the whole machine state is the C64 memory plus the
+ * SID registers and the voice 3 model, the CPU registers are reset by every
+ * c64_cpu_jsr(). A checkpoint therefore only stores the SID shadow registers,
+ * the voice 3 model and the pages the CPU wrote since the image was loaded,
+ * everything else is restored by reloading the image. Checkpoints are taken every SID_SEEK_INTERVAL frames,
+ * when the pool runs out every other checkpoint is dropped and the interval
+ * doubles, so a whole song always fits.
+ *
+ * A seek restores the nearest checkpoint before the target and then runs the
+ * play routine at full speed with the SID muted, only the final register
+ * state is sent to the chip. Voice 3 still moves on a whole frame per play
+ * call, so OSC3 and ENV3 read the same as in uninterrupted playback.
+ *
+ * Without a checkpoint at or before the target, when not even the one of
+ * frame 0 fitted in the pool, a seek back reloads the image and reruns init
+ * instead. The registers and voice 3 then get the state they had right after
+ * the first init, a tune seeding itself from OSC3 during init can still come
+ * out differently.
+ */
+
+#include "sid_seek.h"
+#include "sid_clock.h"
+#include "sid_voice3.h"
+#include "c64.h"
+
+#include <string.h>
+
+#ifdef __ZEPHYR__
+#include <zephyr.h>
+
+static uint32_t seek_time_us(void)
+{
+  return k_cyc_to_us_floor32(k_cycle_get_32());
+}
+#else
+#include <time.h>
+
+static uint32_t seek_time_us(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (uint32_t)(ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000);
+}
+#endif
+
+struct checkpoint
+{
+  uint32_t frame;
+  uint32_t dirty[8];
+  uint16_t offset;
+  uint16_t size;
+  uint8_t  regs[SID_NUM_REGS];
+  uint8_t  voice3[SID_VOICE3_STATE_SIZE];
+};
+
+static const uint8_t* seek_data;
+static size_t seek_size;
+static uint16_t seek_play_addr;
+static uint8_t seek_song;
+
+static uint8_t start_regs[SID_NUM_REGS];
+static uint8_t start_voice3[SID_VOICE3_STATE_SIZE];
+
+static uint32_t frame;
+static uint32_t interval;
+
+static struct checkpoint checkpoints[SID_SEEK_MAX_CHECKPOINTS];
+static uint8_t n_checkpoints;
+
+static uint8_t pool[SID_SEEK_POOL_SIZE];
+static uint16_t pool_used;
+
+static struct sid_seek_stats stats;
+
+static bool checkpoint_record(void)
+{
+  struct checkpoint* cp;
+  uint32_t dirty[8];
+  uint32_t size = 0;
+
+  c64_get_dirty(dirty);
+
+  for (int page = 0; page < 256; page++) {
+    if (dirty[page >> 5] & (1U << (page & 31))) {
+      size += 256;
+    }
+  }
+
+  if (n_checkpoints == SID_SEEK_MAX_CHECKPOINTS ||
+      pool_used + size > SID_SEEK_POOL_SIZE) {
+    return false;
+  }
+
+  cp = &checkpoints[n_checkpoints++];
+  cp->frame = frame;
+  cp->offset = pool_used;
+  cp->size = size;
+  memcpy(cp->dirty, dirty, sizeof(dirty));
+  sid_get_regs(cp->regs);
+  sid_voice3_save(cp->voice3);
+
+  for (int page = 0; page < 256; page++) {
+    if (dirty[page >> 5] & (1U << (page & 31))) {
+      c64_memread(&pool[pool_used], page << 8, 256);
+      pool_used += 256;
+    }
+  }
+
+  return true;
+}
+
+static void checkpoint_restore(const struct checkpoint* cp)
+{
+  uint16_t offset = cp->offset;
+
+  sid_load_payload(seek_data, seek_size);
+
+  for (int page = 0; page < 256; page++) {
+    if (cp->dirty[page >> 5] & (1U << (page & 31))) {
+      c64_memcpy(page << 8, &pool[offset], 256);
+      offset += 256;
+    }
+  }
+
+  c64_set_dirty(cp->dirty);
+  sid_set_regs(cp->regs);
+  sid_voice3_load(cp->voice3);
+  frame = cp->frame;
+}
+
+/* Back to frame 0 the way the tune was started, for want of a checkpoint */
+static void seek_restart(void)
+{
+  static const uint32_t clean[8];
+  struct sid_info info;
+
+  c64_set_dirty(clean);
+  if (!sid_load_from_memory(seek_data, seek_size, &info))
+    return;
+
+  c64_cpu_jsr(info.init_addr, seek_song);
+
+  sid_set_regs(start_regs);
+  sid_voice3_load(start_voice3);
+  frame = 0;
+}
+
+/* Drop every other checkpoint (keeping the first) and compact the pool */
+static void checkpoint_thin(void)
+{
+  uint8_t n = 0;
+
+  pool_used = 0;
+
+  for (int i = 0; i < n_checkpoints; i += 2) {
+    struct checkpoint cp = checkpoints[i];
+
+    memmove(&pool[pool_used], &pool[cp.offset], cp.size);
+    cp.offset = pool_used;
+    pool_used += cp.size;
+
+    checkpoints[n++] = cp;
+  }
+
+  n_checkpoints = n;
+  interval *= 2;
+}
+
+static void seek_advance(void)
+{
+  frame++;
+
+  if (frame % interval)
+    return;
+
+  if (n_checkpoints && checkpoints[n_checkpoints - 1].frame >= frame)
+    return;
+
+  if (!checkpoint_record()) {
+    checkpoint_thin();
+
+    if ((frame % interval) == 0) {
+      checkpoint_record();
+    }
+  }
+}
+
+void sid_seek_init(const uint8_t* data, size_t size, const struct sid_info* info,
+                   uint8_t song)
+{
+  seek_data = data;
+  seek_size = size;
+  seek_play_addr = info->play_addr;
+  seek_song = song;
+
+  sid_get_regs(start_regs);
+  sid_voice3_save(start_voice3);
+
+  frame = 0;
+  interval = SID_SEEK_INTERVAL;
+  n_checkpoints = 0;
+  pool_used = 0;
+  memset(&stats, 0, sizeof(stats));
+
+  /* Frame 0 is the state right after init, seeks never need to rerun it */
+  checkpoint_record();
+}
+
+void sid_seek_frame(void)
+{
+  seek_advance();
+}
+
+uint32_t sid_seek_position(void)
+{
+  return frame;
+}
+
+void sid_seek_to(uint32_t target)
+{
+  const struct checkpoint* cp = NULL;
+  uint32_t start = seek_time_us();
+
+  for (int i = 0; i < n_checkpoints && checkpoints[i].frame <= target; i++) {
+    cp = &checkpoints[i];
+  }
+
+  sid_mute(true);
+
+  /* Running on from the current position beats any older checkpoint */
+  if (cp && (target < frame || cp->frame > frame)) {
+    checkpoint_restore(cp);
+  } else if (!cp && target < frame) {
+    seek_restart();
+  }
+
+  stats.from_frame = frame;
+
+  while (frame < target) {
+    c64_cpu_jsr(seek_play_addr, 0);
+    sid_voice3_end_frame();
+    seek_advance();
+  }
+
+  sid_mute(false);
+  sid_flush_regs();
+
+  stats.to_frame = frame;
+  stats.time_us = seek_time_us() - start;
+
+  if (frame > stats.from_frame) {
+    stats.us_per_minute = (uint32_t)((uint64_t)stats.time_us *
+      (60 * sid_clock_frames_per_second(sid_clock_get())) / (frame - stats.from_frame));
+  } else {
+    stats.us_per_minute = 0;
+  }
+}
+
+void sid_seek_get_stats(struct sid_seek_stats* s)
+{
+  *s = stats;
+  s->interval = interval;
+  s->checkpoints = n_checkpoints;
+  s->pool_used = pool_used;
+}
@@ -0,0 +1,42 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef SID_SEEK_H
+#define SID_SEEK_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "sid.h"
+
+#define SID_SEEK_FRAMES_PER_SECOND  50
+
+/* Bytes reserved for checkpoint page copies */
+#define SID_SEEK_POOL_SIZE          (6 * 1024)
+#define SID_SEEK_MAX_CHECKPOINTS    16
+
+/* Initial checkpoint distance, doubled each time the pool fills up */
+#define SID_SEEK_INTERVAL           (10 * SID_SEEK_FRAMES_PER_SECOND)
+
+struct sid_seek_stats
+{
+    uint32_t from_frame;    /* frame the last seek restored from */
+    uint32_t to_frame;
+    uint32_t time_us;       /* wall time of the last seek */
+    uint32_t us_per_minute; /* last seek cost per emulated minute */
+    uint32_t interval;      /* current checkpoint distance in frames */
+    uint8_t  checkpoints;
+    uint16_t pool_used;
+};
+
+void sid_seek_init(const uint8_t* data, size_t size, const struct sid_info* info,
+                   uint8_t song);
+void sid_seek_frame(void);
+uint32_t sid_seek_position(void);
+void sid_seek_to(uint32_t frame);
+void sid_seek_get_stats(struct sid_seek_stats* stats);
+
+#endif /* SID_SEEK_H */
@@ -0,0 +1,500 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Player commands for the Zephyr shell, see sid_shell.h.
+ *
+ * The handlers only check their arguments against the tunes in flash and the
+ * published status, which they may read from the shell thread, and queue a
+ * request. Anything that changes C64 memory or the SID happens in the player
+ * thread between two frames, so a command costs the playback no more than a
+ * playlist switch.
+ *
+ * "sid busy" keeps the shell thread spinning, the frames played meanwhile
+ * are counted apart to show that the shell does not disturb the playback.
+ */
+
+#include "sid_shell.h"
+#include "sid.h"
+#include "sid_file.h"
+#include "sid_stream.h"
+#include "sid_clock.h"
+#include "c64_scan.h"
+#include "c64_aot.h"
+
+#include <zephyr.h>
+#include <shell/shell.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_BUSY_MS     10000
+
+K_MSGQ_DEFINE(requests, sizeof(struct sid_shell_request), SID_SHELL_QUEUE_SIZE, 4);
+
+static struct k_spinlock lock;
+static struct sid_shell_status published;
+static atomic_t busy;
+
+bool sid_shell_get_request(struct sid_shell_request* req)
+{
+  return k_msgq_get(&requests, req, K_NO_WAIT) == 0;
+}
+
+void sid_shell_publish(const struct sid_shell_status* status)
+{
+  k_spinlock_key_t key = k_spin_lock(&lock);
+
+  published = *status;
+  k_spin_unlock(&lock, key);
+}
+
+bool sid_shell_busy(void)
+{
+  return atomic_get(&busy) != 0;
+}
+
+static void get_status(struct sid_shell_status* status)
+{
+  k_spinlock_key_t key = k_spin_lock(&lock);
+
+  *status = published;
+  k_spin_unlock(&lock, key);
+}
+
+static int submit(const struct shell* shell, enum sid_shell_cmd cmd, uint32_t arg, uint32_t arg2)
+{
+  struct sid_shell_request req = { .cmd = cmd, .arg = arg, .arg2 = arg2 };
+
+  if (k_msgq_put(&requests, &req, K_NO_WAIT) != 0) {
+    shell_error(shell, "the player is busy, try again");
+    return -EBUSY;
+  }
+
+  return 0;
+}
+
+static bool parse_number(const struct shell* shell, const char* arg, uint32_t min,
+                         uint32_t max, uint32_t* value)
+{
+  char* end;
+  unsigned long v = strtoul(arg, &end, 0);
+
+  if (*arg == '\0' || *end != '\0' || v < min || v > max) {
+    shell_error(shell, "%s is not a number from %u to %u", arg, min, max);
+    return false;
+  }
+
+  *value = v;
+
+  return true;
+}
+
+static int cmd_list(const struct shell* shell, size_t argc, char** argv)
+{
+  struct sid_shell_status status;
+
+  get_status(&status);
+
+  for (uint8_t i = 0; i < sid_num_files; i++) {
+    const struct sid_file_entry* f = &sid_files[i];
+    char mark = i == status.tune ? '*' : ' ';
+    struct sid_info info;
+
+    if (sid_stream_is(f->data, f->size)) {
+      shell_print(shell, "%c%u: register stream, %u bytes", mark, i + 1, f->size);
+    } else if (sid_parse_header(f->data, f->size, &info)) {
+      shell_print(shell, "%c%u: %s by %s, %u songs, %u bytes%s", mark, i + 1,
+                  info.title, info.author, info.subsongs + 1, f->size,
+                  sid_is_packed(f->data, f->size) ? " packed" :
+                  sid_is_chunked(f->data, f->size) ? " chunked" : "");
+    } else {
+      shell_print(shell, "%c%u: not a SID file", mark, i + 1);
+    }
+  }
+
+  return 0;
+}
+
+static int cmd_load(const struct shell* shell, size_t argc, char** argv)
+{
+  const struct sid_file_entry* f;
+  struct sid_info info;
+  uint32_t tune;
+  uint32_t song = 0;
+
+  if (!parse_number(shell, argv[1], 1, sid_num_files, &tune))
+    return -EINVAL;
+  f = &sid_files[tune - 1];
+
+  if (sid_stream_is(f->data, f->size)) {
+    if (argc > 2) {
+      shell_error(shell, "a register stream has no songs");
+      return -EINVAL;
+    }
+  } else if (!sid_parse_header(f->data, f->size, &info)) {
+    shell_error(shell, "tune %u is not a SID file", tune);
+    return -EINVAL;
+  } else if (argc > 2) {
+    if (!parse_number(shell, argv[2], 1, info.subsongs + 1, &song))
+      return -EINVAL;
+    song--;
+  } else {
+    song = info.start_song;
+  }
+
+  return submit(shell, SID_SHELL_LOAD, tune - 1, song);
+}
+
+static int cmd_song(const struct shell* shell, size_t argc, char** argv)
+{
+  struct sid_shell_status status;
+  uint32_t song;
+
+  get_status(&status);
+
+  if (status.tune == SID_SHELL_UPLOAD) {
+    shell_error(shell, "an uploaded tune can only be restarted by a new upload");
+    return -EINVAL;
+  }
+
+  if (status.tune == SID_SHELL_LIVE) {
+    shell_error(shell, "the host picks the song of a live stream");
+    return -EINVAL;
+  }
+
+  if (!parse_number(shell, argv[1], 1, status.subsongs + 1, &song))
+    return -EINVAL;
+
+  return submit(shell, SID_SHELL_LOAD, status.tune, song - 1);
+}
+
+static int cmd_pause(const struct shell* shell, size_t argc, char** argv)
+{
+  return submit(shell, SID_SHELL_PAUSE, 0, 0);
+}
+
+static int cmd_resume(const struct shell* shell, size_t argc, char** argv)
+{
+  return submit(shell, SID_SHELL_RESUME, 0, 0);
+}
+
+static int cmd_seek(const struct shell* shell, size_t argc, char** argv)
+{
+  struct sid_shell_status status;
+  uint32_t seconds;
+
+  get_status(&status);
+
+  if (!status.seekable) {
+    shell_error(shell, "this tune can not seek");
+    return -EINVAL;
+  }
+
+  if (!parse_number(shell, argv[1], 0, 24 * 3600, &seconds))
+    return -EINVAL;
+
+  return submit(shell, SID_SHELL_SEEK, seconds * sid_clock_frames_per_second(status.clock), 0);
+}
+
+static int cmd_speed(const struct shell* shell, size_t argc, char** argv)
+{
+  uint32_t speed;
+
+  if (!parse_number(shell, argv[1], SID_SHELL_MIN_SPEED, SID_SHELL_MAX_SPEED, &speed))
+    return -EINVAL;
+
+  return submit(shell, SID_SHELL_SPEED, speed, 0);
+}
+
+static int cmd_status(const struct shell* shell, size_t argc, char** argv)
+{
+  struct sid_shell_status status;
+  uint32_t seconds;
+
+  get_status(&status);
+  seconds = status.position / sid_clock_frames_per_second(status.clock);
+
+  if (status.tune == SID_SHELL_UPLOAD) {
+    shell_print(shell, "uploaded tune");
+  } else if (status.tune == SID_SHELL_LIVE) {
+    shell_print(shell, "live stream from the host");
+  } else {
+    shell_print(shell, "tune %u song %u/%u", status.tune + 1, status.song + 1,
+                status.subsongs + 1);
+  }
+  shell_print(shell, "%s at %u:%02u, speed %u%%, %s clock",
+              status.paused ? "paused" : "playing", seconds / 60, seconds % 60,
+              status.speed, sid_clock_name(status.clock));
+
+  return 0;
+}
+
+static int cmd_stats(const struct shell* shell, size_t argc, char** argv)
+{
+  struct sid_shell_status s;
+  uint32_t frame_us;
+  uint32_t mean_us;
+
+  if (argc > 1) {
+    if (strcmp(argv[1], "reset") != 0) {
+      shell_error(shell, "unknown argument %s", argv[1]);
+      return -EINVAL;
+    }
+    return submit(shell, SID_SHELL_RESET_STATS, 0, 0);
+  }
+
+  get_status(&s);
+  frame_us = sid_clock_frame_us(s.clock) * 100 / MAX(s.speed, 1);
+  mean_us = s.frames ? s.play_sum_us / s.frames : 0;
+
+  shell_print(shell, "%u frames in %u s, %u overruns, start jitter max %u us",
+              s.frames, s.elapsed_ms / 1000, s.overruns, s.jitter_max_us);
+  shell_print(shell, "play mean %u us max %u us, %u%% of a frame at most",
+              mean_us, s.play_max_us, s.play_max_us * 100 / frame_us);
+  shell_print(shell, "%u.%u SID writes per frame, %u SPI bytes/s",
+              s.frames ? s.writes / s.frames : 0,
+              s.frames ? (uint32_t)((uint64_t)s.writes * 10 / s.frames % 10) : 0,
+              s.elapsed_ms ? (uint32_t)((uint64_t)s.spi_bytes * 1000 / s.elapsed_ms) : 0);
+  shell_print(shell, "play routine on the %s core, %u 6510 cycles per frame, %u ns per cycle",
+              c64_core_name(s.core), s.frames ? (uint32_t)(s.play_sum_cycles / s.frames) : 0,
+              s.play_sum_cycles ? (uint32_t)(s.play_sum_us * 1000 / s.play_sum_cycles) : 0);
+  shell_print(shell, "%u commands, %u frames with the shell busy: %u overruns,"
+              " start jitter max %u us", s.commands, s.busy_frames, s.busy_overruns,
+              s.busy_jitter_max_us);
+
+  return 0;
+}
+
+static int cmd_power(const struct shell* shell, size_t argc, char** argv)
+{
+  struct sid_shell_status s;
+  struct sid_power_stats* p = &s.power;
+  uint64_t total_us;
+  uint32_t duty;
+  uint32_t ua;
+
+  if (argc > 1) {
+    if (strcmp(argv[1], "on") != 0 && strcmp(argv[1], "off") != 0) {
+      shell_error(shell, "unknown argument %s", argv[1]);
+      return -EINVAL;
+    }
+    return submit(shell, SID_SHELL_POWER, strcmp(argv[1], "on") == 0, 0);
+  }
+
+  get_status(&s);
+  total_us = p->busy_us;
+  for (int i = 0; i < SID_POWER_NUM_STATES; i++) {
+    total_us += p->idle_us[i];
+  }
+  duty = total_us ? p->busy_us * 1000 / total_us : 1000;
+  ua = sid_power_mean_ua(p);
+
+  shell_print(shell, "power saving %s, busy %u.%u%% of the time",
+              s.power_saving ? "on" : "off", duty / 10, duty % 10);
+  shell_print(shell, "busy mean %u us max %u us, predicted %u us, reserve %u us,"
+              " %u late wake ups", p->frames ? (uint32_t)(p->busy_us / p->frames) : 0,
+              p->busy_max_us, p->predicted_us, p->reserve_us, p->late_wakes);
+  for (int i = 0; i < SID_POWER_NUM_STATES; i++) {
+    shell_print(shell, "%-5s %u frames, %u ms idle, start latency mean %u us max %u us",
+                sid_power_state_name(i), p->entries[i], (uint32_t)(p->idle_us[i] / 1000),
+                p->entries[i] ? (uint32_t)(p->latency_sum_us[i] / p->entries[i]) : 0,
+                p->latency_max_us[i]);
+  }
+  shell_print(shell, "about %u.%u mA, %u%% less than never sleeping",
+              ua / 1000, ua % 1000 / 100, (SID_POWER_RUN_UA - ua) * 100 / SID_POWER_RUN_UA);
+
+  return 0;
+}
+
+static int cmd_multi(const struct shell* shell, size_t argc, char** argv)
+{
+  struct sid_shell_status s;
+  uint32_t tunes = 0;
+  uint32_t load;
+
+  if (argc == 2 && strcmp(argv[1], "off") == 0)
+    return submit(shell, SID_SHELL_MULTI, 0, 0);
+
+  if (argc > 1) {
+    for (size_t i = 1; i < argc; i++) {
+      const struct sid_file_entry* f;
+      struct sid_info info;
+      uint32_t tune;
+
+      if (!parse_number(shell, argv[i], 1, sid_num_files, &tune))
+        return -EINVAL;
+
+      f = &sid_files[tune - 1];
+      if (!sid_parse_header(f->data, f->size, &info)) {
+        shell_error(shell, "tune %u is not a SID file", tune);
+        return -EINVAL;
+      }
+      tunes |= (tune - 1) << ((i - 1) * 8);
+    }
+    return submit(shell, SID_SHELL_MULTI, argc - 1, tunes);
+  }
+
+  get_status(&s);
+  if (!s.multi.players) {
+    shell_print(shell, "one tune plays, start several with multi <tune> <tune>...");
+    return 0;
+  }
+
+  for (uint8_t i = 0; i < s.multi.players; i++) {
+    struct sid_multi_player_stats* p = &s.multi.player[i];
+
+    if (!p->running) {
+      shell_print(shell, "bridge %u: tune %u stopped", i, s.multi_tunes[i] + 1);
+      continue;
+    }
+    shell_print(shell, "bridge %u: tune %u %s, %u frames, %u misses, %u overruns,"
+                " late max %u us, play mean %u us max %u us, %u pages, %u writes lost",
+                i, s.multi_tunes[i] + 1, sid_clock_name(p->clock), p->frames, p->misses,
+                p->overruns, p->late_max_us,
+                p->frames ? (uint32_t)(p->play_sum_us / p->frames) : 0, p->play_max_us,
+                p->pages, p->lost_writes);
+  }
+
+  load = s.multi.elapsed_us ? (uint32_t)(s.multi.busy_us * 1000 / s.multi.elapsed_us) : 0;
+  shell_print(shell, "load %u.%u%% mean, %u.%u%% peak", load / 10, load % 10,
+              s.multi.load_max / 10, s.multi.load_max % 10);
+
+  return 0;
+}
+
+static int cmd_live(const struct shell* shell, size_t argc, char** argv)
+{
+  struct sid_shell_status s;
+  struct sid_live_stats* l = &s.live;
+
+  get_status(&s);
+
+  if (!l->frames) {
+    shell_print(shell, "no live stream yet, send one with sidstream");
+    return 0;
+  }
+
+  shell_print(shell, "%s, buffer %u of %u frames, target %u, %u to %u while playing",
+              s.tune == SID_SHELL_LIVE ? "streaming" : "ended", l->fill, SID_LIVE_FRAMES,
+              l->target, l->fill_min == 0xff ? 0 : l->fill_min, l->fill_max);
+  shell_print(shell, "%u frames received, %u played, %u late, %u underruns, %u rebuffers,"
+              " %u overflows", l->frames, l->played, l->late, l->underruns, l->rebuffers,
+              l->overflows);
+  shell_print(shell, "%u link bytes/s, %u crc errors, %u packets lost",
+              s.elapsed_ms ? (uint32_t)((uint64_t)l->bytes * 1000 / s.elapsed_ms) : 0,
+              l->crc_errors, l->lost);
+
+  return 0;
+}
+
+static int cmd_upload(const struct shell* shell, size_t argc, char** argv)
+{
+  struct sid_shell_status s;
+  struct sid_upload_stats* u = &s.upload;
+
+  get_status(&s);
+
+  if (!u->packets) {
+    shell_print(shell, "no upload yet, send one with sidupload");
+    return 0;
+  }
+
+  if (!s.upload_ok) {
+    shell_print(shell, "last upload of %u bytes failed after %u ms", u->size, s.upload_ms);
+  } else {
+    shell_print(shell, "%u bytes in %u ms, %u bytes/s, first note after %u ms", u->size,
+                s.upload_ms, (uint32_t)((uint64_t)u->size * 1000 / MAX(s.upload_ms, 1)),
+                s.first_note_ms);
+  }
+  shell_print(shell, "all uploads: %u packets, %u crc errors, %u duplicates, %u rejected,"
+              " %u UART overruns",
+              u->packets, u->crc_errors, u->duplicates, u->rejects, s.uart_overruns);
+
+  return 0;
+}
+
+static int cmd_digi(const struct shell* shell, size_t argc, char** argv)
+{
+  struct sid_shell_status s;
+  struct sid_digi_stats* d = &s.digi;
+
+  get_status(&s);
+
+  if (!d->writes) {
+    shell_print(shell, "no digi writes since the last reset, registers %08x", d->regs);
+    return 0;
+  }
+
+  shell_print(shell, "registers %08x, %u writes queued, %u sent, %u dropped", d->regs,
+              d->writes, d->sent, d->dropped);
+  shell_print(shell, "%u later than %u us, mean %u us max %u us", d->late, SID_DIGI_LATE_US,
+              d->sent ? d->sum_us / d->sent : 0, d->max_us);
+  for (int i = 0; i < SID_DIGI_HIST_BUCKETS; i++) {
+    shell_print(shell, "%s%3u us late: %u", i + 1 == SID_DIGI_HIST_BUCKETS ? ">=" : "  ",
+                i ? 1U << (i - 1) : 0, d->hist[i]);
+  }
+
+  return 0;
+}
+
+static int cmd_aot(const struct shell* shell, size_t argc, char** argv)
+{
+  struct sid_shell_status s;
+
+  if (argc > 1) {
+    if (strcmp(argv[1], "on") != 0 && strcmp(argv[1], "off") != 0) {
+      shell_error(shell, "unknown argument %s", argv[1]);
+      return -EINVAL;
+    }
+    return submit(shell, SID_SHELL_AOT, strcmp(argv[1], "on") == 0, 0);
+  }
+
+  get_status(&s);
+  shell_print(shell, "%u translated routines, %s, the play routine runs on the %s core",
+              sid_aot_n_routines, s.aot ? "on" : "off", c64_core_name(s.core));
+
+  return 0;
+}
+
+static int cmd_busy(const struct shell* shell, size_t argc, char** argv)
+{
+  uint32_t ms;
+
+  if (!parse_number(shell, argv[1], 1, MAX_BUSY_MS, &ms))
+    return -EINVAL;
+
+  /* Spins at the shell's priority, the player preempts it every frame */
+  atomic_set(&busy, 1);
+  k_busy_wait(ms * 1000);
+  atomic_set(&busy, 0);
+
+  shell_print(shell, "done, see sid stats");
+
+  return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_sid,
+  SHELL_CMD(list, NULL, "List the tunes in flash", cmd_list),
+  SHELL_CMD_ARG(load, NULL, "Play a tune: load <tune> [song]", cmd_load, 2, 1),
+  SHELL_CMD_ARG(song, NULL, "Play another song of the tune: song <song>", cmd_song, 2, 0),
+  SHELL_CMD(pause, NULL, "Pause and silence the SID", cmd_pause),
+  SHELL_CMD(resume, NULL, "Continue after a pause", cmd_resume),
+  SHELL_CMD_ARG(seek, NULL, "Jump to a time: seek <seconds>", cmd_seek, 2, 0),
+  SHELL_CMD_ARG(speed, NULL, "Play faster or slower: speed <percent>", cmd_speed, 2, 0),
+  SHELL_CMD(status, NULL, "Show the tune and position", cmd_status),
+  SHELL_CMD_ARG(stats, NULL, "Show the playback counters: stats [reset]", cmd_stats, 1, 1),
+  SHELL_CMD_ARG(power, NULL, "Show the sleep states, turn saving on or off: power [on|off]",
+                cmd_power, 1, 1),
+  SHELL_CMD_ARG(multi, NULL, "Play a tune per bridge, show their deadlines and the load:"
+                " multi [<tune>... | off]", cmd_multi, 1, SID_MULTI_MAX_PLAYERS),
+  SHELL_CMD_ARG(aot, NULL, "Show or switch the routines translated ahead of time: aot [on|off]",
+                cmd_aot, 1, 1),
+  SHELL_CMD(live, NULL, "Show the jitter buffer of a live stream from the host", cmd_live),
+  SHELL_CMD(upload, NULL, "Show the throughput of the last upload from the host", cmd_upload),
+  SHELL_CMD(digi, NULL, "Show the timing of sample writes since the last stats reset", cmd_digi),
+  SHELL_CMD_ARG(busy, NULL, "Keep the shell thread busy: busy <ms>", cmd_busy, 2, 0),
+  SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(sid, &sub_sid, "SID player", NULL);
@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef SID_SHELL_H
+#define SID_SHELL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "sid_power.h"
+#include "sid_multi.h"
+#include "sid_live.h"
+#include "sid_digi.h"
+#include "sid_upload.h"
+
+/*
+ * Shell commands for the player, on RTT. The shell thread runs at the lowest
+ * application priority and never touches the player, it queues requests
+ * that the player takes between two frames and reads the status the player
+ * publishes after every frame.
+ */
+
+/* Requests waiting for the player, more are refused */
+#define SID_SHELL_QUEUE_SIZE    4
+
+#define SID_SHELL_MIN_SPEED     25
+#define SID_SHELL_MAX_SPEED     400
+
+/* Tune number while an uploaded tune plays, or frames from the host */
+#define SID_SHELL_UPLOAD        0xff
+#define SID_SHELL_LIVE          0xfe
+
+enum sid_shell_cmd
+{
+    SID_SHELL_LOAD,             /* tune, song */
+    SID_SHELL_PAUSE,
+    SID_SHELL_RESUME,
+    SID_SHELL_SEEK,             /* frame */
+    SID_SHELL_SPEED,            /* percent */
+    SID_SHELL_RESET_STATS,
+    SID_SHELL_POWER,            /* on */
+    SID_SHELL_MULTI,            /* players or 0 to stop, their tunes 8 bits each */
+    SID_SHELL_AOT,              /* on */
+};
+
+struct sid_shell_request
+{
+    enum sid_shell_cmd cmd;
+    uint32_t arg;
+    uint32_t arg2;
+};
+
+struct sid_shell_status
+{
+    uint8_t  tune;
+    uint8_t  song;              /* counts from 0 */
+    uint8_t  subsongs;          /* last song, like sid_info */
+    bool     paused;
+    bool     seekable;
+    bool     power_saving;
+    bool     aot;               /* translated routines are used where they fit */
+    uint8_t  core;              /* enum c64_core of the last play call */
+    uint8_t  clock;             /* enum sid_clock */
+    uint16_t speed;             /* percent */
+    uint32_t position;          /* frames into the tune */
+    uint8_t  multi_tunes[SID_MULTI_MAX_PLAYERS];
+
+    /* Uploads since power up, the times of the last one count from its first byte */
+    struct sid_upload_stats upload;
+    bool     upload_ok;
+    uint32_t upload_ms;         /* until the image was complete or given up */
+    uint32_t first_note_ms;     /* until init and the first play call ran */
+    uint32_t uart_overruns;
+
+    /* Since the last reset */
+    uint32_t elapsed_ms;
+    uint32_t frames;            /* played, pauses excluded */
+    uint32_t overruns;          /* timer periods missed */
+    uint32_t jitter_max_us;     /* worst deviation of a frame start */
+    uint32_t play_max_us;
+    uint64_t play_sum_us;
+    uint64_t play_sum_cycles;   /* 6510 cycles, to compare the cores */
+    uint32_t writes;            /* SID registers written */
+    uint32_t spi_bytes;
+    uint32_t commands;
+
+    /* Frames that started while the shell thread was kept busy */
+    uint32_t busy_frames;
+    uint32_t busy_overruns;
+    uint32_t busy_jitter_max_us;
+
+    struct sid_power_stats power;
+
+    /* While several tunes play at once, players is 0 otherwise */
+    struct sid_multi_stats multi;
+
+    /* Of the last live stream */
+    struct sid_live_stats live;
+
+    /* Timed writes of sample playback */
+    struct sid_digi_stats digi;
+};
+
+/* Called by the player between frames, never block */
+bool sid_shell_get_request(struct sid_shell_request* req);
+void sid_shell_publish(const struct sid_shell_status* status);
+bool sid_shell_busy(void);
+
+#endif /* SID_SHELL_H */
@@ -12,6 +12,7 @@
 #include <device.h>
 #include <drivers/spi.h>
 #include <soc.h>
+#include <stm32g4xx_ll_rcc.h>
 
 static const struct device *gpioa;
 static const struct device *gpiob;
@@ -19,9 +20,18 @@ static const struct device *gpioc;
 
 static const struct device *spi;
 
-static struct spi_config       spi_cfg;
+/*
+ * The driver only reconfigures the peripheral when it gets a different
+ * spi_config, so a clock change switches to the other one of the pair.
+ */
+static struct spi_config       spi_cfgs[2];
+static struct spi_config*      spi_cfg = &spi_cfgs[0];
 static struct spi_cs_control   spi_cs;
 
+/* PB6, PA9 and PC7, the driver takes the pin from spi_cs on every transfer */
+static const struct device**   cs_ports[SID_SPI_MAX_BRIDGES] = { &gpiob, &gpioa, &gpioc };
+static const uint8_t           cs_pins[SID_SPI_MAX_BRIDGES] = { 6, 9, 7 };
+
 void sid_spi_transfer( uint8_t cmd_addr, uint8_t wr_data,
                        uint8_t* status, uint8_t* rd_data)
 {
@@ -57,12 +67,82 @@ void sid_spi_transfer( uint8_t cmd_addr, uint8_t wr_data,
     .count = 1,
   };
 
-  res = spi_transceive(spi, &spi_cfg, &tx, &rx);
+  res = spi_transceive(spi, spi_cfg, &tx, &rx);
 
   *status = rd_buffer[0];
   *rd_data = rd_buffer[1];
 }
 
+void sid_spi_transceive(const uint8_t* tx, uint8_t* rx, size_t len)
+{
+  struct spi_buf wr_bufs[] = {
+    {
+      .buf = (uint8_t*)tx,
+      .len = len,
+    },
+  };
+
+  struct spi_buf rd_bufs[] = {
+    {
+      .buf = rx,
+      .len = len,
+    },
+  };
+
+  struct spi_buf_set tx_set = {
+    .buffers = wr_bufs,
+    .count = 1,
+  };
+
+  struct spi_buf_set rx_set = {
+    .buffers = rd_bufs,
+    .count = 1,
+  };
+
+  if (rx) {
+    spi_transceive(spi, spi_cfg, &tx_set, &rx_set);
+  } else {
+    spi_write(spi, spi_cfg, &tx_set);
+  }
+}
+
+int sid_spi_get_rates(uint32_t* rates, int max)
+{
+  LL_RCC_ClocksTypeDef clocks;
+  int n;
+
+  /* SPI1 runs from PCLK2 with a power of two prescaler from 2 to 256 */
+  LL_RCC_GetSystemClocksFreq(&clocks);
+
+  for (n = 0; n < max && n < 8; n++) {
+    rates[n] = clocks.PCLK2_Frequency >> (n + 1);
+  }
+
+  return n;
+}
+
+void sid_spi_set_frequency(uint32_t hz)
+{
+  struct spi_config* next = (spi_cfg == &spi_cfgs[0]) ? &spi_cfgs[1] : &spi_cfgs[0];
+
+  *next = *spi_cfg;
+  next->frequency = hz;
+  spi_cfg = next;
+}
+
+uint32_t sid_spi_get_frequency(void)
+{
+  return spi_cfg->frequency;
+}
+
+void sid_spi_select(uint8_t bridge)
+{
+  if (bridge < SID_SPI_MAX_BRIDGES) {
+    spi_cs.gpio_dev = *cs_ports[bridge];
+    spi_cs.gpio_pin = cs_pins[bridge];
+  }
+}
+
 int sid_spi_init(void)
 {
   int err;
@@ -97,14 +177,13 @@ int sid_spi_init(void)
   }
 
   spi_cs.delay = 0;
-  spi_cs.gpio_dev = gpiob;
-  spi_cs.gpio_pin = 6;
   spi_cs.gpio_dt_flags = GPIO_ACTIVE_LOW;
+  sid_spi_select(0);
 
-  spi_cfg.slave = 0;
-  spi_cfg.operation = SPI_OP_MODE_MASTER | SPI_WORD_SET(8);
-  spi_cfg.frequency = 10000000U;
-  spi_cfg.cs = &spi_cs;
+  spi_cfg->slave = 0;
+  spi_cfg->operation = SPI_OP_MODE_MASTER | SPI_WORD_SET(8);
+  spi_cfg->frequency = SID_SPI_DEFAULT_FREQUENCY;
+  spi_cfg->cs = &spi_cs;
 
   return 0;
 }
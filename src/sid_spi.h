@@ -9,8 +9,27 @@
 
 #include <stdint.h>
 
+#include <stddef.h>
+
+/* Used until link training found the fastest reliable clock */
+#define SID_SPI_DEFAULT_FREQUENCY 10000000U
+
+/* Bridges on the bus, each on its own chip select, bridge 0 is the default */
+#define SID_SPI_MAX_BRIDGES       3
+
 void sid_spi_transfer( uint8_t cmd_addr, uint8_t wr_data,
                        uint8_t* status, uint8_t* rd_data);
+
+/* One chip select assertion, rx may be NULL for a write only transfer */
+void sid_spi_transceive(const uint8_t* tx, uint8_t* rx, size_t len);
+
+/* Clocks the SPI peripheral can generate, fastest first */
+int sid_spi_get_rates(uint32_t* rates, int max);
+void sid_spi_set_frequency(uint32_t hz);
+uint32_t sid_spi_get_frequency(void);
+
+/* Chip select of the transfers that follow, flush the protocol before a switch */
+void sid_spi_select(uint8_t bridge);
 int sid_spi_init(void);
 
 #endif /* SID_SPI_H */
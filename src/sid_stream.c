@@ -0,0 +1,302 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Pre-rendered stream player, see sid_stream.h. The writes go through
+ * sid_poke() in their recorded order, so a register written twice in a
+ * frame is sent twice like when the tune is emulated.
+ *
+ * A seek in a keyframed stream looks its keyframe up in the index, loads its
+ * registers and decodes the frames after it muted, at most a keyframe
+ * distance of them.
+ */
+
+#include "sid_stream.h"
+#include "sid_clock.h"
+#include "c64.h"
+
+#include <string.h>
+
+static const uint8_t* stream;
+static size_t stream_size;
+static size_t pos;
+static uint32_t frame;
+
+static uint32_t intro_frames;
+static uint32_t loop_frames;
+static size_t loop_offset;
+
+/* Keyframed streams */
+static bool keyed;
+static uint32_t key_frames;
+static uint32_t n_keys;
+static const uint8_t* key_index;
+static uint32_t next_key;
+static const uint8_t* tune;
+static size_t tune_size;
+static uint8_t clock;
+
+static uint32_t get_le32(const uint8_t* p)
+{
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static bool is_keyed(const uint8_t* data, size_t size)
+{
+  return size >= SID_STREAM_KEY_HEADER_SIZE && memcmp(data, "SIDK", 4) == 0;
+}
+
+bool sid_stream_is(const uint8_t* data, size_t size)
+{
+  return (size >= SID_STREAM_HEADER_SIZE && memcmp(data, "SIDR", 4) == 0) ||
+         is_keyed(data, size);
+}
+
+/* Where keyframe k and the frames after it start, false when it is cut off */
+static bool keyframe(uint32_t k, size_t* at, size_t* frames)
+{
+  uint32_t n_pages;
+
+  *at = get_le32(key_index + 4 * k);
+  if (*at < SID_STREAM_KEY_HEADER_SIZE || *at + SID_STREAM_KEY_PAGES + 2 > stream_size)
+    return false;
+
+  n_pages = stream[*at + SID_STREAM_KEY_PAGES] | (stream[*at + SID_STREAM_KEY_PAGES + 1] << 8);
+  *frames = *at + SID_STREAM_KEY_PAGES + 2 + n_pages * 257;
+
+  return *frames <= stream_size;
+}
+
+static bool init_keyed(const uint8_t* data, size_t size)
+{
+  uint32_t index_offset = get_le32(data + 16);
+  uint32_t tune_offset = get_le32(data + 20);
+  size_t at;
+
+  intro_frames = get_le32(data + 4);
+  loop_frames = 0;
+  key_frames = get_le32(data + 8);
+  n_keys = get_le32(data + 12);
+  tune_size = get_le32(data + 24);
+  clock = data[29];
+
+  if (!key_frames || n_keys != (intro_frames + key_frames - 1) / key_frames || !n_keys ||
+      index_offset > size || n_keys > (size - index_offset) / 4 ||
+      tune_offset > size || tune_size > size - tune_offset)
+    return false;
+
+  stream = data;
+  stream_size = size;
+  key_index = data + index_offset;
+  tune = data + tune_offset;
+
+  if (!keyframe(0, &at, &pos)) {
+    stream = NULL;
+    return false;
+  }
+
+  keyed = true;
+  next_key = key_frames;
+  frame = 0;
+
+  sid_load_regs(data + at);
+
+  return true;
+}
+
+bool sid_stream_init(const uint8_t* data, size_t size)
+{
+  keyed = false;
+  clock = SID_CLOCK_PAL;
+
+  if (is_keyed(data, size))
+    return init_keyed(data, size);
+
+  if (!sid_stream_is(data, size))
+    return false;
+
+  intro_frames = get_le32(data + 4);
+  loop_frames = get_le32(data + 8);
+  loop_offset = get_le32(data + 12);
+
+  if (loop_offset < SID_STREAM_HEADER_SIZE || loop_offset > size)
+    return false;
+
+  stream = data;
+  stream_size = size;
+  pos = SID_STREAM_HEADER_SIZE;
+  frame = 0;
+
+  sid_load_regs(data + 16);
+
+  return true;
+}
+
+/* Pokes one run of writes, false when it runs past the end */
+static bool run(uint8_t* groups)
+{
+  const uint8_t* masks;
+  uint8_t n_groups = 0;
+  size_t values;
+
+  if (pos == stream_size)
+    return false;
+
+  *groups = stream[pos++];
+
+  for (uint8_t g = 0; g < SID_STREAM_GROUPS; g++) {
+    n_groups += (*groups >> g) & 1;
+  }
+
+  if (pos + n_groups > stream_size)
+    return false;
+
+  masks = &stream[pos];
+  values = pos + n_groups;
+
+  for (uint8_t g = 0; g < SID_STREAM_GROUPS; g++) {
+    uint8_t mask;
+
+    if (!(*groups & (1U << g)))
+      continue;
+
+    mask = *masks++;
+
+    for (uint8_t r = 0; r < SID_STREAM_GROUP_REGS; r++) {
+      if (!(mask & (1U << r)))
+        continue;
+
+      if (values == stream_size)
+        return false;
+
+      sid_poke(g * SID_STREAM_GROUP_REGS + r, stream[values++]);
+    }
+  }
+
+  pos = values;
+
+  return true;
+}
+
+bool sid_stream_frame(void)
+{
+  uint8_t groups;
+  size_t at;
+
+  if (!stream)
+    return false;
+
+  if (frame == intro_frames + loop_frames) {
+    if (!loop_frames)
+      return false;
+
+    pos = loop_offset;
+    frame = intro_frames;
+  }
+
+  /* Playing on, the keyframe holds what the registers already are */
+  if (keyed && frame == next_key) {
+    if (!keyframe(frame / key_frames, &at, &pos)) {
+      stream = NULL;
+      return false;
+    }
+    next_key += key_frames;
+  }
+
+  do {
+    if (!run(&groups)) {
+      stream = NULL;
+      return false;
+    }
+  } while (groups & SID_STREAM_MORE);
+
+  frame++;
+
+  return true;
+}
+
+uint32_t sid_stream_position(void)
+{
+  return frame;
+}
+
+uint32_t sid_stream_length(void)
+{
+  return intro_frames + loop_frames;
+}
+
+bool sid_stream_seekable(void)
+{
+  return stream && keyed;
+}
+
+bool sid_stream_seek(uint32_t target)
+{
+  uint32_t k = target / key_frames;
+  size_t at;
+  size_t frames;
+  bool ok = true;
+
+  if (!sid_stream_seekable() || target >= intro_frames || !keyframe(k, &at, &frames))
+    return false;
+
+  sid_mute(true);
+  sid_set_regs(stream + at);
+  pos = frames;
+  frame = k * key_frames;
+  next_key = frame + key_frames;
+
+  while (ok && frame < target) {
+    ok = sid_stream_frame();
+  }
+
+  sid_mute(false);
+  sid_flush_regs();
+
+  return ok;
+}
+
+uint8_t sid_stream_clock(void)
+{
+  return clock;
+}
+
+bool sid_stream_restore(uint32_t target, struct sid_info* info)
+{
+  uint32_t k = target / key_frames;
+  size_t at;
+  size_t end;
+
+  if (!sid_stream_seekable() || !tune_size)
+    return false;
+
+  if (k >= n_keys) {
+    k = n_keys - 1;
+  }
+
+  if (!keyframe(k, &at, &end) || !sid_parse_header(tune, tune_size, info) ||
+      !sid_load_payload(tune, tune_size))
+    return false;
+
+  for (size_t p = at + SID_STREAM_KEY_PAGES + 2; p < end; p += 257) {
+    c64_memcpy(stream[p] << 8, &stream[p + 1], 256);
+  }
+  sid_voice3_load(stream + at + SID_NUM_REGS);
+
+  if (info->play_addr == 0) {
+    info->play_addr = (c64_getmem(0x0315) << 8) | c64_getmem(0x0314);
+  }
+
+  sid_mute(true);
+  sid_set_regs(stream + at);
+
+  for (uint32_t f = k * key_frames; f < target; f++) {
+    c64_cpu_jsr(info->play_addr, 0);
+    sid_flush();
+  }
+
+  sid_mute(false);
+
+  return true;
+}
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef SID_STREAM_H
+#define SID_STREAM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "sid.h"
+#include "sid_voice3.h"
+
+/*
+ * A pre-rendered tune: the SID writes of every frame, an intro followed by a
+ * loop that is played forever. Multi byte fields are little endian.
+ *
+ *   0   "SIDR"
+ *   4   intro frames
+ *   8   loop frames, 0 when the tune ends after the intro
+ *   12  offset of the first loop frame from the start of the stream
+ *   16  SID_NUM_REGS registers after init
+ *   41  frames
+ *
+ * A frame holds the writes in the order they were sent, cut into runs of
+ * ascending registers. A run starts with a byte holding SID_STREAM_MORE when
+ * another run follows in the same frame and a bit for every register group
+ * with writes, followed by a mask byte for every such group and the values
+ * in register order. A frame without writes is a single 0.
+ *
+ * A keyframed stream, made by tools/sidrender.c, has no loop but can seek:
+ *
+ *   0   "SIDK"
+ *   4   frames
+ *   8   frames per keyframe
+ *   12  keyframes
+ *   16  offset of the index, the 32 bit offset of every keyframe
+ *   20  offset of the tune the stream was rendered from
+ *   24  size of the tune
+ *   28  song, clock (enum sid_clock), 2 bytes 0
+ *   32  keyframes, each followed by its frames
+ *
+ * A keyframe holds the SID_NUM_REGS registers at its frame, the voice 3
+ * model (SID_VOICE3_STATE_SIZE bytes), a 16 bit count of the memory pages
+ * that differ from the freshly loaded tune and those pages, a page number
+ * and 256 bytes each. The registers are all a seek needs, the rest lets the
+ * tune be emulated on from the keyframe.
+ */
+#define SID_STREAM_HEADER_SIZE  (16 + SID_NUM_REGS)
+#define SID_STREAM_KEY_HEADER_SIZE  32
+#define SID_STREAM_KEY_PAGES    (SID_NUM_REGS + SID_VOICE3_STATE_SIZE)
+#define SID_STREAM_MORE         0x80
+
+/* Voice 1, voice 2, voice 3 and filter plus volume */
+#define SID_STREAM_GROUPS       4
+#define SID_STREAM_GROUP_REGS   7
+
+bool sid_stream_is(const uint8_t* data, size_t size);
+
+/* Loads the registers after init, the next sid_flush() sends them */
+bool sid_stream_init(const uint8_t* data, size_t size);
+
+/* Pokes the writes of the next frame, false when the stream has ended */
+bool sid_stream_frame(void);
+
+uint32_t sid_stream_position(void);
+
+/* Frames until the loop repeats, 0 when the stream has none */
+uint32_t sid_stream_length(void);
+
+/* Keyframed streams only, a seek decodes from the keyframe before frame */
+bool sid_stream_seekable(void);
+bool sid_stream_seek(uint32_t frame);
+uint8_t sid_stream_clock(void);
+
+/*
+ * Loads the tune of a keyframed stream with the memory it has at frame, to
+ * emulate it on from there. Returns its header with the play address.
+ */
+bool sid_stream_restore(uint32_t frame, struct sid_info* info);
+
+#endif /* SID_STREAM_H */
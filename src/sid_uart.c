@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Interrupt driven receive into a ring buffer, the upload protocol waits for
+ * an answer after every packet so the ring never holds more than one. Live
+ * frames come without answers but paced by the host, a few per frame.
+ */
+
+#include "sid_uart.h"
+#include "sid_upload.h"
+#include "sid_live.h"
+
+#include <errno.h>
+#include <zephyr.h>
+#include <device.h>
+#include <drivers/uart.h>
+#include <sys/ring_buffer.h>
+
+static const struct device* uart;
+
+RING_BUF_DECLARE(rx_ring, SID_UART_RX_SIZE);
+K_SEM_DEFINE(rx_sem, 0, 1);
+
+static uint32_t overruns;
+
+static void uart_isr(const struct device* dev, void* user_data)
+{
+  uint8_t buf[32];
+
+  while (uart_irq_update(dev) && uart_irq_rx_ready(dev)) {
+    int n = uart_fifo_read(dev, buf, sizeof(buf));
+
+    if (n <= 0)
+      break;
+
+    if (ring_buf_put(&rx_ring, buf, n) < n) {
+      overruns++;
+    }
+
+    k_sem_give(&rx_sem);
+  }
+}
+
+int sid_uart_init(void)
+{
+  uart = device_get_binding(SID_UART_DEVICE);
+  if (!uart) {
+    return -ENODEV;
+  }
+
+  uart_irq_callback_user_data_set(uart, uart_isr, NULL);
+  uart_irq_rx_enable(uart);
+
+  return 0;
+}
+
+size_t sid_uart_read(uint8_t* buf, size_t max, uint32_t timeout_ms)
+{
+  if (!uart)
+    return 0;
+
+  if (ring_buf_is_empty(&rx_ring) && timeout_ms) {
+    k_sem_take(&rx_sem, K_MSEC(timeout_ms));
+  }
+
+  return ring_buf_get(&rx_ring, buf, max);
+}
+
+uint32_t sid_uart_get_overruns(void)
+{
+  return overruns;
+}
+
+void sid_upload_reply(uint8_t reply)
+{
+  uart_poll_out(uart, reply);
+}
+
+void sid_live_send(const uint8_t* data, size_t len)
+{
+  while (len--) {
+    uart_poll_out(uart, *data++);
+  }
+}
@@ -0,0 +1,34 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef SID_UART_H
+#define SID_UART_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Received bytes waiting to be taken, one upload packet and then some */
+#define SID_UART_RX_SIZE    1024
+
+/* UART1 under QEMU, UART0 carries the console and the shell there */
+#ifdef CONFIG_BOARD_MPS2_AN385
+#define SID_UART_DEVICE     "UART_1"
+#else
+#define SID_UART_DEVICE     "LPUART_1"
+#endif
+
+/*
+ * Serial link for tune uploads and live frames, the ST-Link virtual COM port
+ * on LPUART1. It also provides sid_upload_reply() and sid_live_send().
+ */
+int sid_uart_init(void);
+
+/* Waits up to timeout_ms for the first byte, 0 returns at once */
+size_t sid_uart_read(uint8_t* buf, size_t max, uint32_t timeout_ms);
+
+uint32_t sid_uart_get_overruns(void);
+
+#endif /* SID_UART_H */
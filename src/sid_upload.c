@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Streaming SID loader, see sid_upload.h.
+ *
+ * Only the header is collected, up to the load address in front of the
+ * payload. From there on every data byte is copied to its final place in
+ * C64 memory as soon as its packet checks out.
+ */
+
+#include "sid_upload.h"
+#include "c64.h"
+
+#include <string.h>
+
+/* Header, load address included, padded for sid_parse_header() */
+#define HEADER_MAX  0x80
+
+static enum sid_upload_state state;
+
+static struct sid_packet_rx rx = { .sync = SID_UPLOAD_SYNC };
+
+static uint8_t next_seq;
+
+static uint32_t size;
+static uint32_t received;
+static uint8_t header[HEADER_MAX];
+static uint8_t header_size;
+static uint16_t load_addr;
+static struct sid_info info;
+
+static struct sid_upload_stats stats;
+
+void sid_upload_reset(void)
+{
+  state = SID_UPLOAD_IDLE;
+  sid_packet_rx_init(&rx, SID_UPLOAD_SYNC);
+}
+
+static bool begin(void)
+{
+  if (rx.len != 4)
+    return false;
+
+  size = rx.data[0] | (rx.data[1] << 8) | (rx.data[2] << 16) | ((uint32_t)rx.data[3] << 24);
+
+  /* Header and load address up to a payload filling the whole memory */
+  if (size < 0x78 || size > 0x7c + 2 + 0x10000)
+    return false;
+
+  received = 0;
+  header_size = 8;
+  memset(header, 0, sizeof(header));
+
+  c64_init();
+
+  state = SID_UPLOAD_RECEIVING;
+  stats.size = size;
+
+  return true;
+}
+
+static bool parse_header(void)
+{
+  if (memcmp(&header[1], "SID", 3) != 0 || (header[0] != 'P' && header[0] != 'R'))
+    return false;
+
+  if (header[7] < 0x76 || header[7] > 0x7c || header[6] != 0)
+    return false;
+
+  load_addr = header[header[7]] | (header[header[7] + 1] << 8);
+
+  if (load_addr + (size - header_size) > 0x10000)
+    return false;
+
+  return sid_parse_header(header, sizeof(header), &info);
+}
+
+static bool data(void)
+{
+  const uint8_t* src = rx.data;
+  uint8_t len = rx.len;
+
+  if (state != SID_UPLOAD_RECEIVING || received + len > size)
+    return false;
+
+  /* The data offset is in the first 8 bytes, the header size follows */
+  while (len && received < header_size) {
+    header[received++] = *src++;
+    len--;
+
+    if (received == 8) {
+      header_size = header[7] + 2;
+      if (header[7] < 0x76 || header[7] > 0x7c)
+        return false;
+    } else if (received == header_size && !parse_header()) {
+      return false;
+    }
+  }
+
+  if (len) {
+    c64_memcpy(load_addr + (received - header_size), src, len);
+    received += len;
+  }
+
+  if (received == size) {
+    state = SID_UPLOAD_READY;
+  }
+
+  return true;
+}
+
+static void packet(void)
+{
+  bool ok;
+
+  stats.packets++;
+
+  if (rx.type == SID_UPLOAD_BEGIN) {
+    /* A repeated begin restarts the upload, harmless as nothing is lost */
+    ok = begin();
+    next_seq = rx.seq + 1;
+  } else if (rx.type == SID_UPLOAD_DATA && rx.seq == (uint8_t)(next_seq - 1) &&
+             state != SID_UPLOAD_IDLE) {
+    stats.duplicates++;
+    ok = true;
+  } else if (rx.type == SID_UPLOAD_DATA && rx.seq == next_seq) {
+    ok = data();
+    next_seq++;
+  } else {
+    ok = false;
+  }
+
+  if (!ok) {
+    stats.rejects++;
+    state = SID_UPLOAD_IDLE;
+  }
+
+  sid_upload_reply(ok ? SID_UPLOAD_ACK : SID_UPLOAD_REJECT);
+}
+
+enum sid_upload_state sid_upload_feed(const uint8_t* data, size_t len)
+{
+  while (len--) {
+    switch (sid_packet_rx_byte(&rx, *data++)) {
+      case SID_PACKET_OK:
+        packet();
+        break;
+      case SID_PACKET_CRC_ERROR:
+        stats.crc_errors++;
+        sid_upload_reply(SID_UPLOAD_NAK);
+        break;
+      case SID_PACKET_NONE:
+        break;
+    }
+  }
+
+  return state;
+}
+
+enum sid_upload_state sid_upload_get_state(void)
+{
+  return state;
+}
+
+const struct sid_info* sid_upload_info(void)
+{
+  return &info;
+}
+
+void sid_upload_get_stats(struct sid_upload_stats* s)
+{
+  *s = stats;
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef SID_UPLOAD_H
+#define SID_UPLOAD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "sid.h"
+#include "sid_packet.h"
+
+/*
+ * Loads a SID file sent over a serial link straight into C64 memory, the
+ * file is never stored as a whole. Every packet is framed by sid_packet.h:
+ *
+ *   SID_UPLOAD_SYNC, type, sequence, length, length bytes, CRC-8
+ *
+ * with the CRC-8 (poly 0x07) over type up to the last data byte. A begin
+ * packet carries the file size as 32 bit little endian, data packets carry
+ * the file in order. The device answers every packet with one byte: ACK,
+ * NAK for a damaged packet, which the host sends again, or REJECT when the
+ * file can not be loaded, which ends the upload. A packet that was already
+ * taken is answered with ACK again, for when an ACK got lost.
+ *
+ * Packed images are rejected, the payload goes to its place as it arrives.
+ */
+#define SID_UPLOAD_SYNC         0xa5
+#define SID_UPLOAD_BEGIN        'B'
+#define SID_UPLOAD_DATA         'D'
+
+#define SID_UPLOAD_ACK          0x06
+#define SID_UPLOAD_NAK          0x15
+#define SID_UPLOAD_REJECT       0x18
+
+#define SID_UPLOAD_MAX_DATA     SID_PACKET_MAX_DATA
+
+/* An upload with no bytes for this long is given up */
+#define SID_UPLOAD_TIMEOUT_MS   1000
+
+enum sid_upload_state
+{
+    SID_UPLOAD_IDLE,
+    SID_UPLOAD_RECEIVING,       /* C64 memory is being overwritten */
+    SID_UPLOAD_READY,           /* the whole payload is in place, init can run */
+};
+
+struct sid_upload_stats
+{
+    uint32_t size;              /* of the last upload */
+    uint32_t packets;
+    uint32_t crc_errors;
+    uint32_t duplicates;
+    uint32_t rejects;
+};
+
+void sid_upload_reset(void);
+
+/* Takes received bytes, answers through sid_upload_reply() */
+enum sid_upload_state sid_upload_feed(const uint8_t* data, size_t len);
+enum sid_upload_state sid_upload_get_state(void);
+
+/* Header of the tune once it is ready */
+const struct sid_info* sid_upload_info(void);
+
+void sid_upload_get_stats(struct sid_upload_stats* stats);
+
+/* Sends one answer byte, provided by the transport */
+void sid_upload_reply(uint8_t reply);
+
+#endif /* SID_UPLOAD_H */
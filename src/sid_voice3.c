@@ -0,0 +1,377 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Voice 3 model, see sid_voice3.h. It follows reSID, clocked lazily: the
+ * cycles since the last access are applied in one go when a register is
+ * written or read. The accumulators advance by frequency times cycles, only
+ * the noise shift register, hard sync and the envelope take a step per event.
+ * tools/sid_voice3_test.c holds it against a cycle by cycle reference.
+ *
+ * Voice 2 is kept as far as voice 3 needs it, as the source of hard sync and
+ * ring modulation. Combined waveforms are the AND of their parts, which is
+ * close enough for tunes that use OSC3 as a random or LFO source.
+ */
+
+#include "sid_voice3.h"
+#include "c64.h"
+
+#include <stdbool.h>
+
+#define CTRL_GATE       0x01
+#define CTRL_SYNC       0x02
+#define CTRL_RING       0x04
+#define CTRL_TEST       0x08
+#define CTRL_TRIANGLE   0x10
+#define CTRL_SAW        0x20
+#define CTRL_PULSE      0x40
+#define CTRL_NOISE      0x80
+
+#define ACC_MASK        0xffffff
+#define ACC_MSB         0x800000
+#define NOISE_RESET     0x7ffff8
+
+/* More than a second between accesses is the machine being reloaded */
+#define MAX_DELTA       1000000
+
+enum envelope_state
+{
+  ATTACK,
+  DECAY_SUSTAIN,
+  RELEASE,
+};
+
+/* Cycles per envelope step for every ADSR value */
+static const uint16_t rate_period[16] = {
+  9, 32, 63, 95, 149, 220, 267, 313, 392, 977, 1954, 3126, 3907, 11720, 19532, 31251
+};
+
+static uint16_t freq2;
+static uint8_t ctrl2;
+static uint32_t acc2;
+
+static uint16_t freq3;
+static uint16_t pw3;
+static uint8_t ctrl3;
+static uint8_t ad3;
+static uint8_t sr3;
+static uint32_t acc3;
+static uint32_t noise = NOISE_RESET;
+
+static enum envelope_state env_state = RELEASE;
+static uint8_t env_counter;
+static uint16_t rate_counter;
+static uint8_t exp_counter;
+static uint8_t exp_period = 1;
+static bool hold_zero = true;
+
+static uint32_t cpu_ref;
+static uint32_t frame_cycles;
+static uint32_t frame_length = SID_VOICE3_FRAME_CYCLES;
+
+/*
+ * The feedback is bit 22 EOR bit 17, so the next 17 bits shifted in only
+ * depend on bits already in the register and come out of one EOR.
+ */
+static void clock_noise(uint32_t steps)
+{
+  while (steps) {
+    uint32_t n = steps > 17 ? 17 : steps;
+    uint32_t feedback = noise ^ (noise >> 5);
+
+    noise = ((noise << n) | ((feedback >> (18 - n)) & ((1U << n) - 1))) & 0x7fffff;
+    steps -= n;
+  }
+}
+
+/* Voice 3 runs on for a number of cycles, the noise register shifts when bit 19 goes high */
+static void clock_voice3(uint32_t cycles)
+{
+  uint64_t end3 = (uint64_t)acc3 + (uint64_t)freq3 * cycles;
+
+  clock_noise(((end3 + 0x80000) >> 20) - ((acc3 + 0x80000) >> 20));
+  acc3 = end3 & ACC_MASK;
+}
+
+static void clock_oscillators(uint32_t delta)
+{
+  uint64_t end2 = (uint64_t)acc2 + (uint64_t)freq2 * delta;
+
+  if (ctrl3 & CTRL_TEST) {
+    acc3 = 0;
+  } else if ((ctrl3 & CTRL_SYNC) && !(ctrl2 & CTRL_TEST) && freq2) {
+    /* Voice 3 restarts in every cycle voice 2's MSB goes high */
+    uint64_t pos2 = (uint64_t)acc2 + ACC_MSB;
+
+    while (delta) {
+      uint32_t next = (uint32_t)((((pos2 >> 24) + 1) << 24) - pos2 + freq2 - 1) / freq2;
+
+      if (next > delta) {
+        clock_voice3(delta);
+        break;
+      }
+
+      clock_voice3(next);
+      acc3 = 0;
+      pos2 += (uint64_t)freq2 * next;
+      delta -= next;
+    }
+  } else {
+    clock_voice3(delta);
+  }
+
+  acc2 = (ctrl2 & CTRL_TEST) ? 0 : end2 & ACC_MASK;
+}
+
+static void set_exp_period(void)
+{
+  switch (env_counter) {
+    case 0xff: exp_period = 1; break;
+    case 0x5d: exp_period = 2; break;
+    case 0x36: exp_period = 4; break;
+    case 0x1a: exp_period = 8; break;
+    case 0x0e: exp_period = 16; break;
+    case 0x06: exp_period = 30; break;
+    case 0x00: exp_period = 1; hold_zero = true; break;
+  }
+}
+
+static uint16_t env_rate(void)
+{
+  switch (env_state) {
+    case ATTACK:
+      return rate_period[ad3 >> 4];
+    case DECAY_SUSTAIN:
+      return rate_period[ad3 & 0x0f];
+    default:
+      return rate_period[sr3 & 0x0f];
+  }
+}
+
+static void clock_envelope(uint32_t delta)
+{
+  uint32_t count = rate_counter + delta;
+  uint16_t period = env_rate();
+
+  /*
+   * A shorter rate written while the counter was past it: the 15 bit
+   * counter runs up to $8000 and restarts at 1, the ADSR delay bug.
+   */
+  if (rate_counter >= period) {
+    if (count < 0x8000) {
+      rate_counter = count;
+      return;
+    }
+    count -= 0x7fff;
+  }
+
+  while (count >= period) {
+    count -= period;
+
+    /* Nothing moves any more, only the phase of the rate and exponential counters */
+    if (hold_zero ||
+        (env_state == DECAY_SUSTAIN && env_counter == (sr3 >> 4) * 0x11)) {
+      exp_counter = env_state == ATTACK ? 0 : (exp_counter + 1 + count / period) % exp_period;
+      count %= period;
+      break;
+    }
+
+    if (env_state == ATTACK) {
+      /* Regated at $ff in release the counter flips over to 0 and sticks there */
+      if (++env_counter == 0xff) {
+        env_state = DECAY_SUSTAIN;
+        period = env_rate();
+      }
+      exp_counter = 0;
+    } else if (++exp_counter == exp_period) {
+      exp_counter = 0;
+      env_counter--;
+    } else {
+      continue;
+    }
+
+    set_exp_period();
+  }
+
+  rate_counter = count;
+}
+
+/* Bring the model up to the current cycle */
+static void update(void)
+{
+  uint32_t cpu = c64_cpu_cycles();
+  uint32_t delta = cpu - cpu_ref;
+
+  cpu_ref = cpu;
+
+  /* c64_init() restarts the counter */
+  if (delta > MAX_DELTA)
+    return;
+
+  clock_oscillators(delta);
+  clock_envelope(delta);
+  frame_cycles += delta;
+}
+
+void sid_voice3_write(uint8_t reg, uint8_t val)
+{
+  if (reg < 0x07 || reg > 0x14 || (reg > 0x08 && reg < 0x0b) || reg == 0x0c || reg == 0x0d)
+    return;
+
+  update();
+
+  switch (reg) {
+    case 0x07: freq2 = (freq2 & 0xff00) | val; break;
+    case 0x08: freq2 = (freq2 & 0x00ff) | (val << 8); break;
+    case 0x0b: ctrl2 = val; break;
+    case 0x0e: freq3 = (freq3 & 0xff00) | val; break;
+    case 0x0f: freq3 = (freq3 & 0x00ff) | (val << 8); break;
+    case 0x10: pw3 = (pw3 & 0x0f00) | val; break;
+    case 0x11: pw3 = (pw3 & 0x00ff) | ((val & 0x0f) << 8); break;
+    case 0x12:
+      /* The noise register is cleared by the test bit and reset when it goes */
+      if (val & CTRL_TEST) {
+        acc3 = 0;
+        noise = 0;
+      } else if (ctrl3 & CTRL_TEST) {
+        noise = NOISE_RESET;
+      }
+
+      if ((val & CTRL_GATE) && !(ctrl3 & CTRL_GATE)) {
+        env_state = ATTACK;
+        hold_zero = false;
+      } else if (!(val & CTRL_GATE) && (ctrl3 & CTRL_GATE)) {
+        env_state = RELEASE;
+      }
+
+      ctrl3 = val;
+      break;
+    case 0x13: ad3 = val; break;
+    case 0x14: sr3 = val; break;
+  }
+}
+
+uint8_t sid_voice3_osc(void)
+{
+  uint8_t out = 0xff;
+
+  update();
+
+  if (!(ctrl3 & 0xf0))
+    return 0;
+
+  if (ctrl3 & CTRL_TRIANGLE) {
+    uint32_t msb = (ctrl3 & CTRL_RING) ? (acc3 ^ acc2) & ACC_MSB : acc3 & ACC_MSB;
+
+    out &= (msb ? ~acc3 : acc3) >> 15;
+  }
+
+  if (ctrl3 & CTRL_SAW) {
+    out &= acc3 >> 16;
+  }
+
+  if ((ctrl3 & CTRL_PULSE) && !(ctrl3 & CTRL_TEST) && (acc3 >> 12) < pw3) {
+    out = 0;
+  }
+
+  if (ctrl3 & CTRL_NOISE) {
+    out &= ((noise >> 15) & 0x80) | ((noise >> 14) & 0x40) | ((noise >> 11) & 0x20) |
+           ((noise >> 9) & 0x10) | ((noise >> 8) & 0x08) | ((noise >> 5) & 0x04) |
+           ((noise >> 3) & 0x02) | ((noise >> 2) & 0x01);
+  }
+
+  return out;
+}
+
+uint8_t sid_voice3_env(void)
+{
+  update();
+
+  return env_counter;
+}
+
+void sid_voice3_end_frame(void)
+{
+  update();
+
+  if (frame_cycles < frame_length) {
+    clock_oscillators(frame_length - frame_cycles);
+    clock_envelope(frame_length - frame_cycles);
+  }
+
+  frame_cycles = 0;
+}
+
+void sid_voice3_set_frame(uint32_t cycles)
+{
+  frame_length = cycles;
+}
+
+static uint8_t* put(uint8_t* p, uint32_t val, uint8_t n)
+{
+  while (n--) {
+    *p++ = val;
+    val >>= 8;
+  }
+
+  return p;
+}
+
+static const uint8_t* get(const uint8_t* p, uint32_t* val, uint8_t n)
+{
+  *val = 0;
+  for (uint8_t i = 0; i < n; i++) {
+    *val |= (uint32_t)*p++ << (i * 8);
+  }
+
+  return p;
+}
+
+void sid_voice3_save(uint8_t state[SID_VOICE3_STATE_SIZE])
+{
+  uint8_t* p = state;
+
+  update();
+
+  p = put(p, freq2, 2);
+  p = put(p, ctrl2, 1);
+  p = put(p, acc2, 3);
+  p = put(p, freq3, 2);
+  p = put(p, pw3, 2);
+  p = put(p, ctrl3, 1);
+  p = put(p, ad3, 1);
+  p = put(p, sr3, 1);
+  p = put(p, acc3, 3);
+  p = put(p, noise, 3);
+  p = put(p, env_state | (hold_zero ? 0x80 : 0), 1);
+  p = put(p, env_counter, 1);
+  p = put(p, rate_counter, 2);
+  p = put(p, exp_counter, 1);
+  put(p, exp_period, 1);
+}
+
+void sid_voice3_load(const uint8_t state[SID_VOICE3_STATE_SIZE])
+{
+  const uint8_t* p = state;
+  uint32_t v;
+
+  p = get(p, &v, 2); freq2 = v;
+  p = get(p, &v, 1); ctrl2 = v;
+  p = get(p, &v, 3); acc2 = v;
+  p = get(p, &v, 2); freq3 = v;
+  p = get(p, &v, 2); pw3 = v;
+  p = get(p, &v, 1); ctrl3 = v;
+  p = get(p, &v, 1); ad3 = v;
+  p = get(p, &v, 1); sr3 = v;
+  p = get(p, &v, 3); acc3 = v;
+  p = get(p, &v, 3); noise = v;
+  p = get(p, &v, 1); env_state = v & 0x7f; hold_zero = v & 0x80;
+  p = get(p, &v, 1); env_counter = v;
+  p = get(p, &v, 2); rate_counter = v;
+  p = get(p, &v, 1); exp_counter = v;
+  get(p, &v, 1); exp_period = v;
+
+  cpu_ref = c64_cpu_cycles();
+  frame_cycles = 0;
+}
@@ -0,0 +1,39 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef SID_VOICE3_H
+#define SID_VOICE3_H
+
+#include <stdint.h>
+
+/*
+ * Model of the voice 3 oscillator and envelope, for tunes that read OSC3
+ * ($d41b) as a random or LFO source or follow ENV3 ($d41c). The SID on the
+ * bridge is never asked, a read is answered from the model in a few
+ * instructions.
+ *
+ * The model runs on the emulated cycle counter. Between two play calls the
+ * counter stands still, sid_voice3_end_frame() moves the model on to the
+ * start of the next frame.
+ */
+#define SID_VOICE3_FRAME_CYCLES 19656   /* PAL, 312 lines of 63 cycles */
+
+/* Register writes, before they reach the shadow registers */
+void sid_voice3_write(uint8_t reg, uint8_t val);
+uint8_t sid_voice3_osc(void);
+uint8_t sid_voice3_env(void);
+void sid_voice3_end_frame(void);
+
+/* Cycles per frame of the tune's clock, SID_VOICE3_FRAME_CYCLES until set */
+void sid_voice3_set_frame(uint32_t cycles);
+
+/* The model between two frames, for stream keyframes */
+#define SID_VOICE3_STATE_SIZE   25
+
+void sid_voice3_save(uint8_t state[SID_VOICE3_STATE_SIZE]);
+void sid_voice3_load(const uint8_t state[SID_VOICE3_STATE_SIZE]);
+
+#endif /* SID_VOICE3_H */
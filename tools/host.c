@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "host.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <fcntl.h>
+#include <termios.h>
+
+uint8_t* host_load_file(const char* path, size_t* size)
+{
+  FILE* f;
+  long len;
+  uint8_t* data;
+
+  f = fopen(path, "rb");
+  if (!f) {
+    perror(path);
+    return NULL;
+  }
+
+  fseek(f, 0, SEEK_END);
+  len = ftell(f);
+  fseek(f, 0, SEEK_SET);
+
+  data = malloc(len > 0 ? len : 1);
+  if (!data || fread(data, 1, len, f) != (size_t)len) {
+    fprintf(stderr, "%s: read error\n", path);
+    free(data);
+    fclose(f);
+    return NULL;
+  }
+
+  fclose(f);
+  *size = len;
+
+  return data;
+}
+
+uint64_t host_time_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+int host_open_serial(const char* path, uint32_t baud)
+{
+  struct termios tio;
+  speed_t speed;
+  int fd;
+
+  switch (baud) {
+    case 115200: speed = B115200; break;
+    case 230400: speed = B230400; break;
+    case 460800: speed = B460800; break;
+    case 921600: speed = B921600; break;
+    case 1000000: speed = B1000000; break;
+    case 2000000: speed = B2000000; break;
+    default:
+      fprintf(stderr, "unsupported baud rate %u\n", baud);
+      return -1;
+  }
+
+  fd = open(path, O_RDWR | O_NOCTTY);
+  if (fd < 0) {
+    perror(path);
+    return -1;
+  }
+
+  tcgetattr(fd, &tio);
+  cfmakeraw(&tio);
+  cfsetspeed(&tio, speed);
+  tcsetattr(fd, TCSANOW, &tio);
+  tcflush(fd, TCIOFLUSH);
+
+  return fd;
+}
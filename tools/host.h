@@ -0,0 +1,21 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Helpers shared by the host side tools.
+ */
+
+#ifndef HOST_H
+#define HOST_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+uint8_t* host_load_file(const char* path, size_t* size);
+uint64_t host_time_ns(void);
+
+/* Raw mode at one of the usual rates, -1 when it fails */
+int host_open_serial(const char* path, uint32_t baud);
+
+#endif /* HOST_H */
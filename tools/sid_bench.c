@@ -0,0 +1,206 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Measures the emulator alone, the SID is muted and the SPI layer drops
+ * everything. Every tune is played for the given number of frames, the best
+ * of the repeats is reported as ns per emulated instruction and us per frame.
+ * Every tune runs on the generic core and on the core c64_cpu_optimize()
+ * picks for its play routine. Built with -DC64_JIT and src/c64_jit.c it
+ * runs on the JIT as well.
+ *
+ *   sid_bench [-f frames] [-r repeats] file.sid...
+ *
+ * The checksum covers the SID registers after every frame and the memory at
+ * the end, it has to be the same for all cores and stay the same when the
+ * interpreter is changed. The JIT has to count the same cycles too.
+ */
+
+#include "c64.h"
+#include "c64_jit.h"
+#include "sid.h"
+#include "sid_proto.h"
+#include "host.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static uint32_t fnv1a(uint32_t hash, const uint8_t* data, size_t len)
+{
+  while (len--) {
+    hash ^= *data++;
+    hash *= 16777619U;
+  }
+
+  return hash;
+}
+
+struct result
+{
+  uint64_t ns;
+  uint32_t instructions;
+  uint32_t cycles;
+  uint32_t checksum;
+  enum c64_core core;           /* core at the end of the run */
+  struct c64_scan_info scan;
+};
+
+static void run(const uint8_t* data, size_t size, uint32_t frames,
+                enum c64_core want, struct result* res)
+{
+  static uint8_t mem[65536];
+  struct sid_info info;
+  uint8_t regs[SID_NUM_REGS];
+  uint32_t hash = 2166136261U;
+  uint64_t start;
+
+#ifdef C64_JIT
+  c64_cpu_set_jit(want == C64_CORE_JIT);
+#endif
+
+  c64_init();
+  sid_load_from_memory(data, size, &info);
+  c64_cpu_jsr(info.init_addr, info.start_song);
+
+  if (want == C64_CORE_PREDECODED) {
+    c64_cpu_optimize(info.play_addr, &res->scan);
+  }
+
+  start = host_time_ns();
+  res->instructions = c64_cpu_instructions();
+
+  for (uint32_t frame = 0; frame < frames; frame++) {
+    c64_cpu_jsr(info.play_addr, 0);
+    sid_get_regs(regs);
+    hash = fnv1a(hash, regs, sizeof(regs));
+  }
+
+  res->ns = host_time_ns() - start;
+  res->instructions = c64_cpu_instructions() - res->instructions;
+  res->core = c64_cpu_get_core();
+
+  c64_memread(mem, 0, sizeof(mem));
+  res->checksum = fnv1a(hash, mem, sizeof(mem));
+  res->cycles = c64_cpu_cycles();
+
+#ifdef C64_JIT
+  c64_cpu_set_jit(false);
+#endif
+}
+
+static void best_of(const uint8_t* data, size_t size, uint32_t frames,
+                    uint32_t repeats, enum c64_core want, struct result* best)
+{
+  struct result res;
+
+  best->ns = UINT64_MAX;
+
+  for (uint32_t r = 0; r < repeats; r++) {
+    run(data, size, frames, want, &res);
+
+    if (res.ns < best->ns) {
+      *best = res;
+    }
+  }
+}
+
+static void print(const char* name, const struct result* res, uint32_t frames)
+{
+  printf("  %-10s %10u instr %6.1f instr/f %6.2f ns/instr %7.2f us/f sum %08x\n",
+         name, res->instructions, (double)res->instructions / frames,
+         res->instructions ? (double)res->ns / res->instructions : 0.0,
+         res->ns / 1000.0 / frames, res->checksum);
+}
+
+int main(int argc, char** argv)
+{
+  uint32_t frames = 15000;
+  uint32_t repeats = 5;
+  int res = 0;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "f:r:")) != -1) {
+    switch (opt) {
+      case 'f':
+        frames = strtoul(optarg, NULL, 0);
+        break;
+      case 'r':
+        repeats = strtoul(optarg, NULL, 0);
+        break;
+      default:
+        fprintf(stderr, "usage: %s [-f frames] [-r repeats] file.sid...\n", argv[0]);
+        return 1;
+    }
+  }
+
+  if (!frames || !repeats) {
+    fprintf(stderr, "frames and repeats must be at least 1\n");
+    return 1;
+  }
+
+  sid_proto_init(SID_PROTO_MODE_BLOCKING, false);
+  sid_mute(true);
+
+  for (int i = optind; i < argc; i++) {
+    size_t size;
+    uint8_t* data = host_load_file(argv[i], &size);
+    struct result generic;
+    struct result optimized;
+    const struct c64_scan_info* scan = &optimized.scan;
+
+    if (!data) {
+      res = 1;
+      continue;
+    }
+
+    best_of(data, size, frames, repeats, C64_CORE_GENERIC, &generic);
+    best_of(data, size, frames, repeats, C64_CORE_PREDECODED, &optimized);
+
+    printf("%s: %u instructions on %u pages, %u ram %u io %u guarded operands,"
+           " %u indirect jumps%s%s%s%s\n",
+           argv[i], scan->insns, scan->pages, scan->ram_ops, scan->io_ops,
+           scan->guarded_ops, scan->indirect_jumps,
+           scan->smc ? ", self modifying" : "",
+           scan->illegal ? ", undocumented opcodes" : "",
+           scan->stack_code ? ", code in stack page" : "",
+           scan->overflow ? ", too large" : "");
+
+    print("generic", &generic, frames);
+    print(c64_core_name(optimized.core), &optimized, frames);
+    printf("  speedup %.2fx\n", (double)generic.ns / optimized.ns);
+
+    if (generic.checksum != optimized.checksum) {
+      printf("  CHECKSUM MISMATCH\n");
+      res = 1;
+    }
+
+#ifdef C64_JIT
+    {
+      struct result jit;
+      struct c64_jit_stats stats;
+
+      best_of(data, size, frames, repeats, C64_CORE_JIT, &jit);
+      c64_jit_get_stats(&stats);
+
+      print("jit", &jit, frames);
+      printf("  speedup %.2fx, %u blocks of %u instructions, %u invalidated,"
+             " %u interpreted, %u KB code\n",
+             (double)generic.ns / jit.ns, stats.blocks, stats.insns,
+             stats.invalidated, stats.fallbacks, stats.code_bytes / 1024);
+
+      if (jit.checksum != generic.checksum || jit.instructions != generic.instructions ||
+          jit.cycles != generic.cycles) {
+        printf("  JIT MISMATCH\n");
+        res = 1;
+      }
+    }
+#endif
+
+    free(data);
+  }
+
+  return res;
+}
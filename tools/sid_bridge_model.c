@@ -0,0 +1,404 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "sid_bridge_model.h"
+#include "sid_spi.h"
+#include "sid_proto.h"
+#include "sid_digi.h"
+#include "sid_packet.h"
+
+#include <string.h>
+
+static struct sid_bridge_model_config cfg;
+static struct sid_bridge_model_stats stats;
+
+static uint64_t now_ns;
+static uint64_t next_drain_ns;
+
+static uint8_t regs[32];
+
+static uint8_t fifo_reg[SID_PROTO_FIFO_DEPTH];
+static uint8_t fifo_val[SID_PROTO_FIFO_DEPTH];
+static uint8_t fifo_head;
+static uint8_t fifo_level;
+static uint8_t overflow;
+
+static uint8_t rd_valid;
+static uint8_t rd_data;
+
+static uint8_t rx_crc;
+static uint8_t echo_prev;
+static uint32_t noise = 1;
+
+/* Frame parser, reset by every chip select */
+enum parse_state
+{
+  PARSE_CMD,
+  PARSE_DATA,
+  PARSE_COUNT,
+  PARSE_MASK,
+  PARSE_VALUES,
+  PARSE_ECHO_COUNT,
+  PARSE_ECHO,
+  PARSE_CRC,
+};
+
+static enum parse_state state;
+static uint8_t cmd;
+static uint8_t pos;
+static uint8_t count;
+static uint32_t mask;
+static uint8_t reg;
+
+/* Every write reaches the SID drain_ns after the previous one or its push */
+static void drain(void)
+{
+  while (fifo_level && next_drain_ns <= now_ns) {
+    regs[fifo_reg[fifo_head]] = fifo_val[fifo_head];
+    fifo_head = (fifo_head + 1) % SID_PROTO_FIFO_DEPTH;
+    fifo_level--;
+    next_drain_ns += cfg.drain_ns;
+  }
+}
+
+/* Voice 3 output, changing over time like the real OSC3 and ENV3 do */
+static uint8_t read_reg(uint8_t reg)
+{
+  switch (reg) {
+    case 0x19:
+    case 0x1a:
+      return 0xff;
+    case 0x1b:
+      return (uint8_t)(now_ns >> 10);
+    case 0x1c:
+      return regs[0x12] & 1 ? 0xff : 0x00;
+  }
+
+  return 0;
+}
+
+static void push(uint8_t r, uint8_t val)
+{
+  if (fifo_level == SID_PROTO_FIFO_DEPTH) {
+    overflow = 1;
+    stats.overflows++;
+  } else {
+    uint8_t tail = (fifo_head + fifo_level) % SID_PROTO_FIFO_DEPTH;
+
+    if (!fifo_level) {
+      next_drain_ns = now_ns + cfg.drain_ns;
+    }
+
+    fifo_reg[tail] = r;
+    fifo_val[tail] = val;
+    fifo_level++;
+  }
+}
+
+static uint8_t status_byte(void)
+{
+  uint8_t status = fifo_level;
+
+  if (overflow) {
+    status |= SID_PROTO_STATUS_OVERFLOW;
+  }
+  if (rd_valid) {
+    status |= SID_PROTO_STATUS_RD_VALID;
+  }
+
+  return status;
+}
+
+/*
+ * Above max_hz bits start to flip, rarely just above it and often at twice
+ * the rate, like marginal wiring does.
+ */
+static uint8_t line(uint8_t in)
+{
+  uint32_t one_in;
+
+  if (!cfg.max_hz || cfg.spi_hz <= cfg.max_hz)
+    return in;
+
+  one_in = (cfg.spi_hz < 2 * cfg.max_hz) ? 2000 : 20;
+
+  noise = noise * 1103515245 + 12345;
+  if ((noise >> 8) % one_in)
+    return in;
+
+  stats.corrupted++;
+
+  return in ^ (1 << ((noise >> 4) & 7));
+}
+
+/* Next register set in the mask of a masked burst */
+static void next_masked_reg(void)
+{
+  while (reg < 32 && !(mask & (1U << reg))) {
+    reg++;
+  }
+}
+
+static uint8_t byte(uint8_t in)
+{
+  uint8_t out;
+
+  drain();
+
+  in = line(in);
+
+  if (fifo_level > stats.max_level) {
+    stats.max_level = fifo_level;
+  }
+
+  if (state != PARSE_CRC && (state != PARSE_CMD || in != SID_PROTO_CMD_CRC)) {
+    rx_crc = sid_crc8(rx_crc, &in, 1);
+  }
+
+  switch (state) {
+    case PARSE_CMD:
+      out = status_byte();
+      cmd = in;
+
+      if (cmd == SID_PROTO_CMD_ECHO) {
+        state = PARSE_ECHO_COUNT;
+        break;
+      }
+
+      if (cmd == SID_PROTO_CMD_CRC) {
+        state = PARSE_CRC;
+        break;
+      }
+
+      rd_valid = 0;
+      overflow = 0;
+
+      if ((cmd & 0xe0) == SID_PROTO_CMD_BURST) {
+        state = PARSE_COUNT;
+      } else if ((cmd & 0xe0) == SID_PROTO_CMD_MASKED) {
+        state = PARSE_MASK;
+        mask = 0;
+        pos = 0;
+      } else {
+        state = PARSE_DATA;
+      }
+      break;
+
+    case PARSE_DATA:
+      out = rd_data;
+      state = PARSE_CMD;
+
+      if (cmd & SID_PROTO_CMD_WRITE) {
+        push(cmd & SID_PROTO_REG_MASK, in);
+      } else if ((cmd & SID_PROTO_CMD_NOP) == 0) {
+        rd_data = read_reg(cmd & SID_PROTO_REG_MASK);
+        rd_valid = 1;
+      }
+      break;
+
+    case PARSE_COUNT:
+      out = rd_data;
+      reg = cmd & SID_PROTO_REG_MASK;
+      count = in;
+      state = count ? PARSE_VALUES : PARSE_CMD;
+      break;
+
+    case PARSE_MASK:
+      out = pos ? status_byte() : rd_data;
+      mask |= (uint32_t)in << (8 * pos);
+
+      if (++pos == 4) {
+        reg = 0;
+        count = 0;
+        for (uint32_t m = mask; m; m &= m - 1) {
+          count++;
+        }
+        next_masked_reg();
+        state = count ? PARSE_VALUES : PARSE_CMD;
+      }
+      break;
+
+    case PARSE_ECHO_COUNT:
+      out = rd_data;
+      count = in;
+      echo_prev = 0;
+      state = PARSE_ECHO;
+      break;
+
+    case PARSE_ECHO:
+      out = echo_prev;
+      echo_prev = in;
+
+      if (count-- == 0) {
+        state = PARSE_CMD;
+      }
+      break;
+
+    case PARSE_CRC:
+      out = rx_crc;
+      rx_crc = 0;
+      state = PARSE_CMD;
+      break;
+
+    case PARSE_VALUES:
+    default:
+      out = status_byte();
+      push(reg & SID_PROTO_REG_MASK, in);
+      reg++;
+
+      if ((cmd & 0xe0) == SID_PROTO_CMD_MASKED) {
+        next_masked_reg();
+      }
+
+      if (--count == 0) {
+        state = PARSE_CMD;
+      }
+      break;
+  }
+
+  now_ns += 8ULL * 1000000000ULL / cfg.spi_hz;
+
+  return line(out);
+}
+
+void sid_bridge_model_init(const struct sid_bridge_model_config* config)
+{
+  cfg = *config;
+  memset(&stats, 0, sizeof(stats));
+  memset(regs, 0, sizeof(regs));
+
+  now_ns = 0;
+  next_drain_ns = 0;
+  fifo_head = 0;
+  fifo_level = 0;
+  overflow = 0;
+  rd_valid = 0;
+  rd_data = 0;
+  rx_crc = 0;
+  noise = 1;
+  state = PARSE_CMD;
+}
+
+void sid_bridge_model_idle(uint64_t ns)
+{
+  now_ns += ns;
+  drain();
+}
+
+uint64_t sid_bridge_model_time(void)
+{
+  return now_ns;
+}
+
+void sid_bridge_model_get_regs(uint8_t r[32])
+{
+  uint8_t level = fifo_level;
+  uint8_t head = fifo_head;
+
+  memcpy(r, regs, sizeof(regs));
+
+  while (level--) {
+    r[fifo_reg[head]] = fifo_val[head];
+    head = (head + 1) % SID_PROTO_FIFO_DEPTH;
+  }
+}
+
+void sid_bridge_model_get_stats(struct sid_bridge_model_stats* s)
+{
+  *s = stats;
+}
+
+void sid_spi_transceive(const uint8_t* tx, uint8_t* rx, size_t len)
+{
+  uint64_t start = now_ns;
+
+  now_ns += cfg.cs_overhead_ns;
+  state = PARSE_CMD;
+
+  for (size_t i = 0; i < len; i++) {
+    uint8_t out = byte(tx[i]);
+
+    if (rx) {
+      rx[i] = out;
+    }
+  }
+
+  stats.link_ns += now_ns - start;
+}
+
+void sid_spi_transfer( uint8_t cmd_addr, uint8_t wr_data,
+                       uint8_t* status, uint8_t* rd_data)
+{
+  uint8_t tx[2] = { cmd_addr, wr_data };
+  uint8_t rx[2];
+
+  sid_spi_transceive(tx, rx, 2);
+
+  *status = rx[0];
+  *rd_data = rx[1];
+}
+
+int sid_spi_get_rates(uint32_t* rates, int max)
+{
+  int n;
+
+  for (n = 0; n < max && n < 8; n++) {
+    rates[n] = cfg.pclk_hz >> (n + 1);
+  }
+
+  return n;
+}
+
+void sid_spi_set_frequency(uint32_t hz)
+{
+  cfg.spi_hz = hz;
+}
+
+uint32_t sid_spi_get_frequency(void)
+{
+  return cfg.spi_hz;
+}
+
+/* A single bridge, every chip select reaches it */
+void sid_spi_select(uint8_t bridge)
+{
+}
+
+int sid_spi_init(void)
+{
+  return 0;
+}
+
+int sid_digi_timer_init(void)
+{
+  return 0;
+}
+
+uint32_t sid_digi_timer_now(void)
+{
+  return now_ns / 1000;
+}
+
+void sid_digi_timer_wait(uint32_t until)
+{
+  int32_t us = until - sid_digi_timer_now();
+
+  if (us > 0) {
+    sid_bridge_model_idle(us * 1000ULL - now_ns % 1000);
+  }
+}
+
+void sid_digi_timer_wake(void)
+{
+}
+
+void sid_digi_lock(void)
+{
+}
+
+void sid_digi_unlock(void)
+{
+}
@@ -0,0 +1,41 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Reference model of the SPI to SID bridge. It implements the sid_spi.h
+ * interface so the protocol layer can run on a host without the FPGA, and
+ * the digi timer hooks of sid_digi.h on the model clock.
+ */
+
+#ifndef SID_BRIDGE_MODEL_H
+#define SID_BRIDGE_MODEL_H
+
+#include <stdint.h>
+
+struct sid_bridge_model_config
+{
+    uint32_t spi_hz;
+    uint32_t cs_overhead_ns;  /* driver call and chip select setup */
+    uint32_t drain_ns;        /* time for one write from FIFO to SID */
+    uint32_t max_hz;          /* fastest clock the wiring handles, 0 for any */
+    uint32_t pclk_hz;         /* SPI kernel clock the rates derive from */
+};
+
+struct sid_bridge_model_stats
+{
+    uint64_t link_ns;         /* time the bus was busy */
+    uint32_t overflows;
+    uint32_t corrupted;       /* bytes damaged by a too fast clock */
+    uint8_t  max_level;
+};
+
+void sid_bridge_model_init(const struct sid_bridge_model_config* config);
+void sid_bridge_model_idle(uint64_t ns);
+uint64_t sid_bridge_model_time(void);
+
+/* SID registers after the FIFO has been drained completely */
+void sid_bridge_model_get_regs(uint8_t regs[32]);
+void sid_bridge_model_get_stats(struct sid_bridge_model_stats* stats);
+
+#endif /* SID_BRIDGE_MODEL_H */
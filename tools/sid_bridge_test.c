@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Runs tunes through the protocol layer against the bridge model and reports
+ * link throughput and flow control behaviour for both protocol modes, with
+ * and without burst writes. "poke B/f" is what one two byte frame per
+ * register write costs, "wire B/f" what was actually sent.
+ *
+ *   sid_bridge_test [-f frames] [-d drain_ns] file.sid...
+ *
+ * -d sets the time the bridge needs for one write to the SID, 1000 ns by
+ * default. With a slow enough drain blocking mode overflows the FIFO, the
+ * credits of pipelined mode must keep it from ever doing so.
+ *
+ * Fails when pipelined mode overflows the FIFO or gives up waiting for it,
+ * or when the register state seen by the model does not match the shadow
+ * registers without an overflow to explain it.
+ */
+
+#include "c64.h"
+#include "sid.h"
+#include "sid_proto.h"
+#include "sid_bridge_model.h"
+#include "host.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define FRAME_NS 20000000ULL
+
+static const uint32_t spi_rates[] = { 2000000, 10000000, 20000000, 40000000 };
+
+/* Returns the FIFO overflows of the run, -1 when it failed */
+static int run(const uint8_t* data, size_t size, enum sid_proto_mode mode,
+               bool burst, uint32_t spi_hz, uint32_t drain_ns, uint32_t frames)
+{
+  struct sid_bridge_model_config cfg = {
+    .spi_hz = spi_hz,
+    .cs_overhead_ns = 2000,
+    .drain_ns = drain_ns,
+  };
+  struct sid_bridge_model_stats model;
+  struct sid_proto_stats proto;
+  struct sid_stats sid;
+  struct sid_info info;
+  uint64_t max_frame_ns = 0;
+  uint8_t shadow[SID_NUM_REGS];
+  uint8_t regs[32];
+  int match;
+
+  sid_bridge_model_init(&cfg);
+  sid_proto_init(mode, burst);
+
+  c64_init();
+  sid_load_from_memory(data, size, &info);
+  c64_cpu_jsr(info.init_addr, info.start_song);
+  sid_flush();
+  sid_proto_reset_stats();
+  sid_reset_stats();
+
+  for (uint32_t frame = 0; frame < frames; frame++) {
+    uint64_t start = sid_bridge_model_time();
+    uint64_t busy;
+
+    c64_cpu_jsr(info.play_addr, 0);
+    sid_flush();
+
+    busy = sid_bridge_model_time() - start;
+    if (busy > max_frame_ns) {
+      max_frame_ns = busy;
+    }
+
+    sid_bridge_model_idle(busy < FRAME_NS ? FRAME_NS - busy : 0);
+  }
+
+  sid_proto_get_stats(&proto);
+  sid_get_stats(&sid);
+  sid_bridge_model_get_stats(&model);
+  sid_bridge_model_get_regs(regs);
+  sid_get_regs(shadow);
+  match = memcmp(regs, shadow, SID_NUM_REGS) == 0;
+
+  printf("%-9s %-6s %3u MHz %5.1f poke B/f %5.1f wire B/f %5.1f xfer/f"
+         " %6.1f us/f %6.1f us max %5u stalls %3u lvl %4u ovf %s\n",
+         mode == SID_PROTO_MODE_BLOCKING ? "blocking" : "pipelined",
+         burst ? "burst" : "single",
+         spi_hz / 1000000,
+         2.0 * sid.pokes / frames,
+         (double)proto.bytes / frames,
+         (double)proto.transfers / frames,
+         model.link_ns / 1000.0 / frames,
+         max_frame_ns / 1000.0,
+         proto.stalls, model.max_level, model.overflows,
+         proto.timeouts ? "TIMEOUT" : match ? "ok" : "MISMATCH");
+
+  /* Writes lost to an overflow explain a mismatch, nothing else does */
+  if ((!match && !model.overflows) || proto.timeouts)
+    return -1;
+
+  return model.overflows;
+}
+
+int main(int argc, char** argv)
+{
+  uint32_t frames = 3000;
+  uint32_t drain_ns = 1000;
+  int res = 0;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "f:d:")) != -1) {
+    switch (opt) {
+      case 'f':
+        frames = strtoul(optarg, NULL, 0);
+        break;
+      case 'd':
+        drain_ns = strtoul(optarg, NULL, 0);
+        break;
+      default:
+        fprintf(stderr, "usage: %s [-f frames] [-d drain_ns] file.sid...\n", argv[0]);
+        return 1;
+    }
+  }
+
+  for (int i = optind; i < argc; i++) {
+    size_t size;
+    uint8_t* data = host_load_file(argv[i], &size);
+    int overflowed = 0;
+    int runs = 0;
+
+    if (!data) {
+      res = 1;
+      continue;
+    }
+
+    printf("%s\n", argv[i]);
+
+    for (size_t r = 0; r < sizeof(spi_rates) / sizeof(spi_rates[0]); r++) {
+      for (int burst = 0; burst < 2; burst++) {
+        int blocking = run(data, size, SID_PROTO_MODE_BLOCKING, burst,
+                           spi_rates[r], drain_ns, frames);
+        int pipelined = run(data, size, SID_PROTO_MODE_PIPELINED, burst,
+                            spi_rates[r], drain_ns, frames);
+
+        if (blocking < 0 || pipelined != 0)
+          res = 1;
+
+        if (blocking > 0)
+          overflowed++;
+        runs++;
+      }
+    }
+
+    printf("blocking mode overflowed in %d of %d runs\n", overflowed, runs);
+
+    free(data);
+  }
+
+  return res;
+}
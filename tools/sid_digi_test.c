@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Plays a generated sample tune, a play routine that updates a few voice
+ * registers and then writes $d418 from a delay loop at the given rate for
+ * most of the frame, through the digi channel against the bridge model and
+ * reports how late the writes went out.
+ *
+ *   sid_digi_test [-f frames] [-r rate] [-p play_us] [-m spi_mhz]
+ *
+ * play_us is the time the play call takes on the board, the model clock
+ * does not advance while the emulator runs. On the board the sender thread
+ * preempts the play call, here the writes due during it are sent first,
+ * they were all queued by the frame before. Fails when writes are dropped
+ * or the model ends up with other registers than the shadow copy.
+ */
+
+#include "c64.h"
+#include "sid.h"
+#include "sid_proto.h"
+#include "sid_digi.h"
+#include "sid_clock.h"
+#include "sid_bridge_model.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define CODE_ADDR     0x1000
+#define SAMPLE_ADDR   0x1100
+#define FRAME_CYCLES  19000   /* stay clear of the next frame */
+
+/* Cycles of one loop pass with a delay count of n: 16 + 5 * n */
+static uint8_t build_tune(uint32_t rate, uint8_t* count)
+{
+  uint32_t period = SID_DIGI_CLOCK_HZ / rate;
+  uint8_t delay = period > 21 ? (period - 16) / 5 : 1;
+  uint32_t n = FRAME_CYCLES / (16 + 5 * delay);
+  uint8_t samples[256];
+  uint8_t code[] = {
+    0xe6, 0x02,                   /*       inc $02 */
+    0xa5, 0x02,                   /*       lda $02 */
+    0x8d, 0x00, 0xd4,             /*       sta $d400 */
+    0x8d, 0x01, 0xd4,             /*       sta $d401 */
+    0x8d, 0x05, 0xd4,             /*       sta $d405 */
+    0xa2, 0x00,                   /*       ldx #0 */
+    0xbd, 0x00, SAMPLE_ADDR >> 8, /* loop: lda samples,x */
+    0x8d, 0x18, 0xd4,             /*       sta $d418 */
+    0xa0, delay,                  /*       ldy #delay */
+    0x88,                         /* wait: dey */
+    0xd0, 0xfd,                   /*       bne wait */
+    0xe8,                         /*       inx */
+    0xe0, 0x00,                   /*       cpx #count */
+    0xd0, 0xf0,                   /*       bne loop */
+    0x60,                         /*       rts */
+  };
+
+  *count = n > 255 ? 255 : n;
+  code[sizeof(code) - 4] = *count;
+
+  for (int i = 0; i < 256; i++) {
+    samples[i] = 0x10 | (i & 0x0f);
+  }
+
+  c64_memcpy(CODE_ADDR, code, sizeof(code));
+  c64_memcpy(SAMPLE_ADDR, samples, sizeof(samples));
+
+  return delay;
+}
+
+int main(int argc, char** argv)
+{
+  struct sid_bridge_model_config cfg = {
+    .spi_hz = 10000000,
+    .cs_overhead_ns = 2000,
+    .drain_ns = 1000,
+  };
+  struct sid_digi_stats digi;
+  uint32_t frames = 500;
+  uint32_t rate = 8000;
+  uint32_t play_us = 1000;
+  uint32_t frame_us;
+  uint8_t shadow[SID_NUM_REGS];
+  uint8_t regs[32];
+  uint8_t count;
+  uint8_t delay;
+  int match;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "f:r:p:m:")) != -1) {
+    switch (opt) {
+      case 'f':
+        frames = strtoul(optarg, NULL, 0);
+        break;
+      case 'r':
+        rate = strtoul(optarg, NULL, 0);
+        break;
+      case 'p':
+        play_us = strtoul(optarg, NULL, 0);
+        break;
+      case 'm':
+        cfg.spi_hz = strtoul(optarg, NULL, 0) * 1000000;
+        break;
+      default:
+        fprintf(stderr, "usage: %s [-f frames] [-r rate] [-p play_us] [-m spi_mhz]\n",
+                argv[0]);
+        return 1;
+    }
+  }
+
+  if (!rate || !cfg.spi_hz) {
+    fprintf(stderr, "rate and clock must not be 0\n");
+    return 1;
+  }
+
+  sid_bridge_model_init(&cfg);
+  sid_proto_init(SID_PROTO_MODE_BLOCKING, false);
+  c64_init();
+  sid_digi_reset();
+
+  delay = build_tune(rate, &count);
+  frame_us = sid_clock_frame_us(SID_CLOCK_PAL);
+
+  for (uint32_t frame = 0; frame < frames; frame++) {
+    uint32_t start = frame * frame_us;
+
+    sid_digi_timer_wait(start);
+    sid_digi_frame();
+
+    sid_digi_send(start + play_us);
+    c64_cpu_jsr(CODE_ADDR, 0);
+    sid_digi_timer_wait(start + play_us);
+
+    sid_flush();
+    sid_digi_send(start + frame_us);
+  }
+
+  sid_digi_send(frames * frame_us + SID_DIGI_DELAY_US + frame_us);
+
+  sid_digi_get_stats(&digi);
+  sid_bridge_model_get_regs(regs);
+  sid_get_regs(shadow);
+  match = memcmp(regs, shadow, SID_NUM_REGS) == 0;
+
+  printf("%u Hz (delay %u, %u writes/f) play %u us, spi %u MHz\n",
+         (unsigned)(SID_DIGI_CLOCK_HZ / (16 + 5 * delay)), delay, count,
+         play_us, cfg.spi_hz / 1000000);
+  printf("  regs %08x writes %u sent %u dropped %u late %u mean %.2f us max %u us %s\n",
+         digi.regs, digi.writes, digi.sent, digi.dropped, digi.late,
+         digi.sent ? (double)digi.sum_us / digi.sent : 0.0, digi.max_us,
+         match ? "ok" : "MISMATCH");
+
+  printf("  late us ");
+  for (int i = 0; i < SID_DIGI_HIST_BUCKETS; i++) {
+    printf(" %s%u:%u", i == SID_DIGI_HIST_BUCKETS - 1 ? ">=" : "",
+           i ? 1U << (i - 1) : 0, digi.hist[i]);
+  }
+  printf("\n");
+
+  return (match && !digi.dropped) ? 0 : 1;
+}
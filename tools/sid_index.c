@@ -0,0 +1,213 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Reads the catalog written by sidindex, see sid_index.h. The file is mapped
+ * and checked once, lookups are binary searches in the mapping.
+ */
+
+#include "sid_index.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+bool sid_index_open(struct sid_index* index, const char* path)
+{
+  const struct sid_index_header* h;
+  struct stat st;
+  void* map;
+  int fd;
+
+  memset(index, 0, sizeof(*index));
+
+  fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(*h)) {
+    close(fd);
+    return false;
+  }
+
+  map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED)
+    return false;
+
+  h = map;
+  index->map = map;
+  index->size = st.st_size;
+
+  if (memcmp(h->magic, SID_INDEX_MAGIC, 4) != 0 || h->version != SID_INDEX_VERSION ||
+      sizeof(*h) + (uint64_t)h->count * sizeof(struct sid_index_entry) > h->by_path ||
+      h->by_path + (uint64_t)h->count * sizeof(uint32_t) > h->strings ||
+      (uint64_t)h->strings + h->strings_size != index->size ||
+      h->strings_size == 0 || index->map[index->size - 1] != '\0') {
+    fprintf(stderr, "%s: not a version %u SID index\n", path, SID_INDEX_VERSION);
+    sid_index_close(index);
+    return false;
+  }
+
+  index->header = h;
+  index->entries = (const struct sid_index_entry*)(index->map + sizeof(*h));
+  index->by_path = (const uint32_t*)(index->map + h->by_path);
+  index->strings = (const char*)(index->map + h->strings);
+
+  return true;
+}
+
+void sid_index_close(struct sid_index* index)
+{
+  if (index->map) {
+    munmap((void*)index->map, index->size);
+  }
+  memset(index, 0, sizeof(*index));
+}
+
+const char* sid_index_string(const struct sid_index* index, uint32_t offset)
+{
+  return offset < index->header->strings_size ? &index->strings[offset] : "";
+}
+
+const struct sid_index_entry* sid_index_find_md5(const struct sid_index* index,
+                                                 const uint8_t md5[16])
+{
+  uint32_t lo = 0;
+  uint32_t hi = index->header->count;
+
+  while (lo < hi) {
+    uint32_t mid = lo + (hi - lo) / 2;
+
+    if (memcmp(index->entries[mid].md5, md5, 16) < 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+  if (lo < index->header->count && memcmp(index->entries[lo].md5, md5, 16) == 0)
+    return &index->entries[lo];
+
+  return NULL;
+}
+
+const struct sid_index_entry* sid_index_find_path(const struct sid_index* index,
+                                                  const char* path)
+{
+  uint32_t lo = 0;
+  uint32_t hi = index->header->count;
+
+  while (lo < hi) {
+    uint32_t mid = lo + (hi - lo) / 2;
+    const struct sid_index_entry* e = &index->entries[index->by_path[mid]];
+    int cmp = strcmp(sid_index_string(index, e->path), path);
+
+    if (cmp == 0)
+      return e;
+
+    if (cmp < 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+  return NULL;
+}
+
+/* RFC 1321 */
+
+static const uint32_t md5_k[64] = {
+  0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+  0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+  0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+  0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+  0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+  0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+  0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+  0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391,
+};
+
+static const uint8_t md5_r[64] = {
+  7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+  5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20,
+  4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+  6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21,
+};
+
+static void md5_block(uint32_t h[4], const uint8_t* block)
+{
+  uint32_t w[16];
+  uint32_t a = h[0];
+  uint32_t b = h[1];
+  uint32_t c = h[2];
+  uint32_t d = h[3];
+
+  for (int i = 0; i < 16; i++) {
+    w[i] = block[i * 4] | (block[i * 4 + 1] << 8) | (block[i * 4 + 2] << 16) |
+           ((uint32_t)block[i * 4 + 3] << 24);
+  }
+
+  for (int i = 0; i < 64; i++) {
+    uint32_t f;
+    int g;
+
+    if (i < 16) {
+      f = (b & c) | (~b & d);
+      g = i;
+    } else if (i < 32) {
+      f = (d & b) | (~d & c);
+      g = (5 * i + 1) % 16;
+    } else if (i < 48) {
+      f = b ^ c ^ d;
+      g = (3 * i + 5) % 16;
+    } else {
+      f = c ^ (b | ~d);
+      g = (7 * i) % 16;
+    }
+
+    f += a + md5_k[i] + w[g];
+    a = d;
+    d = c;
+    c = b;
+    b += (f << md5_r[i]) | (f >> (32 - md5_r[i]));
+  }
+
+  h[0] += a;
+  h[1] += b;
+  h[2] += c;
+  h[3] += d;
+}
+
+void sid_index_md5(const uint8_t* data, size_t size, uint8_t md5[16])
+{
+  uint32_t h[4] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476 };
+  uint8_t tail[128] = { 0 };
+  size_t rest = size % 64;
+  size_t tail_size = rest < 56 ? 64 : 128;
+  uint64_t bits = (uint64_t)size * 8;
+
+  for (size_t pos = 0; pos + 64 <= size; pos += 64) {
+    md5_block(h, &data[pos]);
+  }
+
+  memcpy(tail, &data[size - rest], rest);
+  tail[rest] = 0x80;
+  for (int i = 0; i < 8; i++) {
+    tail[tail_size - 8 + i] = bits >> (i * 8);
+  }
+
+  md5_block(h, tail);
+  if (tail_size == 128) {
+    md5_block(h, &tail[64]);
+  }
+
+  for (int i = 0; i < 16; i++) {
+    md5[i] = h[i / 4] >> ((i % 4) * 8);
+  }
+}
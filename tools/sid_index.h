@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef SID_INDEX_H
+#define SID_INDEX_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Catalog of a SID collection, written by sidindex and mapped as it is by
+ * the tools that query it. All numbers are little endian, the file is
+ *
+ *   header
+ *   entries, sorted by MD5, then by path
+ *   by_path, entry numbers sorted by path
+ *   string table, NUL terminated, offset 0 is the empty string
+ *
+ * The MD5 covers the whole file, as the HVSC song length database uses it.
+ */
+#define SID_INDEX_MAGIC     "SIDX"
+#define SID_INDEX_VERSION   1
+
+#define SID_INDEX_RSID      0x0001
+#define SID_INDEX_PACKED    0x0002      /* made by sidpack */
+#define SID_INDEX_MUS       0x0004      /* Compute!'s Sidplayer data */
+#define SID_INDEX_BASIC     0x0008      /* RSID that needs the BASIC ROM */
+#define SID_INDEX_PAL       0x0010
+#define SID_INDEX_NTSC      0x0020
+#define SID_INDEX_6581      0x0040
+#define SID_INDEX_8580      0x0080
+#define SID_INDEX_CIA       0x0100      /* a song is timed by CIA 1 */
+#define SID_INDEX_IRQ_PLAY  0x0200      /* no play address, init sets a vector */
+#define SID_INDEX_MULTI     0x0400      /* more than one SID */
+#define SID_INDEX_BAD       0x8000      /* header not usable, only the hash is valid */
+
+struct sid_index_header
+{
+    char     magic[4];
+    uint32_t version;
+    uint32_t count;
+    uint32_t by_path;           /* file offsets */
+    uint32_t strings;
+    uint32_t strings_size;
+    uint32_t reserved[2];
+};
+
+struct sid_index_entry
+{
+    uint8_t  md5[16];
+    int64_t  mtime_ns;          /* of the file when it was hashed */
+    uint32_t size;
+    uint32_t path;              /* string table offsets */
+    uint32_t title;
+    uint32_t author;
+    uint32_t released;
+    uint16_t load_addr;
+    uint16_t init_addr;
+    uint16_t play_addr;
+    uint16_t flags;
+    uint8_t  subsongs;          /* last song, like sid_info */
+    uint8_t  start_song;
+    uint8_t  version;
+    uint8_t  sid2;              /* address bits 4-11 of the second and third SID */
+    uint32_t speed;             /* bit n set: song n is timed by CIA 1 */
+    uint8_t  sid3;
+    uint8_t  reserved[3];
+};
+
+struct sid_index
+{
+    const uint8_t* map;
+    size_t size;
+    const struct sid_index_header* header;
+    const struct sid_index_entry* entries;
+    const uint32_t* by_path;
+    const char* strings;
+};
+
+bool sid_index_open(struct sid_index* index, const char* path);
+void sid_index_close(struct sid_index* index);
+
+const char* sid_index_string(const struct sid_index* index, uint32_t offset);
+
+/* The first entry with the hash, the ones with the same hash follow it */
+const struct sid_index_entry* sid_index_find_md5(const struct sid_index* index,
+                                                 const uint8_t md5[16]);
+const struct sid_index_entry* sid_index_find_path(const struct sid_index* index,
+                                                  const char* path);
+
+void sid_index_md5(const uint8_t* data, size_t size, uint8_t md5[16]);
+
+#endif /* SID_INDEX_H */
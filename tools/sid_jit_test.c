@@ -0,0 +1,193 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Plays every subsong of the given tunes on the interpreter and on the JIT
+ * and compares them frame by frame: the SID writes as the SPI layer of
+ * tools/sid_render.c records them, the cycle and instruction counters and
+ * the whole memory. Reports the first frame that differs.
+ *
+ *   sid_jit_test [-f frames] [-n songs] file.sid...
+ *
+ * Build it with -DC64_JIT, src/c64_jit.c and tools/sid_render.c.
+ */
+
+#include "c64.h"
+#include "c64_jit.h"
+#include "sid.h"
+#include "sid_proto.h"
+#include "sid_clock.h"
+#include "sid_render.h"
+#include "host.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+struct frame
+{
+  uint32_t writes;              /* hash */
+  uint32_t n_writes;
+  uint32_t cycles;
+  uint32_t instructions;
+  uint32_t memory;              /* hash */
+};
+
+static uint32_t fnv1a(uint32_t hash, const uint8_t* data, size_t len)
+{
+  while (len--) {
+    hash ^= *data++;
+    hash *= 16777619U;
+  }
+
+  return hash;
+}
+
+static bool play(const uint8_t* data, size_t size, uint8_t song, bool jit,
+                 struct frame* frames, uint32_t n_frames)
+{
+  static uint8_t mem[65536];
+  struct sid_info info;
+
+  c64_cpu_set_jit(jit);
+  sid_set_regs((const uint8_t[SID_NUM_REGS]){ 0 });
+  c64_init();
+
+  if (!sid_parse_header(data, size, &info) || !sid_load_payload(data, size))
+    return false;
+
+  sid_set_clock(info.clock);
+  sid_clock_set(SID_CLOCK_CHIP);
+  c64_cpu_jsr(info.init_addr, song);
+
+  if (info.play_addr == 0) {
+    info.play_addr = (c64_getmem(0x0315) << 8) | c64_getmem(0x0314);
+  }
+
+  sid_render_start((const uint8_t[SID_NUM_REGS]){ 0 });
+
+  for (uint32_t f = 0; f < n_frames; f++) {
+    sid_render_frame(info.play_addr);
+
+    frames[f].writes = fnv1a(2166136261U, (const uint8_t*)sid_render_writes,
+                             sid_render_n_writes * sizeof(sid_render_writes[0]));
+    frames[f].n_writes = sid_render_n_writes;
+    frames[f].cycles = c64_cpu_cycles();
+    frames[f].instructions = c64_cpu_instructions();
+
+    c64_memread(mem, 0, sizeof(mem));
+    frames[f].memory = fnv1a(2166136261U, mem, sizeof(mem));
+  }
+
+  c64_cpu_set_jit(false);
+
+  return true;
+}
+
+static const char* differs(const struct frame* a, const struct frame* b)
+{
+  if (a->writes != b->writes || a->n_writes != b->n_writes)
+    return "SID writes";
+  if (a->cycles != b->cycles)
+    return "cycles";
+  if (a->instructions != b->instructions)
+    return "instructions";
+  if (a->memory != b->memory)
+    return "memory";
+
+  return NULL;
+}
+
+int main(int argc, char** argv)
+{
+  uint32_t n_frames = 3000;
+  uint32_t max_songs = 256;
+  struct frame* interpreted;
+  struct frame* translated;
+  int res = 0;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "f:n:")) != -1) {
+    switch (opt) {
+      case 'f':
+        n_frames = strtoul(optarg, NULL, 0);
+        break;
+      case 'n':
+        max_songs = strtoul(optarg, NULL, 0);
+        break;
+      default:
+        fprintf(stderr, "usage: %s [-f frames] [-n songs] file.sid...\n", argv[0]);
+        return 1;
+    }
+  }
+
+  if (!n_frames || !max_songs) {
+    fprintf(stderr, "frames and songs must be at least 1\n");
+    return 1;
+  }
+
+  interpreted = calloc(n_frames, sizeof(*interpreted));
+  translated = calloc(n_frames, sizeof(*translated));
+  if (!interpreted || !translated)
+    return 1;
+
+  sid_proto_init(SID_PROTO_MODE_BLOCKING, false);
+  sid_mute(false);
+
+  for (int i = optind; i < argc; i++) {
+    size_t size;
+    uint8_t* data = host_load_file(argv[i], &size);
+    struct sid_info info;
+    uint32_t songs;
+
+    if (!data || !sid_parse_header(data, size, &info)) {
+      fprintf(stderr, "%s: not a SID file\n", argv[i]);
+      res = 1;
+      free(data);
+      continue;
+    }
+
+    songs = info.subsongs + 1U < max_songs ? info.subsongs + 1U : max_songs;
+
+    for (uint32_t song = 0; song < songs; song++) {
+      struct c64_jit_stats stats;
+      uint32_t writes = 0;
+      uint32_t f;
+
+      if (!play(data, size, song, false, interpreted, n_frames) ||
+          !play(data, size, song, true, translated, n_frames)) {
+        fprintf(stderr, "%s: cannot load\n", argv[i]);
+        res = 1;
+        break;
+      }
+      c64_jit_get_stats(&stats);
+
+      for (f = 0; f < n_frames; f++) {
+        const char* what = differs(&interpreted[f], &translated[f]);
+
+        if (what) {
+          printf("%s song %u: %s differ in frame %u\n", argv[i], song + 1, what, f);
+          res = 1;
+          break;
+        }
+        writes += interpreted[f].n_writes;
+      }
+
+      if (f == n_frames) {
+        printf("%s song %u: %u frames, %u writes, %u instructions the same,"
+               " %u blocks, %u invalidated, %u interpreted\n",
+               argv[i], song + 1, n_frames, writes, interpreted[n_frames - 1].instructions,
+               stats.blocks, stats.invalidated, stats.fallbacks);
+      }
+    }
+
+    free(data);
+  }
+
+  free(interpreted);
+  free(translated);
+
+  return res;
+}
@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Link training and frame CRC checks against the bridge model with boards
+ * of different quality.
+ *
+ *   sid_link_test [-f frames] file.sid
+ *
+ * For every simulated board the link is trained, then the tune is played
+ * with frame checks at the trained clock and once more starting at the
+ * fastest clock to show the fallback.
+ */
+
+#include "c64.h"
+#include "sid.h"
+#include "sid_proto.h"
+#include "sid_spi.h"
+#include "sid_bridge_model.h"
+#include "host.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define FRAME_NS 20000000ULL
+#define PCLK_HZ  170000000U
+
+/* Fastest clock the wiring of each simulated board survives */
+static const uint32_t boards[] = { 6000000, 12000000, 30000000, 0 };
+
+static int play(const uint8_t* data, size_t size, uint32_t frames, const char* what)
+{
+  struct sid_proto_stats proto;
+  struct sid_bridge_model_stats model;
+  struct sid_info info;
+  uint8_t shadow[SID_NUM_REGS];
+  uint8_t regs[32];
+  int match;
+
+  sid_proto_set_verify(true);
+  sid_proto_reset_stats();
+
+  c64_init();
+  sid_load_from_memory(data, size, &info);
+  c64_cpu_jsr(info.init_addr, info.start_song);
+  sid_flush();
+
+  for (uint32_t frame = 0; frame < frames; frame++) {
+    c64_cpu_jsr(info.play_addr, 0);
+    sid_flush();
+    sid_bridge_model_idle(FRAME_NS);
+  }
+
+  /* One clean frame so a final failed check has been repaired */
+  sid_flush();
+
+  sid_proto_get_stats(&proto);
+  sid_bridge_model_get_stats(&model);
+  sid_bridge_model_get_regs(regs);
+  sid_get_regs(shadow);
+  match = memcmp(regs, shadow, SID_NUM_REGS) == 0;
+
+  printf("  %-8s %6.2f MHz %6u checks %5u crc errors %2u fallbacks %s\n",
+         what, proto.rate / 1e6, proto.checks, proto.crc_errors,
+         proto.fallbacks, match ? "ok" : "MISMATCH");
+
+  return match ? 0 : -1;
+}
+
+int main(int argc, char** argv)
+{
+  uint32_t frames = 3000;
+  uint8_t* data;
+  size_t size;
+  int res = 0;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "f:")) != -1) {
+    switch (opt) {
+      case 'f':
+        frames = strtoul(optarg, NULL, 0);
+        break;
+      default:
+        fprintf(stderr, "usage: %s [-f frames] file.sid\n", argv[0]);
+        return 1;
+    }
+  }
+
+  if (optind >= argc) {
+    fprintf(stderr, "usage: %s [-f frames] file.sid\n", argv[0]);
+    return 1;
+  }
+
+  data = host_load_file(argv[optind], &size);
+  if (!data)
+    return 1;
+
+  for (size_t b = 0; b < sizeof(boards) / sizeof(boards[0]); b++) {
+    struct sid_bridge_model_config cfg = {
+      .spi_hz = SID_SPI_DEFAULT_FREQUENCY,
+      .cs_overhead_ns = 2000,
+      .drain_ns = 1000,
+      .max_hz = boards[b],
+      .pclk_hz = PCLK_HZ,
+    };
+    struct sid_proto_stats proto;
+    uint32_t rate;
+
+    sid_bridge_model_init(&cfg);
+    sid_proto_init(SID_PROTO_MODE_PIPELINED, true);
+
+    rate = sid_proto_train();
+    sid_proto_get_stats(&proto);
+
+    printf("board limit %6.2f MHz: trained %6.2f MHz (%u failed rounds)\n",
+           boards[b] / 1e6, rate / 1e6, proto.echo_errors);
+
+    if (!rate) {
+      res = 1;
+      continue;
+    }
+
+    if (play(data, size, frames, "trained") < 0)
+      res = 1;
+
+    sid_spi_set_frequency(PCLK_HZ / 2);
+    if (play(data, size, frames, "fastest") < 0)
+      res = 1;
+  }
+
+  free(data);
+
+  return res;
+}
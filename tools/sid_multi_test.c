@@ -0,0 +1,242 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Plays up to SID_MULTI_MAX_PLAYERS tunes at once through sid_multi on a
+ * simulated board and reports the deadline misses of every player and the
+ * load, to see how many bridges one MCU keeps up with.
+ *
+ *   sid_multi_test [-s seconds] [-c core MHz] [-i cycles/instr] [-k SPI Hz]
+ *                  file.sid[:song]...
+ *
+ * The board clock only moves while it waits, while the SPI is busy and by
+ * the projected MCU time of the emulated instructions, like sid_profile
+ * projects it. -i defaults to a rough figure for the generic core with
+ * sparse accesses, the players never run on the predecoded one. Songs count
+ * from 1, the start song is the default. The players always use blocking
+ * mode without bursts, see sid_multi.h.
+ */
+
+#include "c64.h"
+#include "sid.h"
+#include "sid_proto.h"
+#include "sid_spi.h"
+#include "sid_digi.h"
+#include "sid_multi.h"
+#include "sid_clock.h"
+#include "host.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Chip select, driver call and completion of one transfer */
+#define CS_COST_NS      1500
+
+static double core_mhz = 170;
+static double cycles_per_insn = 60;
+static double spi_hz = SID_SPI_DEFAULT_FREQUENCY;
+
+static uint64_t idle_ns;
+static uint64_t link_ns;
+static uint8_t bridge;
+static uint64_t bridge_bytes[SID_SPI_MAX_BRIDGES];
+
+static void transfer(size_t len)
+{
+  link_ns += CS_COST_NS + (uint64_t)(len * 8 * 1e9 / spi_hz);
+  bridge_bytes[bridge] += len;
+}
+
+void sid_spi_transfer( uint8_t cmd_addr, uint8_t wr_data,
+                       uint8_t* status, uint8_t* rd_data)
+{
+  transfer(2);
+  *status = 0;
+  *rd_data = 0;
+}
+
+void sid_spi_transceive(const uint8_t* tx, uint8_t* rx, size_t len)
+{
+  transfer(len);
+  if (rx) {
+    memset(rx, 0, len);
+  }
+}
+
+int sid_spi_get_rates(uint32_t* rates, int max)
+{
+  if (max < 1)
+    return 0;
+
+  rates[0] = spi_hz;
+
+  return 1;
+}
+
+void sid_spi_set_frequency(uint32_t hz)
+{
+}
+
+uint32_t sid_spi_get_frequency(void)
+{
+  return spi_hz;
+}
+
+void sid_spi_select(uint8_t b)
+{
+  bridge = b;
+}
+
+int sid_spi_init(void)
+{
+  return 0;
+}
+
+int sid_digi_timer_init(void)
+{
+  return 0;
+}
+
+uint32_t sid_digi_timer_now(void)
+{
+  struct sid_multi_stats s;
+  uint64_t instructions = 0;
+
+  sid_multi_get_stats(&s);
+  for (uint8_t i = 0; i < s.players; i++) {
+    instructions += s.player[i].instructions;
+  }
+
+  return (idle_ns + link_ns + (uint64_t)(instructions * cycles_per_insn * 1000 / core_mhz)) /
+         1000;
+}
+
+void sid_digi_timer_wait(uint32_t until)
+{
+  int32_t us = until - sid_digi_timer_now();
+
+  if (us > 0) {
+    idle_ns += us * 1000ULL;
+  }
+}
+
+void sid_digi_timer_wake(void)
+{
+}
+
+void sid_digi_lock(void)
+{
+}
+
+void sid_digi_unlock(void)
+{
+}
+
+int main(int argc, char** argv)
+{
+  struct sid_multi_stats s;
+  double seconds = 60;
+  uint32_t load;
+  uint8_t running;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "s:c:i:k:")) != -1) {
+    switch (opt) {
+      case 's':
+        seconds = strtod(optarg, NULL);
+        break;
+      case 'c':
+        core_mhz = strtod(optarg, NULL);
+        break;
+      case 'i':
+        cycles_per_insn = strtod(optarg, NULL);
+        break;
+      case 'k':
+        spi_hz = strtod(optarg, NULL);
+        break;
+      default:
+        fprintf(stderr, "usage: %s [-s seconds] [-c core MHz] [-i cycles/instr]"
+                " [-k SPI Hz] file.sid[:song]...\n", argv[0]);
+        return 1;
+    }
+  }
+
+  if (optind == argc || argc - optind > SID_MULTI_MAX_PLAYERS) {
+    fprintf(stderr, "1 to %u tunes\n", SID_MULTI_MAX_PLAYERS);
+    return 1;
+  }
+
+  if (seconds <= 0 || seconds > 3600 || core_mhz <= 0 || spi_hz <= 0) {
+    fprintf(stderr, "up to an hour, core and SPI clock above 0\n");
+    return 1;
+  }
+
+  sid_proto_init(SID_PROTO_DEFAULT_MODE, SID_PROTO_DEFAULT_BURST);
+  c64_init();
+  sid_multi_init();
+
+  for (int i = optind; i < argc; i++) {
+    char* name = argv[i];
+    char* colon = strrchr(name, ':');
+    struct sid_info info;
+    uint8_t* data;
+    size_t size;
+    int song = 0;
+
+    if (colon) {
+      *colon = '\0';
+      song = atoi(colon + 1);
+    }
+
+    data = host_load_file(name, &size);
+    if (!data || !sid_parse_header(data, size, &info)) {
+      fprintf(stderr, "%s: not a SID file\n", name);
+      return 1;
+    }
+
+    sid_multi_add(data, size, song > 0 ? song - 1 : info.start_song);
+  }
+
+  printf("%.0f MHz core, %.1f cycles per instruction, %.1f MHz SPI, %.0f s\n",
+         core_mhz, cycles_per_insn, spi_hz / 1e6, seconds);
+
+  running = sid_multi_start();
+
+  do {
+    sid_multi_poll();
+    sid_multi_get_stats(&s);
+  } while (s.elapsed_us < seconds * 1e6);
+
+  for (uint8_t i = 0; i < s.players; i++) {
+    struct sid_multi_player_stats* p = &s.player[i];
+    uint32_t frames = p->frames ? p->frames : 1;
+
+    printf("player %u %s: %s, %u pages", i, argv[optind + i],
+           p->running ? sid_clock_name(p->clock) : "stopped", p->pages);
+    if (p->frames) {
+      printf(", %u frames, %u misses, %u overruns, late max %u us\n"
+             "  play mean %u us max %u us, %u instructions and %.1f writes per frame,"
+             " %u lost, %.0f SPI bytes/s\n",
+             p->frames, p->misses, p->overruns, p->late_max_us,
+             (uint32_t)(p->play_sum_us / frames), p->play_max_us,
+             p->instructions / frames, (double)p->writes / frames, p->lost_writes,
+             bridge_bytes[i] * 1e6 / s.elapsed_us);
+    } else {
+      printf("\n");
+    }
+  }
+
+  load = (uint32_t)(s.busy_us * 1000 / s.elapsed_us);
+  printf("load %u.%u%% mean, %u.%u%% peak", load / 10, load % 10,
+         s.load_max / 10, s.load_max % 10);
+  if (running && load) {
+    printf(", the core would keep up with about %u players like these",
+           running * 1000 / load);
+  }
+  printf("\n");
+
+  return 0;
+}
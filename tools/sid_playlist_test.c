@@ -0,0 +1,206 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Plays the given tunes as a gapless playlist and checks every frame against
+ * a fresh load and init of the same tune, the way the player started tunes
+ * before. Reports the cost of the switch frames and of a fresh start.
+ *
+ *   sid_playlist_test [-f frames] [-l loops] file.sid...
+ *
+ * Every tune plays for the given number of frames, the playlist wraps around
+ * loops times. It takes at least two tunes, a single one never switches.
+ * Fails when a frame differs from the reference.
+ */
+
+#include "c64.h"
+#include "sid.h"
+#include "sid_proto.h"
+#include "sid_seek.h"
+#include "sid_playlist.h"
+#include "host.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MAX_FRAMES 20000
+
+struct reference
+{
+  uint32_t regs_hash[MAX_FRAMES];
+  uint32_t mem_hash;        /* after the last frame */
+  uint64_t start_ns;        /* load and init from scratch */
+};
+
+static uint8_t mem[65536];
+
+static uint32_t fnv1a(uint32_t h, const uint8_t* data, size_t len)
+{
+  while (len--) {
+    h = (h ^ *data++) * 16777619U;
+  }
+
+  return h;
+}
+
+static uint32_t regs_hash(void)
+{
+  uint8_t regs[SID_NUM_REGS];
+
+  sid_get_regs(regs);
+
+  return fnv1a(2166136261U, regs, sizeof(regs));
+}
+
+static uint32_t mem_hash(void)
+{
+  c64_memread(mem, 0, sizeof(mem));
+
+  return fnv1a(2166136261U, mem, sizeof(mem));
+}
+
+static void reference_run(struct reference* ref, const uint8_t* data, size_t size,
+                          uint32_t frames)
+{
+  static const uint8_t start_regs[SID_NUM_REGS] = { [0x18] = SID_PLAYLIST_START_VOLUME };
+  struct sid_info info;
+  struct sid_info header;
+  uint64_t start = host_time_ns();
+
+  sid_parse_header(data, size, &header);
+
+  sid_mute(true);
+  sid_set_regs(start_regs);
+  c64_init();
+  sid_load_from_memory(data, size, &info);
+  c64_cpu_jsr(info.init_addr, header.start_song);
+
+  ref->start_ns = host_time_ns() - start;
+
+  for (uint32_t frame = 0; frame < frames; frame++) {
+    c64_cpu_jsr(info.play_addr, 0);
+    ref->regs_hash[frame] = regs_hash();
+  }
+
+  ref->mem_hash = mem_hash();
+  sid_mute(false);
+}
+
+int main(int argc, char** argv)
+{
+  struct sid_playlist_stats stats;
+  struct sid_proto_stats proto;
+  struct reference* refs;
+  uint32_t frames = 500;
+  uint32_t loops = 2;
+  uint64_t switch_ns = 0;
+  uint64_t frame_ns = 0;
+  uint32_t switch_writes = 0;
+  uint32_t errors = 0;
+  int n;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "f:l:")) != -1) {
+    switch (opt) {
+      case 'f':
+        frames = strtoul(optarg, NULL, 0);
+        break;
+      case 'l':
+        loops = strtoul(optarg, NULL, 0);
+        break;
+      default:
+        fprintf(stderr, "usage: %s [-f frames] [-l loops] file.sid...\n", argv[0]);
+        return 1;
+    }
+  }
+
+  n = argc - optind;
+  /* A single tune never switches */
+  if (n < 2 || n > SID_PLAYLIST_MAX_TUNES || frames < 1 || frames > MAX_FRAMES) {
+    fprintf(stderr, "2 to %d files, 1 to %d frames\n", SID_PLAYLIST_MAX_TUNES, MAX_FRAMES);
+    return 1;
+  }
+
+  refs = calloc(n, sizeof(*refs));
+
+  sid_proto_init(SID_PROTO_MODE_BLOCKING, false);
+  sid_playlist_init();
+
+  for (int i = 0; i < n; i++) {
+    size_t size;
+    uint8_t* data = host_load_file(argv[optind + i], &size);
+    struct sid_info header;
+
+    if (!data || !sid_parse_header(data, size, &header))
+      return 1;
+
+    reference_run(&refs[i], data, size, frames);
+    sid_playlist_add(data, size, header.start_song, frames);
+  }
+
+  sid_set_regs((const uint8_t[SID_NUM_REGS]){ 0 });
+  sid_playlist_start();
+
+  for (uint32_t total = 0; total < n * frames * loops; total++) {
+    uint8_t tune = sid_playlist_current();
+    uint32_t pos = sid_seek_position();
+    uint64_t start;
+    uint64_t ns;
+
+    sid_proto_reset_stats();
+    start = host_time_ns();
+
+    sid_playlist_play();
+    sid_flush();
+
+    ns = host_time_ns() - start;
+    sid_proto_get_stats(&proto);
+
+    /* The first frame of a tune is the switch frame, except at the start */
+    if (total && sid_playlist_current() != tune) {
+      switch_ns += ns;
+      switch_writes += proto.writes;
+      tune = sid_playlist_current();
+      pos = 0;
+    } else {
+      frame_ns += ns;
+    }
+
+    if (regs_hash() != refs[tune].regs_hash[pos]) {
+      if (errors++ < 10) {
+        printf("tune %u frame %u: registers differ\n", tune, pos);
+      }
+    }
+
+    sid_seek_frame();
+
+    if (pos + 1 == frames && mem_hash() != refs[tune].mem_hash) {
+      if (errors++ < 10) {
+        printf("tune %u frame %u: memory differs\n", tune, pos);
+      }
+    }
+
+    sid_playlist_idle();
+  }
+
+  sid_playlist_get_stats(&stats);
+
+  for (int i = 0; i < n; i++) {
+    printf("%-28s fresh start %7.1f us\n", argv[optind + i], refs[i].start_ns / 1000.0);
+  }
+
+  printf("%u switches, %u gapless, %u late, %u fallbacks\n",
+         stats.switches, stats.gapless, stats.late, stats.fallbacks);
+  printf("last preload: %u frames, %u init instructions, %u pages, %u registers changed\n",
+         stats.preload_frames, stats.init_instructions, stats.pages, stats.regs_changed);
+  printf("switch frame %.1f us and %.1f writes, other frames %.1f us\n",
+         stats.switches ? switch_ns / 1000.0 / stats.switches : 0.0,
+         stats.switches ? (double)switch_writes / stats.switches : 0.0,
+         frame_ns / 1000.0 / (n * frames * loops - stats.switches));
+  printf("%s\n", errors ? "MISMATCH" : "ok");
+
+  return errors ? 1 : 0;
+}
@@ -0,0 +1,327 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Profiles the cost of every frame of every subsong, to find the tunes that
+ * do not fit the board before they are deployed.
+ *
+ *   sid_profile [-s seconds] [-c core MHz] [-i cycles/instr] [-k SPI Hz]
+ *               [-p] [-b budget %] [-w worst] [-o frames.csv] file.sid...
+ *
+ * Every subsong is initialised and played like the firmware does it, on the
+ * core c64_cpu_optimize() picks, for the given number of seconds. Per frame
+ * the emulated instructions and cycles, the SID writes, the SPI bytes and
+ * chip selects and the host time are recorded. -o writes them all as CSV.
+ *
+ * The MCU time of a frame is projected from the emulated instructions times
+ * the MCU cycles one takes at the given core clock, plus the SPI bytes at the
+ * given SPI clock and a fixed cost per chip select. -i defaults to a rough
+ * figure for the predecoded core on the G474, calibrate it against the board.
+ * -p profiles the pipelined mode with bursts instead of the default mode.
+ *
+ * A subsong whose worst frame takes more than the budget share of a frame
+ * needs lookahead when its mean fits, pre-rendering when it does not.
+ */
+
+#include "c64.h"
+#include "sid.h"
+#include "sid_proto.h"
+#include "sid_spi.h"
+#include "sid_seek.h"
+#include "host.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define FRAME_US        (1000000 / SID_SEEK_FRAMES_PER_SECOND)
+
+/* Chip select, DMA setup and completion of one transfer */
+#define CS_COST_US      1.5
+
+struct sample
+{
+  uint32_t instructions;
+  uint32_t cycles;
+  uint32_t writes;
+  uint32_t bytes;
+  uint32_t transfers;
+  uint32_t host_ns;
+  float mcu_us;
+};
+
+struct config
+{
+  uint32_t frames;
+  double core_mhz;
+  double cycles_per_insn;
+  double spi_hz;
+  double budget;
+  uint32_t worst;
+  FILE* csv;
+};
+
+static double project(const struct config* cfg, const struct sample* s)
+{
+  return s->instructions * cfg->cycles_per_insn / cfg->core_mhz +
+         s->bytes * 8 * 1e6 / cfg->spi_hz + s->transfers * CS_COST_US;
+}
+
+static int cmp_double(const void* a, const void* b)
+{
+  double x = *(const double*)a;
+  double y = *(const double*)b;
+
+  return (x > y) - (x < y);
+}
+
+static double percentile(const double* sorted, uint32_t n, double p)
+{
+  uint32_t i = (uint32_t)(p / 100.0 * (n - 1) + 0.5);
+
+  return sorted[i];
+}
+
+static void summarize(const char* name, const struct sample* samples, uint32_t n,
+                      size_t offset, bool is_float, double scale, double* sorted)
+{
+  double sum = 0;
+
+  for (uint32_t i = 0; i < n; i++) {
+    const void* field = (const uint8_t*)&samples[i] + offset;
+
+    sorted[i] = (is_float ? *(const float*)field : *(const uint32_t*)field) * scale;
+    sum += sorted[i];
+  }
+
+  qsort(sorted, n, sizeof(*sorted), cmp_double);
+
+  printf("    %-12s %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f\n", name, sum / n,
+         percentile(sorted, n, 50), percentile(sorted, n, 90),
+         percentile(sorted, n, 99), percentile(sorted, n, 99.9), sorted[n - 1]);
+}
+
+static void print_worst(const struct config* cfg, const struct sample* samples, uint32_t n)
+{
+  uint32_t* worst = calloc(cfg->worst, sizeof(*worst));
+  uint32_t found = 0;
+
+  /* Few enough to pick by selection, frames are only reported once */
+  for (uint32_t w = 0; w < cfg->worst && w < n; w++) {
+    uint32_t best = UINT32_MAX;
+
+    for (uint32_t i = 0; i < n; i++) {
+      bool taken = false;
+
+      for (uint32_t j = 0; j < found; j++) {
+        taken |= worst[j] == i;
+      }
+
+      if (!taken && (best == UINT32_MAX || samples[i].mcu_us > samples[best].mcu_us)) {
+        best = i;
+      }
+    }
+
+    worst[found++] = best;
+  }
+
+  for (uint32_t w = 0; w < found; w++) {
+    const struct sample* s = &samples[worst[w]];
+    uint32_t frame = worst[w];
+
+    printf("    worst frame %6u at %2u:%02u.%02u %7.1f us: %5u instr %6u cycles"
+           " %3u writes %4u bytes\n",
+           frame, frame / SID_SEEK_FRAMES_PER_SECOND / 60,
+           frame / SID_SEEK_FRAMES_PER_SECOND % 60,
+           frame % SID_SEEK_FRAMES_PER_SECOND * (100 / SID_SEEK_FRAMES_PER_SECOND),
+           s->mcu_us, s->instructions, s->cycles, s->writes, s->bytes);
+  }
+
+  free(worst);
+}
+
+static void profile(const struct config* cfg, const char* path, const uint8_t* data,
+                    size_t size, uint8_t song, struct sample* samples)
+{
+  static double sorted[SID_SEEK_FRAMES_PER_SECOND * 3600];
+  struct sid_proto_stats proto;
+  struct sid_info info;
+  double sum_us = 0;
+  double max_us = 0;
+  double budget_us = FRAME_US * cfg->budget / 100.0;
+
+  sid_mute(true);
+  c64_init();
+  sid_load_from_memory(data, size, &info);
+  sid_set_regs((const uint8_t[SID_NUM_REGS]){ 0 });
+  c64_cpu_jsr(info.init_addr, song);
+  sid_mute(false);
+  sid_flush();
+
+  c64_cpu_optimize(info.play_addr, NULL);
+
+  for (uint32_t frame = 0; frame < cfg->frames; frame++) {
+    struct sample* s = &samples[frame];
+    uint32_t instructions = c64_cpu_instructions();
+    uint32_t cycles = c64_cpu_cycles();
+    uint64_t start;
+
+    sid_proto_reset_stats();
+    start = host_time_ns();
+
+    c64_cpu_jsr(info.play_addr, 0);
+    sid_flush();
+
+    s->host_ns = host_time_ns() - start;
+    s->instructions = c64_cpu_instructions() - instructions;
+    s->cycles = c64_cpu_cycles() - cycles;
+
+    sid_proto_get_stats(&proto);
+    s->writes = proto.writes;
+    s->bytes = proto.bytes;
+    s->transfers = proto.transfers;
+    s->mcu_us = project(cfg, s);
+
+    sum_us += s->mcu_us;
+    if (s->mcu_us > max_us) {
+      max_us = s->mcu_us;
+    }
+
+    if (cfg->csv) {
+      fprintf(cfg->csv, "%s,%u,%u,%u,%u,%u,%u,%u,%u,%.2f\n", path, song + 1, frame,
+              s->instructions, s->cycles, s->writes, s->bytes, s->transfers,
+              s->host_ns, s->mcu_us);
+    }
+  }
+
+  printf("  song %u/%u on the %s core, %u frames\n", song + 1, info.subsongs + 1,
+         c64_core_name(c64_cpu_get_core()), cfg->frames);
+  printf("    %-12s %9s %9s %9s %9s %9s %9s\n", "", "mean", "p50", "p90", "p99",
+         "p99.9", "max");
+
+  summarize("instructions", samples, cfg->frames,
+            offsetof(struct sample, instructions), false, 1, sorted);
+  summarize("cycles", samples, cfg->frames,
+            offsetof(struct sample, cycles), false, 1, sorted);
+  summarize("writes", samples, cfg->frames,
+            offsetof(struct sample, writes), false, 1, sorted);
+  summarize("spi bytes", samples, cfg->frames,
+            offsetof(struct sample, bytes), false, 1, sorted);
+  summarize("host us", samples, cfg->frames,
+            offsetof(struct sample, host_ns), false, 0.001, sorted);
+  summarize("mcu us", samples, cfg->frames,
+            offsetof(struct sample, mcu_us), true, 1, sorted);
+
+  print_worst(cfg, samples, cfg->frames);
+
+  printf("    duty cycle mean %.2f%% worst %.2f%%, %s\n",
+         sum_us / cfg->frames * 100.0 / FRAME_US, max_us * 100.0 / FRAME_US,
+         max_us <= budget_us ? "fits" :
+         sum_us / cfg->frames <= budget_us ? "needs lookahead" : "needs pre-rendering");
+}
+
+int main(int argc, char** argv)
+{
+  struct config cfg = {
+    .frames = 180 * SID_SEEK_FRAMES_PER_SECOND,
+    .core_mhz = 170,
+    .cycles_per_insn = 40,
+    .spi_hz = SID_SPI_DEFAULT_FREQUENCY,
+    .budget = 50,
+    .worst = 5,
+  };
+  enum sid_proto_mode mode = SID_PROTO_DEFAULT_MODE;
+  bool burst = SID_PROTO_DEFAULT_BURST;
+  struct sample* samples;
+  int res = 0;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "s:c:i:k:pb:w:o:")) != -1) {
+    switch (opt) {
+      case 's':
+        cfg.frames = strtod(optarg, NULL) * SID_SEEK_FRAMES_PER_SECOND;
+        break;
+      case 'c':
+        cfg.core_mhz = strtod(optarg, NULL);
+        break;
+      case 'i':
+        cfg.cycles_per_insn = strtod(optarg, NULL);
+        break;
+      case 'k':
+        cfg.spi_hz = strtod(optarg, NULL);
+        break;
+      case 'p':
+        mode = SID_PROTO_MODE_PIPELINED;
+        burst = true;
+        break;
+      case 'b':
+        cfg.budget = strtod(optarg, NULL);
+        break;
+      case 'w':
+        cfg.worst = strtoul(optarg, NULL, 0);
+        break;
+      case 'o':
+        cfg.csv = fopen(optarg, "w");
+        if (!cfg.csv) {
+          perror(optarg);
+          return 1;
+        }
+        break;
+      default:
+        fprintf(stderr, "usage: %s [-s seconds] [-c core MHz] [-i cycles/instr]"
+                " [-k SPI Hz] [-p] [-b budget %%] [-w worst] [-o frames.csv]"
+                " file.sid...\n", argv[0]);
+        return 1;
+    }
+  }
+
+  if (cfg.frames < 1 || cfg.frames > SID_SEEK_FRAMES_PER_SECOND * 3600 ||
+      cfg.core_mhz <= 0 || cfg.spi_hz <= 0) {
+    fprintf(stderr, "1 frame to an hour, core and SPI clock above 0\n");
+    return 1;
+  }
+
+  samples = calloc(cfg.frames, sizeof(*samples));
+
+  sid_proto_init(mode, burst);
+
+  printf("%.0f MHz core, %.1f cycles per instruction, %.1f MHz SPI %s%s,"
+         " budget %.0f%% of %u us\n",
+         cfg.core_mhz, cfg.cycles_per_insn, cfg.spi_hz / 1e6,
+         mode == SID_PROTO_MODE_PIPELINED ? "pipelined" : "blocking",
+         burst ? " burst" : "", cfg.budget, FRAME_US);
+
+  if (cfg.csv) {
+    fprintf(cfg.csv, "file,song,frame,instructions,cycles,writes,spi_bytes,"
+            "transfers,host_ns,mcu_us\n");
+  }
+
+  for (int i = optind; i < argc; i++) {
+    size_t size;
+    uint8_t* data = host_load_file(argv[i], &size);
+    struct sid_info header;
+
+    if (!data || !sid_parse_header(data, size, &header)) {
+      res = 1;
+      continue;
+    }
+
+    printf("%s: %.32s, %.32s\n", argv[i], header.title, header.author);
+
+    /* subsongs holds the last song, counting from 0 like start_song */
+    for (uint32_t song = 0; song <= header.subsongs; song++) {
+      profile(&cfg, argv[i], data, size, song, samples);
+    }
+
+    free(data);
+  }
+
+  if (cfg.csv) {
+    fclose(cfg.csv);
+  }
+  free(samples);
+
+  return res;
+}
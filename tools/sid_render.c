@@ -0,0 +1,208 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Register stream rendering, see sid_render.h.
+ */
+
+#include "sid_render.h"
+#include "c64.h"
+#include "sid_proto.h"
+#include "sid_spi.h"
+#include "sid_digi.h"
+#include "sid_stream.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+struct sid_render_write sid_render_writes[SID_RENDER_MAX_WRITES];
+uint32_t sid_render_n_writes;
+
+/* Registers as the SID has them after the writes so far */
+static uint8_t chip[SID_NUM_REGS];
+
+void sid_spi_transfer( uint8_t cmd_addr, uint8_t wr_data,
+                       uint8_t* status, uint8_t* rd_data)
+{
+  *status = 0;
+  *rd_data = 0;
+}
+
+void sid_spi_transceive(const uint8_t* tx, uint8_t* rx, size_t len)
+{
+  for (size_t i = 0; i + 1 < len; i += 2) {
+    uint8_t reg = tx[i] & SID_PROTO_REG_MASK;
+
+    if ((tx[i] & 0xe0) == SID_PROTO_CMD_WRITE && reg < SID_NUM_REGS &&
+        sid_render_n_writes < SID_RENDER_MAX_WRITES) {
+      sid_render_writes[sid_render_n_writes].reg = reg;
+      sid_render_writes[sid_render_n_writes].val = tx[i + 1];
+      sid_render_n_writes++;
+    }
+  }
+
+  if (rx) {
+    memset(rx, 0, len);
+  }
+}
+
+int sid_spi_get_rates(uint32_t* rates, int max)
+{
+  if (max < 1)
+    return 0;
+
+  rates[0] = SID_SPI_DEFAULT_FREQUENCY;
+
+  return 1;
+}
+
+void sid_spi_set_frequency(uint32_t hz)
+{
+}
+
+uint32_t sid_spi_get_frequency(void)
+{
+  return SID_SPI_DEFAULT_FREQUENCY;
+}
+
+void sid_spi_select(uint8_t bridge)
+{
+}
+
+int sid_spi_init(void)
+{
+  return 0;
+}
+
+int sid_digi_timer_init(void)
+{
+  return 0;
+}
+
+uint32_t sid_digi_timer_now(void)
+{
+  return 0;
+}
+
+void sid_digi_timer_wait(uint32_t until)
+{
+}
+
+void sid_digi_timer_wake(void)
+{
+}
+
+void sid_digi_lock(void)
+{
+}
+
+void sid_digi_unlock(void)
+{
+}
+
+void sid_render_start(const uint8_t regs[SID_NUM_REGS])
+{
+  memcpy(chip, regs, sizeof(chip));
+}
+
+/* A write of the value a register already holds changes nothing on the chip */
+static void drop_unchanged(void)
+{
+  uint32_t n = 0;
+
+  for (uint32_t i = 0; i < sid_render_n_writes; i++) {
+    if (chip[sid_render_writes[i].reg] != sid_render_writes[i].val) {
+      chip[sid_render_writes[i].reg] = sid_render_writes[i].val;
+      sid_render_writes[n++] = sid_render_writes[i];
+    }
+  }
+
+  sid_render_n_writes = n;
+}
+
+void sid_render_frame(uint16_t play_addr)
+{
+  sid_render_n_writes = 0;
+
+  sid_digi_frame();
+  c64_cpu_jsr(play_addr, 0);
+  sid_flush();
+  sid_digi_send(UINT32_MAX / 2);
+
+  drop_unchanged();
+}
+
+void sid_render_canonical(struct sid_render_write* w, uint32_t n)
+{
+  for (uint32_t i = 1; i < n; i++) {
+    struct sid_render_write tmp = w[i];
+    uint32_t j = i;
+
+    for (; j > 0 && w[j - 1].reg > tmp.reg; j--) {
+      w[j] = w[j - 1];
+    }
+    w[j] = tmp;
+  }
+}
+
+void sid_render_put(struct sid_render_buffer* b, uint8_t val)
+{
+  if (b->size == b->max) {
+    b->max = b->max ? b->max * 2 : 65536;
+    b->data = realloc(b->data, b->max);
+  }
+
+  b->data[b->size++] = val;
+}
+
+void sid_render_put_le32(struct sid_render_buffer* b, uint32_t val)
+{
+  for (int i = 0; i < 4; i++) {
+    sid_render_put(b, val >> (i * 8));
+  }
+}
+
+static void encode_run(struct sid_render_buffer* b, const struct sid_render_write* w,
+                       uint32_t n, bool more)
+{
+  uint8_t masks[SID_STREAM_GROUPS] = { 0 };
+  uint8_t groups = more ? SID_STREAM_MORE : 0;
+
+  for (uint32_t i = 0; i < n; i++) {
+    uint8_t g = w[i].reg / SID_STREAM_GROUP_REGS;
+
+    masks[g] |= 1U << (w[i].reg % SID_STREAM_GROUP_REGS);
+    groups |= 1U << g;
+  }
+
+  sid_render_put(b, groups);
+
+  for (uint8_t g = 0; g < SID_STREAM_GROUPS; g++) {
+    if (masks[g]) {
+      sid_render_put(b, masks[g]);
+    }
+  }
+
+  for (uint32_t i = 0; i < n; i++) {
+    sid_render_put(b, w[i].val);
+  }
+}
+
+void sid_render_encode(struct sid_render_buffer* b, const struct sid_render_write* w,
+                       uint32_t n)
+{
+  uint32_t start = 0;
+
+  if (!n) {
+    sid_render_put(b, 0);
+    return;
+  }
+
+  for (uint32_t i = 1; i <= n; i++) {
+    if (i == n || w[i].reg <= w[i - 1].reg) {
+      encode_run(b, &w[start], i - start, i < n);
+      start = i;
+    }
+  }
+}
@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef SID_RENDER_H
+#define SID_RENDER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "sid.h"
+
+/*
+ * Register stream rendering shared by sidloop and sidrender. It brings an
+ * SPI layer that records the writes of a frame, the protocol has to run
+ * blocking without bursts so every write is one SPI frame. Digi writes are
+ * all due at once, after the frame.
+ */
+#define SID_RENDER_MAX_WRITES   4096    /* per frame */
+
+struct sid_render_write
+{
+    uint8_t reg;
+    uint8_t val;
+};
+
+struct sid_render_buffer
+{
+    uint8_t* data;
+    size_t size;
+    size_t max;
+};
+
+/* The writes of the last frame, in the order they reached the SID */
+extern struct sid_render_write sid_render_writes[SID_RENDER_MAX_WRITES];
+extern uint32_t sid_render_n_writes;
+
+/* The registers the SID has before the next frame */
+void sid_render_start(const uint8_t regs[SID_NUM_REGS]);
+
+/* Runs one play call and keeps the writes that change a register */
+void sid_render_frame(uint16_t play_addr);
+
+/*
+ * Writes to one register keep their order, the order between registers
+ * within a frame may change when the runs are batched again. Sorts by
+ * register, stable, to compare frames.
+ */
+void sid_render_canonical(struct sid_render_write* w, uint32_t n);
+
+void sid_render_put(struct sid_render_buffer* b, uint8_t val);
+void sid_render_put_le32(struct sid_render_buffer* b, uint32_t val);
+
+/* Appends the frame in the format of sid_stream.h */
+void sid_render_encode(struct sid_render_buffer* b, const struct sid_render_write* w,
+                       uint32_t n);
+
+#endif /* SID_RENDER_H */
@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * SPI layer that drops everything, for tools that only care about the
+ * emulator. Digi writes are due immediately.
+ */
+
+#include "sid_spi.h"
+#include "sid_digi.h"
+
+#include <string.h>
+
+static uint32_t frequency = SID_SPI_DEFAULT_FREQUENCY;
+
+void sid_spi_transfer( uint8_t cmd_addr, uint8_t wr_data,
+                       uint8_t* status, uint8_t* rd_data)
+{
+  *status = 0;
+  *rd_data = 0;
+}
+
+void sid_spi_transceive(const uint8_t* tx, uint8_t* rx, size_t len)
+{
+  if (rx) {
+    memset(rx, 0, len);
+  }
+}
+
+int sid_spi_get_rates(uint32_t* rates, int max)
+{
+  if (max < 1)
+    return 0;
+
+  rates[0] = frequency;
+
+  return 1;
+}
+
+void sid_spi_set_frequency(uint32_t hz)
+{
+  frequency = hz;
+}
+
+uint32_t sid_spi_get_frequency(void)
+{
+  return frequency;
+}
+
+void sid_spi_select(uint8_t bridge)
+{
+}
+
+int sid_spi_init(void)
+{
+  return 0;
+}
+
+int sid_digi_timer_init(void)
+{
+  return 0;
+}
+
+uint32_t sid_digi_timer_now(void)
+{
+  return 0;
+}
+
+void sid_digi_timer_wait(uint32_t until)
+{
+}
+
+void sid_digi_timer_wake(void)
+{
+}
+
+void sid_digi_lock(void)
+{
+}
+
+void sid_digi_unlock(void)
+{
+}
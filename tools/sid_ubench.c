@@ -0,0 +1,480 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Micro benchmarks for the interpreter, where sid_bench only shows whole
+ * tunes. Every benchmark is a loop over copies of one instruction, or of a
+ * pair that has to stay balanced like PHA PLA:
+ *
+ *   LDX #4, LDY #4, LDA #n, STA $02
+ *   loop: copies, DEC $02, BNE loop, RTS
+ *
+ * The same loop without copies is measured too, the difference is the cost
+ * of the copies alone. Every benchmark runs on the generic core and on the
+ * core c64_cpu_optimize() picks, the best of the repeats is reported as ns
+ * per emulated instruction and emulated MHz, emulated cycles per host
+ * second. Both cores have to end with the same memory and cycle count.
+ *
+ *   sid_ubench [-n instructions] [-r repeats] [-l label] [-j results.jsonl]
+ *              [-b baseline.jsonl] [name...]
+ *
+ * Names select the benchmarks that start with them, or a whole group. -j
+ * appends the results as JSON lines tagged with the label and the time, -b
+ * compares against the last results for the same benchmark and core in
+ * such a file, so a change to the interpreter can be checked against the
+ * state before it.
+ */
+
+#include "c64.h"
+#include "sid.h"
+#include "sid_proto.h"
+#include "host.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define CODE_ADDR       0x1000
+#define LOOP_ADDR       0x1008
+#define SUB_ADDR        0x3000
+#define JUMP_VECTORS    0x40
+#define COUNTER         0x02
+#define ITERATIONS      200
+
+/* Room for the copies within the reach of the closing branch */
+#define MAX_BODY        120
+#define MAX_COPIES      32
+
+#define MAX_BASELINE    256
+
+enum fixup
+{
+  FIX_NONE,
+  FIX_NEXT,                     /* absolute operand is the next copy */
+  FIX_VECTOR,                   /* indirect operand points at the next copy */
+};
+
+struct bench
+{
+  const char* name;
+  const char* group;
+  uint8_t code[4];
+  uint8_t len;
+  uint8_t instrs;               /* per copy */
+  enum fixup fixup;
+};
+
+/* X and Y are 4, $10 and $14 point at $2000, $3000 holds an RTS */
+static const struct bench benches[] = {
+  { "lda_imm",        "load",   { 0xa9, 0x01 },       2, 1, FIX_NONE },
+  { "lda_zp",         "load",   { 0xa5, 0x10 },       2, 1, FIX_NONE },
+  { "lda_zpx",        "load",   { 0xb5, 0x10 },       2, 1, FIX_NONE },
+  { "ldx_zpy",        "load",   { 0xb6, 0x10 },       2, 1, FIX_NONE },
+  { "lda_abs",        "load",   { 0xad, 0x00, 0x20 }, 3, 1, FIX_NONE },
+  { "lda_absx",       "load",   { 0xbd, 0x00, 0x20 }, 3, 1, FIX_NONE },
+  { "lda_absy",       "load",   { 0xb9, 0x00, 0x20 }, 3, 1, FIX_NONE },
+  { "lda_absx_page",  "load",   { 0xbd, 0xfe, 0x20 }, 3, 1, FIX_NONE },
+  { "lda_indx",       "load",   { 0xa1, 0x0c },       2, 1, FIX_NONE },
+  { "lda_indy",       "load",   { 0xb1, 0x10 },       2, 1, FIX_NONE },
+  { "sta_zp",         "store",  { 0x85, 0x30 },       2, 1, FIX_NONE },
+  { "sta_zpx",        "store",  { 0x95, 0x30 },       2, 1, FIX_NONE },
+  { "sta_abs",        "store",  { 0x8d, 0x00, 0x21 }, 3, 1, FIX_NONE },
+  { "sta_absx",       "store",  { 0x9d, 0x00, 0x21 }, 3, 1, FIX_NONE },
+  { "sta_absy",       "store",  { 0x99, 0x00, 0x21 }, 3, 1, FIX_NONE },
+  { "sta_indx",       "store",  { 0x81, 0x0c },       2, 1, FIX_NONE },
+  { "sta_indy",       "store",  { 0x91, 0x10 },       2, 1, FIX_NONE },
+  { "sta_sid",        "io",     { 0x8d, 0x18, 0xd4 }, 3, 1, FIX_NONE },
+  { "sta_sid_absx",   "io",     { 0x9d, 0x14, 0xd4 }, 3, 1, FIX_NONE },
+  { "sta_vic",        "io",     { 0x8d, 0x20, 0xd0 }, 3, 1, FIX_NONE },
+  { "lda_osc3",       "io",     { 0xad, 0x1b, 0xd4 }, 3, 1, FIX_NONE },
+  { "inc_zp",         "rmw",    { 0xe6, 0x30 },       2, 1, FIX_NONE },
+  { "inc_zpx",        "rmw",    { 0xf6, 0x30 },       2, 1, FIX_NONE },
+  { "inc_abs",        "rmw",    { 0xee, 0x00, 0x21 }, 3, 1, FIX_NONE },
+  { "inc_absx",       "rmw",    { 0xfe, 0x00, 0x21 }, 3, 1, FIX_NONE },
+  { "rol_zp",         "rmw",    { 0x26, 0x30 },       2, 1, FIX_NONE },
+  { "lsr_abs",        "rmw",    { 0x4e, 0x00, 0x21 }, 3, 1, FIX_NONE },
+  { "asl_a",          "rmw",    { 0x0a },             1, 1, FIX_NONE },
+  { "adc_imm",        "alu",    { 0x69, 0x01 },       2, 1, FIX_NONE },
+  { "adc_zp",         "alu",    { 0x65, 0x10 },       2, 1, FIX_NONE },
+  { "sbc_abs",        "alu",    { 0xed, 0x00, 0x20 }, 3, 1, FIX_NONE },
+  { "cmp_imm",        "alu",    { 0xc9, 0x01 },       2, 1, FIX_NONE },
+  { "bit_zp",         "alu",    { 0x24, 0x10 },       2, 1, FIX_NONE },
+  { "inx",            "alu",    { 0xe8 },             1, 1, FIX_NONE },
+  { "tax",            "alu",    { 0xaa },             1, 1, FIX_NONE },
+  { "clc",            "alu",    { 0x18 },             1, 1, FIX_NONE },
+  { "bne_taken",      "branch", { 0xd0, 0x00 },       2, 1, FIX_NONE },
+  { "beq_not_taken",  "branch", { 0xf0, 0x00 },       2, 1, FIX_NONE },
+  { "bcc_taken",      "branch", { 0x90, 0x00 },       2, 1, FIX_NONE },
+  { "bcs_not_taken",  "branch", { 0xb0, 0x00 },       2, 1, FIX_NONE },
+  { "jmp_abs",        "jump",   { 0x4c },             3, 1, FIX_NEXT },
+  { "jmp_ind",        "jump",   { 0x6c },             3, 1, FIX_VECTOR },
+  { "jsr_rts",        "jump",   { 0x20, 0x00, 0x30 }, 3, 2, FIX_NONE },
+  { "pha_pla",        "stack",  { 0x48, 0x68 },       2, 2, FIX_NONE },
+  { "php_plp",        "stack",  { 0x08, 0x28 },       2, 2, FIX_NONE },
+  { "tsx_txs",        "stack",  { 0xba, 0x9a },       2, 2, FIX_NONE },
+};
+
+#define NUM_BENCHES (sizeof(benches) / sizeof(benches[0]))
+
+struct run
+{
+  uint64_t ns;
+  uint32_t instructions;
+  uint32_t cycles;
+  uint32_t checksum;
+  enum c64_core core;
+};
+
+struct result
+{
+  double ns_per_instr;
+  double cycles_per_instr;
+  double emu_mhz;
+  enum c64_core core;
+};
+
+struct baseline
+{
+  char bench[32];
+  char core[16];
+  double ns_per_instr;
+};
+
+static struct baseline baseline[MAX_BASELINE];
+static uint32_t num_baseline;
+
+static uint32_t fnv1a(uint32_t hash, const uint8_t* data, size_t len)
+{
+  while (len--) {
+    hash ^= *data++;
+    hash *= 16777619U;
+  }
+
+  return hash;
+}
+
+static uint32_t copies_of(const struct bench* b)
+{
+  uint32_t copies = MAX_BODY / b->len;
+
+  return copies < MAX_COPIES ? copies : MAX_COPIES;
+}
+
+/* The benchmark loop with the given number of copies */
+static void load(const struct bench* b, uint32_t copies)
+{
+  static const uint8_t prologue[] = {
+    0xa2, 0x04, 0xa0, 0x04, 0xa9, ITERATIONS, 0x85, COUNTER
+  };
+  uint16_t addr = LOOP_ADDR;
+
+  c64_init();
+  c64_memcpy(CODE_ADDR, prologue, sizeof(prologue));
+  c64_memcpy(0x0010, (const uint8_t[]){ 0x00, 0x20, 0x00, 0x00, 0x00, 0x20 }, 6);
+  c64_setmem(SUB_ADDR, 0x60);
+
+  for (uint32_t i = 0; i < copies; i++) {
+    uint16_t next = addr + b->len;
+
+    c64_memcpy(addr, b->code, b->len);
+
+    if (b->fixup == FIX_NEXT) {
+      c64_setmem(addr + 1, next & 0xff);
+      c64_setmem(addr + 2, next >> 8);
+    } else if (b->fixup == FIX_VECTOR) {
+      uint16_t vector = JUMP_VECTORS + i * 2;
+
+      c64_setmem(addr + 1, vector);
+      c64_setmem(addr + 2, 0);
+      c64_setmem(vector, next & 0xff);
+      c64_setmem(vector + 1, next >> 8);
+    }
+
+    addr = next;
+  }
+
+  c64_memcpy(addr, (const uint8_t[]){ 0xc6, COUNTER, 0xd0, LOOP_ADDR - (addr + 4), 0x60 }, 5);
+}
+
+static void run(const struct bench* b, uint32_t copies, uint32_t calls,
+                bool optimize, struct run* res)
+{
+  static uint8_t mem[65536];
+  uint64_t start;
+
+  load(b, copies);
+
+  if (optimize) {
+    c64_cpu_optimize(CODE_ADDR, NULL);
+  }
+
+  res->instructions = c64_cpu_instructions();
+  res->cycles = c64_cpu_cycles();
+  start = host_time_ns();
+
+  for (uint32_t call = 0; call < calls; call++) {
+    c64_cpu_jsr(CODE_ADDR, 0);
+  }
+
+  res->ns = host_time_ns() - start;
+  res->instructions = c64_cpu_instructions() - res->instructions;
+  res->cycles = c64_cpu_cycles() - res->cycles;
+  res->core = c64_cpu_get_core();
+
+  c64_memread(mem, 0, sizeof(mem));
+  res->checksum = fnv1a(2166136261U, mem, sizeof(mem));
+}
+
+static void best_of(const struct bench* b, uint32_t copies, uint32_t calls,
+                    uint32_t repeats, bool optimize, struct run* best)
+{
+  struct run res;
+
+  best->ns = UINT64_MAX;
+
+  for (uint32_t r = 0; r < repeats; r++) {
+    run(b, copies, calls, optimize, &res);
+
+    if (res.ns < best->ns) {
+      *best = res;
+    }
+  }
+}
+
+/* The copies alone, what the loop around them costs is taken out */
+static void measure(const struct bench* b, uint32_t calls, uint32_t repeats,
+                    bool optimize, struct result* res, struct run* full)
+{
+  struct run empty;
+  uint32_t instructions;
+  double ns;
+
+  best_of(b, copies_of(b), calls, repeats, optimize, full);
+  best_of(b, 0, calls, repeats, optimize, &empty);
+
+  instructions = full->instructions - empty.instructions;
+  ns = full->ns > empty.ns ? full->ns - empty.ns : 0;
+
+  res->ns_per_instr = ns / instructions;
+  res->cycles_per_instr = (double)(full->cycles - empty.cycles) / instructions;
+  res->emu_mhz = ns ? (full->cycles - empty.cycles) / ns * 1000.0 : 0.0;
+  res->core = full->core;
+}
+
+static bool selected(const struct bench* b, int argc, char** argv)
+{
+  if (argc == 0)
+    return true;
+
+  for (int i = 0; i < argc; i++) {
+    if (strcmp(argv[i], b->group) == 0 || strncmp(argv[i], b->name, strlen(argv[i])) == 0)
+      return true;
+  }
+
+  return false;
+}
+
+static bool json_string(const char* line, const char* key, char* buf, size_t size)
+{
+  char pattern[40];
+  const char* p;
+  size_t len = 0;
+
+  snprintf(pattern, sizeof(pattern), "\"%s\":\"", key);
+  p = strstr(line, pattern);
+  if (!p)
+    return false;
+
+  for (p += strlen(pattern); *p && *p != '"' && len + 1 < size; p++) {
+    buf[len++] = *p;
+  }
+  buf[len] = '\0';
+
+  return true;
+}
+
+static bool json_number(const char* line, const char* key, double* value)
+{
+  char pattern[40];
+  const char* p;
+
+  snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+  p = strstr(line, pattern);
+  if (!p)
+    return false;
+
+  *value = strtod(p + strlen(pattern), NULL);
+
+  return true;
+}
+
+/* The last result of every benchmark and core, later lines win */
+static bool load_baseline(const char* path)
+{
+  FILE* f = fopen(path, "r");
+  char line[512];
+
+  if (!f) {
+    perror(path);
+    return false;
+  }
+
+  while (fgets(line, sizeof(line), f)) {
+    struct baseline entry;
+    uint32_t i;
+
+    if (!json_string(line, "bench", entry.bench, sizeof(entry.bench)) ||
+        !json_string(line, "core", entry.core, sizeof(entry.core)) ||
+        !json_number(line, "ns_per_instr", &entry.ns_per_instr))
+      continue;
+
+    for (i = 0; i < num_baseline; i++) {
+      if (strcmp(baseline[i].bench, entry.bench) == 0 &&
+          strcmp(baseline[i].core, entry.core) == 0)
+        break;
+    }
+
+    if (i < MAX_BASELINE) {
+      baseline[i] = entry;
+      num_baseline += i == num_baseline;
+    }
+  }
+
+  fclose(f);
+
+  return true;
+}
+
+static const struct baseline* find_baseline(const char* bench, const char* core)
+{
+  for (uint32_t i = 0; i < num_baseline; i++) {
+    if (strcmp(baseline[i].bench, bench) == 0 && strcmp(baseline[i].core, core) == 0)
+      return &baseline[i];
+  }
+
+  return NULL;
+}
+
+static void print_change(const struct bench* b, const struct result* res)
+{
+  const struct baseline* base = find_baseline(b->name, c64_core_name(res->core));
+
+  if (base && base->ns_per_instr > 0) {
+    printf(" %+6.1f%%", (res->ns_per_instr / base->ns_per_instr - 1) * 100);
+  } else if (num_baseline) {
+    printf("       -");
+  }
+}
+
+static void write_json(FILE* f, const char* label, time_t now, const struct bench* b,
+                       const struct result* res)
+{
+  fprintf(f, "{\"label\":\"%s\",\"time\":%lld,\"bench\":\"%s\",\"group\":\"%s\","
+             "\"core\":\"%s\",\"ns_per_instr\":%.3f,\"cycles_per_instr\":%.2f,"
+             "\"emu_mhz\":%.1f}\n",
+          label, (long long)now, b->name, b->group, c64_core_name(res->core),
+          res->ns_per_instr, res->cycles_per_instr, res->emu_mhz);
+}
+
+int main(int argc, char** argv)
+{
+  uint32_t target = 2000000;
+  uint32_t repeats = 5;
+  const char* label = "";
+  FILE* json = NULL;
+  time_t now = time(NULL);
+  int ret = 0;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "n:r:l:j:b:")) != -1) {
+    switch (opt) {
+      case 'n':
+        target = strtoul(optarg, NULL, 0);
+        break;
+      case 'r':
+        repeats = strtoul(optarg, NULL, 0);
+        break;
+      case 'l':
+        label = optarg;
+        break;
+      case 'j':
+        json = fopen(optarg, "a");
+        if (!json) {
+          perror(optarg);
+          return 1;
+        }
+        break;
+      case 'b':
+        if (!load_baseline(optarg))
+          return 1;
+        break;
+      default:
+        fprintf(stderr, "usage: %s [-n instructions] [-r repeats] [-l label]"
+                        " [-j results.jsonl] [-b baseline.jsonl] [name...]\n", argv[0]);
+        return 1;
+    }
+  }
+
+  if (!target || !repeats) {
+    fprintf(stderr, "instructions and repeats must be at least 1\n");
+    return 1;
+  }
+
+  sid_proto_init(SID_PROTO_MODE_BLOCKING, false);
+  sid_mute(true);
+
+  printf("%-14s %-6s %5s %9s %8s %9s %8s %7s%s\n", "bench", "group", "cyc",
+         "generic", "MHz", "scanned", "MHz", "speedup",
+         num_baseline ? "  generic scanned vs baseline" : "");
+
+  for (uint32_t i = 0; i < NUM_BENCHES; i++) {
+    const struct bench* b = &benches[i];
+    uint32_t per_call = ITERATIONS * (copies_of(b) * b->instrs + 2) + 6;
+    uint32_t calls = (target + per_call - 1) / per_call;
+    struct result generic;
+    struct result optimized;
+    struct run generic_run;
+    struct run optimized_run;
+
+    if (!selected(b, argc - optind, &argv[optind]))
+      continue;
+
+    measure(b, calls, repeats, false, &generic, &generic_run);
+    measure(b, calls, repeats, true, &optimized, &optimized_run);
+
+    printf("%-14s %-6s %5.2f %6.2f ns %8.1f %6.2f ns %8.1f %6.2fx",
+           b->name, b->group, generic.cycles_per_instr,
+           generic.ns_per_instr, generic.emu_mhz,
+           optimized.ns_per_instr, optimized.emu_mhz,
+           optimized.ns_per_instr > 0 ? generic.ns_per_instr / optimized.ns_per_instr : 0.0);
+    print_change(b, &generic);
+    print_change(b, &optimized);
+
+    if (optimized.core == C64_CORE_GENERIC) {
+      printf(" (not scanned)");
+    }
+
+    if (generic_run.checksum != optimized_run.checksum ||
+        generic_run.cycles != optimized_run.cycles) {
+      printf(" CORES DIFFER");
+      ret = 1;
+    }
+    printf("\n");
+
+    if (json) {
+      write_json(json, label, now, b, &generic);
+      if (optimized.core != C64_CORE_GENERIC) {
+        write_json(json, label, now, b, &optimized);
+      }
+    }
+  }
+
+  if (json) {
+    fclose(json);
+  }
+
+  return ret;
+}
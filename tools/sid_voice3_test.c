@@ -0,0 +1,487 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Checks the voice 3 model against a cycle by cycle reference written after
+ * reSID 0.16 (wave.cc and envelope.cc): the noise shift register, the saw,
+ * triangle and pulse outputs with ring modulation and hard sync, and the
+ * envelope with its exponential decay and the ADSR delay bug. The model is
+ * only clocked when it is accessed, the reference every cycle, OSC3 and ENV3
+ * are compared after random gaps and at frame ends.
+ *
+ *   sid_voice3_test [-n rounds] [-s seed]
+ *
+ * A few absolute values pin the reference itself to reSID. Fails on the
+ * first difference and prints the register history of the round.
+ */
+
+#include "sid_voice3.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/* The model runs on this instead of the emulated CPU */
+static uint32_t cycles;
+
+uint32_t c64_cpu_cycles(void)
+{
+  return cycles;
+}
+
+static const uint16_t rate_period[16] = {
+  9, 32, 63, 95, 149, 220, 267, 313, 392, 977, 1954, 3126, 3907, 11720, 19532, 31251
+};
+
+enum ref_state
+{
+  REF_ATTACK,
+  REF_DECAY_SUSTAIN,
+  REF_RELEASE,
+};
+
+struct ref_voice
+{
+  uint32_t acc;
+  uint32_t shift;
+  uint16_t freq;
+  uint16_t pw;
+  uint8_t ctrl;
+  bool msb_rising;
+};
+
+static struct ref_voice v2;
+static struct ref_voice v3;
+
+static enum ref_state state;
+static uint8_t attack, decay, sustain, release;
+static uint16_t rate_counter;
+static uint16_t rate;
+static uint8_t exp_counter;
+static uint8_t exp_period;
+static uint8_t envelope;
+static bool hold_zero;
+
+static void ref_reset(void)
+{
+  v2 = (struct ref_voice){ .shift = 0x7ffff8 };
+  v3 = (struct ref_voice){ .shift = 0x7ffff8 };
+  state = REF_RELEASE;
+  attack = decay = sustain = release = 0;
+  rate_counter = 0;
+  rate = rate_period[0];
+  exp_counter = 0;
+  exp_period = 1;
+  envelope = 0;
+  hold_zero = true;
+}
+
+static void ref_clock_voice(struct ref_voice* v)
+{
+  uint32_t prev = v->acc;
+
+  if (v->ctrl & 0x08) {
+    v->msb_rising = false;
+    return;
+  }
+
+  v->acc = (v->acc + v->freq) & 0xffffff;
+  v->msb_rising = !(prev & 0x800000) && (v->acc & 0x800000);
+
+  if (!(prev & 0x080000) && (v->acc & 0x080000)) {
+    uint32_t bit0 = ((v->shift >> 22) ^ (v->shift >> 17)) & 1;
+
+    v->shift = ((v->shift << 1) & 0x7fffff) | bit0;
+  }
+}
+
+static void ref_clock_envelope(void)
+{
+  if (++rate_counter & 0x8000) {
+    ++rate_counter;
+    rate_counter &= 0x7fff;
+  }
+
+  if (rate_counter != rate)
+    return;
+
+  rate_counter = 0;
+
+  if (state != REF_ATTACK && ++exp_counter != exp_period)
+    return;
+
+  exp_counter = 0;
+
+  if (hold_zero)
+    return;
+
+  switch (state) {
+    case REF_ATTACK:
+      /* Regated at $ff the counter flips over to 0 */
+      envelope++;
+      if (envelope == 0xff) {
+        state = REF_DECAY_SUSTAIN;
+        rate = rate_period[decay];
+      }
+      break;
+    case REF_DECAY_SUSTAIN:
+      if (envelope != sustain * 0x11) {
+        envelope--;
+      }
+      break;
+    case REF_RELEASE:
+      envelope--;
+      break;
+  }
+
+  switch (envelope) {
+    case 0xff: exp_period = 1; break;
+    case 0x5d: exp_period = 2; break;
+    case 0x36: exp_period = 4; break;
+    case 0x1a: exp_period = 8; break;
+    case 0x0e: exp_period = 16; break;
+    case 0x06: exp_period = 30; break;
+    case 0x00: exp_period = 1; hold_zero = true; break;
+  }
+}
+
+static void ref_clock(void)
+{
+  ref_clock_voice(&v2);
+  ref_clock_voice(&v3);
+
+  /* Voice 2 syncs voice 3 */
+  if (v2.msb_rising && (v3.ctrl & 0x02)) {
+    v3.acc = 0;
+  }
+
+  ref_clock_envelope();
+}
+
+static void ref_write(uint8_t reg, uint8_t val)
+{
+  switch (reg) {
+    case 0x07: v2.freq = (v2.freq & 0xff00) | val; break;
+    case 0x08: v2.freq = (v2.freq & 0x00ff) | (val << 8); break;
+    case 0x0b:
+      if (val & 0x08) {
+        v2.acc = 0;
+      }
+      v2.ctrl = val;
+      break;
+    case 0x0e: v3.freq = (v3.freq & 0xff00) | val; break;
+    case 0x0f: v3.freq = (v3.freq & 0x00ff) | (val << 8); break;
+    case 0x10: v3.pw = (v3.pw & 0x0f00) | val; break;
+    case 0x11: v3.pw = (v3.pw & 0x00ff) | ((val & 0x0f) << 8); break;
+    case 0x12:
+      if (val & 0x08) {
+        v3.acc = 0;
+        v3.shift = 0;
+      } else if (v3.ctrl & 0x08) {
+        v3.shift = 0x7ffff8;
+      }
+      if ((val & 0x01) && !(v3.ctrl & 0x01)) {
+        state = REF_ATTACK;
+        rate = rate_period[attack];
+        hold_zero = false;
+      } else if (!(val & 0x01) && (v3.ctrl & 0x01)) {
+        state = REF_RELEASE;
+        rate = rate_period[release];
+      }
+      v3.ctrl = val;
+      break;
+    case 0x13:
+      attack = val >> 4;
+      decay = val & 0x0f;
+      if (state == REF_ATTACK) {
+        rate = rate_period[attack];
+      } else if (state == REF_DECAY_SUSTAIN) {
+        rate = rate_period[decay];
+      }
+      break;
+    case 0x14:
+      sustain = val >> 4;
+      release = val & 0x0f;
+      if (state == REF_RELEASE) {
+        rate = rate_period[release];
+      }
+      break;
+  }
+}
+
+/* Top 8 of the 12 bit waveform outputs, combinations are the AND */
+static uint8_t ref_osc(void)
+{
+  uint8_t ctrl = v3.ctrl;
+  uint8_t out = 0xff;
+  uint32_t s = v3.shift;
+
+  if (!(ctrl & 0xf0))
+    return 0;
+
+  if (ctrl & 0x10) {
+    uint32_t msb = ((ctrl & 0x04) ? v3.acc ^ v2.acc : v3.acc) & 0x800000;
+
+    out &= (((msb ? ~v3.acc : v3.acc) >> 11) & 0xfff) >> 4;
+  }
+  if (ctrl & 0x20) {
+    out &= v3.acc >> 16;
+  }
+  if ((ctrl & 0x40) && !((ctrl & 0x08) || (v3.acc >> 12) >= v3.pw)) {
+    out = 0;
+  }
+  if (ctrl & 0x80) {
+    out &= (((s & 0x400000) >> 11) | ((s & 0x100000) >> 10) | ((s & 0x010000) >> 7) |
+            ((s & 0x002000) >> 5) | ((s & 0x000800) >> 4) | ((s & 0x000080) >> 1) |
+            ((s & 0x000010) << 1) | ((s & 0x000004) << 2)) >> 4;
+  }
+
+  return out;
+}
+
+static uint32_t seed = 1;
+
+static uint32_t rnd(uint32_t n)
+{
+  seed = seed * 1103515245 + 12345;
+
+  return (seed >> 8) % n;
+}
+
+struct event
+{
+    uint32_t cycle;
+    uint8_t reg;
+    uint8_t val;
+};
+
+#define MAX_EVENTS 4096
+
+static struct event history[MAX_EVENTS];
+static uint32_t n_history;
+static uint32_t frame_pos;
+static uint32_t now;
+
+static void advance(uint32_t n)
+{
+  for (uint32_t i = 0; i < n; i++) {
+    ref_clock();
+  }
+
+  cycles += n;
+  frame_pos += n;
+  now += n;
+}
+
+/* Frame ends go into the history as register $ff */
+static void record(uint8_t reg, uint8_t val)
+{
+  if (n_history < MAX_EVENTS) {
+    history[n_history++] = (struct event){ now, reg, val };
+  }
+}
+
+static void poke(uint8_t reg, uint8_t val)
+{
+  record(reg, val);
+
+  sid_voice3_write(reg, val);
+  ref_write(reg, val);
+}
+
+/* The model moves on to the frame end by itself, the CPU counter stands still */
+static void end_frame(void)
+{
+  uint32_t rest = frame_pos < SID_VOICE3_FRAME_CYCLES ? SID_VOICE3_FRAME_CYCLES - frame_pos : 0;
+
+  for (uint32_t i = 0; i < rest; i++) {
+    ref_clock();
+  }
+
+  now += rest;
+  frame_pos = 0;
+  record(0xff, 0);
+  sid_voice3_end_frame();
+}
+
+static bool compare(const char* what)
+{
+  uint8_t osc = sid_voice3_osc();
+  uint8_t env = sid_voice3_env();
+  uint8_t want_osc = ref_osc();
+
+  if (osc == want_osc && env == envelope)
+    return true;
+
+  printf("%s at cycle %u: OSC3 %02x, reSID %02x, ENV3 %02x, reSID %02x\n",
+         what, now, osc, want_osc, env, envelope);
+  for (uint32_t i = 0; i < n_history; i++) {
+    if (history[i].reg == 0xff) {
+      printf("  %8u frame end\n", history[i].cycle);
+    } else {
+      printf("  %8u $d4%02x = $%02x\n", history[i].cycle, history[i].reg, history[i].val);
+    }
+  }
+
+  return false;
+}
+
+/* Brings the model and the reference to the same state, a silent voice 3 */
+static void start(void)
+{
+  static const uint8_t regs[] = { 0x07, 0x08, 0x0b, 0x0e, 0x0f, 0x10, 0x11, 0x13, 0x14 };
+  uint8_t state[SID_VOICE3_STATE_SIZE] = { 0 };
+
+  /* noise at NOISE_RESET, everything else 0 and the envelope released */
+  state[16] = 0xf8;
+  state[17] = 0xff;
+  state[18] = 0x7f;
+  state[19] = 0x82;
+  state[24] = 1;
+
+  sid_voice3_load(state);
+  ref_reset();
+  frame_pos = 0;
+  now = 0;
+  n_history = 0;
+
+  for (size_t i = 0; i < sizeof(regs); i++) {
+    sid_voice3_write(regs[i], 0);
+  }
+}
+
+/* Hand checked values of reSID, so the reference is not just another model */
+static bool check_absolute(void)
+{
+  bool ok = true;
+
+  /* The test bit clears the shift register, it restarts at 0x7ffff8 */
+  start();
+  poke(0x12, 0x88);
+  ok &= sid_voice3_osc() == 0x00 && ref_osc() == 0x00;
+  poke(0x12, 0x80);
+  ok &= sid_voice3_osc() == 0xfe && ref_osc() == 0xfe;
+
+  /* Attack 0 counts up every 9 cycles, 255 steps to the peak */
+  start();
+  poke(0x13, 0x00);
+  poke(0x14, 0xf0);
+  poke(0x12, 0x01);
+  advance(9 * 255 - 1);
+  ok &= sid_voice3_env() == 0xfe && envelope == 0xfe;
+  advance(1);
+  ok &= sid_voice3_env() == 0xff && envelope == 0xff;
+
+  /* A saw at $0100 reads $10 after 4096 cycles */
+  start();
+  poke(0x0e, 0x00);
+  poke(0x0f, 0x01);
+  poke(0x12, 0x20);
+  advance(4096);
+  ok &= sid_voice3_osc() == 0x10 && ref_osc() == 0x10;
+
+  /* Release 0 with the counter at 37: it first runs through $8000 to 1 */
+  start();
+  poke(0x13, 0x20);
+  poke(0x14, 0x00);
+  poke(0x12, 0x01);
+  advance(100);
+  poke(0x12, 0x00);
+  advance(0x8000 - 37 + 9 - 2);
+  ok &= sid_voice3_env() == 0x01 && envelope == 0x01;
+  advance(1);
+  ok &= sid_voice3_env() == 0x00 && envelope == 0x00;
+
+  if (!ok) {
+    printf("reSID reference values differ\n");
+  }
+
+  return ok;
+}
+
+static const uint8_t waveforms[] = { 0x10, 0x20, 0x40, 0x80, 0x14, 0x30, 0x50, 0x22, 0x42 };
+
+static bool round_trip(uint32_t round)
+{
+  uint32_t length = 2 + rnd(40);
+  char what[48];
+
+  start();
+
+  poke(0x07, rnd(256));
+  poke(0x08, rnd(256));
+  poke(0x0e, rnd(256));
+  poke(0x0f, rnd(4) ? rnd(256) : rnd(4));
+  poke(0x10, rnd(256));
+  poke(0x11, rnd(16));
+  poke(0x13, rnd(256));
+  poke(0x14, rnd(256));
+  poke(0x12, waveforms[rnd(sizeof(waveforms))] | 0x01);
+
+  for (uint32_t step = 0; step < length; step++) {
+    switch (rnd(8)) {
+      case 0:
+        end_frame();
+        snprintf(what, sizeof(what), "round %u frame end", round);
+        break;
+      case 1:
+        advance(1 + rnd(30000));
+        poke(0x12, waveforms[rnd(sizeof(waveforms))] | (rnd(2) ? 0x01 : 0));
+        snprintf(what, sizeof(what), "round %u control", round);
+        break;
+      case 2:
+        advance(1 + rnd(3000));
+        poke(0x0e + rnd(4), rnd(256));
+        snprintf(what, sizeof(what), "round %u frequency or pulse", round);
+        break;
+      case 3:
+        advance(1 + rnd(3000));
+        poke(0x13 + rnd(2), rnd(256));
+        snprintf(what, sizeof(what), "round %u envelope", round);
+        break;
+      default:
+        advance(1 + rnd(rnd(2) ? 100 : 20000));
+        snprintf(what, sizeof(what), "round %u read", round);
+        break;
+    }
+
+    if (!compare(what))
+      return false;
+  }
+
+  return true;
+}
+
+int main(int argc, char** argv)
+{
+  uint32_t rounds = 2000;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "n:s:")) != -1) {
+    switch (opt) {
+      case 'n':
+        rounds = strtoul(optarg, NULL, 0);
+        break;
+      case 's':
+        seed = strtoul(optarg, NULL, 0);
+        break;
+      default:
+        fprintf(stderr, "usage: %s [-n rounds] [-s seed]\n", argv[0]);
+        return 1;
+    }
+  }
+
+  if (!check_absolute())
+    return 1;
+
+  for (uint32_t round = 0; round < rounds; round++) {
+    if (!round_trip(round))
+      return 1;
+  }
+
+  printf("%u rounds match reSID\n", rounds);
+
+  return 0;
+}
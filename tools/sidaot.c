@@ -0,0 +1,1092 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Translates the init and play routines of tunes to C ahead of time, see
+ * c64_aot.h, for the firmware to run instead of interpreting them.
+ *
+ *   sidaot [-n song] [-f frames] [-o src/sid_aot.c] file.sid...
+ *
+ * Every tune is first run in a background context, init for the song and
+ * play for the given number of frames, to learn where its returns and
+ * indirect jumps go: jump tables are only known once they ran. The code
+ * reachable from the entry, from the return points after every JSR and
+ * from those targets is then disassembled and every instruction becomes a
+ * line of C. Jumps to code that was not found leave to the interpreter.
+ *
+ * Init is translated from the memory as the tune was loaded, play from the
+ * memory after init of the song. A routine that stores into its own code
+ * through a constant address, or whose code changed while it was profiled,
+ * is not translated at all and the tune stays on the interpreter. Without
+ * -o it only reports what it would translate.
+ */
+
+#include "c64.h"
+#include "sid.h"
+#include "sid_proto.h"
+#include "mos6510.h"
+#include "host.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <libgen.h>
+
+#define MAX_ROUTINES    32
+
+/* A call that runs longer is cut short, what it ran so far still counts */
+#define PROFILE_INSNS   2000000
+
+#define IO_BASE         0xd400
+#define IO_SIZE         0x0400
+
+/* Per address of a routine */
+#define F_INSN          0x01    /* a translated instruction starts here */
+#define F_CODE          0x02    /* a byte of a translated instruction */
+#define F_LABEL         0x04    /* jumped to */
+#define F_DISPATCH      0x08    /* reached through a return or an indirect jump */
+#define F_RAN           0x10    /* while profiling */
+#define F_SEEN          0x20    /* a return or an indirect jump went here */
+#define F_QUEUED        0x40
+
+struct routine
+{
+  const char* path;
+  const char* kind;             /* init or play */
+  uint8_t song;
+  uint16_t entry;
+  uint8_t image[65536];         /* the code is taken from */
+  uint8_t before[65536];        /* in the context, before and after it ran */
+  uint8_t after[65536];
+  uint8_t flags[65536];
+  uint32_t insns;
+  uint32_t ran;
+  uint32_t bytes;
+  uint16_t n_ranges;
+  const char* refused;          /* why it is not translated */
+  uint16_t refused_at;
+};
+
+/* Temporaries the generated code of a routine needs */
+struct gen
+{
+  FILE* f;
+  const struct routine* r;
+  bool b;
+  bool t;
+  bool ea;
+  bool smc;
+  bool dispatch;
+};
+
+static const char* const names[MOS6510_TYPE_XXX] = {
+  "adc", "and", "asl", "bcc", "bcs", "beq", "bit", "bmi", "bne", "bpl", "brk",
+  "bvc", "bvs", "clc", "cld", "cli", "clv", "cmp", "cpx", "cpy", "dec", "dex",
+  "dey", "eor", "inc", "inx", "iny", "jmp", "jsr", "lda", "ldx", "ldy", "lsr",
+  "nop", "ora", "pha", "php", "pla", "plp", "rol", "ror", "rti", "rts", "sbc",
+  "sec", "sed", "sei", "sta", "stx", "sty", "tax", "tay", "tsx", "txa", "txs",
+  "tya",
+};
+
+static uint8_t pool[C64_CONTEXT_NO_PAGE][256];
+
+static struct routine* routines[MAX_ROUTINES];
+static uint8_t n_routines;
+
+static uint8_t type_of(uint8_t opc)
+{
+  return mos6510_opcode_table[opc].type;
+}
+
+static uint8_t mode_of(uint8_t opc)
+{
+  return mos6510_opcode_table[opc].mode;
+}
+
+/* Like the interpreter, which skips the undocumented opcodes as one byte */
+static uint8_t insn_len(uint8_t opc)
+{
+  if (type_of(opc) >= MOS6510_TYPE_XXX || type_of(opc) == MOS6510_TYPE_NOP)
+    return 1;
+
+  switch (mode_of(opc)) {
+    case MOS6510_MODE_IMM:
+    case MOS6510_MODE_ZP:
+    case MOS6510_MODE_ZPX:
+    case MOS6510_MODE_ZPY:
+    case MOS6510_MODE_INDX:
+    case MOS6510_MODE_INDY:
+    case MOS6510_MODE_REL:
+      return 2;
+
+    case MOS6510_MODE_ABS:
+    case MOS6510_MODE_ABSX:
+    case MOS6510_MODE_ABSY:
+    case MOS6510_MODE_IND:
+      return 3;
+  }
+
+  return 1;
+}
+
+static bool is_branch(uint8_t type)
+{
+  return type == MOS6510_TYPE_BCC || type == MOS6510_TYPE_BCS ||
+         type == MOS6510_TYPE_BEQ || type == MOS6510_TYPE_BNE ||
+         type == MOS6510_TYPE_BMI || type == MOS6510_TYPE_BPL ||
+         type == MOS6510_TYPE_BVC || type == MOS6510_TYPE_BVS;
+}
+
+static bool is_store(uint8_t type)
+{
+  return type == MOS6510_TYPE_STA || type == MOS6510_TYPE_STX ||
+         type == MOS6510_TYPE_STY || type == MOS6510_TYPE_ASL ||
+         type == MOS6510_TYPE_LSR || type == MOS6510_TYPE_ROL ||
+         type == MOS6510_TYPE_ROR || type == MOS6510_TYPE_INC ||
+         type == MOS6510_TYPE_DEC;
+}
+
+static uint16_t operand_of(const uint8_t* mem, uint16_t pc)
+{
+  switch (insn_len(mem[pc])) {
+    case 2:
+      return mem[(uint16_t)(pc + 1)];
+    case 3:
+      return mem[(uint16_t)(pc + 1)] | mem[(uint16_t)(pc + 2)] << 8;
+  }
+
+  return 0;
+}
+
+static uint16_t branch_target(uint16_t pc, uint16_t arg)
+{
+  return pc + 2 + (int8_t)arg;
+}
+
+/* Runs a call and marks what it ran and where returns and indirect jumps went */
+static void profile(struct c64_context* c, uint16_t addr, uint8_t a, uint8_t* flags)
+{
+  c64_context_call(c, addr, a);
+
+  for (uint32_t i = 0; i < PROFILE_INSNS; i++) {
+    uint16_t pc = c->cpu.pc;
+    uint8_t opc = c64_context_peek(c, pc);
+    enum c64_context_state state = c64_context_run(c, 1);
+
+    flags[pc] |= F_RAN;
+
+    if ((type_of(opc) == MOS6510_TYPE_JMP && mode_of(opc) == MOS6510_MODE_IND) ||
+        type_of(opc) == MOS6510_TYPE_RTS || type_of(opc) == MOS6510_TYPE_RTI) {
+      if (c->cpu.pc > 1) {
+        flags[c->cpu.pc] |= F_SEEN;
+      }
+    }
+
+    if (state != C64_CONTEXT_RUNNING)
+      break;
+  }
+}
+
+static void snapshot(const struct c64_context* c, uint8_t* mem)
+{
+  for (uint32_t addr = 0; addr < 65536; addr++) {
+    mem[addr] = c64_context_peek(c, addr);
+  }
+}
+
+static void refuse(struct routine* r, const char* why, uint16_t at)
+{
+  if (!r->refused) {
+    r->refused = why;
+    r->refused_at = at;
+  }
+}
+
+static void queue(struct routine* r, uint16_t* work, uint32_t* n, uint16_t addr, uint8_t flags)
+{
+  r->flags[addr] |= flags;
+
+  if (!(r->flags[addr] & F_QUEUED)) {
+    r->flags[addr] |= F_QUEUED;
+    work[(*n)++] = addr;
+  }
+}
+
+/* Follows the code from the entry and from every place a return or jump went */
+static void disassemble(struct routine* r)
+{
+  static uint16_t work[65536];
+  uint32_t n = 0;
+
+  queue(r, work, &n, r->entry, F_LABEL);
+  for (uint32_t addr = 0; addr < 65536; addr++) {
+    if (r->flags[addr] & F_SEEN) {
+      queue(r, work, &n, addr, F_LABEL | F_DISPATCH);
+    }
+  }
+
+  while (n) {
+    uint16_t pc = work[--n];
+    uint8_t opc = r->image[pc];
+    uint8_t type = type_of(opc);
+    uint8_t len = insn_len(opc);
+    uint16_t arg = operand_of(r->image, pc);
+
+    /* Wrapping code is left to the interpreter */
+    if (pc + len > 0x10000)
+      continue;
+
+    r->flags[pc] |= F_INSN;
+    for (uint8_t i = 0; i < len; i++) {
+      r->flags[pc + i] |= F_CODE;
+      if ((pc + i) >> 8 == 0x01) {
+        refuse(r, "runs code in the stack page", pc);
+      }
+    }
+
+    if (is_branch(type)) {
+      queue(r, work, &n, branch_target(pc, arg), F_LABEL);
+    } else if (type == MOS6510_TYPE_JMP) {
+      if (mode_of(opc) != MOS6510_MODE_IND) {
+        queue(r, work, &n, arg, F_LABEL);
+      }
+      continue;
+    } else if (type == MOS6510_TYPE_JSR) {
+      queue(r, work, &n, arg, F_LABEL);
+      if (pc + len < 0x10000) {
+        queue(r, work, &n, pc + len, F_LABEL | F_DISPATCH);
+      }
+      continue;
+    } else if (type == MOS6510_TYPE_RTS || type == MOS6510_TYPE_RTI ||
+               type == MOS6510_TYPE_BRK) {
+      continue;
+    }
+
+    if (pc + len < 0x10000) {
+      queue(r, work, &n, pc + len, 0);
+    }
+  }
+
+  /* Stores the tool can place have to miss the code, the others are guarded */
+  for (uint32_t pc = 0; pc < 65536; pc++) {
+    uint8_t opc = r->image[pc];
+    uint8_t mode = mode_of(opc);
+    uint16_t arg = operand_of(r->image, pc);
+
+    if (!(r->flags[pc] & F_INSN))
+      continue;
+
+    r->insns++;
+    if (r->flags[pc] & F_RAN) {
+      r->ran++;
+    }
+
+    if (is_store(type_of(opc)) && (mode == MOS6510_MODE_ZP || mode == MOS6510_MODE_ABS) &&
+        (r->flags[arg] & F_CODE)) {
+      refuse(r, "stores into its own code", pc);
+    }
+  }
+
+  for (uint32_t addr = 0; addr < 65536; addr++) {
+    if (!(r->flags[addr] & F_CODE))
+      continue;
+
+    r->bytes++;
+    if (addr == 0 || !(r->flags[addr - 1] & F_CODE)) {
+      r->n_ranges++;
+    }
+
+    if (r->before[addr] != r->after[addr]) {
+      refuse(r, "changed its own code", addr);
+    }
+  }
+
+  if (!(r->flags[r->entry] & F_INSN)) {
+    refuse(r, "can not translate its entry", r->entry);
+  }
+}
+
+static struct routine* new_routine(const char* path, const char* kind, uint8_t song,
+                                   uint16_t entry)
+{
+  struct routine* r;
+
+  if (n_routines == MAX_ROUTINES) {
+    fprintf(stderr, "%s: more than %u routines\n", path, MAX_ROUTINES);
+    return NULL;
+  }
+
+  r = calloc(1, sizeof(*r));
+  if (!r)
+    return NULL;
+
+  r->path = path;
+  r->kind = kind;
+  r->song = song;
+  r->entry = entry;
+  routines[n_routines++] = r;
+
+  return r;
+}
+
+static bool translate_file(const char* path, uint8_t song, uint32_t frames)
+{
+  static struct c64_context ctx;
+  size_t size;
+  uint8_t* data = host_load_file(path, &size);
+  struct routine* init;
+  struct routine* play;
+  struct sid_info info;
+
+  if (!data || !sid_parse_header(data, size, &info)) {
+    fprintf(stderr, "%s: not a SID file\n", path);
+    free(data);
+    return false;
+  }
+
+  if (song > info.subsongs) {
+    fprintf(stderr, "%s: has %u songs\n", path, info.subsongs + 1);
+    free(data);
+    return false;
+  }
+
+  init = new_routine(path, "init", song, info.init_addr);
+  play = new_routine(path, "play", song, info.play_addr);
+  if (!init || !play) {
+    free(data);
+    return false;
+  }
+
+  /* The live machine gives the memory the firmware will see */
+  sid_set_regs((const uint8_t[SID_NUM_REGS]){ 0 });
+  c64_init();
+  if (!sid_load_payload(data, size)) {
+    fprintf(stderr, "%s: can not load\n", path);
+    free(data);
+    return false;
+  }
+  c64_memread(init->image, 0, 65536);
+  c64_cpu_jsr(info.init_addr, song);
+  c64_memread(play->image, 0, 65536);
+
+  /* The context gives what ran */
+  c64_context_init(&ctx, pool, C64_CONTEXT_NO_PAGE);
+  sid_load_context(&ctx, data, size);
+  snapshot(&ctx, init->before);
+  profile(&ctx, info.init_addr, song, init->flags);
+  snapshot(&ctx, init->after);
+
+  if (!info.play_addr) {
+    play->entry = c64_context_peek(&ctx, 0x0314) | c64_context_peek(&ctx, 0x0315) << 8;
+  }
+  memcpy(play->before, init->after, 65536);
+  for (uint32_t f = 0; f < frames; f++) {
+    profile(&ctx, play->entry, 0, play->flags);
+  }
+  snapshot(&ctx, play->after);
+
+  if (ctx.full) {
+    fprintf(stderr, "%s: the context ran out of pages, the profile is incomplete\n", path);
+  }
+
+  disassemble(init);
+  disassemble(play);
+
+  free(data);
+
+  return true;
+}
+
+static void report(const struct routine* r)
+{
+  printf("%s song %u %s $%04x: ", r->path, r->song + 1, r->kind, r->entry);
+
+  if (r->refused) {
+    printf("%s at $%04x, left to the interpreter\n", r->refused, r->refused_at);
+  } else {
+    printf("%u instructions, %u ran, %u bytes in %u ranges\n",
+           r->insns, r->ran, r->bytes, r->n_ranges);
+  }
+}
+
+/* Any of size addresses from addr on, wrapping, has flag */
+static bool hits_code(const struct routine* r, uint32_t addr, uint32_t size)
+{
+  for (uint32_t i = 0; i < size; i++) {
+    if (r->flags[(addr + i) & 0xffff] & F_CODE)
+      return true;
+  }
+
+  return false;
+}
+
+static bool hits_io(uint32_t addr, uint32_t size)
+{
+  for (uint32_t i = 0; i < size; i++) {
+    if ((uint16_t)(((addr + i) & 0xffff) - IO_BASE) < IO_SIZE)
+      return true;
+  }
+
+  return false;
+}
+
+/* The addresses an indexed or indirect operand can reach */
+static void reach(uint8_t mode, uint16_t arg, uint32_t* addr, uint32_t* size)
+{
+  switch (mode) {
+    case MOS6510_MODE_ZPX:
+    case MOS6510_MODE_ZPY:
+      *addr = 0;
+      *size = 256;
+      break;
+
+    case MOS6510_MODE_ABSX:
+    case MOS6510_MODE_ABSY:
+      *addr = arg;
+      *size = 256;
+      break;
+
+    default:
+      *addr = 0;
+      *size = 65536;
+      break;
+  }
+}
+
+static bool is_indexed(uint8_t mode)
+{
+  return mode == MOS6510_MODE_ZPX || mode == MOS6510_MODE_ZPY ||
+         mode == MOS6510_MODE_ABSX || mode == MOS6510_MODE_ABSY ||
+         mode == MOS6510_MODE_INDX || mode == MOS6510_MODE_INDY;
+}
+
+static void emit_ea(struct gen* g, uint8_t mode, uint16_t arg)
+{
+  g->ea = true;
+
+  switch (mode) {
+    case MOS6510_MODE_ZPX:
+      fprintf(g->f, "ea = (uint8_t)(0x%02x + x); ", arg);
+      break;
+    case MOS6510_MODE_ZPY:
+      fprintf(g->f, "ea = (uint8_t)(0x%02x + y); ", arg);
+      break;
+    case MOS6510_MODE_ABSX:
+      fprintf(g->f, "ea = (uint16_t)(0x%04x + x); ", arg);
+      break;
+    case MOS6510_MODE_ABSY:
+      fprintf(g->f, "ea = (uint16_t)(0x%04x + y); ", arg);
+      break;
+    case MOS6510_MODE_INDX:
+      fprintf(g->f, "ea = mem[(uint8_t)(0x%02x + x)] | mem[(uint8_t)(0x%02x + x)] << 8; ",
+              arg, (arg + 1) & 0xff);
+      break;
+    case MOS6510_MODE_INDY:
+      fprintf(g->f, "ea = (uint16_t)((mem[0x%02x] | mem[0x%02x] << 8) + y); ",
+              arg, (arg + 1) & 0xff);
+      break;
+  }
+}
+
+/* Emits ea where the mode needs it and returns how the operand is read */
+static const char* emit_load(struct gen* g, uint8_t mode, uint16_t arg)
+{
+  static char buf[64];
+  uint32_t addr;
+  uint32_t size;
+
+  switch (mode) {
+    case MOS6510_MODE_IMM:
+      snprintf(buf, sizeof(buf), "0x%02x", arg);
+      return buf;
+
+    case MOS6510_MODE_ACC:
+      return "a";
+
+    case MOS6510_MODE_ZP:
+      snprintf(buf, sizeof(buf), "mem[0x%02x]", arg);
+      return buf;
+
+    case MOS6510_MODE_ABS:
+      if (hits_io(arg, 1)) {
+        snprintf(buf, sizeof(buf), "(SYNC(), sid_peek(0x%02x))", arg & 0x1f);
+      } else {
+        snprintf(buf, sizeof(buf), "mem[0x%04x]", arg);
+      }
+      return buf;
+  }
+
+  emit_ea(g, mode, arg);
+  reach(mode, arg, &addr, &size);
+
+  return hits_io(addr, size) ? "READ(ea)" : "mem[ea]";
+}
+
+/* ea is already there for indexed modes, returns true for a guarded store */
+static bool emit_store(struct gen* g, uint8_t mode, uint16_t arg, const char* val)
+{
+  uint32_t addr;
+  uint32_t size;
+
+  switch (mode) {
+    case MOS6510_MODE_ACC:
+      fprintf(g->f, "a = %s; ", val);
+      return false;
+
+    case MOS6510_MODE_ZP:
+      fprintf(g->f, "mem[0x%02x] = %s; DIRTY(0x%04x); ", arg, val, arg);
+      return false;
+
+    case MOS6510_MODE_ABS:
+      if (hits_io(arg, 1)) {
+        fprintf(g->f, "SYNC(); sid_poke(0x%02x, %s); ", arg & 0x1f, val);
+      } else {
+        fprintf(g->f, "mem[0x%04x] = %s; DIRTY(0x%04x); ", arg, val, arg);
+      }
+      return false;
+  }
+
+  reach(mode, arg, &addr, &size);
+
+  if (hits_code(g->r, addr, size)) {
+    g->smc = true;
+    fprintf(g->f, "SYNC(); smc = !c64_aot_write(ea, %s); ", val);
+    return true;
+  }
+
+  if (hits_io(addr, size)) {
+    fprintf(g->f, "WRITE(ea, %s); ", val);
+  } else {
+    fprintf(g->f, "mem[ea] = %s; DIRTY(ea); ", val);
+  }
+
+  return false;
+}
+
+static void emit_jump(struct gen* g, uint32_t target)
+{
+  /* Off the end of memory the interpreter's pc is 0, which ends the call */
+  if (target == 0x10000) {
+    fprintf(g->f, "LEAVE(0, true);");
+  } else if (g->r->flags[target] & F_INSN) {
+    fprintf(g->f, "goto L%04x;", target);
+  } else {
+    fprintf(g->f, "LEAVE(0x%04x, true);", target);
+  }
+}
+
+static void emit_disassembly(struct gen* g, uint16_t pc)
+{
+  uint8_t opc = g->r->image[pc];
+  uint8_t type = type_of(opc);
+  uint16_t arg = operand_of(g->r->image, pc);
+
+  fprintf(g->f, "  /* %04x ", pc);
+
+  if (type >= MOS6510_TYPE_XXX) {
+    fprintf(g->f, "$%02x */\n", opc);
+    return;
+  }
+
+  fprintf(g->f, "%s", names[type]);
+
+  switch (mode_of(opc)) {
+    case MOS6510_MODE_IMM:  fprintf(g->f, " #$%02x", arg); break;
+    case MOS6510_MODE_ABS:  fprintf(g->f, " $%04x", arg); break;
+    case MOS6510_MODE_ABSX: fprintf(g->f, " $%04x,x", arg); break;
+    case MOS6510_MODE_ABSY: fprintf(g->f, " $%04x,y", arg); break;
+    case MOS6510_MODE_ZP:   fprintf(g->f, " $%02x", arg); break;
+    case MOS6510_MODE_ZPX:  fprintf(g->f, " $%02x,x", arg); break;
+    case MOS6510_MODE_ZPY:  fprintf(g->f, " $%02x,y", arg); break;
+    case MOS6510_MODE_IND:  fprintf(g->f, " ($%04x)", arg); break;
+    case MOS6510_MODE_INDX: fprintf(g->f, " ($%02x,x)", arg); break;
+    case MOS6510_MODE_INDY: fprintf(g->f, " ($%02x),y", arg); break;
+    case MOS6510_MODE_ACC:  fprintf(g->f, " a"); break;
+    case MOS6510_MODE_REL:  fprintf(g->f, " $%04x", branch_target(pc, arg)); break;
+  }
+
+  fprintf(g->f, " */\n");
+}
+
+/* Returns whether the instruction falls through to the next one */
+static bool emit_insn(struct gen* g, uint16_t pc)
+{
+  const char* const branch_cond[] = {
+    [MOS6510_TYPE_BCC] = "!c",
+    [MOS6510_TYPE_BCS] = "c",
+    [MOS6510_TYPE_BEQ] = "nz == 0",
+    [MOS6510_TYPE_BNE] = "nz != 0",
+    [MOS6510_TYPE_BMI] = "n & 0x80",
+    [MOS6510_TYPE_BPL] = "!(n & 0x80)",
+    [MOS6510_TYPE_BVC] = "!v",
+    [MOS6510_TYPE_BVS] = "v",
+  };
+  FILE* f = g->f;
+  uint8_t opc = g->r->image[pc];
+  uint8_t type = type_of(opc);
+  uint8_t mode = mode_of(opc);
+  uint16_t arg = operand_of(g->r->image, pc);
+  uint16_t next = pc + insn_len(opc);
+  const char* reg;
+  const char* val;
+  bool guarded = false;
+
+  if (g->r->flags[pc] & F_LABEL) {
+    fprintf(f, "L%04x:\n", pc);
+  }
+  emit_disassembly(g, pc);
+  fprintf(f, "  cyc += %u; ", mos6510_cycle_table[opc]);
+
+  if (type >= MOS6510_TYPE_XXX) {
+    type = MOS6510_TYPE_NOP;
+  }
+
+  switch (type) {
+    case MOS6510_TYPE_ADC:
+    case MOS6510_TYPE_SBC:
+      val = emit_load(g, mode, arg);
+      g->t = true;
+      if (type == MOS6510_TYPE_ADC) {
+        fprintf(f, "t = a + %s + c; ", val);
+      } else {
+        fprintf(f, "t = a + (uint8_t)(%s ^ 0xff) + c; ", val);
+      }
+      fprintf(f, "c = t >> 8; a = t; NZ(a); v = c ^ (a >> 7); ");
+      break;
+
+    case MOS6510_TYPE_AND:
+      fprintf(f, "a &= %s; NZ(a); ", emit_load(g, mode, arg));
+      break;
+    case MOS6510_TYPE_ORA:
+      fprintf(f, "a |= %s; NZ(a); ", emit_load(g, mode, arg));
+      break;
+    case MOS6510_TYPE_EOR:
+      fprintf(f, "a ^= %s; NZ(a); ", emit_load(g, mode, arg));
+      break;
+
+    case MOS6510_TYPE_ASL:
+    case MOS6510_TYPE_LSR:
+    case MOS6510_TYPE_ROL:
+    case MOS6510_TYPE_ROR:
+    case MOS6510_TYPE_INC:
+    case MOS6510_TYPE_DEC:
+      g->b = true;
+      fprintf(f, "b = %s; ", emit_load(g, mode, arg));
+      switch (type) {
+        case MOS6510_TYPE_ASL:
+          fprintf(f, "c = b >> 7; b <<= 1; ");
+          break;
+        case MOS6510_TYPE_LSR:
+          fprintf(f, "c = b & 1; b >>= 1; ");
+          break;
+        case MOS6510_TYPE_ROL:
+          g->t = true;
+          fprintf(f, "t = c; c = b >> 7; b = b << 1 | t; ");
+          break;
+        case MOS6510_TYPE_ROR:
+          g->t = true;
+          fprintf(f, "t = c; c = b & 1; b = b >> 1 | t << 7; ");
+          break;
+        case MOS6510_TYPE_INC:
+          fprintf(f, "b++; ");
+          break;
+        case MOS6510_TYPE_DEC:
+          fprintf(f, "b--; ");
+          break;
+      }
+      guarded = emit_store(g, mode, arg, "b");
+      fprintf(f, "NZ(b); ");
+      break;
+
+    case MOS6510_TYPE_BIT:
+      g->b = true;
+      fprintf(f, "b = %s; nz = a & b; n = b; v = b >> 6 & 1; ", emit_load(g, mode, arg));
+      break;
+
+    case MOS6510_TYPE_CMP:
+    case MOS6510_TYPE_CPX:
+    case MOS6510_TYPE_CPY:
+      reg = type == MOS6510_TYPE_CMP ? "a" : type == MOS6510_TYPE_CPX ? "x" : "y";
+      g->b = true;
+      fprintf(f, "b = %s; NZ(%s - b); c = %s >= b; ", emit_load(g, mode, arg), reg, reg);
+      break;
+
+    case MOS6510_TYPE_LDA:
+      fprintf(f, "a = %s; NZ(a); ", emit_load(g, mode, arg));
+      break;
+    case MOS6510_TYPE_LDX:
+      fprintf(f, "x = %s; NZ(x); ", emit_load(g, mode, arg));
+      break;
+    case MOS6510_TYPE_LDY:
+      fprintf(f, "y = %s; NZ(y); ", emit_load(g, mode, arg));
+      break;
+
+    case MOS6510_TYPE_STA:
+    case MOS6510_TYPE_STX:
+    case MOS6510_TYPE_STY:
+      if (is_indexed(mode)) {
+        emit_ea(g, mode, arg);
+      }
+      guarded = emit_store(g, mode, arg, type == MOS6510_TYPE_STA ? "a" :
+                                         type == MOS6510_TYPE_STX ? "x" : "y");
+      break;
+
+    case MOS6510_TYPE_DEX: fprintf(f, "x--; NZ(x); "); break;
+    case MOS6510_TYPE_DEY: fprintf(f, "y--; NZ(y); "); break;
+    case MOS6510_TYPE_INX: fprintf(f, "x++; NZ(x); "); break;
+    case MOS6510_TYPE_INY: fprintf(f, "y++; NZ(y); "); break;
+    case MOS6510_TYPE_TAX: fprintf(f, "x = a; NZ(x); "); break;
+    case MOS6510_TYPE_TAY: fprintf(f, "y = a; NZ(y); "); break;
+    case MOS6510_TYPE_TSX: fprintf(f, "x = s; NZ(x); "); break;
+    case MOS6510_TYPE_TXA: fprintf(f, "a = x; NZ(a); "); break;
+    case MOS6510_TYPE_TYA: fprintf(f, "a = y; NZ(a); "); break;
+    case MOS6510_TYPE_TXS: fprintf(f, "s = x; "); break;
+    case MOS6510_TYPE_CLC: fprintf(f, "c = 0; "); break;
+    case MOS6510_TYPE_SEC: fprintf(f, "c = 1; "); break;
+    case MOS6510_TYPE_CLV: fprintf(f, "v = 0; "); break;
+    case MOS6510_TYPE_CLD: fprintf(f, "p &= ~MOS6510_FLAG_D; "); break;
+    case MOS6510_TYPE_SED: fprintf(f, "p |= MOS6510_FLAG_D; "); break;
+    case MOS6510_TYPE_CLI: fprintf(f, "p &= ~MOS6510_FLAG_I; "); break;
+    case MOS6510_TYPE_SEI: fprintf(f, "p |= MOS6510_FLAG_I; "); break;
+    case MOS6510_TYPE_PHA: fprintf(f, "PUSH(a); "); break;
+    case MOS6510_TYPE_PHP: fprintf(f, "PUSH(GET_P()); "); break;
+    case MOS6510_TYPE_PLA: fprintf(f, "a = POP(); NZ(a); "); break;
+
+    case MOS6510_TYPE_PLP:
+      g->b = true;
+      fprintf(f, "b = POP(); SET_P(b); ");
+      break;
+
+    case MOS6510_TYPE_NOP:
+      break;
+
+    case MOS6510_TYPE_BRK:
+      fprintf(f, "ins++; LEAVE(0, true);\n");
+      return false;
+
+    case MOS6510_TYPE_JMP:
+      if (mode == MOS6510_MODE_IND) {
+        g->dispatch = true;
+        fprintf(f, "pc = mem[0x%04x] | mem[0x%04x] << 8; ins++; goto dispatch;\n",
+                arg, (uint16_t)(arg + 1));
+      } else {
+        fprintf(f, "ins++; ");
+        emit_jump(g, arg);
+        fprintf(f, "\n");
+      }
+      return false;
+
+    case MOS6510_TYPE_JSR:
+      fprintf(f, "PUSH(0x%02x); PUSH(0x%02x); ins++; ",
+              (uint16_t)(pc + 2) >> 8, (pc + 2) & 0xff);
+      emit_jump(g, arg);
+      fprintf(f, "\n");
+      return false;
+
+    case MOS6510_TYPE_RTI:
+    case MOS6510_TYPE_RTS:
+      g->b = true;
+      g->dispatch = true;
+      fprintf(f, "b = POP(); pc = b; b = POP(); pc = (pc | b << 8) + 1; ins++; goto dispatch;\n");
+      return false;
+
+    default:
+      if (is_branch(type)) {
+        fprintf(f, "ins++; if (%s) { cyc++; ", branch_cond[type]);
+        emit_jump(g, branch_target(pc, arg));
+        fprintf(f, " }\n");
+        return true;
+      }
+      break;
+  }
+
+  fprintf(f, "ins++;");
+  if (guarded) {
+    fprintf(f, " if (smc) LEAVE(0x%04x, false);", next);
+  }
+  fprintf(f, "\n");
+
+  return true;
+}
+
+static void routine_name(char* buf, size_t size, const struct routine* r, uint8_t index)
+{
+  snprintf(buf, size, "%s_%04x_%u", r->kind, r->entry, index);
+}
+
+static void emit_routine(FILE* out, const struct routine* r, uint8_t index)
+{
+  struct gen g = { .r = r };
+  char* body;
+  size_t body_size;
+  char name[32];
+  bool falls = false;
+  uint32_t next = 0;
+
+  g.f = open_memstream(&body, &body_size);
+  if (!g.f) {
+    perror("open_memstream");
+    exit(1);
+  }
+
+  for (uint32_t pc = 0; pc < 65536; pc++) {
+    if (!(r->flags[pc] & F_INSN))
+      continue;
+
+    /* Falling through to an instruction that is not the next one */
+    if (falls && next != pc) {
+      fprintf(g.f, "  ");
+      emit_jump(&g, next);
+      fprintf(g.f, "\n");
+    }
+
+    falls = emit_insn(&g, pc);
+    next = pc + insn_len(r->image[pc]);
+  }
+
+  if (falls) {
+    fprintf(g.f, "  ");
+    emit_jump(&g, next);
+    fprintf(g.f, "\n");
+  }
+  fclose(g.f);
+
+  routine_name(name, sizeof(name), r, index);
+
+  fprintf(out, "/* %s song %u, %u instructions */\n", r->path, r->song + 1, r->insns);
+  fprintf(out, "static bool %s(struct c64_aot_machine* m)\n{\n", name);
+  fprintf(out, "  uint8_t* mem = m->memory;\n");
+  fprintf(out, "  uint32_t cyc = *m->cycles;\n");
+  fprintf(out, "  uint32_t ins = *m->instructions;\n");
+  fprintf(out, "  uint8_t a = m->cpu.a;\n");
+  fprintf(out, "  uint8_t x = m->cpu.x;\n");
+  fprintf(out, "  uint8_t y = m->cpu.y;\n");
+  fprintf(out, "  uint8_t s = m->cpu.s;\n");
+  fprintf(out, "  uint8_t p, n, nz, c, v;\n");
+  if (g.b) {
+    fprintf(out, "  uint8_t b;\n");
+  }
+  if (g.t) {
+    fprintf(out, "  unsigned t;\n");
+  }
+  if (g.ea) {
+    fprintf(out, "  uint16_t ea;\n");
+  }
+  fprintf(out, "  uint16_t pc;\n");
+  if (g.smc) {
+    fprintf(out, "  bool smc = false;\n");
+  }
+  fprintf(out, "  bool ok;\n\n");
+  fprintf(out, "  SET_P(m->cpu.p);\n");
+  fprintf(out, "  goto L%04x;\n\n", r->entry);
+
+  /* The end of the call, pc 0 or 1, leaves like code that was not found */
+  if (g.dispatch) {
+    bool cases = false;
+
+    fprintf(out, "dispatch:\n");
+    for (uint32_t pc = 0; pc < 65536; pc++) {
+      if ((r->flags[pc] & (F_INSN | F_DISPATCH)) == (F_INSN | F_DISPATCH)) {
+        fprintf(out, "%s    case 0x%04x: goto L%04x;\n", cases ? "" : "  switch (pc) {\n",
+                pc, pc);
+        cases = true;
+      }
+    }
+    if (cases) {
+      fprintf(out, "    default: LEAVE(pc, true);\n  }\n\n");
+    } else {
+      fprintf(out, "  LEAVE(pc, true);\n\n");
+    }
+  }
+
+  fwrite(body, 1, body_size, out);
+  free(body);
+
+  fprintf(out, "\nleave:\n");
+  fprintf(out, "  SYNC();\n");
+  fprintf(out, "  m->cpu.a = a;\n");
+  fprintf(out, "  m->cpu.x = x;\n");
+  fprintf(out, "  m->cpu.y = y;\n");
+  fprintf(out, "  m->cpu.s = s;\n");
+  fprintf(out, "  m->cpu.p = GET_P();\n");
+  fprintf(out, "  m->cpu.pc = pc;\n\n");
+  fprintf(out, "  return ok;\n");
+  fprintf(out, "}\n\n");
+}
+
+static void emit_ranges(FILE* out, const struct routine* r, uint8_t index)
+{
+  char name[32];
+  uint32_t offset = 0;
+  uint32_t col = 0;
+
+  routine_name(name, sizeof(name), r, index);
+
+  fprintf(out, "static const uint8_t %s_code[] = {", name);
+  for (uint32_t addr = 0; addr < 65536; addr++) {
+    if (r->flags[addr] & F_CODE) {
+      fprintf(out, "%s0x%02x,", col++ % 12 ? " " : "\n  ", r->image[addr]);
+    }
+  }
+  fprintf(out, "\n};\n\n");
+
+  fprintf(out, "static const struct c64_aot_range %s_ranges[] = {\n", name);
+  for (uint32_t addr = 0; addr < 65536; addr++) {
+    uint32_t end = addr;
+
+    if (!(r->flags[addr] & F_CODE))
+      continue;
+
+    while (end < 65536 && (r->flags[end] & F_CODE)) {
+      end++;
+    }
+
+    fprintf(out, "  { 0x%04x, %u, %s_code + %u },\n", addr, end - addr, name, offset);
+    offset += end - addr;
+    addr = end;
+  }
+  fprintf(out, "};\n\n");
+}
+
+static const char prologue[] =
+  "/*\n"
+  " * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com\n"
+  " *\n"
+  " * SPDX-License-Identifier: GPL-2.0-or-later\n"
+  " *\n"
+  " * The routines tools/sidaot.c translated, see c64_aot.h. The tool writes\n"
+  " * this file, run it again instead of editing it.\n"
+  " */\n"
+  "\n"
+  "#include \"c64_aot.h\"\n"
+  "#include \"sid.h\"\n"
+  "\n"
+  "#include <stddef.h>\n"
+  "\n";
+
+static const char macros[] =
+  "/*\n"
+  " * The CPU is kept in locals, the counters are stored before the SID or the\n"
+  " * interpreter can look at them. The flags are kept the way the interpreter\n"
+  " * keeps them, nz holds the result that sets Z and n the one that sets N.\n"
+  " */\n"
+  "#define SYNC()          (*m->cycles = cyc, *m->instructions = ins)\n"
+  "#define NZ(val)         (nz = n = (uint8_t)(val))\n"
+  "#define DIRTY(addr)     (m->dirty[(addr) >> 13] |= 1U << (((addr) >> 8) & 31))\n"
+  "#define IO(addr)        (((addr) & 0xfc00) == 0xd400)\n"
+  "#define READ(addr)      (IO(addr) ? (SYNC(), sid_peek((addr) & 0x1f)) : mem[addr])\n"
+  "#define WRITE(addr, val) \\\n"
+  "  do { if (IO(addr)) { SYNC(); sid_poke((addr) & 0x1f, (val)); } \\\n"
+  "       else { mem[addr] = (val); DIRTY(addr); } } while (0)\n"
+  "#define PUSH(val)       (mem[0x100 + s] = (val), DIRTY(0x100), s -= s != 0)\n"
+  "#define POP()           (s += s < 0xff, mem[0x100 + s])\n"
+  "#define GET_P()         ((p & ~(MOS6510_FLAG_N | MOS6510_FLAG_V | MOS6510_FLAG_Z | \\\n"
+  "                                MOS6510_FLAG_C)) | (n & MOS6510_FLAG_N) | \\\n"
+  "                         (v ? MOS6510_FLAG_V : 0) | (nz ? 0 : MOS6510_FLAG_Z) | c)\n"
+  "#define SET_P(val)      (p = (val), n = p, nz = !(p & MOS6510_FLAG_Z), \\\n"
+  "                         c = p & MOS6510_FLAG_C, v = !!(p & MOS6510_FLAG_V))\n"
+  "#define LEAVE(addr, intact) do { pc = (addr); ok = (intact); goto leave; } while (0)\n"
+  "\n";
+
+static bool write_output(const char* path)
+{
+  FILE* out = fopen(path, "w");
+  uint8_t n = 0;
+
+  if (!out) {
+    perror(path);
+    return false;
+  }
+
+  fputs(prologue, out);
+
+  for (uint8_t i = 0; i < n_routines; i++) {
+    n += !routines[i]->refused;
+  }
+
+  if (!n) {
+    fprintf(out, "const struct c64_aot_routine* const sid_aot_routines = NULL;\n");
+    fprintf(out, "const uint8_t sid_aot_n_routines = 0;\n");
+    return fclose(out) == 0;
+  }
+
+  fputs(macros, out);
+
+  for (uint8_t i = 0; i < n_routines; i++) {
+    if (!routines[i]->refused) {
+      emit_ranges(out, routines[i], i);
+      emit_routine(out, routines[i], i);
+    }
+  }
+
+  fprintf(out, "static const struct c64_aot_routine routines[] = {\n");
+  for (uint8_t i = 0; i < n_routines; i++) {
+    const struct routine* r = routines[i];
+    char name[32];
+
+    if (r->refused)
+      continue;
+
+    routine_name(name, sizeof(name), r, i);
+    fprintf(out, "  { 0x%04x, %u, %s_ranges, %s },\n", r->entry, r->n_ranges, name, name);
+  }
+  fprintf(out, "};\n\n");
+
+  fprintf(out, "const struct c64_aot_routine* const sid_aot_routines = routines;\n");
+  fprintf(out, "const uint8_t sid_aot_n_routines = %u;\n", n);
+
+  return fclose(out) == 0;
+}
+
+int main(int argc, char** argv)
+{
+  const char* out = NULL;
+  uint32_t frames = 3000;
+  uint32_t song = 1;
+  int res = 0;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "n:f:o:")) != -1) {
+    switch (opt) {
+      case 'n':
+        song = strtoul(optarg, NULL, 0);
+        break;
+      case 'f':
+        frames = strtoul(optarg, NULL, 0);
+        break;
+      case 'o':
+        out = optarg;
+        break;
+      default:
+        fprintf(stderr, "usage: %s [-n song] [-f frames] [-o src/sid_aot.c] file.sid...\n",
+                argv[0]);
+        return 1;
+    }
+  }
+
+  if (song < 1 || song > 256) {
+    fprintf(stderr, "songs count from 1\n");
+    return 1;
+  }
+
+  sid_proto_init(SID_PROTO_MODE_BLOCKING, false);
+  sid_mute(true);
+
+  for (int i = optind; i < argc; i++) {
+    if (!translate_file(argv[i], song - 1, frames)) {
+      res = 1;
+    }
+  }
+
+  for (uint8_t i = 0; i < n_routines; i++) {
+    report(routines[i]);
+  }
+
+  if (out && !write_output(out)) {
+    res = 1;
+  }
+
+  return res;
+}
@@ -0,0 +1,425 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Cuts the payloads of SID files into chunks and keeps every chunk once, see
+ * sid_is_chunked() in sid.h.
+ *
+ *   sidchunk [-a bytes] [-x] -o dir file.sid...
+ *                                  write the store and the chunked images,
+ *                                  -x writes C includes like the .hex files
+ *                                  in src
+ *   sidchunk [-a bytes] file.sid...
+ *                                  report what every file shares and the
+ *                                  dedup ratio of them all
+ *
+ * A chunk ends where a gear hash over the bytes so far has its top bits
+ * clear, so the same code cuts the same way wherever it was loaded and
+ * whatever data comes before it. -a sets the average chunk size, a power of
+ * two, chunks are at least a quarter and at most eight times of it. Every
+ * chunked image is loaded again and compared with the plain file before it
+ * is written or counted.
+ */
+
+#include "c64.h"
+#include "sid.h"
+#include "sid_proto.h"
+#include "host.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <libgen.h>
+
+#define MAX_CHUNKS      65535
+#define HASH_BITS       16
+
+#define LOAD_REPEATS    2000
+
+struct file
+{
+  const char* path;
+  uint8_t* data;
+  size_t size;
+  uint8_t* chunked;
+  size_t chunked_size;
+  uint32_t chunks;
+  size_t new_bytes;             /* in chunks no earlier file had */
+};
+
+struct store
+{
+  uint8_t* data;                /* the chunks */
+  size_t size;
+  size_t max;
+  uint32_t offsets[MAX_CHUNKS + 1];
+  uint64_t hashes[MAX_CHUNKS];
+  uint16_t n;
+  int32_t head[1 << HASH_BITS];
+  int32_t next[MAX_CHUNKS];
+};
+
+static uint32_t gear[256];
+static struct store store;
+
+static uint32_t min_size = 32;
+static uint32_t avg_size = 128;
+static uint32_t max_size = 1024;
+
+static void init_gear(void)
+{
+  uint64_t x = 0x5349444353494443ULL;
+
+  /* splitmix64, any fixed random table does */
+  for (int i = 0; i < 256; i++) {
+    uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    gear[i] = (z ^ (z >> 31)) >> 32;
+  }
+}
+
+/* Length of the chunk that starts at in */
+static size_t cut(const uint8_t* in, size_t n)
+{
+  uint32_t mask = ~(UINT32_MAX >> __builtin_ctz(avg_size));
+  uint32_t h = 0;
+
+  if (n <= min_size)
+    return n;
+
+  for (size_t i = 0; i < n && i < max_size; i++) {
+    h = (h << 1) + gear[in[i]];
+
+    if (i + 1 >= min_size && (h & mask) == 0)
+      return i + 1;
+  }
+
+  return n < max_size ? n : max_size;
+}
+
+static uint64_t fnv1a64(const uint8_t* data, size_t len)
+{
+  uint64_t hash = 0xcbf29ce484222325ULL;
+
+  while (len--) {
+    hash ^= *data++;
+    hash *= 0x100000001b3ULL;
+  }
+
+  return hash;
+}
+
+/* Number of the chunk, a new one when no chunk is the same, -1 when full */
+static int32_t add_chunk(const uint8_t* data, size_t len, bool* added)
+{
+  uint64_t hash = fnv1a64(data, len);
+  uint32_t slot = hash & ((1 << HASH_BITS) - 1);
+
+  for (int32_t id = store.head[slot]; id >= 0; id = store.next[id]) {
+    if (store.hashes[id] == hash && store.offsets[id + 1] - store.offsets[id] == len &&
+        memcmp(&store.data[store.offsets[id]], data, len) == 0) {
+      *added = false;
+      return id;
+    }
+  }
+
+  if (store.n == MAX_CHUNKS)
+    return -1;
+
+  if (store.size + len > store.max) {
+    store.max = (store.max + len) * 2;
+    store.data = realloc(store.data, store.max);
+  }
+  memcpy(&store.data[store.size], data, len);
+
+  store.offsets[store.n] = store.size;
+  store.size += len;
+  store.offsets[store.n + 1] = store.size;
+  store.hashes[store.n] = hash;
+  store.next[store.n] = store.head[slot];
+  store.head[slot] = store.n;
+  *added = true;
+
+  return store.n++;
+}
+
+/* Cuts the payload into the store and makes the chunked image */
+static bool chunk_file(struct file* f)
+{
+  const uint8_t* data = f->data;
+  uint8_t offset;
+  size_t payload;
+  size_t pos;
+  size_t list;
+
+  if (f->size < 0x7c || memcmp(&data[1], "SID", 3) || (data[0] != 'P' && data[0] != 'R'))
+    return false;
+
+  offset = data[7];
+  if (f->size < offset + 3u)
+    return false;
+
+  payload = f->size - (offset + 2);
+  if (payload > 0xffff)
+    return false;
+
+  /* At most one chunk per minimum size, and the last one */
+  f->chunked = malloc(offset + 6 + (payload / min_size + 1) * 2);
+  memcpy(f->chunked, data, offset + 2);
+  f->chunked[3] = 'C';
+  f->chunked[offset + 2] = payload;
+  f->chunked[offset + 3] = payload >> 8;
+  list = offset + 6;
+
+  f->chunks = 0;
+  f->new_bytes = 0;
+
+  for (pos = 0; pos < payload;) {
+    const uint8_t* p = &data[offset + 2 + pos];
+    size_t len = cut(p, payload - pos);
+    bool added;
+    int32_t id = add_chunk(p, len, &added);
+
+    if (id < 0) {
+      fprintf(stderr, "%s: more than %u chunks\n", f->path, MAX_CHUNKS);
+      return false;
+    }
+
+    f->chunked[list++] = id;
+    f->chunked[list++] = id >> 8;
+    f->chunks++;
+    if (added) {
+      f->new_bytes += len;
+    }
+
+    pos += len;
+  }
+
+  f->chunked[offset + 4] = f->chunks;
+  f->chunked[offset + 5] = f->chunks >> 8;
+  f->chunked_size = list;
+
+  return true;
+}
+
+/* SIDC, the number of chunks, the offsets from the start of the store, the chunks */
+static uint8_t* make_store(size_t* size)
+{
+  size_t table = 6 + (store.n + 1) * 4;
+  uint8_t* out = malloc(table + store.size);
+
+  memcpy(out, "SIDC", 4);
+  out[4] = store.n;
+  out[5] = store.n >> 8;
+
+  for (uint32_t i = 0; i <= store.n; i++) {
+    uint32_t val = table + store.offsets[i];
+
+    for (int b = 0; b < 4; b++) {
+      out[6 + i * 4 + b] = val >> (b * 8);
+    }
+  }
+
+  memcpy(&out[table], store.data, store.size);
+  *size = table + store.size;
+
+  return out;
+}
+
+static bool same_memory(const uint8_t* a, size_t a_size, const uint8_t* b, size_t b_size)
+{
+  static uint8_t mem_a[65536];
+  static uint8_t mem_b[65536];
+
+  if (!sid_load_payload(a, a_size))
+    return false;
+  c64_memread(mem_a, 0, sizeof(mem_a));
+
+  if (!sid_load_payload(b, b_size))
+    return false;
+  c64_memread(mem_b, 0, sizeof(mem_b));
+
+  return memcmp(mem_a, mem_b, sizeof(mem_a)) == 0;
+}
+
+static double load_us(const uint8_t* data, size_t size)
+{
+  uint64_t start = host_time_ns();
+
+  for (int i = 0; i < LOAD_REPEATS; i++) {
+    sid_load_payload(data, size);
+  }
+
+  return (host_time_ns() - start) / 1000.0 / LOAD_REPEATS;
+}
+
+static int write_output(const char* path, const uint8_t* data, size_t size, bool hex)
+{
+  FILE* f = fopen(path, hex ? "w" : "wb");
+
+  if (!f) {
+    perror(path);
+    return -1;
+  }
+
+  if (hex) {
+    for (size_t i = 0; i < size; i++) {
+      fprintf(f, "0x%02x,%s", data[i], (i % 8 == 7 || i + 1 == size) ? "\n" : " ");
+    }
+  } else {
+    fwrite(data, 1, size, f);
+  }
+
+  return fclose(f);
+}
+
+/* dir/name_chunked.hex for dir/name.sid */
+static char* output_path(const char* dir, const char* path, bool hex)
+{
+  char* copy = strdup(path);
+  char* base = basename(copy);
+  char* dot = strrchr(base, '.');
+  char* out;
+
+  if (dot) {
+    *dot = '\0';
+  }
+
+  out = malloc(strlen(dir) + strlen(base) + 16);
+  sprintf(out, "%s/%s_chunked.%s", dir, base, hex ? "hex" : "bin");
+  free(copy);
+
+  return out;
+}
+
+int main(int argc, char** argv)
+{
+  const char* out = NULL;
+  bool hex = false;
+  struct file* files;
+  int n_files = 0;
+  uint8_t* store_data;
+  size_t store_size;
+  size_t total_raw = 0;
+  size_t total_payload = 0;
+  size_t total_chunked = 0;
+  double total_raw_us = 0;
+  double total_chunked_us = 0;
+  int res = 0;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "a:o:x")) != -1) {
+    switch (opt) {
+      case 'a':
+        avg_size = strtoul(optarg, NULL, 0);
+        break;
+      case 'o':
+        out = optarg;
+        break;
+      case 'x':
+        hex = true;
+        break;
+      default:
+        fprintf(stderr, "usage: %s [-a bytes] [-x] -o dir file.sid...\n"
+                        "       %s [-a bytes] file.sid...\n", argv[0], argv[0]);
+        return 1;
+    }
+  }
+
+  if (avg_size < 16 || avg_size > 4096 || (avg_size & (avg_size - 1))) {
+    fprintf(stderr, "the average chunk size is a power of two from 16 to 4096\n");
+    return 1;
+  }
+  min_size = avg_size / 4;
+  max_size = avg_size * 8;
+
+  if (optind == argc) {
+    fprintf(stderr, "no files\n");
+    return 1;
+  }
+
+  init_gear();
+  memset(store.head, 0xff, sizeof(store.head));
+  files = calloc(argc - optind, sizeof(*files));
+
+  for (int i = optind; i < argc; i++) {
+    struct file* f = &files[n_files];
+
+    f->path = argv[i];
+    f->data = host_load_file(argv[i], &f->size);
+    if (!f->data) {
+      res = 1;
+      continue;
+    }
+
+    if (!chunk_file(f)) {
+      fprintf(stderr, "%s: not a SID file\n", argv[i]);
+      free(f->data);
+      res = 1;
+      continue;
+    }
+
+    n_files++;
+  }
+
+  store_data = make_store(&store_size);
+
+  sid_proto_init(SID_PROTO_MODE_BLOCKING, false);
+  c64_init();
+  sid_set_chunk_store(store_data, store_size);
+
+  for (int i = 0; i < n_files; i++) {
+    struct file* f = &files[i];
+    double raw_us, chunked_us;
+
+    if (!same_memory(f->data, f->size, f->chunked, f->chunked_size)) {
+      fprintf(stderr, "%s: chunked image does not load like the original\n", f->path);
+      return 1;
+    }
+
+    if (out) {
+      char* path = output_path(out, f->path, hex);
+
+      if (write_output(path, f->chunked, f->chunked_size, hex) < 0)
+        res = 1;
+      free(path);
+      continue;
+    }
+
+    raw_us = load_us(f->data, f->size);
+    chunked_us = load_us(f->chunked, f->chunked_size);
+
+    printf("%-28s %6zu bytes %4u chunks %5.1f%% shared  load %6.2f us raw %6.2f us chunked\n",
+           f->path, f->size, f->chunks,
+           100.0 - 100.0 * f->new_bytes / (f->size - (f->data[7] + 2)), raw_us, chunked_us);
+
+    total_raw += f->size;
+    total_payload += f->size - (f->data[7] + 2);
+    total_chunked += f->chunked_size;
+    total_raw_us += raw_us;
+    total_chunked_us += chunked_us;
+  }
+
+  if (out) {
+    char* path = malloc(strlen(out) + 20);
+
+    sprintf(path, "%s/sid_chunks.%s", out, hex ? "hex" : "bin");
+    if (write_output(path, store_data, store_size, hex) < 0)
+      res = 1;
+    free(path);
+  } else if (n_files) {
+    printf("%-28s %6zu bytes %4u chunks, payloads %zu bytes dedup to %zu, ratio %.2f\n",
+           "store", store_size, store.n, total_payload, store.size,
+           (double)total_payload / store.size);
+    printf("%-28s %6zu -> %6zu bytes %5.1f%%  load %6.2f us raw %6.2f us chunked %+.1f%%\n",
+           "total", total_raw, total_chunked + store_size,
+           100.0 * (total_chunked + store_size) / total_raw, total_raw_us, total_chunked_us,
+           100.0 * (total_chunked_us - total_raw_us) / total_raw_us);
+  }
+
+  return res;
+}
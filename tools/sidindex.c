@@ -0,0 +1,592 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Indexes a SID collection into one catalog file, see sid_index.h.
+ *
+ *   sidindex [-j threads] [-f] -o index.sidx dir|file...
+ *   sidindex -q index.sidx [md5|text]...
+ *
+ * Directories are searched for .sid files. Every file is mapped, hashed and
+ * its header parsed by sid_parse_header(), spread over the given number of
+ * threads, all cores by default. When the output exists, files with the
+ * same path, size and modification time as in it are taken from it without
+ * reading them again, -f indexes everything. Paths are stored as found, run
+ * it from the same directory with the same arguments to reuse entries.
+ *
+ * -q prints the entries with the given MD5, or with the text in their path,
+ * title or author, or all of them.
+ */
+
+#define _GNU_SOURCE
+
+#include "sid.h"
+#include "sid_index.h"
+#include "host.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define MAX_THREADS     64
+
+struct record
+{
+  char* path;
+  int64_t mtime_ns;
+  uint32_t size;
+  bool reused;
+  bool failed;                  /* could not be read */
+  struct sid_index_entry entry;
+  char title[33];
+  char author[33];
+  char released[33];
+};
+
+struct strings
+{
+  char* data;
+  uint32_t size;
+  uint32_t capacity;
+  uint32_t* slots;              /* offset + 1, 0 is free */
+  uint32_t num_slots;
+};
+
+static struct record* records;
+static size_t num_records;
+static size_t max_records;
+
+static size_t* todo;
+static size_t num_todo;
+static atomic_size_t next_todo;
+
+static struct strings strings;
+
+static bool add_record(const char* path, const struct stat* st)
+{
+  struct record* r;
+
+  if (num_records == max_records) {
+    max_records = max_records ? max_records * 2 : 1024;
+    records = realloc(records, max_records * sizeof(*records));
+    if (!records) {
+      perror("records");
+      return false;
+    }
+  }
+
+  r = &records[num_records++];
+  memset(r, 0, sizeof(*r));
+  r->path = strdup(path);
+  r->size = st->st_size;
+  r->mtime_ns = (int64_t)st->st_mtim.tv_sec * 1000000000 + st->st_mtim.tv_nsec;
+
+  return r->path != NULL;
+}
+
+static int visit(const char* path, const struct stat* st, int type, struct FTW* ftw)
+{
+  size_t len = strlen(path);
+
+  if (type != FTW_F || len < 4 || strcasecmp(&path[len - 4], ".sid") != 0)
+    return 0;
+
+  return add_record(path, st) ? 0 : -1;
+}
+
+static int compare_path(const void* a, const void* b)
+{
+  return strcmp(((const struct record*)a)->path, ((const struct record*)b)->path);
+}
+
+static void fill_entry(struct record* r, const uint8_t* data, size_t size)
+{
+  struct sid_index_entry* e = &r->entry;
+  struct sid_info info;
+
+  sid_index_md5(data, size, e->md5);
+
+  if (!sid_parse_header(data, size, &info)) {
+    e->flags = SID_INDEX_BAD;
+    return;
+  }
+
+  e->load_addr = info.load_addr;
+  e->init_addr = info.init_addr;
+  e->play_addr = info.play_addr;
+  e->subsongs = info.subsongs;
+  e->start_song = info.start_song;
+  e->version = data[5];
+  e->speed = ((uint32_t)data[0x12] << 24) | (data[0x13] << 16) | (data[0x14] << 8) | data[0x15];
+
+  memcpy(r->title, info.title, sizeof(r->title));
+  memcpy(r->author, info.author, sizeof(r->author));
+  memcpy(r->released, info.released, sizeof(r->released));
+
+  if (data[0] == 'R') {
+    e->flags |= SID_INDEX_RSID;
+  } else if (e->speed) {
+    e->flags |= SID_INDEX_CIA;
+  }
+
+  if (sid_is_packed(data, size)) {
+    e->flags |= SID_INDEX_PACKED;
+  }
+
+  if (e->play_addr == 0) {
+    e->flags |= SID_INDEX_IRQ_PLAY;
+  }
+
+  /* Version 2 and later header fields */
+  if (e->version >= 2 && data[7] >= 0x7c) {
+    uint8_t flags = data[0x77];
+
+    e->flags |= (flags & 0x01) ? SID_INDEX_MUS : 0;
+    e->flags |= (flags & 0x02) && data[0] == 'R' ? SID_INDEX_BASIC : 0;
+    e->flags |= (flags & 0x04) ? SID_INDEX_PAL : 0;
+    e->flags |= (flags & 0x08) ? SID_INDEX_NTSC : 0;
+    e->flags |= (flags & 0x10) ? SID_INDEX_6581 : 0;
+    e->flags |= (flags & 0x20) ? SID_INDEX_8580 : 0;
+
+    if (e->version >= 3 && data[0x7a]) {
+      e->sid2 = data[0x7a];
+      e->flags |= SID_INDEX_MULTI;
+    }
+
+    if (e->version >= 4) {
+      e->sid3 = data[0x7b];
+    }
+  }
+}
+
+static void index_file(struct record* r)
+{
+  struct stat st;
+  void* data;
+  int fd;
+
+  fd = open(r->path, O_RDONLY);
+  if (fd < 0 || fstat(fd, &st) < 0 || st.st_size == 0) {
+    r->failed = true;
+    if (fd >= 0) {
+      close(fd);
+    }
+    return;
+  }
+
+  data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    r->failed = true;
+    return;
+  }
+
+  r->size = st.st_size;
+  fill_entry(r, data, st.st_size);
+  munmap(data, st.st_size);
+}
+
+static void* worker(void* arg)
+{
+  size_t i;
+
+  while ((i = atomic_fetch_add(&next_todo, 1)) < num_todo) {
+    index_file(&records[todo[i]]);
+  }
+
+  return NULL;
+}
+
+/* Entries whose file did not change since the old index */
+static void reuse(const struct sid_index* old)
+{
+  for (size_t i = 0; i < num_records; i++) {
+    struct record* r = &records[i];
+    const struct sid_index_entry* e = old->map ? sid_index_find_path(old, r->path) : NULL;
+
+    if (!e || e->size != r->size || e->mtime_ns != r->mtime_ns) {
+      todo[num_todo++] = i;
+      continue;
+    }
+
+    r->entry = *e;
+    r->reused = true;
+    snprintf(r->title, sizeof(r->title), "%s", sid_index_string(old, e->title));
+    snprintf(r->author, sizeof(r->author), "%s", sid_index_string(old, e->author));
+    snprintf(r->released, sizeof(r->released), "%s", sid_index_string(old, e->released));
+  }
+}
+
+static uint32_t hash_string(const char* s)
+{
+  uint32_t hash = 2166136261U;
+
+  while (*s) {
+    hash ^= (uint8_t)*s++;
+    hash *= 16777619U;
+  }
+
+  return hash;
+}
+
+static bool strings_init(struct strings* t, size_t count)
+{
+  t->num_slots = 16;
+  while (t->num_slots < count * 2) {
+    t->num_slots *= 2;
+  }
+
+  t->slots = calloc(t->num_slots, sizeof(uint32_t));
+  t->capacity = 65536;
+  t->data = malloc(t->capacity);
+  t->data[0] = '\0';
+  t->size = 1;
+
+  return t->slots && t->data;
+}
+
+/* Equal strings are stored once, authors and release years repeat a lot */
+static uint32_t strings_add(struct strings* t, const char* s)
+{
+  uint32_t slot;
+  size_t len = strlen(s) + 1;
+
+  if (!*s)
+    return 0;
+
+  for (slot = hash_string(s) & (t->num_slots - 1); t->slots[slot];
+       slot = (slot + 1) & (t->num_slots - 1)) {
+    if (strcmp(&t->data[t->slots[slot] - 1], s) == 0)
+      return t->slots[slot] - 1;
+  }
+
+  while (t->size + len > t->capacity) {
+    t->capacity *= 2;
+    t->data = realloc(t->data, t->capacity);
+    if (!t->data) {
+      perror("strings");
+      exit(1);
+    }
+  }
+
+  memcpy(&t->data[t->size], s, len);
+  t->slots[slot] = t->size + 1;
+  t->size += len;
+
+  return t->slots[slot] - 1;
+}
+
+static struct sid_index_entry* sort_entries;
+
+static int compare_md5(const void* a, const void* b)
+{
+  const struct sid_index_entry* x = a;
+  const struct sid_index_entry* y = b;
+  int cmp = memcmp(x->md5, y->md5, 16);
+
+  return cmp ? cmp : strcmp(&strings.data[x->path], &strings.data[y->path]);
+}
+
+static int compare_entry_path(const void* a, const void* b)
+{
+  return strcmp(&strings.data[sort_entries[*(const uint32_t*)a].path],
+                &strings.data[sort_entries[*(const uint32_t*)b].path]);
+}
+
+static bool write_index(const char* path, uint32_t count)
+{
+  struct sid_index_header header = { .version = SID_INDEX_VERSION };
+  struct sid_index_entry* entries = calloc(count ? count : 1, sizeof(*entries));
+  uint32_t* by_path = calloc(count ? count : 1, sizeof(*by_path));
+  char tmp[4096];
+  uint32_t n = 0;
+  FILE* f;
+
+  if (!entries || !by_path || !strings_init(&strings, count * 4)) {
+    perror("index");
+    return false;
+  }
+
+  for (size_t i = 0; i < num_records; i++) {
+    struct record* r = &records[i];
+
+    if (r->failed)
+      continue;
+
+    entries[n] = r->entry;
+    entries[n].size = r->size;
+    entries[n].mtime_ns = r->mtime_ns;
+    entries[n].path = strings_add(&strings, r->path);
+    entries[n].title = strings_add(&strings, r->title);
+    entries[n].author = strings_add(&strings, r->author);
+    entries[n].released = strings_add(&strings, r->released);
+    n++;
+  }
+
+  qsort(entries, n, sizeof(*entries), compare_md5);
+
+  for (uint32_t i = 0; i < n; i++) {
+    by_path[i] = i;
+  }
+  sort_entries = entries;
+  qsort(by_path, n, sizeof(*by_path), compare_entry_path);
+
+  memcpy(header.magic, SID_INDEX_MAGIC, 4);
+  header.count = n;
+  header.by_path = sizeof(header) + n * sizeof(*entries);
+  header.strings = header.by_path + n * sizeof(*by_path);
+  header.strings_size = strings.size;
+
+  /* Replaced in one go, a reader never sees half an index */
+  snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+  f = fopen(tmp, "wb");
+  if (!f) {
+    perror(tmp);
+    return false;
+  }
+
+  fwrite(&header, sizeof(header), 1, f);
+  fwrite(entries, sizeof(*entries), n, f);
+  fwrite(by_path, sizeof(*by_path), n, f);
+  fwrite(strings.data, 1, strings.size, f);
+
+  if (fclose(f) != 0 || rename(tmp, path) != 0) {
+    perror(path);
+    return false;
+  }
+
+  printf("%s: %u entries, %u string bytes, %zu bytes\n", path, n, strings.size,
+         (size_t)header.strings + strings.size);
+
+  free(entries);
+  free(by_path);
+
+  return true;
+}
+
+static void print_md5(const uint8_t md5[16])
+{
+  for (int i = 0; i < 16; i++) {
+    printf("%02x", md5[i]);
+  }
+}
+
+static void print_entry(const struct sid_index* index, const struct sid_index_entry* e)
+{
+  print_md5(e->md5);
+
+  if (e->flags & SID_INDEX_BAD) {
+    printf(" %s: bad header\n", sid_index_string(index, e->path));
+    return;
+  }
+
+  printf(" %s: %s by %s (%s), %u songs, %s%s%s%s%s%s\n",
+         sid_index_string(index, e->path), sid_index_string(index, e->title),
+         sid_index_string(index, e->author), sid_index_string(index, e->released),
+         e->subsongs + 1, e->flags & SID_INDEX_RSID ? "RSID" : "PSID",
+         e->flags & SID_INDEX_PACKED ? " packed" : "",
+         e->flags & SID_INDEX_NTSC ? (e->flags & SID_INDEX_PAL ? " PAL/NTSC" : " NTSC") : "",
+         e->flags & SID_INDEX_8580 ? (e->flags & SID_INDEX_6581 ? " 6581/8580" : " 8580") : "",
+         e->flags & SID_INDEX_IRQ_PLAY ? " no play address" : "",
+         e->flags & SID_INDEX_MULTI ? " multi SID" : "");
+}
+
+static bool parse_md5(const char* s, uint8_t md5[16])
+{
+  if (strlen(s) != 32)
+    return false;
+
+  for (int i = 0; i < 16; i++) {
+    unsigned int byte;
+
+    if (sscanf(&s[i * 2], "%2x", &byte) != 1)
+      return false;
+    md5[i] = byte;
+  }
+
+  return true;
+}
+
+static bool matches(const struct sid_index* index, const struct sid_index_entry* e,
+                    const char* text)
+{
+  return strcasestr(sid_index_string(index, e->path), text) ||
+         strcasestr(sid_index_string(index, e->title), text) ||
+         strcasestr(sid_index_string(index, e->author), text);
+}
+
+static int query(const char* path, int argc, char** argv)
+{
+  struct sid_index index;
+  uint32_t found = 0;
+
+  if (!sid_index_open(&index, path))
+    return 1;
+
+  for (int a = 0; a < argc || (a == 0 && argc == 0); a++) {
+    const struct sid_index_entry* end = &index.entries[index.header->count];
+    const struct sid_index_entry* e;
+    uint8_t md5[16];
+
+    if (argc && parse_md5(argv[a], md5)) {
+      /* The same content can be in the collection more than once */
+      for (e = sid_index_find_md5(&index, md5); e && e < end && memcmp(e->md5, md5, 16) == 0; e++) {
+        print_entry(&index, e);
+        found++;
+      }
+      continue;
+    }
+
+    for (e = index.entries; e < end; e++) {
+      if (argc == 0 || matches(&index, e, argv[a])) {
+        print_entry(&index, e);
+        found++;
+      }
+    }
+  }
+
+  fprintf(stderr, "%u entries found in %u\n", found, index.header->count);
+  sid_index_close(&index);
+
+  return found ? 0 : 1;
+}
+
+int main(int argc, char** argv)
+{
+  struct sid_index old = { 0 };
+  const char* out = NULL;
+  const char* query_path = NULL;
+  long threads = sysconf(_SC_NPROCESSORS_ONLN);
+  pthread_t thread[MAX_THREADS];
+  bool force = false;
+  size_t reused = 0;
+  size_t failed = 0;
+  size_t bad = 0;
+  uint64_t bytes = 0;
+  uint64_t start;
+  uint64_t walked;
+  double seconds;
+  size_t n = 0;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "j:fo:q:")) != -1) {
+    switch (opt) {
+      case 'j':
+        threads = strtol(optarg, NULL, 0);
+        break;
+      case 'f':
+        force = true;
+        break;
+      case 'o':
+        out = optarg;
+        break;
+      case 'q':
+        query_path = optarg;
+        break;
+      default:
+        fprintf(stderr, "usage: %s [-j threads] [-f] -o index.sidx dir|file...\n"
+                        "       %s -q index.sidx [md5|text]...\n", argv[0], argv[0]);
+        return 1;
+    }
+  }
+
+  if (query_path)
+    return query(query_path, argc - optind, &argv[optind]);
+
+  if (!out || optind == argc) {
+    fprintf(stderr, "an output and at least one directory or file\n");
+    return 1;
+  }
+
+  if (threads < 1 || threads > MAX_THREADS) {
+    threads = threads < 1 ? 1 : MAX_THREADS;
+  }
+
+  start = host_time_ns();
+
+  for (int i = optind; i < argc; i++) {
+    struct stat st;
+
+    if (stat(argv[i], &st) < 0) {
+      perror(argv[i]);
+      return 1;
+    }
+
+    if (S_ISDIR(st.st_mode) ? nftw(argv[i], visit, 64, FTW_PHYS) != 0 :
+        !add_record(argv[i], &st)) {
+      fprintf(stderr, "%s: can not be searched\n", argv[i]);
+      return 1;
+    }
+  }
+
+  /* The same file reached twice is indexed once */
+  qsort(records, num_records, sizeof(*records), compare_path);
+  for (size_t i = 0; i < num_records; i++) {
+    if (n && strcmp(records[n - 1].path, records[i].path) == 0) {
+      free(records[i].path);
+      continue;
+    }
+    records[n++] = records[i];
+  }
+  num_records = n;
+  walked = host_time_ns();
+
+  todo = malloc((num_records ? num_records : 1) * sizeof(*todo));
+  if (!todo) {
+    perror("todo");
+    return 1;
+  }
+
+  if (!force && access(out, F_OK) == 0 && !sid_index_open(&old, out)) {
+    fprintf(stderr, "%s: indexing everything again\n", out);
+  }
+  reuse(&old);
+
+  if (num_todo < (size_t)threads) {
+    threads = num_todo ? num_todo : 1;
+  }
+
+  for (long i = 0; i < threads; i++) {
+    pthread_create(&thread[i], NULL, worker, NULL);
+  }
+  for (long i = 0; i < threads; i++) {
+    pthread_join(thread[i], NULL);
+  }
+
+  for (size_t i = 0; i < num_records; i++) {
+    reused += records[i].reused;
+    failed += records[i].failed;
+    bad += !records[i].failed && (records[i].entry.flags & SID_INDEX_BAD);
+    bytes += records[i].reused || records[i].failed ? 0 : records[i].size;
+  }
+
+  seconds = (host_time_ns() - walked) / 1e9;
+  printf("%zu files found in %.2f s, %zu reused, %zu hashed (%.1f MB) on %ld threads"
+         " in %.2f s, %.0f files/s, %.1f MB/s\n",
+         num_records, (walked - start) / 1e9, reused, num_todo, bytes / 1e6, threads,
+         seconds, seconds > 0 ? (num_todo - failed) / seconds : 0.0,
+         seconds > 0 ? bytes / 1e6 / seconds : 0.0);
+
+  if (failed || bad) {
+    printf("%zu files could not be read, %zu have a bad header\n", failed, bad);
+  }
+
+  /* The old mapping goes before the file is replaced */
+  sid_index_close(&old);
+
+  if (!write_index(out, num_records - failed))
+    return 1;
+
+  printf("total %.2f s\n", (host_time_ns() - start) / 1e9);
+
+  return 0;
+}
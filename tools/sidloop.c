@@ -0,0 +1,403 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Finds where a tune starts to repeat itself and renders it as an intro plus
+ * loop register stream, see sid_stream.h.
+ *
+ *   sidloop [-s max seconds] [-n song] [-x] -o out file.sid
+ *                                  render one file, -x writes a C include
+ *                                  like the .hex files in src
+ *   sidloop [-s max seconds] file.sid...
+ *                                  report the song length of every file
+ *
+ * Between two play calls the machine state is the memory plus the SID
+ * registers, c64_cpu_jsr() resets the CPU registers for every call. When the
+ * state after frame n equals the state after an earlier frame k, frame n + 1
+ * onwards repeats frame k + 1 onwards, forever. The state is hashed after
+ * every frame and looked up among the earlier ones.
+ *
+ * The memory hash is the XOR of the hashes of all pages with the hashes of
+ * the loaded image taken out, so untouched pages count for nothing and only
+ * the pages a play call wrote have to be hashed again. A loop that is found is checked
+ * by playing it once more, and the stream by playing it back.
+ *
+ * Writes that do not change a register are left out. Digi writes are kept,
+ * but not their timing within the frame.
+ */
+
+#include "c64.h"
+#include "sid.h"
+#include "sid_proto.h"
+#include "sid_digi.h"
+#include "sid_seek.h"
+#include "sid_stream.h"
+#include "sid_render.h"
+#include "host.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static uint64_t page_hash[256];
+static uint64_t mem_hash;
+
+static uint64_t fnv1a64(uint64_t hash, const uint8_t* data, size_t len)
+{
+  while (len--) {
+    hash ^= *data++;
+    hash *= 0x100000001b3ULL;
+  }
+
+  return hash;
+}
+
+static uint64_t hash_page(uint8_t page)
+{
+  uint8_t buf[256];
+
+  c64_memread(buf, page << 8, sizeof(buf));
+
+  return fnv1a64(0xcbf29ce484222325ULL ^ page, buf, sizeof(buf));
+}
+
+static void hash_image(void)
+{
+  for (int page = 0; page < 256; page++) {
+    page_hash[page] = hash_page(page);
+  }
+
+  mem_hash = 0;
+}
+
+/* Hash the pages written since the last call again */
+static uint64_t hash_state(void)
+{
+  static const uint32_t none[8];
+  uint32_t dirty[8];
+  uint8_t regs[SID_NUM_REGS];
+
+  c64_get_dirty(dirty);
+  c64_set_dirty(none);
+
+  for (int page = 0; page < 256; page++) {
+    if (dirty[page >> 5] & (1U << (page & 31))) {
+      uint64_t hash = hash_page(page);
+
+      mem_hash ^= page_hash[page] ^ hash;
+      page_hash[page] = hash;
+    }
+  }
+
+  sid_get_regs(regs);
+
+  return fnv1a64(mem_hash ^ 0xcbf29ce484222325ULL, regs, sizeof(regs));
+}
+
+struct result
+{
+  struct sid_render_buffer stream;
+  uint32_t* frame_offset;
+  struct sid_render_buffer raw;           /* the writes of every frame, canonical */
+  uint32_t* raw_offset;
+  uint32_t intro;
+  uint32_t loop;
+};
+
+static void record(struct result* res, uint32_t frame)
+{
+  res->frame_offset[frame] = res->stream.size;
+  res->raw_offset[frame] = res->raw.size;
+
+  sid_render_encode(&res->stream, sid_render_writes, sid_render_n_writes);
+
+  sid_render_canonical(sid_render_writes, sid_render_n_writes);
+  for (uint32_t i = 0; i < sid_render_n_writes; i++) {
+    sid_render_put(&res->raw, sid_render_writes[i].reg);
+    sid_render_put(&res->raw, sid_render_writes[i].val);
+  }
+}
+
+static bool render(const uint8_t* data, size_t size, uint8_t song, uint32_t max_frames,
+                   struct result* res)
+{
+  struct sid_info info;
+  uint8_t regs[SID_NUM_REGS];
+  uint32_t table_size = 1;
+  uint32_t* table;
+  uint64_t* hashes;
+  uint32_t frame;
+
+  while (table_size < max_frames * 2) {
+    table_size <<= 1;
+  }
+
+  table = calloc(table_size, sizeof(*table));
+  hashes = calloc(max_frames + 1, sizeof(*hashes));
+  res->frame_offset = calloc(max_frames + 1, sizeof(*res->frame_offset));
+  res->raw_offset = calloc(max_frames + 1, sizeof(*res->raw_offset));
+  memset(&res->stream, 0, sizeof(res->stream));
+  memset(&res->raw, 0, sizeof(res->raw));
+  res->intro = 0;
+  res->loop = 0;
+
+  sid_mute(true);
+  sid_set_regs((const uint8_t[SID_NUM_REGS]){ 0 });
+  c64_init();
+  sid_load_from_memory(data, size, &info);
+  hash_image();
+  c64_set_dirty((const uint32_t[8]){ 0 });
+  c64_cpu_jsr(info.init_addr, song);
+  sid_mute(false);
+
+  sid_get_regs(regs);
+  sid_render_start(regs);
+  for (int i = 0; i < 4; i++) {
+    sid_render_put(&res->stream, "SIDR"[i]);
+  }
+  for (int i = 0; i < 12; i++) {
+    sid_render_put(&res->stream, 0);
+  }
+  for (int i = 0; i < SID_NUM_REGS; i++) {
+    sid_render_put(&res->stream, regs[i]);
+  }
+
+  c64_cpu_optimize(info.play_addr, NULL);
+
+  /* State 0 is the one init left */
+  hashes[0] = hash_state();
+  table[hashes[0] & (table_size - 1)] = 1;
+
+  for (frame = 1; frame <= max_frames; frame++) {
+    uint32_t slot;
+
+    sid_render_frame(info.play_addr);
+    record(res, frame - 1);
+
+    hashes[frame] = hash_state();
+
+    for (slot = hashes[frame] & (table_size - 1); table[slot];
+         slot = (slot + 1) & (table_size - 1)) {
+      if (hashes[table[slot] - 1] == hashes[frame])
+        break;
+    }
+
+    if (table[slot]) {
+      res->intro = table[slot] - 1;
+      res->loop = frame - res->intro;
+      break;
+    }
+
+    table[slot] = frame + 1;
+  }
+
+  if (frame > max_frames) {
+    frame = max_frames;
+  }
+  res->frame_offset[frame] = res->stream.size;
+  res->raw_offset[frame] = res->raw.size;
+
+  free(table);
+  free(hashes);
+
+  if (!res->loop) {
+    res->intro = max_frames;
+    return true;
+  }
+
+  /* The next round of the loop has to encode to the same bytes */
+  for (uint32_t i = 0; i < res->loop; i++) {
+    struct sid_render_buffer b = { 0 };
+    uint32_t at = res->frame_offset[res->intro + i];
+    bool same;
+
+    sid_render_frame(info.play_addr);
+    sid_render_encode(&b, sid_render_writes, sid_render_n_writes);
+
+    same = b.size == res->frame_offset[res->intro + i + 1] - at &&
+           memcmp(b.data, res->stream.data + at, b.size) == 0;
+    free(b.data);
+
+    if (!same) {
+      fprintf(stderr, "frame %u of the loop differs the second time\n", i);
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/*
+ * Play the stream back, through the loop point and round the loop once more,
+ * and compare it with the frames it was rendered from
+ */
+static bool check_stream(const struct result* res)
+{
+  uint32_t frames = res->intro + 2 * res->loop;
+
+  sid_mute(true);
+  sid_set_regs((const uint8_t[SID_NUM_REGS]){ 0 });
+  sid_stream_init(res->stream.data, res->stream.size);
+  sid_mute(false);
+
+  for (uint32_t frame = 0; frame < frames; frame++) {
+    uint32_t f = frame < res->intro + res->loop ? frame : frame - res->loop;
+    uint32_t at = res->raw_offset[f];
+    uint32_t n = (res->raw_offset[f + 1] - at) / 2;
+    bool same = true;
+
+    sid_render_n_writes = 0;
+    sid_digi_frame();
+    if (!sid_stream_frame()) {
+      fprintf(stderr, "stream ended at frame %u\n", frame);
+      return false;
+    }
+    sid_flush();
+    sid_digi_send(UINT32_MAX / 2);
+    sid_render_canonical(sid_render_writes, sid_render_n_writes);
+
+    for (uint32_t i = 0; i < n && i < sid_render_n_writes; i++) {
+      same &= sid_render_writes[i].reg == res->raw.data[at + 2 * i] &&
+              sid_render_writes[i].val == res->raw.data[at + 2 * i + 1];
+    }
+
+    if (!same || n != sid_render_n_writes) {
+      fprintf(stderr, "stream frame %u differs\n", frame);
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static int write_output(const char* path, const uint8_t* data, size_t size, bool hex)
+{
+  FILE* f = fopen(path, hex ? "w" : "wb");
+
+  if (!f) {
+    perror(path);
+    return -1;
+  }
+
+  if (hex) {
+    for (size_t i = 0; i < size; i++) {
+      fprintf(f, "0x%02x,%s", data[i], (i % 8 == 7 || i + 1 == size) ? "\n" : " ");
+    }
+  } else {
+    fwrite(data, 1, size, f);
+  }
+
+  return fclose(f);
+}
+
+static void print_time(const char* name, uint32_t frames)
+{
+  uint32_t s = frames / SID_SEEK_FRAMES_PER_SECOND;
+
+  printf(" %s %u frames (%u:%02u.%02u)", name, frames, s / 60, s % 60,
+         frames % SID_SEEK_FRAMES_PER_SECOND * (100 / SID_SEEK_FRAMES_PER_SECOND));
+}
+
+int main(int argc, char** argv)
+{
+  const char* out = NULL;
+  bool hex = false;
+  uint32_t max_frames = 30 * 60 * SID_SEEK_FRAMES_PER_SECOND;
+  int song = -1;
+  int res = 0;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "s:n:o:x")) != -1) {
+    switch (opt) {
+      case 's':
+        max_frames = strtoul(optarg, NULL, 0) * SID_SEEK_FRAMES_PER_SECOND;
+        break;
+      case 'n':
+        song = strtol(optarg, NULL, 0) - 1;
+        break;
+      case 'o':
+        out = optarg;
+        break;
+      case 'x':
+        hex = true;
+        break;
+      default:
+        fprintf(stderr, "usage: %s [-s max seconds] [-n song] [-x] -o out file.sid\n"
+                        "       %s [-s max seconds] file.sid...\n", argv[0], argv[0]);
+        return 1;
+    }
+  }
+
+  if (out && argc - optind != 1) {
+    fprintf(stderr, "-o takes exactly one input file\n");
+    return 1;
+  }
+
+  if (!max_frames) {
+    fprintf(stderr, "max seconds must be at least 1\n");
+    return 1;
+  }
+
+  sid_proto_init(SID_PROTO_MODE_BLOCKING, false);
+
+  for (int i = optind; i < argc; i++) {
+    size_t size;
+    uint8_t* data = host_load_file(argv[i], &size);
+    struct sid_info header;
+    struct result r;
+    uint8_t s;
+    uint64_t start;
+    uint64_t ns;
+
+    if (!data || !sid_parse_header(data, size, &header)) {
+      res = 1;
+      continue;
+    }
+
+    s = song >= 0 ? song : header.start_song;
+
+    start = host_time_ns();
+    if (!render(data, size, s, max_frames, &r)) {
+      res = 1;
+      continue;
+    }
+    ns = host_time_ns() - start;
+
+    /* Patch the header now the lengths are known */
+    r.stream.size = 4;
+    sid_render_put_le32(&r.stream, r.intro);
+    sid_render_put_le32(&r.stream, r.loop);
+    sid_render_put_le32(&r.stream, r.frame_offset[r.intro]);
+    r.stream.size = r.frame_offset[r.intro + r.loop];
+
+    if (!check_stream(&r)) {
+      res = 1;
+      continue;
+    }
+
+    printf("%s song %u:", argv[i], s + 1);
+    print_time("intro", r.intro);
+    if (r.loop) {
+      print_time("loop", r.loop);
+    } else {
+      printf(" no loop");
+    }
+    printf("\n  %zu byte stream, %.1f bytes per frame, %zu writes, found in %.1f ms\n",
+           r.stream.size, (double)r.stream.size / (r.intro + r.loop), r.raw.size / 2,
+           ns / 1e6);
+
+    if (out && write_output(out, r.stream.data, r.stream.size, hex) < 0) {
+      res = 1;
+    }
+
+    free(r.stream.data);
+    free(r.frame_offset);
+    free(r.raw.data);
+    free(r.raw_offset);
+    free(data);
+  }
+
+  return res;
+}
@@ -0,0 +1,345 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Packs SID files into the compressed image format the player loads, see
+ * sid_is_packed() in sid.h.
+ *
+ *   sidpack [-x] -o out file.sid   pack one file, -x writes a C include
+ *                                  like the .hex files in src
+ *   sidpack file.sid...            report ratio and load time of each file
+ *
+ * The payload is an LZ4 block, found with hash chains and one step lazy
+ * matching. Every packed image is decoded again and compared before it is
+ * written or counted.
+ */
+
+#include "c64.h"
+#include "sid.h"
+#include "sid_proto.h"
+#include "host.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MIN_MATCH       4
+#define LAST_LITERALS   5     /* the block ends with at least this many */
+#define MATCH_LIMIT     12    /* no match starts closer to the end */
+#define MAX_OFFSET      65535
+#define HASH_BITS       16
+#define MAX_CHAIN       4096
+
+#define LOAD_REPEATS    2000
+
+static int32_t head[1 << HASH_BITS];
+static int32_t* chain;
+
+static uint32_t hash4(const uint8_t* p)
+{
+  uint32_t v = p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+
+  return (v * 2654435761U) >> (32 - HASH_BITS);
+}
+
+static void insert(const uint8_t* in, size_t pos)
+{
+  uint32_t h = hash4(&in[pos]);
+
+  chain[pos] = head[h];
+  head[h] = pos;
+}
+
+static size_t longest_match(const uint8_t* in, size_t n, size_t pos, size_t* offset)
+{
+  size_t best = 0;
+  size_t limit = n - LAST_LITERALS;
+  int32_t cand = head[hash4(&in[pos])];
+
+  for (int steps = 0; cand >= 0 && steps < MAX_CHAIN; steps++) {
+    size_t len = 0;
+
+    if (pos - cand > MAX_OFFSET)
+      break;
+
+    while (pos + len < limit && in[cand + len] == in[pos + len]) {
+      len++;
+    }
+
+    if (len > best) {
+      best = len;
+      *offset = pos - cand;
+    }
+
+    cand = chain[cand];
+  }
+
+  return best >= MIN_MATCH ? best : 0;
+}
+
+static uint8_t* put_length(uint8_t* out, size_t len)
+{
+  while (len >= 255) {
+    *out++ = 255;
+    len -= 255;
+  }
+  *out++ = len;
+
+  return out;
+}
+
+static uint8_t* put_sequence(uint8_t* out, const uint8_t* lit, size_t lit_len,
+                             size_t offset, size_t match_len)
+{
+  uint8_t* token = out++;
+
+  *token = (lit_len < 15 ? lit_len : 15) << 4;
+  if (lit_len >= 15) {
+    out = put_length(out, lit_len - 15);
+  }
+
+  memcpy(out, lit, lit_len);
+  out += lit_len;
+
+  if (!match_len)
+    return out;
+
+  *out++ = offset;
+  *out++ = offset >> 8;
+
+  match_len -= MIN_MATCH;
+  *token |= match_len < 15 ? match_len : 15;
+  if (match_len >= 15) {
+    out = put_length(out, match_len - 15);
+  }
+
+  return out;
+}
+
+/* out must have room for n + n / 255 + 16 bytes */
+static size_t pack_lz4(const uint8_t* in, size_t n, uint8_t* out)
+{
+  uint8_t* start = out;
+  size_t anchor = 0;
+  size_t pos = 0;
+
+  chain = malloc(n * sizeof(*chain) + 1);
+  memset(head, 0xff, sizeof(head));
+
+  while (n >= MATCH_LIMIT && pos + MATCH_LIMIT <= n) {
+    size_t offset = 0;
+    size_t len = longest_match(in, n, pos, &offset);
+
+    if (!len) {
+      insert(in, pos++);
+      continue;
+    }
+
+    /* Take a literal first when the next position has a longer match */
+    if (pos + 1 + MATCH_LIMIT <= n) {
+      size_t next_offset = 0;
+      size_t next_len;
+
+      insert(in, pos);
+      next_len = longest_match(in, n, pos + 1, &next_offset);
+
+      if (next_len > len) {
+        pos++;
+        len = next_len;
+        offset = next_offset;
+      }
+    } else {
+      insert(in, pos);
+    }
+
+    out = put_sequence(out, &in[anchor], pos - anchor, offset, len);
+
+    for (size_t i = pos + 1; i < pos + len && i + MIN_MATCH <= n; i++) {
+      insert(in, i);
+    }
+
+    pos += len;
+    anchor = pos;
+  }
+
+  out = put_sequence(out, &in[anchor], n - anchor, 0, 0);
+
+  free(chain);
+
+  return out - start;
+}
+
+/* Packed image of a SID file, NULL when the file is not usable */
+static uint8_t* pack_file(const uint8_t* data, size_t size, size_t* packed_size)
+{
+  uint8_t offset;
+  size_t payload;
+  uint8_t* packed;
+  size_t n;
+
+  if (size < 0x7c || memcmp(&data[1], "SID", 3) ||
+      (data[0] != 'P' && data[0] != 'R')) {
+    return NULL;
+  }
+
+  offset = data[7];
+  if (size < offset + 3u)
+    return NULL;
+
+  payload = size - (offset + 2);
+  if (payload > 0xffff)
+    return NULL;
+
+  packed = malloc(offset + 4 + payload + payload / 255 + 16);
+
+  memcpy(packed, data, offset + 2);
+  packed[3] = 'Z';
+  packed[offset + 2] = payload;
+  packed[offset + 3] = payload >> 8;
+
+  n = pack_lz4(&data[offset + 2], payload, &packed[offset + 4]);
+  *packed_size = offset + 4 + n;
+
+  return packed;
+}
+
+static bool same_memory(const uint8_t* a, size_t a_size, const uint8_t* b, size_t b_size)
+{
+  static uint8_t mem_a[65536];
+  static uint8_t mem_b[65536];
+
+  if (!sid_load_payload(a, a_size))
+    return false;
+  c64_memread(mem_a, 0, sizeof(mem_a));
+
+  if (!sid_load_payload(b, b_size))
+    return false;
+  c64_memread(mem_b, 0, sizeof(mem_b));
+
+  return memcmp(mem_a, mem_b, sizeof(mem_a)) == 0;
+}
+
+static double load_us(const uint8_t* data, size_t size)
+{
+  uint64_t start = host_time_ns();
+
+  for (int i = 0; i < LOAD_REPEATS; i++) {
+    sid_load_payload(data, size);
+  }
+
+  return (host_time_ns() - start) / 1000.0 / LOAD_REPEATS;
+}
+
+static int write_output(const char* path, const uint8_t* data, size_t size, bool hex)
+{
+  FILE* f = fopen(path, hex ? "w" : "wb");
+
+  if (!f) {
+    perror(path);
+    return -1;
+  }
+
+  if (hex) {
+    for (size_t i = 0; i < size; i++) {
+      fprintf(f, "0x%02x,%s", data[i], (i % 8 == 7 || i + 1 == size) ? "\n" : " ");
+    }
+  } else {
+    fwrite(data, 1, size, f);
+  }
+
+  return fclose(f);
+}
+
+int main(int argc, char** argv)
+{
+  const char* out = NULL;
+  bool hex = false;
+  size_t total_raw = 0;
+  size_t total_packed = 0;
+  double total_raw_us = 0;
+  double total_packed_us = 0;
+  int res = 0;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "o:x")) != -1) {
+    switch (opt) {
+      case 'o':
+        out = optarg;
+        break;
+      case 'x':
+        hex = true;
+        break;
+      default:
+        fprintf(stderr, "usage: %s [-x] -o out file.sid\n"
+                        "       %s file.sid...\n", argv[0], argv[0]);
+        return 1;
+    }
+  }
+
+  if (out && argc - optind != 1) {
+    fprintf(stderr, "-o takes exactly one input file\n");
+    return 1;
+  }
+
+  sid_proto_init(SID_PROTO_MODE_BLOCKING, false);
+  c64_init();
+
+  for (int i = optind; i < argc; i++) {
+    size_t size;
+    size_t packed_size;
+    uint8_t* data = host_load_file(argv[i], &size);
+    uint8_t* packed;
+    double raw_us, packed_us;
+
+    if (!data) {
+      res = 1;
+      continue;
+    }
+
+    packed = pack_file(data, size, &packed_size);
+    if (!packed) {
+      fprintf(stderr, "%s: not a SID file\n", argv[i]);
+      free(data);
+      res = 1;
+      continue;
+    }
+
+    if (!same_memory(data, size, packed, packed_size)) {
+      fprintf(stderr, "%s: packed image does not decode to the original\n", argv[i]);
+      free(packed);
+      free(data);
+      res = 1;
+      continue;
+    }
+
+    if (out) {
+      if (write_output(out, packed, packed_size, hex) < 0)
+        res = 1;
+    } else {
+      raw_us = load_us(data, size);
+      packed_us = load_us(packed, packed_size);
+
+      printf("%-28s %6zu -> %6zu bytes %5.1f%%  load %6.2f us raw %6.2f us packed\n",
+             argv[i], size, packed_size, 100.0 * packed_size / size,
+             raw_us, packed_us);
+
+      total_raw += size;
+      total_packed += packed_size;
+      total_raw_us += raw_us;
+      total_packed_us += packed_us;
+    }
+
+    free(packed);
+    free(data);
+  }
+
+  if (!out && total_raw) {
+    printf("%-28s %6zu -> %6zu bytes %5.1f%%  load %6.2f us raw %6.2f us packed\n",
+           "total", total_raw, total_packed, 100.0 * total_packed / total_raw,
+           total_raw_us, total_packed_us);
+  }
+
+  return res;
+}
@@ -0,0 +1,479 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Renders a tune as a keyframed register stream, see sid_stream.h.
+ *
+ *   sidrender [-s seconds] [-n song] [-k keyframe seconds] [-j jobs] [-x]
+ *             -o out file.sid
+ *
+ * The emulator is one machine per process, so the segments between two
+ * keyframes are rendered by forked workers, as many at a time as -j says,
+ * all cores by default. The parent runs the tune muted from one keyframe to
+ * the next and forks a worker at each, the fork is the snapshot the worker
+ * renders its segment from. Running muted skips the SPI layer and the
+ * encoding, which is all the parent saves, the play calls themselves can
+ * only run one after the other.
+ *
+ * The stream is then checked the way the player uses it, again one worker
+ * per segment: every keyframe is restored with sid_stream_restore() and its
+ * segment emulated again, which has to encode to the same bytes, and a seek
+ * to every keyframe and to the middle of every segment has to give the
+ * registers that playing the stream from the start gives.
+ */
+
+#include "c64.h"
+#include "sid.h"
+#include "sid_proto.h"
+#include "sid_digi.h"
+#include "sid_clock.h"
+#include "sid_voice3.h"
+#include "sid_stream.h"
+#include "sid_render.h"
+#include "host.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#define MAX_JOBS        64
+
+struct segment
+{
+  FILE* file;               /* written by the worker */
+  pid_t pid;
+  size_t offset;            /* in the stream */
+  size_t size;
+};
+
+struct render
+{
+  const uint8_t* tune;
+  size_t tune_size;
+  struct sid_info info;
+  uint8_t song;
+  uint32_t frames;
+  uint32_t key_frames;
+  uint32_t n_keys;
+  uint8_t image[65536];     /* memory after loading, before init */
+  struct segment* segments;
+  struct sid_render_buffer stream;
+};
+
+static int jobs;
+static int running;
+
+static uint32_t segment_frames(const struct render* r, uint32_t k)
+{
+  uint32_t start = k * r->key_frames;
+
+  return r->frames - start < r->key_frames ? r->frames - start : r->key_frames;
+}
+
+/* Waits for a worker, returns the segment it did or -1 when it failed */
+static int reap(const struct render* r)
+{
+  int status;
+  pid_t pid = wait(&status);
+
+  running--;
+
+  for (uint32_t k = 0; k < r->n_keys; k++) {
+    if (r->segments[k].pid == pid) {
+      return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? (int)k : -1;
+    }
+  }
+
+  return -1;
+}
+
+/* Forks a worker for segment k, its exit status tells the parent if it worked */
+static bool spawn(struct render* r, uint32_t k, bool (*work)(struct render*, uint32_t))
+{
+  pid_t pid;
+
+  while (running >= jobs) {
+    if (reap(r) < 0)
+      return false;
+  }
+
+  fflush(stdout);
+  pid = fork();
+  if (pid < 0) {
+    perror("fork");
+    return false;
+  }
+
+  if (pid == 0) {
+    _exit(work(r, k) ? 0 : 1);
+  }
+
+  r->segments[k].pid = pid;
+  running++;
+
+  return true;
+}
+
+static bool wait_all(struct render* r)
+{
+  bool ok = true;
+
+  while (running) {
+    ok &= reap(r) >= 0;
+  }
+
+  return ok;
+}
+
+/* The keyframe at the current state and the frames of segment k */
+static void encode_segment(const struct render* r, uint32_t k, struct sid_render_buffer* b)
+{
+  uint8_t regs[SID_NUM_REGS];
+  uint8_t voice3[SID_VOICE3_STATE_SIZE];
+  uint8_t page[256];
+  size_t count_at;
+  uint16_t n_pages = 0;
+
+  sid_get_regs(regs);
+  sid_voice3_save(voice3);
+  sid_render_start(regs);
+
+  for (int i = 0; i < SID_NUM_REGS; i++) {
+    sid_render_put(b, regs[i]);
+  }
+  for (int i = 0; i < SID_VOICE3_STATE_SIZE; i++) {
+    sid_render_put(b, voice3[i]);
+  }
+
+  count_at = b->size;
+  sid_render_put(b, 0);
+  sid_render_put(b, 0);
+
+  for (int p = 0; p < 256; p++) {
+    c64_memread(page, p << 8, sizeof(page));
+    if (memcmp(page, &r->image[p << 8], sizeof(page)) == 0)
+      continue;
+
+    sid_render_put(b, p);
+    for (int i = 0; i < 256; i++) {
+      sid_render_put(b, page[i]);
+    }
+    n_pages++;
+  }
+  b->data[count_at] = n_pages;
+  b->data[count_at + 1] = n_pages >> 8;
+
+  for (uint32_t f = segment_frames(r, k); f; f--) {
+    sid_render_frame(r->info.play_addr);
+    sid_render_encode(b, sid_render_writes, sid_render_n_writes);
+  }
+}
+
+static bool render_worker(struct render* r, uint32_t k)
+{
+  struct sid_render_buffer b = { 0 };
+
+  sid_mute(false);
+  encode_segment(r, k, &b);
+
+  return fwrite(b.data, 1, b.size, r->segments[k].file) == b.size &&
+         fflush(r->segments[k].file) == 0;
+}
+
+static bool load(struct render* r)
+{
+  sid_mute(true);
+  sid_set_regs((const uint8_t[SID_NUM_REGS]){ 0 });
+  c64_init();
+
+  if (!sid_parse_header(r->tune, r->tune_size, &r->info) ||
+      !sid_load_payload(r->tune, r->tune_size)) {
+    fprintf(stderr, "not a SID file\n");
+    return false;
+  }
+
+  /* The stream keeps the values the tune wrote, the player converts them */
+  sid_set_clock(r->info.clock);
+  sid_clock_set(SID_CLOCK_CHIP);
+  c64_memread(r->image, 0, sizeof(r->image));
+  c64_cpu_jsr(r->info.init_addr, r->song);
+
+  if (r->info.play_addr == 0) {
+    r->info.play_addr = (c64_getmem(0x0315) << 8) | c64_getmem(0x0314);
+  }
+  c64_cpu_optimize(r->info.play_addr, NULL);
+
+  return true;
+}
+
+static bool render(struct render* r)
+{
+  size_t index_at;
+  size_t tune_at;
+  size_t size;
+  bool ok = true;
+
+  if (!load(r))
+    return false;
+
+  for (int i = 0; i < 4; i++) {
+    sid_render_put(&r->stream, "SIDK"[i]);
+  }
+  sid_render_put_le32(&r->stream, r->frames);
+  sid_render_put_le32(&r->stream, r->key_frames);
+  sid_render_put_le32(&r->stream, r->n_keys);
+  for (int i = 0; i < 3; i++) {
+    sid_render_put_le32(&r->stream, 0);
+  }
+  sid_render_put(&r->stream, r->song);
+  sid_render_put(&r->stream, r->info.clock);
+  sid_render_put(&r->stream, 0);
+  sid_render_put(&r->stream, 0);
+
+  for (uint32_t k = 0; ok && k < r->n_keys; k++) {
+    ok = spawn(r, k, render_worker);
+
+    for (uint32_t f = segment_frames(r, k); f; f--) {
+      c64_cpu_jsr(r->info.play_addr, 0);
+      sid_flush();
+    }
+  }
+  ok &= wait_all(r);
+
+  if (!ok) {
+    fprintf(stderr, "rendering failed\n");
+    return false;
+  }
+
+  for (uint32_t k = 0; k < r->n_keys; k++) {
+    struct segment* s = &r->segments[k];
+    int c;
+
+    s->offset = r->stream.size;
+    rewind(s->file);
+    while ((c = getc(s->file)) != EOF) {
+      sid_render_put(&r->stream, c);
+    }
+    s->size = r->stream.size - s->offset;
+  }
+
+  index_at = r->stream.size;
+  for (uint32_t k = 0; k < r->n_keys; k++) {
+    sid_render_put_le32(&r->stream, r->segments[k].offset);
+  }
+
+  tune_at = r->stream.size;
+  for (size_t i = 0; i < r->tune_size; i++) {
+    sid_render_put(&r->stream, r->tune[i]);
+  }
+
+  /* Patch the header now the offsets are known */
+  size = r->stream.size;
+  r->stream.size = 16;
+  sid_render_put_le32(&r->stream, index_at);
+  sid_render_put_le32(&r->stream, tune_at);
+  sid_render_put_le32(&r->stream, r->tune_size);
+  r->stream.size = size;
+
+  return true;
+}
+
+/* Emulates segment k again from its keyframe as the player restores it */
+static bool check_worker(struct render* r, uint32_t k)
+{
+  const struct segment* s = &r->segments[k];
+  struct sid_render_buffer b = { 0 };
+  struct sid_info info;
+  bool same;
+
+  c64_init();
+  sid_set_regs((const uint8_t[SID_NUM_REGS]){ 0 });
+  if (!sid_stream_init(r->stream.data, r->stream.size) ||
+      !sid_stream_restore(k * r->key_frames, &info)) {
+    fprintf(stderr, "keyframe %u does not restore\n", k);
+    return false;
+  }
+  c64_cpu_optimize(info.play_addr, NULL);
+
+  encode_segment(r, k, &b);
+
+  same = b.size == s->size && memcmp(b.data, r->stream.data + s->offset, b.size) == 0;
+  if (!same) {
+    fprintf(stderr, "segment %u differs when restored from its keyframe\n", k);
+  }
+
+  return same;
+}
+
+/* Seeks against playing through, only the stream decoder is involved */
+static bool check_seeks(const struct render* r)
+{
+  uint8_t* played = malloc((size_t)r->frames * SID_NUM_REGS);
+  uint8_t regs[SID_NUM_REGS];
+  bool ok = true;
+
+  sid_mute(true);
+  sid_stream_init(r->stream.data, r->stream.size);
+  for (uint32_t f = 0; f < r->frames; f++) {
+    sid_get_regs(&played[(size_t)f * SID_NUM_REGS]);
+    ok &= sid_stream_frame();
+  }
+  ok &= !sid_stream_frame();
+  sid_mute(false);
+
+  if (!ok) {
+    fprintf(stderr, "the stream does not play through\n");
+  }
+
+  for (uint32_t k = 0; ok && k < r->n_keys; k++) {
+    uint32_t at[2] = { k * r->key_frames, k * r->key_frames + segment_frames(r, k) / 2 };
+
+    for (int i = 0; ok && i < 2; i++) {
+      ok = sid_stream_seek(at[i]) && sid_stream_position() == at[i];
+      sid_get_regs(regs);
+      ok &= memcmp(regs, &played[(size_t)at[i] * SID_NUM_REGS], SID_NUM_REGS) == 0;
+
+      if (!ok) {
+        fprintf(stderr, "seek to frame %u differs\n", at[i]);
+      }
+    }
+  }
+
+  free(played);
+
+  return ok;
+}
+
+static bool check(struct render* r)
+{
+  bool ok = true;
+
+  for (uint32_t k = 0; ok && k < r->n_keys; k++) {
+    ok = spawn(r, k, check_worker);
+  }
+  ok &= wait_all(r);
+
+  return ok && check_seeks(r);
+}
+
+static int write_output(const char* path, const uint8_t* data, size_t size, bool hex)
+{
+  FILE* f = fopen(path, hex ? "w" : "wb");
+
+  if (!f) {
+    perror(path);
+    return -1;
+  }
+
+  if (hex) {
+    for (size_t i = 0; i < size; i++) {
+      fprintf(f, "0x%02x,%s", data[i], (i % 8 == 7 || i + 1 == size) ? "\n" : " ");
+    }
+  } else {
+    fwrite(data, 1, size, f);
+  }
+
+  return fclose(f);
+}
+
+int main(int argc, char** argv)
+{
+  static struct render r;
+  const char* out = NULL;
+  bool hex = false;
+  uint32_t seconds = 180;
+  uint32_t key_seconds = 10;
+  int song = -1;
+  uint64_t start;
+  uint64_t render_ns;
+  uint64_t check_ns;
+  size_t keys_size = 0;
+  int opt;
+
+  jobs = sysconf(_SC_NPROCESSORS_ONLN);
+
+  while ((opt = getopt(argc, argv, "s:n:k:j:o:x")) != -1) {
+    switch (opt) {
+      case 's':
+        seconds = strtoul(optarg, NULL, 0);
+        break;
+      case 'n':
+        song = strtol(optarg, NULL, 0) - 1;
+        break;
+      case 'k':
+        key_seconds = strtoul(optarg, NULL, 0);
+        break;
+      case 'j':
+        jobs = strtol(optarg, NULL, 0);
+        break;
+      case 'o':
+        out = optarg;
+        break;
+      case 'x':
+        hex = true;
+        break;
+      default:
+        fprintf(stderr, "usage: %s [-s seconds] [-n song] [-k keyframe seconds] [-j jobs]"
+                        " [-x] -o out file.sid\n", argv[0]);
+        return 1;
+    }
+  }
+
+  if (!out || argc - optind != 1 || !seconds || !key_seconds || jobs < 1 || jobs > MAX_JOBS) {
+    fprintf(stderr, "need -o, one input file, seconds and keyframe seconds of at least 1"
+                    " and 1 to %d jobs\n", MAX_JOBS);
+    return 1;
+  }
+
+  sid_proto_init(SID_PROTO_MODE_BLOCKING, false);
+
+  r.tune = host_load_file(argv[optind], &r.tune_size);
+  if (!r.tune || !sid_parse_header(r.tune, r.tune_size, &r.info))
+    return 1;
+
+  r.song = song >= 0 ? song : r.info.start_song;
+  r.frames = seconds * sid_clock_frames_per_second(r.info.clock);
+  r.key_frames = key_seconds * sid_clock_frames_per_second(r.info.clock);
+  r.n_keys = (r.frames + r.key_frames - 1) / r.key_frames;
+  r.segments = calloc(r.n_keys, sizeof(*r.segments));
+
+  for (uint32_t k = 0; k < r.n_keys; k++) {
+    r.segments[k].file = tmpfile();
+    if (!r.segments[k].file) {
+      perror("tmpfile");
+      return 1;
+    }
+  }
+
+  start = host_time_ns();
+  if (!render(&r))
+    return 1;
+  render_ns = host_time_ns() - start;
+
+  start = host_time_ns();
+  if (!check(&r))
+    return 1;
+  check_ns = host_time_ns() - start;
+
+  for (uint32_t k = 0; k < r.n_keys; k++) {
+    const uint8_t* key = r.stream.data + r.segments[k].offset;
+    uint16_t n_pages = key[SID_STREAM_KEY_PAGES] | (key[SID_STREAM_KEY_PAGES + 1] << 8);
+
+    keys_size += SID_STREAM_KEY_PAGES + 2 + n_pages * 257;
+  }
+
+  printf("%s song %u: %u frames %s, %u keyframes every %u frames, %d jobs\n",
+         argv[optind], r.song + 1, r.frames, sid_clock_name(r.info.clock), r.n_keys,
+         r.key_frames, jobs);
+  printf("  %zu byte stream, %zu in keyframes, %zu index, %zu tune,"
+         " %.1f bytes per frame without them\n", r.stream.size, keys_size, r.n_keys * 4ul,
+         r.tune_size,
+         (double)(r.stream.size - keys_size - r.n_keys * 4 - r.tune_size - SID_STREAM_KEY_HEADER_SIZE) /
+         r.frames);
+  printf("  rendered in %.1f ms, checked in %.1f ms\n", render_ns / 1e6, check_ns / 1e6);
+
+  return write_output(out, r.stream.data, r.stream.size, hex) < 0;
+}
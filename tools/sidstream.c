@@ -0,0 +1,534 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Runs a tune on the host and streams its register frames to the board, see
+ * sid_live.h.
+ *
+ *   sidstream [-b baud] [-s seconds] [-f fill] [-n song] -d /dev/ttyACM0 file.sid
+ *   sidstream -t [-p ppm] [-e every] [-s seconds] [-f fill] [-n song] file.sid
+ *
+ * -t runs the device side on the host instead, in a child behind a pseudo
+ * terminal with a frame clock that is off by -p parts per million, and
+ * checks the registers it ends with against the emulation. -e damages every
+ * given received byte on the device side. Songs count from 1.
+ *
+ * Frames are sent at the rate the device plays them. Its rate comes from
+ * the ticks in its reports over the host time between them, so the drift
+ * between the two clocks drops out, and the send interval leans a little
+ * towards the target fill: longer when the buffer holds more, shorter when
+ * it holds less. Reports the drift, the fill the device saw and the link
+ * bytes per second.
+ */
+
+#define _GNU_SOURCE
+
+#include "c64.h"
+#include "sid.h"
+#include "sid_proto.h"
+#include "sid_clock.h"
+#include "sid_live.h"
+#include "sid_render.h"
+#include "host.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/wait.h>
+
+/* Share of the fill error taken per frame */
+#define FILL_GAIN       0.02
+
+/* Ticks the rate is measured over before it is used */
+#define MIN_TICKS       20
+
+/* Quiet time after the stop until the device counts as done */
+#define DRAIN_MS        500
+
+struct link
+{
+  int fd;
+  uint8_t seq;
+  uint32_t wire_bytes;
+
+  /* the report parser */
+  struct sid_packet_rx rx;
+};
+
+struct report
+{
+  uint32_t ticks;
+  uint32_t next;
+  uint32_t late;
+  uint32_t underruns;
+  uint32_t lost;
+  uint8_t fill;
+};
+
+struct pacer
+{
+  bool have_first;
+  uint32_t first_ticks;
+  uint64_t first_ns;
+  struct report last;
+  uint64_t last_ns;
+  uint32_t reports;
+  bool stopped;                 /* the fill drains, it is not counted */
+  double period_ns;
+  uint8_t fill_min;
+  uint8_t fill_max;
+  uint64_t fill_sum;
+};
+
+static int device_fd = -1;
+
+void sid_live_send(const uint8_t* data, size_t len)
+{
+  if (write(device_fd, data, len) != (ssize_t)len) {
+    perror("report");
+  }
+}
+
+static uint32_t get_le32(const uint8_t* p)
+{
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static int send_packet(struct link* l, uint8_t type, const uint8_t* data, uint8_t len)
+{
+  uint8_t buf[SID_LIVE_MAX_DATA + SID_PACKET_OVERHEAD];
+  size_t size = sid_packet_build(buf, SID_LIVE_SYNC, type, l->seq++, data, len);
+
+  if (write(l->fd, buf, size) != (ssize_t)size) {
+    perror("write");
+    return -1;
+  }
+  l->wire_bytes += size;
+
+  return 0;
+}
+
+static int send_frame(struct link* l, uint32_t number, const struct sid_render_write* w,
+                      uint32_t n)
+{
+  uint8_t data[4 + SID_LIVE_MAX_WRITES * 2];
+
+  for (int i = 0; i < 4; i++) {
+    data[i] = number >> (i * 8);
+  }
+  for (uint32_t i = 0; i < n; i++) {
+    data[4 + i * 2] = w[i].reg;
+    data[5 + i * 2] = w[i].val;
+  }
+
+  return send_packet(l, SID_LIVE_FRAME, data, 4 + n * 2);
+}
+
+/* A frame with more writes than the device takes keeps the last value of each register */
+static uint32_t coalesce(struct sid_render_write* w, uint32_t n)
+{
+  uint32_t mask = 0;
+  uint8_t regs[SID_NUM_REGS];
+  uint32_t out = 0;
+
+  for (uint32_t i = 0; i < n; i++) {
+    regs[w[i].reg] = w[i].val;
+    mask |= 1U << w[i].reg;
+  }
+
+  for (uint8_t reg = 0; reg < SID_NUM_REGS; reg++) {
+    if (mask & (1U << reg)) {
+      w[out].reg = reg;
+      w[out].val = regs[reg];
+      out++;
+    }
+  }
+
+  return out;
+}
+
+static uint32_t add_refresh(struct sid_render_write* w, uint32_t n)
+{
+  uint8_t regs[SID_NUM_REGS];
+
+  sid_get_regs(regs);
+  for (uint8_t reg = 0; reg < SID_NUM_REGS; reg++) {
+    w[n].reg = reg;
+    w[n].val = regs[reg];
+    n++;
+  }
+
+  return n;
+}
+
+static void take_report(struct pacer* p, const uint8_t* data, uint64_t now)
+{
+  struct report r;
+
+  r.ticks = get_le32(&data[0]);
+  r.next = get_le32(&data[4]);
+  r.late = get_le32(&data[8]);
+  r.underruns = get_le32(&data[12]);
+  r.lost = get_le32(&data[16]);
+  r.fill = data[20];
+
+  if (!p->have_first) {
+    p->have_first = true;
+    p->first_ticks = r.ticks;
+    p->first_ns = now;
+    p->fill_min = r.fill;
+  } else if (r.ticks - p->first_ticks >= MIN_TICKS) {
+    p->period_ns = (double)(now - p->first_ns) / (r.ticks - p->first_ticks);
+  }
+
+  if (!p->stopped) {
+    if (r.fill < p->fill_min) {
+      p->fill_min = r.fill;
+    }
+    if (r.fill > p->fill_max) {
+      p->fill_max = r.fill;
+    }
+    p->fill_sum += r.fill;
+    p->reports++;
+  }
+
+  p->last = r;
+  p->last_ns = now;
+}
+
+/* Reads what the device sent, waiting up to ms */
+static void receive(struct link* l, struct pacer* p, int ms)
+{
+  struct pollfd pfd = { .fd = l->fd, .events = POLLIN };
+  uint8_t buf[256];
+  uint64_t now;
+  ssize_t n;
+
+  if (poll(&pfd, 1, ms) <= 0)
+    return;
+
+  n = read(l->fd, buf, sizeof(buf));
+  if (n <= 0)
+    return;
+  now = host_time_ns();
+
+  for (ssize_t i = 0; i < n; i++) {
+    if (sid_packet_rx_byte(&l->rx, buf[i]) == SID_PACKET_OK &&
+        l->rx.type == SID_LIVE_REPORT && l->rx.len == SID_LIVE_REPORT_SIZE) {
+      take_report(p, l->rx.data, now);
+    }
+  }
+}
+
+/*
+ * The device side, the firmware loop of a live stream with a frame clock of
+ * its own. Frames are played until the stream has ended, then the registers
+ * are compared with the ones the sender ends with.
+ */
+static int device(int fd, int regs_fd, double ppm, uint32_t every)
+{
+  uint8_t buf[256];
+  uint8_t regs[SID_NUM_REGS];
+  uint8_t expect[SID_NUM_REGS];
+  struct sid_live_stats s;
+  uint32_t count = 0;
+  uint64_t tick_ns;
+  uint64_t wait_start;
+  bool started = false;
+  bool ok;
+
+  device_fd = fd;
+
+  sid_proto_init(SID_PROTO_MODE_BLOCKING, false);
+  sid_set_regs((const uint8_t[SID_NUM_REGS]){ 0 });
+  sid_set_clock(SID_CLOCK_PAL);
+  sid_live_reset();
+
+  tick_ns = wait_start = host_time_ns();
+
+  for (;;) {
+    uint8_t clock = started ? sid_live_clock() : SID_CLOCK_PAL;
+    uint64_t now = host_time_ns();
+    struct pollfd pfd = { .fd = fd, .events = POLLIN };
+    ssize_t n;
+
+    if (now < tick_ns) {
+      if (poll(&pfd, 1, (tick_ns - now) / 1000000) > 0) {
+        n = read(fd, buf, sizeof(buf));
+        if (n <= 0)
+          return 1;
+
+        for (ssize_t i = 0; every && i < n; i++) {
+          if (++count % every == 0) {
+            buf[i] ^= 0x10;
+          }
+        }
+
+        if (sid_live_feed(buf, n) != SID_LIVE_IDLE && !started) {
+          started = true;
+          sid_set_clock(sid_live_clock());
+        }
+      }
+      continue;
+    }
+
+    tick_ns += sid_clock_frame_us(clock) * 1000.0 * (1 + ppm / 1e6);
+
+    if (!started) {
+      if (now - wait_start > 5000000000ULL) {
+        fprintf(stderr, "device: no stream\n");
+        return 1;
+      }
+      continue;
+    }
+
+    sid_live_frame();
+    sid_flush();
+
+    if (sid_live_get_state() == SID_LIVE_IDLE)
+      break;
+  }
+
+  sid_get_regs(regs);
+  sid_live_get_stats(&s);
+
+  ok = read(regs_fd, expect, sizeof(expect)) == sizeof(expect) &&
+       memcmp(regs, expect, sizeof(regs)) == 0;
+
+  printf("device: %u frames received, %u played, %u late, %u underruns, %u rebuffers,"
+         " %u overflows, %u crc errors, %u lost, fill %u to %u\n",
+         s.frames, s.played, s.late, s.underruns, s.rebuffers, s.overflows,
+         s.crc_errors, s.lost, s.fill_min == 0xff ? 0 : s.fill_min, s.fill_max);
+  printf("device: registers %s\n", ok ? "match" : "differ");
+
+  return ok ? 0 : 1;
+}
+
+int main(int argc, char** argv)
+{
+  static struct sid_render_write w[SID_RENDER_MAX_WRITES + SID_NUM_REGS];
+  struct link l = { .fd = -1, .rx = { .sync = SID_LIVE_SYNC } };
+  struct pacer p = { 0 };
+  struct sid_info info;
+  const char* path = NULL;
+  bool test = false;
+  uint32_t baud = 921600;
+  uint32_t every = 0;
+  double ppm = 0;
+  double seconds = 30;
+  uint32_t target = SID_LIVE_DEFAULT_TARGET;
+  int song = 0;
+  uint32_t frames;
+  double nominal_ns;
+  uint64_t start;
+  uint64_t next_ns;
+  uint8_t regs[SID_NUM_REGS];
+  int regs_pipe[2] = { -1, -1 };
+  pid_t child = -1;
+  uint8_t* data;
+  size_t size;
+  int status = 0;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "b:d:tp:e:s:f:n:")) != -1) {
+    switch (opt) {
+      case 'b':
+        baud = strtoul(optarg, NULL, 0);
+        break;
+      case 'd':
+        path = optarg;
+        break;
+      case 't':
+        test = true;
+        break;
+      case 'p':
+        ppm = strtod(optarg, NULL);
+        break;
+      case 'e':
+        every = strtoul(optarg, NULL, 0);
+        break;
+      case 's':
+        seconds = strtod(optarg, NULL);
+        break;
+      case 'f':
+        target = strtoul(optarg, NULL, 0);
+        break;
+      case 'n':
+        song = atoi(optarg);
+        break;
+      default:
+        fprintf(stderr, "usage: %s [-b baud] [-s seconds] [-f fill] [-n song]"
+                        " -d device file.sid\n"
+                        "       %s -t [-p ppm] [-e every] [-s seconds] [-f fill] [-n song]"
+                        " file.sid\n", argv[0], argv[0]);
+        return 1;
+    }
+  }
+
+  if (argc - optind != 1 || (!path && !test)) {
+    fprintf(stderr, "one file and a device or -t\n");
+    return 1;
+  }
+
+  if (target < 1 || target >= SID_LIVE_FRAMES || seconds <= 0 || seconds > 3600) {
+    fprintf(stderr, "fill 1 to %u frames, up to an hour\n", SID_LIVE_FRAMES - 1);
+    return 1;
+  }
+
+  data = host_load_file(argv[optind], &size);
+  if (!data)
+    return 1;
+
+  if (test) {
+    int fd = posix_openpt(O_RDWR | O_NOCTTY);
+
+    if (fd < 0 || grantpt(fd) < 0 || unlockpt(fd) < 0 || pipe(regs_pipe) < 0) {
+      perror("pty");
+      return 1;
+    }
+    path = ptsname(fd);
+
+    fflush(stdout);
+    child = fork();
+    if (child == 0) {
+      close(regs_pipe[1]);
+      exit(device(fd, regs_pipe[0], ppm, every));
+    }
+    close(regs_pipe[0]);
+  }
+
+  l.fd = host_open_serial(path, baud);
+  if (l.fd < 0)
+    return 1;
+
+  /* The frames keep the values the tune wrote, the device converts them */
+  sid_proto_init(SID_PROTO_MODE_BLOCKING, false);
+  sid_mute(true);
+  sid_set_regs((const uint8_t[SID_NUM_REGS]){ 0 });
+  c64_init();
+
+  if (!sid_parse_header(data, size, &info) || !sid_load_payload(data, size)) {
+    fprintf(stderr, "%s: not a SID file\n", argv[optind]);
+    return 1;
+  }
+
+  sid_set_clock(info.clock);
+  sid_clock_set(SID_CLOCK_CHIP);
+  c64_cpu_jsr(info.init_addr, song > 0 ? song - 1 : info.start_song);
+  if (info.play_addr == 0) {
+    info.play_addr = (c64_getmem(0x0315) << 8) | c64_getmem(0x0314);
+  }
+  c64_cpu_optimize(info.play_addr, NULL);
+  sid_mute(false);
+
+  sid_get_regs(regs);
+  sid_render_start(regs);
+
+  nominal_ns = sid_clock_frame_us(info.clock) * 1000.0;
+  p.period_ns = nominal_ns;
+  frames = seconds * 1e9 / nominal_ns;
+
+  printf("%s: %s, %u frames, fill target %u%s\n", argv[optind], sid_clock_name(info.clock),
+         frames, target, test ? ", device on the host" : "");
+
+  if (send_packet(&l, SID_LIVE_START, (const uint8_t[]){ info.clock, target }, 2) < 0)
+    return 1;
+
+  start = next_ns = host_time_ns();
+
+  for (uint32_t frame = 0; frame < frames; frame++) {
+    uint32_t n;
+
+    /* The first frames fill the buffer at once, then one per device tick */
+    while (frame >= target) {
+      uint64_t now = host_time_ns();
+
+      if (now >= next_ns)
+        break;
+      receive(&l, &p, (next_ns - now + 999999) / 1000000);
+    }
+    receive(&l, &p, 0);
+
+    if (frame == 0) {
+      n = add_refresh(w, 0);
+    } else {
+      sid_render_frame(info.play_addr);
+      memcpy(w, sid_render_writes, sid_render_n_writes * sizeof(w[0]));
+      n = sid_render_n_writes;
+
+      if (n > SID_LIVE_MAX_WRITES) {
+        n = coalesce(w, n);
+      }
+      if (frame % SID_LIVE_REFRESH_FRAMES == 0 && n + SID_NUM_REGS <= SID_LIVE_MAX_WRITES) {
+        n = add_refresh(w, n);
+      }
+    }
+
+    if (send_frame(&l, frame, w, n) < 0)
+      return 1;
+
+    if (frame + 1 >= target) {
+      double fill = target;
+      double factor;
+
+      /* The frames the device has not played, from its last report on */
+      if (p.reports) {
+        fill = frame + 1 - (p.last.next + (host_time_ns() - p.last_ns) / p.period_ns);
+      }
+
+      factor = 1 + FILL_GAIN * (fill - target);
+      factor = factor < 0.5 ? 0.5 : factor > 1.5 ? 1.5 : factor;
+      next_ns += p.period_ns * factor;
+    }
+  }
+
+  /* The last frame once more so it is not lost, then the stop */
+  {
+    uint32_t n = add_refresh(w, 0);
+
+    for (int i = 0; i < 2; i++) {
+      send_frame(&l, frames, w, n);
+    }
+    for (int i = 0; i < 3; i++) {
+      send_packet(&l, SID_LIVE_STOP, NULL, 0);
+    }
+  }
+  p.stopped = true;
+
+  for (uint64_t last = host_time_ns(); host_time_ns() - last < DRAIN_MS * 1000000ULL;) {
+    uint64_t seen = p.last_ns;
+
+    receive(&l, &p, DRAIN_MS / 10);
+    if (p.last_ns != seen) {
+      last = host_time_ns();
+    }
+  }
+
+  {
+    double secs = (host_time_ns() - start) / 1e9;
+
+    printf("%u bytes in %.1f s, %.0f bytes/s, %.1f%% of %u baud\n", l.wire_bytes, secs,
+           l.wire_bytes / secs, l.wire_bytes * 10 / secs * 100 / baud, baud);
+    printf("device frame %.1f us, %+.0f ppm from %s\n", p.period_ns / 1000,
+           (p.period_ns / nominal_ns - 1) * 1e6, sid_clock_name(info.clock));
+    printf("%u reports: fill %u / %.1f / %u, %u late, %u underruns, %u lost\n", p.reports,
+           p.fill_min, p.reports ? (double)p.fill_sum / p.reports : 0, p.fill_max,
+           p.last.late, p.last.underruns, p.last.lost);
+  }
+
+  if (test) {
+    fflush(stdout);
+    sid_get_regs(regs);
+    if (write(regs_pipe[1], regs, sizeof(regs)) != sizeof(regs)) {
+      perror("pipe");
+    }
+    waitpid(child, &status, 0);
+    status = WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+  }
+
+  return status;
+}
@@ -0,0 +1,287 @@
+/*
+ * Copyright (c) 2020 Erwin Rol <erwin@erwinrol.com
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Uploads a SID file to the board over a serial port, see sid_upload.h.
+ *
+ *   sidupload [-b baud] -d /dev/ttyACM0 file.sid
+ *   sidupload -t [-b baud] [-e every] file.sid
+ *
+ * -t runs the device side on the host instead, behind a pseudo terminal, and
+ * checks the memory it loaded and the first note against a normal load. -e
+ * damages every given received byte on the device side, to exercise the
+ * resends. Reports the throughput, the time to the first note and the time
+ * the bytes take on a real link at the given baud rate.
+ */
+
+#define _GNU_SOURCE
+
+#include "c64.h"
+#include "sid.h"
+#include "sid_proto.h"
+#include "sid_upload.h"
+#include "host.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+
+#define REPLY_MS        200
+#define MAX_TRIES       10
+
+struct sender_stats
+{
+  uint32_t packets;
+  uint32_t wire_bytes;
+  uint32_t resends;
+};
+
+struct device
+{
+  int fd;
+  uint32_t every;               /* damage every n-th byte, 0 for none */
+  uint8_t reference[65536];
+  uint64_t start_ns;
+  uint64_t ready_ns;
+  uint64_t first_note_ns;
+  uint8_t regs[SID_NUM_REGS];   /* after the first play call */
+  bool memory_ok;
+};
+
+static int device_fd = -1;
+
+void sid_upload_reply(uint8_t reply)
+{
+  if (write(device_fd, &reply, 1) != 1) {
+    perror("reply");
+  }
+}
+
+static int send_packet(int fd, uint8_t type, uint8_t seq, const uint8_t* data,
+                       uint8_t len, struct sender_stats* stats)
+{
+  uint8_t buf[SID_UPLOAD_MAX_DATA + SID_PACKET_OVERHEAD];
+  size_t size = sid_packet_build(buf, SID_UPLOAD_SYNC, type, seq, data, len);
+
+  stats->packets++;
+
+  for (int tries = 0; tries < MAX_TRIES; tries++) {
+    struct pollfd pfd = { .fd = fd, .events = POLLIN };
+    uint8_t reply;
+
+    if (tries) {
+      stats->resends++;
+    }
+
+    if (write(fd, buf, size) != (ssize_t)size) {
+      perror("write");
+      return -1;
+    }
+    stats->wire_bytes += size + 1;
+
+    if (poll(&pfd, 1, REPLY_MS) <= 0 || read(fd, &reply, 1) != 1)
+      continue;
+
+    if (reply == SID_UPLOAD_ACK)
+      return 0;
+
+    if (reply == SID_UPLOAD_REJECT) {
+      fprintf(stderr, "the device rejected packet %u\n", stats->packets);
+      return -1;
+    }
+  }
+
+  fprintf(stderr, "packet %u failed %d times\n", stats->packets, MAX_TRIES);
+  return -1;
+}
+
+static int send_file(int fd, const uint8_t* data, size_t size, struct sender_stats* stats)
+{
+  uint8_t begin[4] = { size, size >> 8, size >> 16, size >> 24 };
+  uint8_t seq = 0;
+
+  if (send_packet(fd, SID_UPLOAD_BEGIN, seq++, begin, sizeof(begin), stats) < 0)
+    return -1;
+
+  for (size_t pos = 0; pos < size; pos += SID_UPLOAD_MAX_DATA) {
+    size_t len = size - pos < SID_UPLOAD_MAX_DATA ? size - pos : SID_UPLOAD_MAX_DATA;
+
+    if (send_packet(fd, SID_UPLOAD_DATA, seq++, &data[pos], len, stats) < 0)
+      return -1;
+  }
+
+  return 0;
+}
+
+/* The firmware loop while an upload is running, and its first frame */
+static void* device_thread(void* arg)
+{
+  struct device* dev = arg;
+  uint8_t buf[SID_UPLOAD_MAX_DATA + 5];
+  uint8_t mem[65536];
+  uint32_t count = 0;
+  struct sid_info info;
+
+  while (sid_upload_get_state() != SID_UPLOAD_READY) {
+    struct pollfd pfd = { .fd = dev->fd, .events = POLLIN };
+    ssize_t n;
+
+    if (poll(&pfd, 1, SID_UPLOAD_TIMEOUT_MS) <= 0)
+      return NULL;
+
+    n = read(dev->fd, buf, sizeof(buf));
+    if (n <= 0)
+      return NULL;
+
+    if (!dev->start_ns) {
+      dev->start_ns = host_time_ns();
+    }
+
+    for (ssize_t i = 0; dev->every && i < n; i++) {
+      if (++count % dev->every == 0) {
+        buf[i] ^= 0x10;
+      }
+    }
+
+    sid_upload_feed(buf, n);
+  }
+
+  dev->ready_ns = host_time_ns();
+
+  c64_memread(mem, 0, sizeof(mem));
+  dev->memory_ok = memcmp(mem, dev->reference, sizeof(mem)) == 0;
+
+  info = *sid_upload_info();
+  sid_upload_reset();
+
+  c64_cpu_jsr(info.init_addr, info.start_song);
+  if (info.play_addr == 0) {
+    info.play_addr = (c64_getmem(0x0315) << 8) | c64_getmem(0x0314);
+  }
+  c64_cpu_optimize(info.play_addr, NULL);
+  c64_cpu_jsr(info.play_addr, 0);
+  sid_flush();
+
+  dev->first_note_ns = host_time_ns();
+  sid_get_regs(dev->regs);
+
+  return NULL;
+}
+
+int main(int argc, char** argv)
+{
+  static struct device dev;
+  struct sender_stats stats = { 0 };
+  const char* path = NULL;
+  bool test = false;
+  uint32_t baud = 921600;
+  uint64_t start;
+  uint64_t ns;
+  size_t size;
+  uint8_t* data;
+  pthread_t thread;
+  int fd;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "b:d:te:")) != -1) {
+    switch (opt) {
+      case 'b':
+        baud = strtoul(optarg, NULL, 0);
+        break;
+      case 'd':
+        path = optarg;
+        break;
+      case 't':
+        test = true;
+        break;
+      case 'e':
+        dev.every = strtoul(optarg, NULL, 0);
+        break;
+      default:
+        fprintf(stderr, "usage: %s [-b baud] -d device file.sid\n"
+                        "       %s -t [-b baud] [-e every] file.sid\n", argv[0], argv[0]);
+        return 1;
+    }
+  }
+
+  if (argc - optind != 1 || (!path && !test)) {
+    fprintf(stderr, "one file and a device or -t\n");
+    return 1;
+  }
+
+  data = host_load_file(argv[optind], &size);
+  if (!data)
+    return 1;
+
+  if (test) {
+    fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (fd < 0 || grantpt(fd) < 0 || unlockpt(fd) < 0) {
+      perror("pty");
+      return 1;
+    }
+    path = ptsname(fd);
+
+    /* What a normal load puts in memory */
+    sid_proto_init(SID_PROTO_MODE_BLOCKING, false);
+    c64_init();
+    sid_mute(true);
+    sid_load_payload(data, size);
+    c64_memread(dev.reference, 0, sizeof(dev.reference));
+    sid_mute(false);
+
+    device_fd = dev.fd = fd;
+    pthread_create(&thread, NULL, device_thread, &dev);
+  }
+
+  fd = host_open_serial(path, baud);
+  if (fd < 0)
+    return 1;
+
+  start = host_time_ns();
+  if (send_file(fd, data, size, &stats) < 0)
+    return 1;
+  ns = host_time_ns() - start;
+
+  printf("%s: %zu bytes in %u packets, %u resends, %.1f ms, %.1f KB/s\n",
+         argv[optind], size, stats.packets, stats.resends, ns / 1e6, size / (ns / 1e9) / 1024);
+  printf("  %u bytes on the wire, %.1f ms at %u baud\n",
+         stats.wire_bytes, stats.wire_bytes * 10.0 * 1000 / baud, baud);
+
+  if (test) {
+    struct sid_upload_stats up;
+    struct sid_info info;
+    uint8_t regs[SID_NUM_REGS];
+    bool note_ok;
+
+    pthread_join(thread, NULL);
+    sid_upload_get_stats(&up);
+
+    /* The first note of a normal load */
+    sid_mute(true);
+    sid_set_regs((const uint8_t[SID_NUM_REGS]){ 0 });
+    c64_init();
+    sid_load_from_memory(data, size, &info);
+    c64_cpu_jsr(info.init_addr, info.start_song);
+    c64_cpu_jsr(info.play_addr, 0);
+    sid_get_regs(regs);
+    note_ok = memcmp(regs, dev.regs, sizeof(regs)) == 0;
+
+    printf("  device: %u packets, %u crc errors, %u duplicates, %u rejects\n",
+           up.packets, up.crc_errors, up.duplicates, up.rejects);
+    printf("  ready after %.2f ms, first note after %.2f ms, memory %s, first note %s\n",
+           (dev.ready_ns - dev.start_ns) / 1e6, (dev.first_note_ns - dev.start_ns) / 1e6,
+           dev.memory_ok ? "ok" : "DIFFERS", note_ok ? "ok" : "DIFFERS");
+
+    if (!dev.memory_ok || !note_ok)
+      return 1;
+  }
+
+  free(data);
+
+  return 0;
+}